@@ -0,0 +1,166 @@
+// -*- mode: c++; tab-width: 4; indent-tabs-mode: t; c-file-style: "stroustrup"; -*-
+// vi:set ts=4 sts=4 sw=4 noet cino+=(0 :
+// Copyright 2026, The TPIE development team
+//
+// This file is part of TPIE.
+//
+// TPIE is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// TPIE is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with TPIE.  If not, see <http://www.gnu.org/licenses/>
+
+// Benchmark of the hash function families on several key sets. For each
+// function it reports the hashing throughput, the lookup throughput of a
+// hash_map using it, and how evenly it spreads the keys: the number of
+// colliding pairs of keys in a table of 2^16 buckets (indexed by low bits,
+// high bits and modulo a prime) relative to a random function, where 1.0
+// is ideal, and the number of full-width collisions.
+
+#include <tpie/tpie.h>
+#include <tpie/hash.h>
+#include <tpie/hash_map.h>
+#include <tpie/unittest.h>
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace tpie;
+
+namespace {
+
+template <typename T>
+struct std_hash {
+	size_t operator()(const T & e) const {return std::hash<T>()(e);}
+};
+
+template <typename T1, typename T2>
+struct std_hash<std::pair<T1,T2> > {
+	size_t operator()(const std::pair<T1,T2> & e) const {
+		return std::hash<T1>()(e.first) * 31 + std::hash<T2>()(e.second);
+	}
+};
+
+const size_t bucket_bits = 16;
+const size_t bucket_prime = 65521;
+
+// Colliding pairs of keys over the number expected from a random function.
+double collision_ratio(const std::vector<size_t> & buckets, size_t keys) {
+	double pairs = 0;
+	for (size_t c : buckets) pairs += 0.5 * static_cast<double>(c) * static_cast<double>(c - (c > 0));
+	double expected = 0.5 * static_cast<double>(keys) * static_cast<double>(keys - 1)
+		/ static_cast<double>(buckets.size());
+	return pairs / expected;
+}
+
+template <typename T, typename hash_t>
+void run(const std::string & keySet, const std::string & family, const std::vector<T> & keys, size_t repeats) {
+	hash_t h;
+	std::vector<size_t> hashes(keys.size());
+
+	test_time start = test_now();
+	size_t x = 0;
+	for (size_t r = 0; r < repeats; ++r)
+		for (size_t i = 0; i < keys.size(); ++i) x ^= h(keys[i]) + r;
+	double hashSecs = test_secs(start, test_now());
+	for (size_t i = 0; i < keys.size(); ++i) hashes[i] = h(keys[i]);
+
+	std::vector<size_t> low(size_t(1) << bucket_bits), high(size_t(1) << bucket_bits), prime(bucket_prime);
+	for (size_t v : hashes) {
+		++low[v & (low.size() - 1)];
+		++high[v >> (8 * sizeof(size_t) - bucket_bits)];
+		++prime[v % bucket_prime];
+	}
+	std::sort(hashes.begin(), hashes.end());
+	size_t full = static_cast<size_t>(hashes.end() - std::unique(hashes.begin(), hashes.end()));
+
+	hash_map<T, size_t, hash_t> m(keys.size());
+	for (size_t i = 0; i < keys.size(); ++i) m[keys[i]] = i;
+	start = test_now();
+	for (size_t r = 0; r < repeats; ++r)
+		for (size_t i = 0; i < keys.size(); ++i) x ^= m.find(keys[i])->second;
+	double findSecs = test_secs(start, test_now());
+
+	double ops = static_cast<double>(keys.size() * repeats) / 1e6;
+	std::cout << std::left << std::setw(10) << keySet << std::setw(8) << family << std::right
+			  << std::fixed << std::setprecision(1)
+			  << std::setw(10) << ops / hashSecs
+			  << std::setw(10) << ops / findSecs
+			  << std::setprecision(3)
+			  << std::setw(10) << collision_ratio(low, keys.size())
+			  << std::setw(10) << collision_ratio(high, keys.size())
+			  << std::setw(10) << collision_ratio(prime, keys.size())
+			  << std::setw(10) << full
+			  << (x == 42 ? " " : "") << std::endl;
+}
+
+template <typename T>
+void run_families(const std::string & keySet, const std::vector<T> & keys, size_t repeats) {
+	run<T, tpie::hash<T> >(keySet, "tpie", keys, repeats);
+	run<T, fast_hash<T> >(keySet, "fast", keys, repeats);
+	run<T, std_hash<T> >(keySet, "std", keys, repeats);
+}
+
+std::string random_string(std::mt19937_64 & rng, size_t length) {
+	std::string s(length, ' ');
+	for (size_t i = 0; i < length; ++i) s[i] = static_cast<char>('a' + rng() % 26);
+	return s;
+}
+
+void usage() {
+	std::cout << "Parameters: [keys] [repeats]" << std::endl;
+}
+
+} // unnamed namespace
+
+int main(int argc, char ** argv) {
+	size_t n = 1 << 20;
+	size_t repeats = 10;
+	if (argc > 1) {
+		std::stringstream(argv[1]) >> n;
+		if (!n) {usage(); return EXIT_FAILURE;}
+	}
+	if (argc > 2) std::stringstream(argv[2]) >> repeats;
+	if (!repeats) {usage(); return EXIT_FAILURE;}
+
+	tpie_init();
+	std::cout << n << " keys, " << repeats << " repeats" << std::endl;
+	std::cout << std::left << std::setw(10) << "keys" << std::setw(8) << "hash" << std::right
+			  << std::setw(10) << "Mhash/s" << std::setw(10) << "Mfind/s"
+			  << std::setw(10) << "low" << std::setw(10) << "high" << std::setw(10) << "prime"
+			  << std::setw(10) << "full" << std::endl;
+
+	std::mt19937_64 rng(42);
+	std::vector<uint64_t> ints(n);
+	for (size_t i = 0; i < n; ++i) ints[i] = i;
+	run_families("dense", ints, repeats);
+	for (size_t i = 0; i < n; ++i) ints[i] = i << 12;
+	run_families("strided", ints, repeats);
+	for (size_t i = 0; i < n; ++i) ints[i] = rng();
+	run_families("random", ints, repeats);
+
+	std::vector<std::pair<uint32_t, uint32_t> > pairs(n);
+	for (size_t i = 0; i < n; ++i) pairs[i] = std::make_pair(static_cast<uint32_t>(i >> 10), static_cast<uint32_t>(i & 1023));
+	run_families("pairs", pairs, repeats);
+
+	std::vector<std::string> strings(n);
+	for (size_t i = 0; i < n; ++i) strings[i] = "key" + std::to_string(i);
+	run_families("short", strings, repeats);
+	for (size_t i = 0; i < n; ++i) strings[i] = random_string(rng, 16 + rng() % 112);
+	run_families("long", strings, repeats);
+
+	tpie_finish();
+	return EXIT_SUCCESS;
+}
@@ -26,6 +26,9 @@
 #include "testtime.h"
 #include "stat.h"
 #include <tpie/priority_queue.h>
+#include <tpie/internal_priority_queue.h>
+#include <tpie/internal_sequence_heap.h>
+#include <tpie/radix_heap.h>
 #include "testinfo.h"
 #include <random>
 #include <tpie/types.h>
@@ -37,7 +40,10 @@ using namespace tpie::test;
 const size_t mb_default=1;
 
 void usage() {
-	std::cout << "Parameters: [times] [mb]" << std::endl;
+	std::cout << "Parameters: [-s] [-i] [-r] [times] [mb] [blockFactor]\n"
+			  << "  -s  Use segments instead of integers\n"
+			  << "  -i  Compare the internal priority queue layouts\n"
+			  << "  -r  Compare the radix heap to the priority queue on monotone keys" << std::endl;
 }
 
 struct intgenerator {
@@ -98,17 +104,119 @@ void test(Generator g, size_t mb, size_t times, float blockFactor = 0.125f) {
 	if (a == g()) std::cout << "oh rly" << std::endl;
 }
 
+// Push count items into an internal priority queue and pop them again,
+// recording the time of each phase.
+template <typename PQ, typename Generator>
+void test_internal_queue(Generator & g, typename Generator::item_type & a,
+						 memory_size_type count, tpie::test::stat & s) {
+	typedef typename Generator::item_type test_t;
+	test_realtime_t start;
+	test_realtime_t end;
+	PQ pq(count);
+	getTestRealtime(start);
+	for (memory_size_type i = 0; i < count; ++i) pq.push(g());
+	getTestRealtime(end);
+	s(testRealtimeDiff(start, end));
+
+	getTestRealtime(start);
+	for (memory_size_type i = 0; i < count; ++i) {
+		test_t x = pq.top();
+		pq.pop();
+		g.use(a, x);
+	}
+	getTestRealtime(end);
+	s(testRealtimeDiff(start, end));
+}
+
+template <typename Generator>
+void test_internal(Generator g, size_t mb, size_t times) {
+	typedef typename Generator::item_type test_t;
+	test_t a = test_t();
+
+	std::vector<const char *> names = {
+		"Binary push", "Binary pop",
+		"4-ary push", "4-ary pop",
+		"8-ary push", "8-ary pop",
+		"Sequence push", "Sequence pop"};
+
+	tpie::test::stat s(names);
+	memory_size_type count = static_cast<memory_size_type>(mb)*1024*1024/sizeof(test_t);
+	for (size_t i = 0; i < times; ++i) {
+		test_internal_queue<internal_priority_queue<test_t, std::less<test_t>, binary_heap> >(g, a, count, s);
+		test_internal_queue<internal_priority_queue<test_t, std::less<test_t>, dary_heap<4> > >(g, a, count, s);
+		test_internal_queue<internal_priority_queue<test_t, std::less<test_t>, dary_heap<8> > >(g, a, count, s);
+		test_internal_queue<internal_sequence_heap<test_t> >(g, a, count, s);
+	}
+	if (a == g()) std::cout << "oh rly" << std::endl;
+}
+
+// Dijkstra-like workload: pop the minimum and push two keys a random integer
+// weight above it.
+template <typename PQ>
+void test_monotone_queue(PQ & pq, memory_size_type count, tpie::uint64_t & a, tpie::test::stat & s) {
+	std::mt19937_64 rnd(42);
+	test_realtime_t start;
+	test_realtime_t end;
+	getTestRealtime(start);
+	for (memory_size_type i = 0; i < count; ++i) pq.push(rnd() % 1000000);
+	getTestRealtime(end);
+	s(testRealtimeDiff(start, end));
+
+	getTestRealtime(start);
+	for (memory_size_type i = 0; i < count; ++i) {
+		tpie::uint64_t x = pq.top();
+		pq.pop();
+		a ^= x;
+		pq.push(x + rnd() % 1000);
+		if (i % 2 == 0) pq.push(x + rnd() % 1000);
+	}
+	while (!pq.empty()) {
+		a ^= pq.top();
+		pq.pop();
+	}
+	getTestRealtime(end);
+	s(testRealtimeDiff(start, end));
+}
+
+void test_monotone(size_t mb, size_t times, float blockFactor) {
+	std::vector<const char *> names = {
+		"PQ fill", "PQ run",
+		"Radix fill", "Radix run"};
+
+	tpie::test::stat s(names);
+	memory_size_type count = static_cast<memory_size_type>(mb)*1024*1024/sizeof(tpie::uint64_t);
+	memory_size_type memory = get_memory_manager().available() / 2;
+	tpie::uint64_t a = 0;
+	for (size_t i = 0; i < times; ++i) {
+		{
+			tpie::priority_queue<tpie::uint64_t> pq(memory, blockFactor);
+			test_monotone_queue(pq, count, a, s);
+		}
+		{
+			radix_heap<tpie::uint64_t> pq(memory, blockFactor);
+			test_monotone_queue(pq, count, a, s);
+		}
+	}
+	if (a == 42) std::cout << "oh rly" << std::endl;
+}
+
 int main(int argc, char **argv) {
 	size_t times = 10;
 	size_t mb = mb_default;
 	float blockFactor = 0.125;
 	bool segments = false;
+	bool internal = false;
+	bool monotone = false;
 
 	int i;
 	for (i = 1; i < argc; ++i) {
 		std::string arg(argv[i]);
 		if (arg == "-s") {
 			segments = true;
+		} else if (arg == "-i") {
+			internal = true;
+		} else if (arg == "-r") {
+			monotone = true;
 		} else {
 			break;
 		}
@@ -141,6 +249,25 @@ int main(int argc, char **argv) {
 		++i;
 	}
 
+	if (internal) {
+		testinfo t("Internal priority queue speed test", 1024, mb, times);
+		if (segments) {
+			sysinfo().printinfo("Item type", "segments");
+			test_internal(segmentgenerator(), mb, times);
+		} else {
+			sysinfo().printinfo("Item type", "64-bit integers");
+			test_internal(intgenerator(), mb, times);
+		}
+		return EXIT_SUCCESS;
+	}
+
+	if (monotone) {
+		testinfo t("Monotone priority queue speed test", 1024, mb, times);
+		sysinfo().printinfo("Block factor", blockFactor);
+		test_monotone(mb, times, blockFactor);
+		return EXIT_SUCCESS;
+	}
+
 	testinfo t("Priority queue speed test", 1024, mb, times);
 	sysinfo().printinfo("Block factor", blockFactor);
 	if (segments) {
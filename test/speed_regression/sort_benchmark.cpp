@@ -0,0 +1,513 @@
+// -*- mode: c++; tab-width: 4; indent-tabs-mode: t; c-file-style: "stroustrup"; -*-
+// vi:set ts=4 sts=4 sw=4 noet :
+// Copyright 2026, The TPIE development team
+//
+// This file is part of TPIE.
+//
+// TPIE is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// TPIE is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with TPIE.  If not, see <http://www.gnu.org/licenses/>
+
+// Benchmark of TPIE's sorters on several key distributions and item sizes.
+// Results are written as JSON with the time and I/O volume of each phase.
+
+#include "blocksize_2MB.h"
+
+#include <tpie/tpie.h>
+#include <tpie/file_stream.h>
+#include <tpie/sort.h>
+#include <tpie/parallel_sort.h>
+#include <tpie/serialization_sorter.h>
+#include <tpie/pipelining.h>
+#include <tpie/pipelining/sort.h>
+#include <tpie/progress_indicator_null.h>
+#include <tpie/jsonprint.h>
+#include <tpie/stats.h>
+#include <tpie/unittest.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+
+using namespace tpie;
+
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////
+// Items
+///////////////////////////////////////////////////////////////////////////////
+
+// Fixed-size record ordered by its key. The payload is derived from the key
+// so that records with equal keys are equal.
+template <size_t N>
+struct record {
+	uint64_t key;
+	char payload[N - sizeof(uint64_t)];
+
+	bool operator<(const record & other) const {
+		return key < other.key;
+	}
+};
+
+template <typename T>
+struct item_traits;
+
+template <>
+struct item_traits<uint64_t> {
+	static std::string name() { return "uint64"; }
+	static uint64_t make(uint64_t key) { return key; }
+	static size_t size(const uint64_t &) { return sizeof(uint64_t); }
+};
+
+template <size_t N>
+struct item_traits<record<N> > {
+	static std::string name() { return "record" + std::to_string(N); }
+	static record<N> make(uint64_t key) {
+		record<N> r;
+		r.key = key;
+		std::memset(r.payload, static_cast<int>(key & 0xff), sizeof(r.payload));
+		return r;
+	}
+	static size_t size(const record<N> &) { return N; }
+};
+
+// Variable-length strings of 20 to 83 characters that compare like their
+// keys: a zero-padded key followed by a filler whose length depends on the
+// key.
+template <>
+struct item_traits<std::string> {
+	static std::string name() { return "string"; }
+	static std::string make(uint64_t key) {
+		std::ostringstream ss;
+		ss << std::setw(20) << std::setfill('0') << key
+		   << std::string(static_cast<size_t>(key % 64), 'x');
+		return ss.str();
+	}
+	static size_t size(const std::string & s) { return s.size(); }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Key distributions
+///////////////////////////////////////////////////////////////////////////////
+
+class key_generator {
+public:
+	key_generator(const std::string & distribution, stream_size_type items)
+		: m_distribution(distribution)
+		, m_items(items)
+		, m_index(0)
+		, m_rng(42)
+	{
+		if (m_distribution == "zipf") {
+			// Zipf distribution with exponent 1 over 2^20 ranks.
+			const size_t ranks = 1 << 20;
+			m_zipf.resize(ranks);
+			double sum = 0;
+			for (size_t i = 0; i < ranks; ++i) {
+				sum += 1.0 / static_cast<double>(i + 1);
+				m_zipf[i] = sum;
+			}
+			for (size_t i = 0; i < ranks; ++i) m_zipf[i] /= sum;
+		}
+	}
+
+	static const std::vector<std::string> & distributions() {
+		static const std::vector<std::string> d = {
+			"uniform", "sorted", "reverse", "few_distinct", "zipf"};
+		return d;
+	}
+
+	uint64_t operator()() {
+		stream_size_type i = m_index++;
+		if (m_distribution == "sorted") return i;
+		if (m_distribution == "reverse") return m_items - i;
+		if (m_distribution == "few_distinct") return m_rng() % 16;
+		if (m_distribution == "zipf") {
+			double u = std::uniform_real_distribution<double>(0, 1)(m_rng);
+			uint64_t rank = static_cast<uint64_t>(
+				std::lower_bound(m_zipf.begin(), m_zipf.end(), u) - m_zipf.begin());
+			// Scatter the ranks so frequent keys are not all small.
+			return rank * 0x9E3779B97F4A7C15ull;
+		}
+		return (static_cast<uint64_t>(m_rng()) << 32) | m_rng();
+	}
+
+private:
+	std::string m_distribution;
+	stream_size_type m_items;
+	stream_size_type m_index;
+	std::mt19937 m_rng;
+	std::vector<double> m_zipf;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Results
+///////////////////////////////////////////////////////////////////////////////
+
+struct phase_result {
+	std::string name;
+	double seconds;
+	stream_size_type bytesRead;
+	stream_size_type bytesWritten;
+};
+
+struct run_result {
+	std::string sorter;
+	std::string distribution;
+	std::string item;
+	memory_size_type memory;
+	stream_size_type items;
+	stream_size_type bytes;
+	bool sorted;
+	std::string error;
+	std::vector<phase_result> phases;
+};
+
+// Measures the wall clock time and I/O volume between begin() and end().
+class phase_timer {
+public:
+	phase_timer(run_result & result) : m_result(result) {}
+
+	void begin(const std::string & name) {
+		m_name = name;
+		m_bytesRead = get_bytes_read();
+		m_bytesWritten = get_bytes_written();
+		m_start = test_now();
+	}
+
+	void end() {
+		phase_result p;
+		p.name = m_name;
+		p.seconds = test_secs(m_start, test_now());
+		p.bytesRead = get_bytes_read() - m_bytesRead;
+		p.bytesWritten = get_bytes_written() - m_bytesWritten;
+		m_result.phases.push_back(p);
+	}
+
+private:
+	run_result & m_result;
+	std::string m_name;
+	stream_size_type m_bytesRead;
+	stream_size_type m_bytesWritten;
+	test_time m_start;
+};
+
+void print_results(std::ostream & out, const std::vector<run_result> & results) {
+	JSONReflector r(out, true);
+	r.begin("sort_benchmark");
+	r.name("runs");
+	r.beginArray(results.size());
+	for (const run_result & res : results) {
+		r.begin("run");
+		r.name("sorter"); r(res.sorter);
+		r.name("distribution"); r(res.distribution);
+		r.name("item"); r(res.item);
+		r.name("memory"); r(static_cast<uint64_t>(res.memory));
+		r.name("items"); r(static_cast<uint64_t>(res.items));
+		r.name("bytes"); r(static_cast<uint64_t>(res.bytes));
+		r.name("sorted"); r(res.sorted);
+		if (!res.error.empty()) {
+			r.name("error"); r(res.error);
+		}
+		r.name("phases");
+		r.beginArray(res.phases.size());
+		for (const phase_result & p : res.phases) {
+			r.begin("phase");
+			r.name("name"); r(p.name);
+			r.name("seconds"); r(p.seconds);
+			r.name("bytes_read"); r(static_cast<uint64_t>(p.bytesRead));
+			r.name("bytes_written"); r(static_cast<uint64_t>(p.bytesWritten));
+			r.end();
+		}
+		r.endArray();
+		r.end();
+	}
+	r.endArray();
+	r.end();
+	out << std::endl;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Sorters
+///////////////////////////////////////////////////////////////////////////////
+
+// Limit the memory available to the sorter to the given amount on top of
+// what is in use, for the lifetime of the object.
+class memory_limit {
+public:
+	memory_limit(memory_size_type memory)
+		: m_oldLimit(get_memory_manager().limit())
+	{
+		get_memory_manager().set_limit(get_memory_manager().used() + memory);
+	}
+
+	~memory_limit() {
+		get_memory_manager().set_limit(m_oldLimit);
+	}
+
+private:
+	memory_size_type m_oldLimit;
+};
+
+template <typename T>
+void write_input(file_stream<T> & fs, key_generator & gen, stream_size_type items) {
+	for (stream_size_type i = 0; i < items; ++i)
+		fs.write(item_traits<T>::make(gen()));
+}
+
+template <typename T>
+bool verify_output(file_stream<T> & fs, stream_size_type items) {
+	fs.seek(0);
+	if (fs.size() != items) return false;
+	if (!fs.can_read()) return true;
+	T prev = fs.read();
+	while (fs.can_read()) {
+		T cur = fs.read();
+		if (cur < prev) return false;
+		prev = cur;
+	}
+	return true;
+}
+
+template <typename T>
+void run_tpie_sort(run_result & res, key_generator & gen, memory_size_type memory) {
+	phase_timer t(res);
+	file_stream<T> fs;
+	fs.open();
+	t.begin("write");
+	write_input(fs, gen, res.items);
+	t.end();
+	t.begin("sort");
+	{
+		memory_limit limit(memory);
+		progress_indicator_null pi;
+		tpie::sort(fs, std::less<T>(), pi);
+	}
+	t.end();
+	t.begin("verify");
+	res.sorted = verify_output(fs, res.items);
+	t.end();
+}
+
+template <typename T>
+void run_pipelining_sort(run_result & res, key_generator & gen, memory_size_type memory) {
+	phase_timer t(res);
+	file_stream<T> in;
+	file_stream<T> out;
+	in.open();
+	out.open();
+	t.begin("write");
+	write_input(in, gen, res.items);
+	in.seek(0);
+	t.end();
+	t.begin("sort");
+	{
+		pipelining::pipeline p = pipelining::input(in) | pipelining::sort() | pipelining::output(out);
+		progress_indicator_null pi;
+		p(res.items, pi, memory, TPIE_FSI);
+	}
+	t.end();
+	t.begin("verify");
+	res.sorted = verify_output(out, res.items);
+	t.end();
+}
+
+template <typename T>
+void run_serialization_sort(run_result & res, key_generator & gen, memory_size_type memory) {
+	phase_timer t(res);
+	serialization_sorter<T> s;
+	s.set_available_memory(memory);
+	t.begin("runs");
+	s.begin();
+	for (stream_size_type i = 0; i < res.items; ++i)
+		s.push(item_traits<T>::make(gen()));
+	s.end();
+	t.end();
+	t.begin("merge");
+	s.merge_runs();
+	t.end();
+	t.begin("output");
+	bool sorted = true;
+	stream_size_type n = 0;
+	T prev = T();
+	while (s.can_pull()) {
+		T cur = s.pull();
+		if (n > 0 && cur < prev) sorted = false;
+		prev = std::move(cur);
+		++n;
+	}
+	res.sorted = sorted && n == res.items;
+	t.end();
+}
+
+// parallel_sort is internal; it runs if the items fit in the memory limit.
+template <typename T>
+void run_parallel_sort(run_result & res, key_generator & gen, memory_size_type memory) {
+	phase_timer t(res);
+	if (res.items * sizeof(T) > memory) {
+		res.error = "items do not fit in memory";
+		return;
+	}
+	t.begin("generate");
+	std::vector<T> items;
+	items.reserve(static_cast<size_t>(res.items));
+	for (stream_size_type i = 0; i < res.items; ++i)
+		items.push_back(item_traits<T>::make(gen()));
+	t.end();
+	t.begin("sort");
+	parallel_sort(items.begin(), items.end(), std::less<T>());
+	t.end();
+	t.begin("verify");
+	res.sorted = std::is_sorted(items.begin(), items.end());
+	t.end();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Driver
+///////////////////////////////////////////////////////////////////////////////
+
+struct parameters {
+	memory_size_type dataMb;
+	std::vector<memory_size_type> memoryMb;
+	std::string filter;
+	std::string output;
+};
+
+class benchmark {
+public:
+	benchmark(const parameters & p) : m_params(p) {}
+
+	template <typename T>
+	void run_item() {
+		// tpie::sort and pipelining sort store items in file_streams.
+		typedef std::integral_constant<bool, std::is_trivially_copyable<T>::value> fixedSize;
+		for (const std::string & distribution : key_generator::distributions()) {
+			for (memory_size_type memoryMb : m_params.memoryMb) {
+				run_file_stream_sorters<T>(distribution, memoryMb, fixedSize());
+				run<T>("serialization_sort", distribution, memoryMb, run_serialization_sort<T>);
+				run<T>("parallel_sort", distribution, memoryMb, run_parallel_sort<T>);
+			}
+		}
+	}
+
+	const std::vector<run_result> & results() const { return m_results; }
+
+private:
+	template <typename T>
+	void run_file_stream_sorters(const std::string & distribution, memory_size_type memoryMb, std::true_type) {
+		run<T>("tpie_sort", distribution, memoryMb, run_tpie_sort<T>);
+		run<T>("pipelining_sort", distribution, memoryMb, run_pipelining_sort<T>);
+	}
+
+	template <typename T>
+	void run_file_stream_sorters(const std::string &, memory_size_type, std::false_type) {
+	}
+
+	template <typename T, typename F>
+	void run(const std::string & sorter, const std::string & distribution,
+			 memory_size_type memoryMb, F f) {
+		std::string item = item_traits<T>::name();
+		std::string name = sorter + "/" + distribution + "/" + item + "/" + std::to_string(memoryMb);
+		if (name.find(m_params.filter) == std::string::npos) return;
+
+		run_result res;
+		res.sorter = sorter;
+		res.distribution = distribution;
+		res.item = item;
+		res.memory = memoryMb * 1024 * 1024;
+		res.bytes = m_params.dataMb * 1024 * 1024;
+		// Strings are 52 characters on average.
+		res.items = res.bytes / std::max<size_t>(item_traits<T>::size(T()), 52);
+		res.sorted = false;
+		std::cerr << name << "..." << std::flush;
+		key_generator gen(distribution, res.items);
+		try {
+			f(res, gen, res.memory);
+		} catch (const std::exception & e) {
+			res.error = e.what();
+		}
+		double total = 0;
+		for (const phase_result & p : res.phases) total += p.seconds;
+		std::cerr << ' ' << total << " s" << (res.error.empty() ? "" : " (" + res.error + ")") << std::endl;
+		m_results.push_back(res);
+	}
+
+	parameters m_params;
+	std::vector<run_result> m_results;
+};
+
+void usage(const char * argv0) {
+	std::cerr << "Usage: " << argv0 << " [--mb N] [--memory M1,M2,...] [--filter SUBSTRING] [--output FILE]\n"
+			  << "  --mb      Data size in MB per run (default 32)\n"
+			  << "  --memory  Memory limits in MB (default 8,32,128)\n"
+			  << "  --filter  Only run benchmarks whose name sorter/distribution/item/memory\n"
+			  << "            contains SUBSTRING\n"
+			  << "  --output  Write JSON to FILE instead of standard output\n";
+}
+
+bool parse_args(int argc, char ** argv, parameters & p) {
+	for (int i = 1; i < argc; ++i) {
+		std::string arg(argv[i]);
+		if (i + 1 == argc) return false;
+		std::string value(argv[++i]);
+		if (arg == "--mb") {
+			std::stringstream(value) >> p.dataMb;
+		} else if (arg == "--memory") {
+			p.memoryMb.clear();
+			std::stringstream ss(value);
+			std::string m;
+			while (std::getline(ss, m, ',')) p.memoryMb.push_back(std::stoul(m));
+		} else if (arg == "--filter") {
+			p.filter = value;
+		} else if (arg == "--output") {
+			p.output = value;
+		} else {
+			return false;
+		}
+	}
+	return p.dataMb > 0 && !p.memoryMb.empty();
+}
+
+} // unnamed namespace
+
+int main(int argc, char ** argv) {
+	parameters p;
+	p.dataMb = 32;
+	p.memoryMb = {8, 32, 128};
+	if (!parse_args(argc, argv, p)) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	tpie_init();
+	get_memory_manager().set_limit(1024*1024*1024);
+	{
+		benchmark b(p);
+		b.run_item<uint64_t>();
+		b.run_item<record<16> >();
+		b.run_item<record<64> >();
+		b.run_item<record<256> >();
+		b.run_item<std::string>();
+
+		if (p.output.empty()) {
+			print_results(std::cout, b.results());
+		} else {
+			std::ofstream out(p.output);
+			print_results(out, b.results());
+		}
+	}
+	tpie_finish();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,238 @@
+// -*- mode: c++; tab-width: 4; indent-tabs-mode: t; c-file-style: "stroustrup"; -*-
+// vi:set ts=4 sts=4 sw=4 noet :
+// Copyright 2026, The TPIE development team
+//
+// This file is part of TPIE.
+//
+// TPIE is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// TPIE is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with TPIE.  If not, see <http://www.gnu.org/licenses/>
+#include "common.h"
+#include <tpie/addressable_priority_queue.h>
+#include <map>
+#include <queue>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace tpie;
+
+typedef addressable_priority_queue<uint64_t> apq_t;
+
+// Blocks of 4 KiB give queues of a few thousand ids several levels.
+double block_factor() {
+	return file_stream<uint64_t>::calculate_block_factor(4 * 1024);
+}
+
+// Reference queue with the same semantics.
+class reference_queue {
+public:
+	void update(uint64_t id, uint64_t priority) {
+		erase(id);
+		m_priority[id] = priority;
+		m_order.insert(std::make_pair(priority, id));
+	}
+
+	void erase(uint64_t id) {
+		std::map<uint64_t, uint64_t>::iterator i = m_priority.find(id);
+		if (i == m_priority.end()) return;
+		m_order.erase(std::make_pair(i->second, id));
+		m_priority.erase(i);
+	}
+
+	bool empty() const {return m_order.empty();}
+	uint64_t top_priority() const {return m_order.begin()->first;}
+	bool contains(uint64_t id, uint64_t priority) const {
+		std::map<uint64_t, uint64_t>::const_iterator i = m_priority.find(id);
+		return i != m_priority.end() && i->second == priority;
+	}
+	size_t size() const {return m_order.size();}
+
+private:
+	std::map<uint64_t, uint64_t> m_priority;
+	std::set<std::pair<uint64_t, uint64_t> > m_order;
+};
+
+// Pop one element from both queues. Ties may be broken differently, so the
+// popped id is checked against the reference instead of its top.
+bool pop_both(apq_t & pq, reference_queue & ref) {
+	TEST_ENSURE_EQUALITY(ref.empty(), pq.empty(), "Emptiness differs");
+	if (ref.empty()) return true;
+	uint64_t id = pq.top_id();
+	uint64_t priority = pq.top_priority();
+	TEST_ENSURE_EQUALITY(ref.top_priority(), priority, "Top priority differs");
+	TEST_ENSURE(ref.contains(id, priority), "Top id has the wrong priority");
+	pq.pop();
+	ref.erase(id);
+	return true;
+}
+
+bool random_test(uint64_t ids, memory_size_type capacity, uint64_t operations) {
+	apq_t pq(ids, apq_t::memory_usage(ids, capacity, block_factor()), block_factor());
+	log_debug() << "capacity " << pq.node_capacity() << ", height " << pq.height() << std::endl;
+	reference_queue ref;
+	std::mt19937_64 rnd(42);
+	for (uint64_t i = 0; i < operations; ++i) {
+		// Alternate between phases that grow and shrink the queue
+		bool growing = (i / (operations / 8)) % 2 == 0;
+		uint64_t r = rnd() % 10;
+		uint64_t id = rnd() % ids;
+		if (r < (growing ? 6u : 3u)) {
+			uint64_t priority = rnd() % (ids * 4);
+			pq.update(id, priority);
+			ref.update(id, priority);
+		} else if (r < 7) {
+			pq.erase(id);
+			ref.erase(id);
+		} else {
+			if (!pop_both(pq, ref)) return false;
+		}
+	}
+	while (!ref.empty())
+		if (!pop_both(pq, ref)) return false;
+	TEST_ENSURE(pq.empty(), "Queue not empty");
+	return true;
+}
+
+bool basic_test() {
+	return random_test(500, 1000, 20000);
+}
+
+bool external_test() {
+	return random_test(200000, 256, 400000);
+}
+
+bool decrease_key_test() {
+	// Every id is inserted, then has its priority lowered repeatedly; the
+	// queue must end up holding each id once at its last priority.
+	const uint64_t ids = 50000;
+	apq_t pq(ids, apq_t::memory_usage(ids, 256, block_factor()), block_factor());
+	TEST_ENSURE(pq.height() > 2, "Queue should be external");
+	for (uint64_t round = 0; round < 4; ++round)
+		for (uint64_t i = 0; i < ids; ++i)
+			pq.update((i * 7919) % ids, (4 - round) * ids + (i * 7919) % ids);
+	for (uint64_t i = 0; i < ids; ++i) {
+		TEST_ENSURE(!pq.empty(), "Queue empty too early");
+		TEST_ENSURE_EQUALITY(i, pq.top_id(), "Wrong id");
+		TEST_ENSURE_EQUALITY(ids + i, pq.top_priority(), "Wrong priority");
+		pq.pop();
+	}
+	TEST_ENSURE(pq.empty(), "Queue not empty");
+	return true;
+}
+
+bool dijkstra_test(uint64_t width) {
+	// Single source shortest paths on a grid with random edge weights,
+	// checked against Dijkstra with lazy deletion in internal memory.
+	const uint64_t n = width * width;
+	std::mt19937_64 rnd(7);
+	std::vector<uint64_t> right(n), down(n);
+	for (uint64_t i = 0; i < n; ++i) {
+		right[i] = rnd() % 100 + 1;
+		down[i] = rnd() % 100 + 1;
+	}
+	auto neighbours = [&](uint64_t v, std::vector<std::pair<uint64_t, uint64_t> > & out) {
+		out.clear();
+		uint64_t x = v % width, y = v / width;
+		if (x + 1 < width) out.push_back(std::make_pair(v + 1, right[v]));
+		if (x > 0) out.push_back(std::make_pair(v - 1, right[v - 1]));
+		if (y + 1 < width) out.push_back(std::make_pair(v + width, down[v]));
+		if (y > 0) out.push_back(std::make_pair(v - width, down[v - width]));
+	};
+	const uint64_t unreached = std::numeric_limits<uint64_t>::max();
+	std::vector<std::pair<uint64_t, uint64_t> > adj;
+
+	std::vector<uint64_t> expected(n, unreached);
+	{
+		typedef std::pair<uint64_t, uint64_t> item;
+		std::priority_queue<item, std::vector<item>, std::greater<item> > q;
+		expected[0] = 0;
+		q.push(item(0, 0));
+		while (!q.empty()) {
+			item t = q.top();
+			q.pop();
+			if (t.first != expected[t.second]) continue;
+			neighbours(t.second, adj);
+			for (size_t i = 0; i < adj.size(); ++i) {
+				uint64_t d = t.first + adj[i].second;
+				if (d < expected[adj[i].first]) {
+					expected[adj[i].first] = d;
+					q.push(item(d, adj[i].first));
+				}
+			}
+		}
+	}
+
+	std::vector<uint64_t> tentative(n, unreached);
+	std::vector<bool> done(n, false);
+	apq_t pq(n, apq_t::memory_usage(n, 256, block_factor()), block_factor());
+	tentative[0] = 0;
+	pq.update(0, 0);
+	uint64_t settled = 0;
+	while (!pq.empty()) {
+		uint64_t v = pq.top_id();
+		uint64_t d = pq.top_priority();
+		pq.pop();
+		TEST_ENSURE(!done[v], "Vertex settled twice");
+		TEST_ENSURE_EQUALITY(expected[v], d, "Wrong distance");
+		done[v] = true;
+		++settled;
+		neighbours(v, adj);
+		for (size_t i = 0; i < adj.size(); ++i) {
+			uint64_t u = adj[i].first;
+			if (done[u] || d + adj[i].second >= tentative[u]) continue;
+			tentative[u] = d + adj[i].second;
+			pq.update(u, tentative[u]);
+		}
+	}
+	TEST_ENSURE_EQUALITY(n, settled, "Not all vertices settled");
+	return true;
+}
+
+class apq_memory_test : public memory_test {
+public:
+	apq_memory_test() : m_ids(100000), m_memory(1 << 20) {}
+
+	virtual void alloc() {
+		m_pq = tpie_new<apq_t>(m_ids, m_memory, block_factor());
+	}
+
+	virtual void use() {
+		std::mt19937_64 rnd(1);
+		for (uint64_t i = 0; i < 4 * m_ids; ++i) {
+			if (i % 3 == 2 && !m_pq->empty()) m_pq->pop();
+			else m_pq->update(rnd() % m_ids, rnd());
+		}
+	}
+
+	virtual void free() {
+		tpie_delete(m_pq);
+	}
+
+	virtual size_type claimed_size() {
+		return m_memory;
+	}
+
+private:
+	const uint64_t m_ids;
+	const memory_size_type m_memory;
+	apq_t * m_pq;
+};
+
+int main(int argc, char ** argv) {
+	return tests(argc, argv)
+		.test(basic_test, "basic")
+		.test(external_test, "external")
+		.test(decrease_key_test, "decrease_key")
+		.test(dijkstra_test, "dijkstra", "width", static_cast<uint64_t>(300))
+		.test(apq_memory_test(), "memory");
+}
@@ -25,7 +25,14 @@
 #include <tpie/tempname.h>
 #include <vector>
 #include <deque>
+#include <list>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <tpie/file_accessor/file_accessor.h>
 
 using namespace tpie;
@@ -191,9 +198,258 @@ bool overwrite() {
 	return true;
 }
 
+bool hit_miss() {
+	temp_file file;
+	block_collection_cache collection(file.path(), BLOCK_SIZE, 40, true);
+	std::vector<block_handle> blocks;
+
+	for(char i = 0; i < 100; ++i) {
+		block_handle handle = collection.get_free_block();
+		block * b = collection.read_block(handle);
+		std::fill(b->begin(), b->end(), i);
+		collection.write_block(handle);
+		blocks.push_back(handle);
+	}
+	TEST_ENSURE_EQUALITY(stream_size_type(100), collection.hits(), "New blocks should be cached");
+	TEST_ENSURE_EQUALITY(stream_size_type(0), collection.misses(), "New blocks should not be read");
+
+	// A working set smaller than the cache misses once per block
+	for(size_t round = 0; round < 10; ++round) {
+		for(size_t i = 0; i < 30; ++i) {
+			block * b = collection.read_block(blocks[i]);
+			TEST_ENSURE_EQUALITY((int) (*b)[0], (int) i, "the content of the returned block is not correct");
+		}
+	}
+	TEST_ENSURE_EQUALITY(stream_size_type(30), collection.misses(), "Working set should stay cached");
+
+	// The last blocks read stay valid while other blocks are read
+	block * first = collection.read_block(blocks[50]);
+	for(size_t i = 60; i < 70; ++i) collection.read_block(blocks[i]);
+	TEST_ENSURE_EQUALITY((int) (*first)[0], 50, "Recently used block was evicted");
+	return true;
+}
+
+bool memory() {
+	const memory_size_type memory = 1024 * 1024;
+	memory_size_type maxSize = block_collection_cache::max_size_for_memory(BLOCK_SIZE, memory);
+	TEST_ENSURE(maxSize > 100, "Cache too small for the memory");
+	TEST_ENSURE(block_collection_cache::memory_usage(BLOCK_SIZE, maxSize) <= memory, "Cache larger than the memory");
+	TEST_ENSURE(block_collection_cache::memory_usage(BLOCK_SIZE, maxSize + 1) > memory, "Cache smaller than the memory allows");
+
+	temp_file file;
+	memory_size_type before = get_memory_manager().used();
+	{
+		block_collection_cache collection(file.path(), BLOCK_SIZE, maxSize, true);
+		// Leave out the free space list of the block collection
+		memory_size_type base = get_memory_manager().used();
+		memory_size_type baseCache = block_collection_cache::memory_usage(BLOCK_SIZE, 0);
+		for(memory_size_type i = 0; i < 2 * maxSize; ++i) {
+			block_handle handle = collection.get_free_block();
+			collection.write_block(handle);
+		}
+		memory_size_type used = get_memory_manager().used() - base + baseCache;
+		log_debug() << maxSize << " blocks, " << used << " bytes" << std::endl;
+		TEST_ENSURE(used <= memory, "Used more memory than given");
+	}
+	TEST_ENSURE_EQUALITY(before, get_memory_manager().used(), "Memory leaked");
+	return true;
+}
+
+// Fill a collection with blocks whose first byte is their index.
+void fill(block_collection_cache & collection, std::vector<block_handle> & blocks, size_t count) {
+	for(size_t i = 0; i < count; ++i) {
+		block_handle handle = collection.get_free_block();
+		block * b = collection.read_block(handle);
+		(*b)[0] = (char) i;
+		collection.write_block(handle);
+		blocks.push_back(handle);
+	}
+}
+
+bool shared_pool() {
+	std::shared_ptr<buffer_pool> pool = std::make_shared<buffer_pool>(64 * buffer_pool::frame_memory(BLOCK_SIZE));
+	temp_file hotFile, coldFile;
+	block_collection_cache hot(hotFile.path(), BLOCK_SIZE, pool, true);
+	block_collection_cache cold(coldFile.path(), BLOCK_SIZE, pool, true);
+	TEST_ENSURE_EQUALITY(memory_size_type(64), hot.max_size(), "Wrong size of a shared cache");
+
+	std::vector<block_handle> hotBlocks, coldBlocks;
+	fill(hot, hotBlocks, 40);
+	fill(cold, coldBlocks, 1000);
+	TEST_ENSURE(pool->blocks() <= 64, "Pool holds too many blocks");
+
+	// A scan of the cold collection interleaved with a hot working set
+	for(size_t i = 0; i < 4000; ++i) {
+		block * b = hot.read_block(hotBlocks[i % 40]);
+		TEST_ENSURE_EQUALITY((int) (*b)[0], (int) (char) (i % 40), "the content of the returned block is not correct");
+		b = cold.read_block(coldBlocks[i % 1000]);
+		TEST_ENSURE_EQUALITY((int) (*b)[0], (int) (char) (i % 1000), "the content of the returned block is not correct");
+	}
+	log_debug() << "hot: " << hot.cached_blocks() << " blocks, " << hot.misses() << " misses; cold: "
+				<< cold.cached_blocks() << " blocks, " << cold.misses() << " misses" << std::endl;
+	TEST_ENSURE(hot.cached_blocks() >= 40, "The hot working set should stay cached");
+	TEST_ENSURE(hot.misses() <= 80, "The hot working set should rarely miss");
+	TEST_ENSURE_EQUALITY(pool->blocks(), hot.cached_blocks() + cold.cached_blocks(), "Blocks not counted");
+	TEST_ENSURE(pool->used() <= pool->memory(), "Pool uses more memory than given");
+
+	pool->set_memory(32 * buffer_pool::frame_memory(BLOCK_SIZE));
+	TEST_ENSURE_EQUALITY(memory_size_type(32), pool->blocks(), "Shrinking the pool should evict blocks");
+	TEST_ENSURE(hot.cached_blocks() > cold.cached_blocks(), "The hot collection should keep more blocks");
+	return true;
+}
+
+bool shared_unregister() {
+	std::shared_ptr<buffer_pool> pool = std::make_shared<buffer_pool>(32 * buffer_pool::frame_memory(BLOCK_SIZE));
+	temp_file file, otherFile;
+	block_collection_cache other(otherFile.path(), BLOCK_SIZE, pool, true);
+	std::vector<block_handle> blocks, otherBlocks;
+	fill(other, otherBlocks, 10);
+	{
+		block_collection_cache collection(file.path(), BLOCK_SIZE, pool, true);
+		fill(collection, blocks, 20);
+		TEST_ENSURE_EQUALITY(memory_size_type(30), pool->blocks(), "Blocks missing from the pool");
+	}
+	TEST_ENSURE_EQUALITY(memory_size_type(10), pool->blocks(), "Blocks of a closed collection stay in the pool");
+
+	// The changed blocks were written when the collection was closed
+	file_accessor::raw_file_accessor f;
+	f.open_ro(file.path());
+	for(size_t i = 0; i < blocks.size(); ++i) {
+		char c = 0;
+		f.seek_i(blocks[i].position);
+		f.read_i(&c, 1);
+		TEST_ENSURE_EQUALITY((int) (char) i, (int) c, "Changed block was not written");
+	}
+	f.close_i();
+
+	for(size_t i = 0; i < otherBlocks.size(); ++i)
+		TEST_ENSURE_EQUALITY((int) (char) i, (int) (*other.read_block(otherBlocks[i]))[0], "Other collection changed");
+	TEST_ENSURE_EQUALITY(stream_size_type(0), other.misses(), "Other collection lost its blocks");
+	return true;
+}
+
+bool thread_exit() {
+	std::shared_ptr<buffer_pool> pool = std::make_shared<buffer_pool>(32 * buffer_pool::frame_memory(BLOCK_SIZE));
+	temp_file file;
+	std::unique_ptr<block_collection_cache> collection(new block_collection_cache(file.path(), BLOCK_SIZE, pool, true));
+	std::vector<block_handle> blocks;
+	fill(*collection, blocks, 20);
+	pool->release_thread();
+
+	// The blocks pinned by a thread are unpinned when it exits
+	std::thread reader([&]() {
+		for(size_t i = 0; i < 8; ++i) collection->read_block(blocks[i]);
+	});
+	reader.join();
+	pool->set_memory(0);
+	TEST_ENSURE_EQUALITY(memory_size_type(0), pool->blocks(), "Blocks of an exited thread stay pinned");
+	pool->set_memory(32 * buffer_pool::frame_memory(BLOCK_SIZE));
+
+	// A thread may exit after the pool it used was destroyed
+	std::mutex mutex;
+	std::condition_variable cond;
+	bool read = false, destroyed = false;
+	std::thread late([&]() {
+		for(size_t i = 0; i < 8; ++i) collection->read_block(blocks[i]);
+		std::unique_lock<std::mutex> lock(mutex);
+		read = true;
+		cond.notify_all();
+		while (!destroyed) cond.wait(lock);
+	});
+	std::unique_lock<std::mutex> lock(mutex);
+	while (!read) cond.wait(lock);
+	collection.reset();
+	pool.reset();
+	destroyed = true;
+	cond.notify_all();
+	lock.unlock();
+	late.join();
+	return true;
+}
+
+bool concurrent_read() {
+	const size_t count = 300;
+	const size_t threads = 8;
+	temp_file file;
+	block_collection_cache collection(file.path(), BLOCK_SIZE, 24, true);
+	std::vector<block_handle> blocks;
+	for(size_t i = 0; i < count; ++i) {
+		block_handle handle = collection.get_free_block();
+		block * b = collection.read_block(handle);
+		std::fill(b->begin(), b->end(), (char) i);
+		collection.write_block(handle);
+		blocks.push_back(handle);
+	}
+
+	std::atomic<bool> ok(true);
+	std::vector<std::thread> workers;
+	for(size_t t = 0; t < threads; ++t) {
+		workers.push_back(std::thread([&, t]() {
+			// Each thread checks that a block it read stays valid while it
+			// reads a few others
+			for(size_t i = 0; i < 20000 && ok; ++i) {
+				size_t first = random(t * 100000 + i) % count;
+				block * held = collection.read_block(blocks[first]);
+				for(size_t j = 1; j <= 8; ++j) {
+					size_t k = random(t * 100000 + i + j * 7) % (j % 2 ? 20 : count);
+					block * b = collection.read_block(blocks[k]);
+					if ((*b)[0] != (char) k || (*b)[BLOCK_SIZE - 1] != (char) k) ok = false;
+				}
+				if ((*held)[0] != (char) first || (*held)[BLOCK_SIZE - 1] != (char) first) ok = false;
+			}
+			collection.pool()->release_thread();
+		}));
+	}
+	for(size_t t = 0; t < threads; ++t) workers[t].join();
+	TEST_ENSURE(ok, "A thread read a wrong block");
+	log_debug() << collection.hits() << " hits, " << collection.misses() << " misses, "
+				<< collection.cached_blocks() << " cached" << std::endl;
+	TEST_ENSURE(collection.misses() > 0, "Blocks should have been evicted");
+	TEST_ENSURE_EQUALITY(stream_size_type(threads * 20000 * 9), collection.hits() + collection.misses() - count, "Reads not counted");
+	return true;
+}
+
+bool prefetch() {
+	temp_file file;
+	std::shared_ptr<block_collection_cache> collection =
+		std::make_shared<block_collection_cache>(file.path(), BLOCK_SIZE, 40, true);
+	std::vector<block_handle> blocks;
+	for(size_t i = 0; i < 100; ++i) {
+		block_handle handle = collection->get_free_block();
+		block * b = collection->read_block(handle);
+		std::fill(b->begin(), b->end(), (char) i);
+		collection->write_block(handle);
+		blocks.push_back(handle);
+	}
+	TEST_ENSURE(!collection->pool()->contains(0, blocks[0]), "First blocks should have been evicted");
+
+	// Prefetching a cached block does nothing
+	collection->prefetch_block(blocks[99]);
+	for(size_t i = 0; i < 20; ++i) collection->prefetch_block(blocks[i]);
+	for(size_t wait = 0; wait < 1000 && collection->misses() < 20; ++wait)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	TEST_ENSURE_EQUALITY(stream_size_type(20), collection->misses(), "Blocks were not prefetched");
+
+	stream_size_type hits = collection->hits();
+	for(size_t i = 0; i < 20; ++i) {
+		block * b = collection->read_block(blocks[i]);
+		TEST_ENSURE_EQUALITY((int) (*b)[BLOCK_SIZE - 1], (int) i, "the content of the returned block is not correct");
+	}
+	TEST_ENSURE_EQUALITY(stream_size_type(20), collection->misses(), "Prefetched blocks should be cached");
+	TEST_ENSURE_EQUALITY(hits + 20, collection->hits(), "Reads not counted");
+	return true;
+}
+
 int main(int argc, char **argv) {
 	return tpie::tests(argc, argv)
 		.test(basic, "basic")
 		.test(erase, "erase")
-		.test(overwrite, "overwrite");
+		.test(overwrite, "overwrite")
+		.test(hit_miss, "hit_miss")
+		.test(memory, "memory")
+		.test(shared_pool, "shared_pool")
+		.test(shared_unregister, "shared_unregister")
+		.test(thread_exit, "thread_exit")
+		.test(concurrent_read, "concurrent_read")
+		.test(prefetch, "prefetch");
 }
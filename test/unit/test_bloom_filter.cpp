@@ -0,0 +1,105 @@
+// -*- mode: c++; tab-width: 4; indent-tabs-mode: t; c-file-style: "stroustrup"; -*-
+// vi:set ts=4 sts=4 sw=4 noet :
+// Copyright 2026, The TPIE development team
+//
+// This file is part of TPIE.
+//
+// TPIE is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// TPIE is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with TPIE.  If not, see <http://www.gnu.org/licenses/>
+#include "common.h"
+#include <tpie/bloom_filter.h>
+#include <tpie/pipelining.h>
+#include <tpie/pipelining/bloom_filter.h>
+#include <vector>
+
+using namespace tpie;
+
+typedef external_bloom_filter<uint64_t> filter_t;
+
+// Even keys are inserted, odd keys are not.
+uint64_t key(uint64_t i) {
+	return (i * 0x9E3779B97F4A7C15ull) & ~uint64_t(1);
+}
+
+bool check_filter(filter_t & f, uint64_t n) {
+	for (uint64_t i = 0; i < n; ++i)
+		TEST_ENSURE(f.contains(key(i)), "False negative");
+	uint64_t falsePositives = 0;
+	stream_size_type reads = f.block_reads();
+	for (uint64_t i = 0; i < n; ++i)
+		if (f.contains(key(i) | 1)) ++falsePositives;
+	TEST_ENSURE(f.block_reads() - reads <= n, "More than one block read per lookup");
+	double rate = static_cast<double>(falsePositives) / static_cast<double>(n);
+	log_debug() << f.blocks() << " blocks, " << f.hashes() << " hashes, false positive rate " << rate << std::endl;
+	TEST_ENSURE(rate < 0.02, "False positive rate too high");
+	return true;
+}
+
+bool basic_test() {
+	const uint64_t n = 50000;
+	filter_t f(n);
+	for (uint64_t i = 0; i < n; ++i) f.insert(key(i));
+	TEST_ENSURE_EQUALITY(n, f.size(), "Wrong size");
+	return check_filter(f, n);
+}
+
+bool batch_test() {
+	const uint64_t n = 200000;
+	filter_t f(n, 10.0, 1024);
+	filter_t g(n, 10.0, 1024);
+	std::vector<size_t> hashes;
+	for (uint64_t i = 0; i < n; ++i) {
+		hashes.push_back(f.hash_value(key(i)));
+		g.insert(key(i));
+	}
+	f.insert_hashes(array_view<size_t>(hashes));
+	TEST_ENSURE_EQUALITY(f.blocks(), f.block_writes(), "Blocks written more than once");
+	for (uint64_t i = 0; i < n; ++i)
+		TEST_ENSURE_EQUALITY(g.contains(key(i) | 1), f.contains(key(i) | 1), "Batch and single inserts differ");
+	return check_filter(f, n);
+}
+
+bool pipeline_test() {
+	const uint64_t n = 100000;
+	filter_t f(n);
+	std::vector<uint64_t> inserted, queries, present, absent;
+	for (uint64_t i = 0; i < n; ++i) {
+		inserted.push_back(key(i));
+		queries.push_back(key(i));
+		queries.push_back(key(i) | 1);
+	}
+	pipelining::pipeline p1 = pipelining::input_vector(inserted) | pipelining::bloom_filter_output(f);
+	p1();
+	TEST_ENSURE_EQUALITY(n, f.size(), "Wrong size");
+
+	pipelining::pipeline p2 = pipelining::input_vector(queries)
+		| pipelining::bloom_filter_contains(f)
+		| pipelining::output_vector(present);
+	p2();
+	pipelining::pipeline p3 = pipelining::input_vector(queries)
+		| pipelining::bloom_filter_absent(f)
+		| pipelining::output_vector(absent);
+	p3();
+	TEST_ENSURE_EQUALITY(queries.size(), present.size() + absent.size(), "Items lost");
+	for (size_t i = 0; i < absent.size(); ++i)
+		TEST_ENSURE(absent[i] & 1, "Inserted item reported absent");
+	TEST_ENSURE(present.size() < n + n / 50, "Too many false positives");
+	return check_filter(f, n);
+}
+
+int main(int argc, char ** argv) {
+	return tests(argc, argv)
+		.test(basic_test, "basic")
+		.test(batch_test, "batch")
+		.test(pipeline_test, "pipeline");
+}
@@ -20,12 +20,21 @@
 #include "common.h"
 #include <tpie/tpie.h>
 #include <tpie/btree.h>
+#include <tpie/pipelining.h>
+#include <tpie/pipelining/btree_builder.h>
 #include <tpie/tempname.h>
 #include <algorithm>
+#include <array>
 #include <set>
 #include <map>
 #include <numeric>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <boost/filesystem/operations.hpp>
 #include <boost/filesystem/path.hpp>
+#include <fstream>
+#include <iterator>
 
 #ifdef TPIE_HAS_LZ4
 #define SKIP_IF_NO_LZ4 {}
@@ -386,6 +395,167 @@ bool augment_test(TA<TT...> ta, A && ... a) {
 	return true;
 }
 
+// Scans of the whole tree and of random key ranges, leaf by leaf, compared
+// against iteration.
+template<typename ... TT, typename ... A>
+bool scan_test(TA<TT...>, A && ... a) {
+	btree<int, TT...> tree(std::forward<A>(a)...);
+	TEST_ENSURE(tree.scan(tree.begin(), tree.end()).next().empty(), "Scan of an empty tree");
+	multiset<int> tree2;
+	std::mt19937 rnd(7);
+	for (int i=0; i < 40000; ++i) {
+		int x = rnd() % 20000;
+		tree.insert(x);
+		tree2.insert(x);
+	}
+
+	for (size_t ahead: {0, 1, 8}) {
+		std::vector<int> items;
+		auto s = tree.scan(tree.begin(), tree.end(), ahead);
+		for (auto v = s.next(); !v.empty(); v = s.next())
+			items.insert(items.end(), v.begin(), v.end());
+		TEST_ENSURE(items == std::vector<int>(tree2.begin(), tree2.end()), "Full scan differs");
+	}
+
+	for (int r=0; r < 200; ++r) {
+		int from = static_cast<int>(rnd() % 20100) - 50;
+		int to = r % 10 == 0 ? from - 1 : from + static_cast<int>(rnd() % (r % 2 ? 50 : 5000));
+		std::vector<int> items;
+		size_t batches = 0;
+		auto s = tree.scan_range(from, to, r % 4);
+		for (auto v = s.next(); !v.empty(); v = s.next()) {
+			items.insert(items.end(), v.begin(), v.end());
+			++batches;
+		}
+		std::vector<int> expect(tree2.lower_bound(from), to < from ? tree2.lower_bound(from) : tree2.lower_bound(to));
+		TEST_ENSURE(items == expect, "Range scan differs");
+		TEST_ENSURE(batches <= tree.size(), "Empty batch returned");
+	}
+	return true;
+}
+
+// Range sums, ranks and selections through the augments of a built tree,
+// compared against a sorted vector.
+template<typename ... TT, typename ... A>
+bool aggregate_test(TA<TT...> ta, A && ... a) {
+	default_comp c;
+	ss_augmenter au;
+	auto builder = get_builder(ta, c, au, std::forward<A>(a)...);
+	std::mt19937 rnd(5);
+	std::vector<int> x;
+	for (int i=0; i < 60000; ++i) x.push_back(rnd() % 20000);
+	std::sort(x.begin(), x.end());
+	for (int v: x) builder.push(v);
+	auto tree = builder.build();
+
+	auto value_fn = [](ss_augment r, int v) {return add(r, ss_augment(1, v));};
+	auto augment_fn = [](ss_augment r, const ss_augment & a) {return add(r, a);};
+	auto count = [](const ss_augment & a) {return a.first;};
+	for (int r=0; r < 300; ++r) {
+		int from = static_cast<int>(rnd() % 20100) - 50;
+		int to = r % 10 == 0 ? from - 1 : from + static_cast<int>(rnd() % (r % 2 ? 50 : 15000));
+		ss_augment expect(0, 0);
+		for (auto i = std::lower_bound(x.begin(), x.end(), from); i != x.end() && *i < to; ++i)
+			expect = value_fn(expect, *i);
+		TEST_ENSURE_EQUALITY(expect, tree.aggregate(from, to, ss_augment(0, 0), value_fn, augment_fn), "Wrong aggregate");
+
+		size_t rank = std::lower_bound(x.begin(), x.end(), from) - x.begin();
+		TEST_ENSURE_EQUALITY(rank, tree.rank(from, count), "Wrong rank");
+		size_t k = rnd() % x.size();
+		TEST_ENSURE_EQUALITY(x[k], *tree.select(k, count), "Wrong item selected");
+	}
+	TEST_ENSURE(tree.select(x.size(), count) == tree.end(), "Selected past the end");
+	TEST_ENSURE_EQUALITY(x.size(), tree.rank(20000, count), "Wrong rank past the end");
+	return true;
+}
+
+// Ranks and selections with count_augmenter while the tree changes.
+template<typename ... TT, typename ... A>
+bool rank_test(TA<TT...>, A && ... a) {
+	btree<int, btree_augment<count_augmenter>, TT...> tree(std::forward<A>(a)...);
+	TEST_ENSURE_EQUALITY(0, tree.rank(5), "Wrong rank in an empty tree");
+	TEST_ENSURE(tree.select(0) == tree.end(), "Selected in an empty tree");
+	multiset<int> tree2;
+	std::mt19937 rnd(13);
+	for (int i=0; i < 40000; ++i) {
+		int x = rnd() % 10000;
+		if (i % 3 == 2) {
+			tree.erase(x);
+			tree2.erase(x);
+		} else {
+			tree.insert(x);
+			tree2.insert(x);
+		}
+	}
+	std::vector<int> items(tree2.begin(), tree2.end());
+	for (int r=0; r < 300; ++r) {
+		int k = static_cast<int>(rnd() % 10100) - 50;
+		size_t expect = std::lower_bound(items.begin(), items.end(), k) - items.begin();
+		TEST_ENSURE_EQUALITY(expect, tree.rank(k), "Wrong rank");
+		size_t i = rnd() % items.size();
+		auto s = tree.select(i);
+		TEST_ENSURE_EQUALITY(items[i], *s, "Wrong item selected");
+		size_t first = std::lower_bound(items.begin(), items.end(), *s) - items.begin();
+		TEST_ENSURE_EQUALITY(first, tree.rank(*s), "Rank and select disagree");
+	}
+	return true;
+}
+
+// Sorted batches into a tree with existing items: batches falling into one
+// gap, spanning the whole tree, before and after all items, and with
+// duplicates of existing keys.
+template<typename ... TT, typename ... A>
+bool insert_sorted_test(TA<TT...> ta, A && ... a) {
+	default_comp c;
+	ss_augmenter au;
+	auto tree = get_btree(ta, c, au, std::forward<A>(a)...);
+	multiset<int> tree2;
+	std::mt19937 rnd(42);
+
+	std::vector<int> x;
+	for (int i=0; i < 2000; ++i) x.push_back(10 * (rnd() % 3000));
+	tree.insert_sorted(x.begin(), x.begin() + 1);
+	tree2.insert(x[0]);
+	for (size_t i=1; i < x.size(); ++i) {
+		tree.insert(x[i]);
+		tree2.insert(x[i]);
+	}
+
+	std::vector<std::vector<int> > batches(5);
+	for (int i=0; i < 20000; ++i) batches[0].push_back(15001 + (i % 7));
+	for (int i=0; i < 30000; ++i) batches[1].push_back(rnd() % 30000);
+	for (int i=0; i < 5000; ++i) batches[2].push_back(-1 - i);
+	for (int i=0; i < 5000; ++i) batches[3].push_back(40000 + i);
+	for (int i=0; i < 3000; ++i) batches[4].push_back(x[i % x.size()]);
+	for (auto & b: batches) {
+		std::sort(b.begin(), b.end());
+		tree.insert_sorted(b.begin(), b.end());
+		tree2.insert(b.begin(), b.end());
+		TEST_ENSURE_EQUALITY(tree2.size(), tree.size(), "The tree has the wrong size");
+		TEST_ENSURE(compare(tree, tree2), "Compare failed");
+	}
+
+	auto i1 = tree.begin();
+	size_t rank=0, sum=0;
+	for (int v: tree2) {
+		TEST_ENSURE(rank_sum(i1) == ss_augment(rank, sum), "Wrong augmentation");
+		++rank;
+		sum += v;
+		++i1;
+	}
+
+	// Erasing checks that the nodes are neither over- nor underfull
+	std::vector<int> y(tree2.begin(), tree2.end());
+	std::shuffle(y.begin(), y.end(), rnd);
+	y.resize(y.size() / 2);
+	for (int v: y) {
+		tree.erase(tree.find(v));
+		tree2.erase(tree2.find(v));
+	}
+	TEST_ENSURE(compare(tree, tree2), "Compare failed after erase");
+	return true;
+}
+
 template<typename ... TT, typename ... A>
 bool build_test(TA<TT...> ta, A && ... a) {
     default_comp c;
@@ -473,6 +643,37 @@ bool bound_test(TA<TT...>, A && ... a) {
 	return true;
 }
 
+// Point lookups and bounds on a tree with many duplicates and gaps, probing
+// every position of every node including keys that are not present.
+template<typename ... TT, typename ... A>
+bool search_test(TA<TT...>, A && ... a) {
+	btree<int, TT...> tree(std::forward<A>(a)...);
+	multiset<int> tree2;
+	std::mt19937 rnd(1234);
+	for (int i = 0; i < 20000; ++i) {
+		int x = 3 * static_cast<int>(rnd() % 4000) - 6000;
+		tree.insert(x);
+		tree2.insert(x);
+	}
+	for (int k = -6010; k <= 6010; ++k) {
+		auto l = tree.lower_bound(k);
+		auto l2 = tree2.lower_bound(k);
+		TEST_ENSURE((l == tree.end()) == (l2 == tree2.end()), "Lower bound end differs");
+		TEST_ENSURE(l == tree.end() || *l == *l2, "Lower bound differs");
+		auto u = tree.upper_bound(k);
+		auto u2 = tree2.upper_bound(k);
+		TEST_ENSURE((u == tree.end()) == (u2 == tree2.end()), "Upper bound end differs");
+		TEST_ENSURE(u == tree.end() || *u == *u2, "Upper bound differs");
+		auto f = tree.find(k);
+		TEST_ENSURE((f == tree.end()) == (tree2.count(k) == 0), "Find differs");
+		TEST_ENSURE(f == tree.end() || *f == k, "Find returned the wrong key");
+		size_t n = 0;
+		for (; l != u; ++l) ++n;
+		TEST_ENSURE_EQUALITY(tree2.count(k), n, "Wrong number of duplicates");
+	}
+	return true;
+}
+
 
 template<typename ... TT, typename ... A>
 bool reopen_test(TA<TT...> ta, A && ... a) {
@@ -494,6 +695,126 @@ bool reopen_test(TA<TT...> ta, A && ... a) {
 	return true;
 }
 
+// Defragment a tree left sparse by erases, check that its file shrinks and
+// that it still works, also after reopening.
+bool external_defragment_test() {
+	temp_file tmp;
+	default_comp c;
+	ss_augmenter au;
+	multiset<int> tree2;
+	std::mt19937 rnd(11);
+	boost::uintmax_t before, after;
+	{
+		auto tree = get_btree(TA<btree_external>(), c, au, tmp.path());
+		for (int i=0; i < 60000; ++i) {
+			int x = rnd() % 100000;
+			tree.insert(x);
+			tree2.insert(x);
+		}
+		std::vector<int> y(tree2.begin(), tree2.end());
+		std::shuffle(y.begin(), y.end(), rnd);
+		for (size_t i=0; i < y.size() * 4 / 5; ++i) {
+			tree.erase(tree.find(y[i]));
+			tree2.erase(tree2.find(y[i]));
+		}
+		before = boost::filesystem::file_size(tmp.path());
+		tree.defragment();
+		after = boost::filesystem::file_size(tmp.path());
+		log_debug() << "File size " << before << " -> " << after << std::endl;
+		TEST_ENSURE(after < before / 2, "The file did not shrink");
+		TEST_ENSURE(compare(tree, tree2), "Compare failed after defragment");
+
+		for (int i=0; i < 5000; ++i) {
+			int x = rnd() % 100000;
+			tree.insert(x);
+			tree2.insert(x);
+		}
+		TEST_ENSURE(compare(tree, tree2), "Compare failed after inserts");
+		tree.defragment();
+	}
+	auto tree = get_btree(TA<btree_external>(), c, au, tmp.path());
+	TEST_ENSURE_EQUALITY(tree2.size(), tree.size(), "The tree has the wrong size");
+	TEST_ENSURE(compare(tree, tree2), "Compare failed after reopen");
+	auto i1 = tree.begin();
+	size_t rank=0, sum=0;
+	for (int v: tree2) {
+		TEST_ENSURE(rank_sum(i1) == ss_augment(rank, sum), "Wrong augmentation");
+		++rank;
+		sum += v;
+		++i1;
+	}
+	return true;
+}
+
+// Defragment a tree with small blocks left so sparse that the free blocks
+// do not all fit in the extents kept in memory.
+bool external_defragment_many_extents_test() {
+	temp_file tmp;
+	multiset<int> tree2;
+	std::mt19937 rnd(13);
+	{
+		btree<int, btree_external, btree_blocksize<128> > tree(tmp.path());
+		for (int i=0; i < 400000; ++i) {
+			int x = rnd() % 1000000;
+			tree.insert(x);
+			tree2.insert(x);
+		}
+		std::vector<int> y(tree2.begin(), tree2.end());
+		std::shuffle(y.begin(), y.end(), rnd);
+		for (size_t i=0; i < y.size() * 3 / 4; ++i) {
+			tree.erase(tree.find(y[i]));
+			tree2.erase(tree2.find(y[i]));
+		}
+		tree.defragment();
+		TEST_ENSURE(compare(tree, tree2), "Compare failed after defragment");
+	}
+	btree<int, btree_external, btree_blocksize<128> > tree(tmp.path());
+	TEST_ENSURE_EQUALITY(tree2.size(), tree.size(), "The tree has the wrong size");
+	TEST_ENSURE(compare(tree, tree2), "Compare failed after reopen");
+	return true;
+}
+
+typedef std::array<uint32_t, 4> long_key;
+
+// Keys with long common prefixes take fewer blocks in a compressed tree,
+// which otherwise behaves as an uncompressed one, also after reopening.
+bool external_compressed_test() {
+	temp_file tmp1, tmp2;
+	multiset<long_key> tree2;
+	std::mt19937 rnd(5);
+	{
+		btree<long_key, btree_external, btree_compressed> tree(tmp1.path());
+		btree<long_key, btree_external> plain(tmp2.path());
+		for (int i=0; i < 50000; ++i) {
+			uint32_t x = rnd() % 1000000;
+			long_key k = {{7, 42, x / 1000, x % 1000}};
+			tree.insert(k);
+			plain.insert(k);
+			tree2.insert(k);
+		}
+		TEST_ENSURE_EQUALITY(tree2.size(), tree.size(), "The tree has the wrong size");
+		TEST_ENSURE(compare(tree, tree2), "Compare failed after inserts");
+
+		std::vector<long_key> y(tree2.begin(), tree2.end());
+		std::shuffle(y.begin(), y.end(), rnd);
+		for (size_t i=0; i < y.size() / 2; ++i) {
+			tree.erase(tree.find(y[i]));
+			plain.erase(plain.find(y[i]));
+			tree2.erase(tree2.find(y[i]));
+		}
+		TEST_ENSURE(compare(tree, tree2), "Compare failed after erase");
+	}
+	boost::uintmax_t packed = boost::filesystem::file_size(tmp1.path());
+	boost::uintmax_t unpacked = boost::filesystem::file_size(tmp2.path());
+	log_debug() << "File size " << unpacked << " -> " << packed << std::endl;
+	TEST_ENSURE(packed < unpacked / 2, "The compressed tree is not smaller");
+
+	btree<long_key, btree_external, btree_compressed> tree(tmp1.path());
+	TEST_ENSURE_EQUALITY(tree2.size(), tree.size(), "The tree has the wrong size after reopen");
+	TEST_ENSURE(compare(tree, tree2), "Compare failed after reopen");
+	return true;
+}
+
 template<typename ... TT, typename ... A>
 bool static_iterator_test(TA<TT...> ta, A && ... a) {
 	if (!build_test(ta, std::forward<A>(a)...)) {
@@ -543,11 +864,86 @@ bool internal_bound_test() {
 	return bound_test(TA<btree_internal>());
 }
 
+bool internal_search_test() {
+	return search_test(TA<btree_internal>());
+}
+
+bool internal_insert_sorted_test() {
+	return insert_sorted_test(TA<btree_internal>());
+}
+
+bool internal_scan_test() {
+	return scan_test(TA<btree_internal>());
+}
+
+bool internal_aggregate_test() {
+	return aggregate_test(TA<btree_internal>());
+}
+
+bool internal_rank_test() {
+	return rank_test(TA<btree_internal>());
+}
+
 bool external_basic_test() {
 	temp_file tmp;
 	return basic_test(TA<btree_external>(), tmp.path());
 }
 
+bool external_cache_test() {
+	temp_file tmp;
+	return basic_test(TA<btree_external>(), tmp.path(), default_comp(), empty_augmenter(),
+					  memory_size_type(4 * 1024 * 1024));
+}
+
+bool external_shared_pool_test() {
+	std::shared_ptr<blocks::buffer_pool> pool = blocks::buffer_pool::global();
+	pool->set_memory(64 * blocks::buffer_pool::frame_memory(7000));
+	bool ok = true;
+	{
+		temp_file tmp1, tmp2;
+		btree<int, btree_external> tree1(tmp1.path()), tree2(tmp2.path());
+		for (int i = 0; i < 20000; ++i) {
+			tree1.insert(i);
+			tree2.insert(i * 2);
+		}
+		ok = pool->blocks() > 0 && pool->used() <= pool->memory();
+		for (int i = 0; i < 20000 && ok; i += 7)
+			ok = tree1.find(i) != tree1.end() && tree2.find(i * 2) != tree2.end() && tree2.find(i * 2 + 1) == tree2.end();
+	}
+	ok = ok && pool->blocks() == 0;
+	pool->set_memory(0);
+	TEST_ENSURE(ok, "Trees sharing the global pool failed");
+	return true;
+}
+
+bool external_concurrent_test() {
+	const int n = 30000;
+	const size_t threads = 8;
+	temp_file tmp;
+	btree<int, btree_external> tree(tmp.path());
+	for (int i = 0; i < n; ++i) tree.insert(i * 3);
+
+	std::atomic<bool> ok(true);
+	std::vector<std::thread> workers;
+	for (size_t t = 0; t < threads; ++t) {
+		workers.push_back(std::thread([&, t]() {
+			std::mt19937 rnd(static_cast<unsigned int>(t));
+			for (int i = 0; i < 5000 && ok; ++i) {
+				int k = static_cast<int>(rnd() % (3 * n));
+				auto j = tree.find(k);
+				if ((j != tree.end()) != (k % 3 == 0) || (j != tree.end() && *j != k)) ok = false;
+				auto l = tree.lower_bound(k);
+				int expect = (k + 2) / 3 * 3;
+				for (int m = 0; m < 50 && expect < 3 * n; ++m, ++l, expect += 3)
+					if (l == tree.end() || *l != expect) ok = false;
+			}
+		}));
+	}
+	for (size_t t = 0; t < threads; ++t) workers[t].join();
+	TEST_ENSURE(ok, "A concurrent reader got a wrong result");
+	return true;
+}
+
 bool external_iterator_test() {
 	temp_file tmp;
 	return dynamic_iterator_test(TA<btree_external>(), tmp.path());
@@ -573,6 +969,31 @@ bool external_bound_test() {
 	return bound_test(TA<btree_external>(), tmp.path());
 }
 
+bool external_search_test() {
+	temp_file tmp;
+	return search_test(TA<btree_external>(), tmp.path());
+}
+
+bool external_insert_sorted_test() {
+	temp_file tmp;
+	return insert_sorted_test(TA<btree_external>(), tmp.path());
+}
+
+bool external_scan_test() {
+	temp_file tmp;
+	return scan_test(TA<btree_external>(), tmp.path());
+}
+
+bool external_aggregate_test() {
+	temp_file tmp;
+	return aggregate_test(TA<btree_external>(), tmp.path());
+}
+
+bool external_rank_test() {
+	temp_file tmp;
+	return rank_test(TA<btree_external>(), tmp.path());
+}
+
 bool external_reopen_test() {
 	temp_file tmp;
 	return reopen_test(TA<btree_external>(), tmp.path());
@@ -583,6 +1004,36 @@ bool external_static_reopen_test() {
 	return reopen_test(TA<btree_external, btree_static>(), tmp.path());
 }
 
+bool external_compressed_augment_test() {
+	temp_file tmp;
+	return augment_test(TA<btree_external, btree_compressed, btree_blocksize<512> >(), tmp.path());
+}
+
+bool external_compressed_insert_sorted_test() {
+	temp_file tmp;
+	return insert_sorted_test(TA<btree_external, btree_compressed, btree_blocksize<512> >(), tmp.path());
+}
+
+// Full internal nodes of a compressed tree with small blocks keep all their
+// children.
+bool external_compressed_small_blocks_test() {
+	temp_file tmp;
+	btree<int, btree_external, btree_compressed, btree_blocksize<512> > tree(tmp.path());
+	std::vector<int> x(100000);
+	std::iota(x.begin(), x.end(), 0);
+	std::shuffle(x.begin(), x.end(), std::mt19937(21));
+	for (int v: x) tree.insert(v);
+	TEST_ENSURE_EQUALITY(x.size(), tree.size(), "The tree has the wrong size");
+	for (int v: x)
+		TEST_ENSURE(tree.find(v) != tree.end(), "Item not found");
+	return true;
+}
+
+bool external_compressed_reopen_test() {
+	temp_file tmp;
+	return reopen_test(TA<btree_external, btree_compressed>(), tmp.path());
+}
+
 bool external_static_iterator_test() {
 	temp_file tmp;
 	return static_iterator_test(TA<btree_external, btree_static>(), tmp.path());
@@ -598,6 +1049,11 @@ bool serialized_reopen_test() {
 	return reopen_test(TA<btree_external, btree_serialized, btree_static>(), tmp.path());
 }
 
+bool serialized_aggregate_test() {
+	temp_file tmp;
+	return aggregate_test(TA<btree_external, btree_serialized, btree_static>(), tmp.path());
+}
+
 bool serialized_iterator_test() {
 	temp_file tmp;
 	return static_iterator_test(TA<btree_external, btree_serialized, btree_static>(), tmp.path());
@@ -639,6 +1095,49 @@ bool serialized_zstd_reopen_test() {
 	return reopen_test(TA<btree_external, btree_serialized, btree_static>(), tmp.path(), btree_flags::compress_zstd);
 }
 
+// Trees built through a pipeline with and without parallel serialization
+// have identical files.
+bool parallel_build_test(btree_flags flags) {
+	typedef btree_builder<int, btree_external, btree_serialized, btree_static> builder_t;
+	std::vector<int> items(300000);
+	std::iota(items.begin(), items.end(), 0);
+	temp_file tmp1, tmp2;
+	std::string contents[2];
+	for (int parallel=0; parallel < 2; ++parallel) {
+		const std::string & path = parallel ? tmp2.path() : tmp1.path();
+		builder_t builder(path, default_comp(), empty_augmenter(),
+						  parallel ? flags | btree_flags::build_parallel : flags);
+		pipelining::pipeline p = pipelining::input_vector(items) | pipelining::btree_builder_output(builder);
+		p();
+		auto tree = builder.build("metadata");
+		TEST_ENSURE_EQUALITY(items.size(), tree.size(), "The tree has the wrong size");
+		TEST_ENSURE_EQUALITY(std::string("metadata"), tree.get_metadata(), "Wrong metadata");
+		std::ifstream f(path, std::ios_base::binary);
+		contents[parallel].assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+	}
+	TEST_ENSURE(contents[0] == contents[1], "The files differ");
+
+	btree<int, btree_external, btree_serialized, btree_static> tree(tmp2.path());
+	TEST_ENSURE(std::equal(items.begin(), items.end(), tree.begin()), "Compare failed");
+	for (int x : {0, 1234, 150000, 299999})
+		TEST_ENSURE(tree.find(x) != tree.end() && *tree.find(x) == x, "Item not found");
+	return true;
+}
+
+bool serialized_parallel_build_test() {
+	return parallel_build_test(btree_flags::compress_none);
+}
+
+bool serialized_parallel_lz4_build_test() {
+	SKIP_IF_NO_LZ4;
+	return parallel_build_test(btree_flags::compress_lz4);
+}
+
+bool serialized_parallel_reopen_test() {
+	temp_file tmp;
+	return reopen_test(TA<btree_external, btree_serialized, btree_static>(), tmp.path(), btree_flags::build_parallel);
+}
+
 bool serialized_read_old_format() {
 	std::string old_path = (boost::filesystem::path(__FILE__).parent_path() / "test_btree_old_serialized.tpie").string();
 
@@ -668,17 +1167,38 @@ int main(int argc, char **argv) {
 		.test(internal_static_test, "internal_static")
 		.test(internal_unordered_test, "internal_unordered")
 		.test(internal_bound_test, "internal_bound")
+		.test(internal_search_test, "internal_search")
+		.test(internal_insert_sorted_test, "internal_insert_sorted")
+		.test(internal_scan_test, "internal_scan")
+		.test(internal_aggregate_test, "internal_aggregate")
+		.test(internal_rank_test, "internal_rank")
 		.test(external_basic_test, "external_basic")
+		.test(external_cache_test, "external_cache")
+		.test(external_shared_pool_test, "external_shared_pool")
+		.test(external_concurrent_test, "external_concurrent")
 		.test(external_iterator_test, "external_iterator")
 		.test(external_key_and_comparator_test, "external_key_and_compare")
 		.test(external_augment_test, "external_augment")
         .test(external_build_test, "external_build")
 		.test(external_bound_test, "external_bound")
+		.test(external_search_test, "external_search")
+		.test(external_insert_sorted_test, "external_insert_sorted")
+		.test(external_scan_test, "external_scan")
+		.test(external_aggregate_test, "external_aggregate")
+		.test(external_rank_test, "external_rank")
+		.test(external_defragment_test, "external_defragment")
+		.test(external_defragment_many_extents_test, "external_defragment_many_extents")
 		.test(external_reopen_test, "external_reopen")
 		.test(external_static_reopen_test, "external_static_reopen")
 		.test(external_static_iterator_test, "external_static_iterator")
+		.test(external_compressed_test, "external_compressed")
+		.test(external_compressed_augment_test, "external_compressed_augment")
+		.test(external_compressed_insert_sorted_test, "external_compressed_insert_sorted")
+		.test(external_compressed_small_blocks_test, "external_compressed_small_blocks")
+		.test(external_compressed_reopen_test, "external_compressed_reopen")
 		.test(serialized_build_test, "serialized_build")
 		.test(serialized_reopen_test, "serialized_reopen")
+		.test(serialized_aggregate_test, "serialized_aggregate")
 		.test(serialized_iterator_test, "serialized_iterator")
         .test(serialized_lz4_build_test, "serialized_lz4_build")
 		.test(serialized_lz4_reopen_test, "serialized_lz4_reopen")
@@ -686,5 +1206,8 @@ int main(int argc, char **argv) {
 		.test(serialized_snappy_reopen_test, "serialized_snappy_reopen")
         .test(serialized_zstd_build_test, "serialized_zstd_build")
 		.test(serialized_zstd_reopen_test, "serialized_zstd_reopen")
+		.test(serialized_parallel_build_test, "serialized_parallel_build")
+		.test(serialized_parallel_lz4_build_test, "serialized_parallel_lz4_build")
+		.test(serialized_parallel_reopen_test, "serialized_parallel_reopen")
 		.test(serialized_read_old_format, "serialized_read_old_format");
 }
@@ -0,0 +1,137 @@
+// -*- mode: c++; tab-width: 4; indent-tabs-mode: t; c-file-style: "stroustrup"; -*-
+// vi:set ts=4 sts=4 sw=4 noet :
+// Copyright 2026, The TPIE development team
+//
+// This file is part of TPIE.
+//
+// TPIE is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// TPIE is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with TPIE.  If not, see <http://www.gnu.org/licenses/>
+#include "common.h"
+#include <tpie/external_hash_map.h>
+#include <map>
+#include <random>
+
+using namespace tpie;
+
+typedef external_hash_map<uint64_t, uint64_t> map_t;
+
+// Random inserts, overwrites, lookups and erases compared against std::map.
+bool random_test(memory_size_type memory, uint64_t keys, uint64_t operations, bool spill) {
+	map_t m(memory);
+	std::map<uint64_t, uint64_t> ref;
+	std::mt19937_64 rnd(17);
+	for (uint64_t i = 0; i < operations; ++i) {
+		uint64_t key = rnd() % keys;
+		uint64_t r = rnd() % 10;
+		if (r < 6) {
+			uint64_t data = rnd();
+			bool inserted = ref.find(key) == ref.end();
+			ref[key] = data;
+			TEST_ENSURE_EQUALITY(inserted, m.insert(key, data), "insert() returned the wrong value");
+		} else if (r < 9) {
+			uint64_t data = 0;
+			bool found = m.find(key, data);
+			std::map<uint64_t, uint64_t>::iterator j = ref.find(key);
+			TEST_ENSURE_EQUALITY(j != ref.end(), found, "find() returned the wrong value");
+			if (found) TEST_ENSURE_EQUALITY(j->second, data, "Wrong data");
+		} else {
+			TEST_ENSURE_EQUALITY(ref.erase(key) == 1, m.erase(key), "erase() returned the wrong value");
+		}
+		TEST_ENSURE_EQUALITY(ref.size(), m.size(), "Sizes differ");
+	}
+	log_debug() << m.partitions() << " partitions, " << m.spilled_partitions() << " spilled" << std::endl;
+	TEST_ENSURE_EQUALITY(spill, m.spilled_partitions() > 0, "Wrong number of spilled partitions");
+	for (std::map<uint64_t, uint64_t>::iterator i = ref.begin(); i != ref.end(); ++i) {
+		uint64_t data = 0;
+		TEST_ENSURE(m.find(i->first, data), "Key missing");
+		TEST_ENSURE_EQUALITY(i->second, data, "Wrong data");
+	}
+	return true;
+}
+
+bool basic_test() {
+	return random_test(16 * 1024 * 1024, 20000, 100000, false);
+}
+
+bool spill_test() {
+	return random_test(6 * 1024 * 1024, 400000, 600000, true);
+}
+
+bool batch_test() {
+	const uint64_t keys = 600000;
+	map_t m(6 * 1024 * 1024);
+	std::mt19937_64 rnd(3);
+	array<map_t::value_t> items(keys / 2);
+	for (uint64_t round = 0; round < 4; ++round) {
+		// Odd keys only, each with data derived from the round
+		for (uint64_t i = 0; i < items.size(); ++i) {
+			uint64_t key = 2 * ((i * 7919 + round * 104729) % (keys / 2)) + 1;
+			items[i] = map_t::value_t(key, key * 3 + round);
+		}
+		memory_size_type inserted = m.insert(array_view<const map_t::value_t>(items));
+		TEST_ENSURE_EQUALITY(round == 0 ? keys / 2 : 0, inserted, "Wrong number of keys inserted");
+	}
+	TEST_ENSURE(m.spilled_partitions() > 0, "Map should have spilled");
+
+	array<uint64_t> query(50000);
+	array<uint64_t> data(query.size());
+	array<bool> found(query.size());
+	for (uint64_t i = 0; i < query.size(); ++i) query[i] = rnd() % keys;
+	memory_size_type hits = m.find(array_view<const uint64_t>(query), data, found);
+	memory_size_type expected = 0;
+	for (uint64_t i = 0; i < query.size(); ++i) {
+		TEST_ENSURE_EQUALITY(query[i] % 2 == 1, found[i], "Wrong key found");
+		if (!found[i]) continue;
+		++expected;
+		TEST_ENSURE_EQUALITY(query[i] * 3 + 3, data[i], "Wrong data");
+		uint64_t d = 0;
+		TEST_ENSURE(m.find(query[i], d) && d == data[i], "Batch and point lookups differ");
+	}
+	TEST_ENSURE_EQUALITY(expected, hits, "Wrong number of hits");
+	return true;
+}
+
+class external_hash_map_memory_test : public memory_test {
+public:
+	external_hash_map_memory_test() : m_memory(6 * 1024 * 1024) {}
+
+	virtual void alloc() {
+		m_map = tpie_new<map_t>(m_memory);
+	}
+
+	virtual void use() {
+		std::mt19937_64 rnd(9);
+		for (uint64_t i = 0; i < 500000; ++i) m_map->insert(rnd(), i);
+		log_debug() << m_map->spilled_partitions() << " partitions spilled" << std::endl;
+	}
+
+	virtual void free() {
+		tpie_delete(m_map);
+	}
+
+	virtual size_type claimed_size() {
+		return m_memory;
+	}
+
+private:
+	const memory_size_type m_memory;
+	map_t * m_map;
+};
+
+int main(int argc, char ** argv) {
+	return tests(argc, argv)
+		.test(basic_test, "basic")
+		.test(spill_test, "spill")
+		.test(batch_test, "batch")
+		.test(external_hash_map_memory_test(), "memory");
+}
@@ -291,6 +291,91 @@ bool remove_group_buffer_test(memory_size_type mmAvail, memory_size_type blockSi
 	return cyclic_pq_test(pq, items, iterations);
 }
 
+template <typename heap_t>
+bool merge_heap_test(memory_size_type mmAvail, memory_size_type blockSize, stream_size_type items, stream_size_type iterations) {
+	typedef bit_pertume_compare< std::greater<uint64_t> > comp_t;
+	typedef tpie::priority_queue<uint64_t, comp_t, pq_overflow_heap<uint64_t, comp_t>, heap_t> PQ;
+	const float blockFact = float(blockSize) / (1<<21);
+	TEST_ENSURE(PQ::memory_usage(items, blockFact) > mmAvail, "Too much mmAvail, would use internal pq");
+	PQ pq(mmAvail, blockFact, items);
+	return cyclic_pq_test(pq, items, iterations);
+}
+
+bool compressed_test(memory_size_type mmAvail, stream_size_type items) {
+	typedef ami::priority_queue<uint64_t> PQ;
+	const float blockFact = float(1<<9) / (1<<21);
+	TEST_ENSURE(PQ::memory_usage(items, blockFact) > mmAvail, "Too much mmAvail, would use internal pq");
+	PQ pq(mmAvail, blockFact, items, compression_normal);
+	std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<uint64_t> > pq2;
+	std::default_random_engine rnd;
+	// Fill the queue, then alternate between pops and pushes so that slots
+	// are partially consumed and refilled, and finally drain it.
+	for (int phase = 0; phase < 3; ++phase) {
+		for (stream_size_type i = 0; i < items; ++i) {
+			if (phase == 0 || (phase == 1 && i % 3 == 0)) {
+				uint64_t x = rnd() % 1000000 + (phase == 1 ? pq2.top() : 0);
+				pq.push(x);
+				pq2.push(x);
+			} else if (!pq2.empty()) {
+				TEST_ENSURE_EQUALITY(pq2.top(), pq.top(), "Tops differ");
+				pq.pop();
+				pq2.pop();
+			}
+			TEST_ENSURE_EQUALITY(pq2.size(), pq.size(), "Sizes differ");
+		}
+	}
+	TEST_ENSURE(pq.empty() && pq2.empty(), "Queues not empty");
+	return true;
+}
+
+bool batch_test(memory_size_type mmAvail, stream_size_type iterations) {
+	typedef ami::priority_queue<uint64_t> PQ;
+	const float blockFact = float(1<<9) / (1<<21);
+	PQ pq(mmAvail, blockFact);
+	std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<uint64_t> > pq2;
+	std::default_random_engine rnd;
+	std::vector<uint64_t> batch;
+	std::vector<uint64_t> popped;
+	for (stream_size_type i = 0; i < iterations; ++i) {
+		batch.resize(rnd() % 3000);
+		for (size_t j = 0; j < batch.size(); ++j) {
+			batch[j] = rnd() % 1000000 + i * 1000;
+			pq2.push(batch[j]);
+		}
+		pq.push_batch(batch);
+
+		popped.clear();
+		if (i % 2 == 0) {
+			uint64_t threshold = i * 1000 + rnd() % 1000000;
+			pq.pop_until(threshold, std::back_inserter(popped));
+			for (size_t j = 0; j < popped.size(); ++j) {
+				TEST_ENSURE_EQUALITY(pq2.top(), popped[j], "pop_until returned the wrong element");
+				pq2.pop();
+			}
+			TEST_ENSURE(pq2.empty() || pq2.top() >= threshold, "pop_until stopped early");
+		} else {
+			stream_size_type n = rnd() % 3000;
+			pq.pop_batch(n, std::back_inserter(popped));
+			TEST_ENSURE_EQUALITY(std::min<size_t>(n, pq2.size()), popped.size(),
+								 "pop_batch returned the wrong number of elements");
+			for (size_t j = 0; j < popped.size(); ++j) {
+				TEST_ENSURE_EQUALITY(pq2.top(), popped[j], "pop_batch returned the wrong element");
+				pq2.pop();
+			}
+		}
+		TEST_ENSURE_EQUALITY(pq2.size(), pq.size(), "Sizes differ");
+		if (!pq.empty()) TEST_ENSURE_EQUALITY(pq2.top(), pq.top(), "Tops differ");
+	}
+	popped.clear();
+	pq.pop_batch(pq.size(), std::back_inserter(popped));
+	for (size_t j = 0; j < popped.size(); ++j) {
+		TEST_ENSURE_EQUALITY(pq2.top(), popped[j], "pop_batch returned the wrong element");
+		pq2.pop();
+	}
+	TEST_ENSURE(pq.empty() && pq2.empty(), "Queues not empty");
+	return true;
+}
+
 int main(int argc, char **argv) {
 	return tpie::tests(argc, argv, 128)
 		.test(basic_test, "basic")
@@ -306,5 +391,16 @@ int main(int argc, char **argv) {
 			  "blocksize", static_cast<memory_size_type>(1<<9),
 			  "items", static_cast<stream_size_type>(5000),
 			  "iterations", static_cast<stream_size_type>(100000))
+		.test(merge_heap_test<dary_heap<4> >, "merge_heap",
+			  "mmavail", static_cast<memory_size_type>((1<<14) + (1<<13) + (1<<12) + (1<<10) + (1<<7)),
+			  "blocksize", static_cast<memory_size_type>(1<<9),
+			  "items", static_cast<stream_size_type>(5000),
+			  "iterations", static_cast<stream_size_type>(100000))
+		.test(batch_test, "batch",
+			  "mmavail", static_cast<memory_size_type>(1<<16),
+			  "iterations", static_cast<stream_size_type>(200))
+		.test(compressed_test, "compressed",
+			  "mmavail", static_cast<memory_size_type>(1<<16),
+			  "items", static_cast<stream_size_type>(200000))
 		;
 }
@@ -108,8 +108,139 @@ bool size_test(memory_size_type size, memory_size_type block_size) {
 	return true;
 }
 
+bool hint_test() {
+	const memory_size_type bs = 1024;
+	temp_file file;
+	freespace_collection collection(file.path(), bs);
+	for(memory_size_type i = 0; i < 100; ++i)
+		TEST_ENSURE_EQUALITY(i * bs, collection.alloc().position, "Blocks should be allocated in order");
+
+	// Free blocks 10-19 and 50-59, which become two extents
+	for(memory_size_type i = 10; i < 20; ++i) collection.free(block_handle(i * bs, bs));
+	for(memory_size_type i = 59; i >= 50; --i) collection.free(block_handle(i * bs, bs));
+	TEST_ENSURE_EQUALITY(memory_size_type(2), collection.extents(), "Adjacent blocks should merge");
+	TEST_ENSURE_EQUALITY(stream_size_type(20), collection.free_blocks(), "Wrong number of free blocks");
+
+	// The closest free block wins, and on ties the one after the hint
+	TEST_ENSURE_EQUALITY(stream_size_type(55 * bs), collection.alloc(55 * bs).position, "The hinted block is free");
+	TEST_ENSURE_EQUALITY(stream_size_type(50 * bs), collection.alloc(45 * bs).position, "Wrong block near the hint");
+	TEST_ENSURE_EQUALITY(stream_size_type(19 * bs), collection.alloc(30 * bs).position, "Wrong block near the hint");
+	TEST_ENSURE_EQUALITY(stream_size_type(56 * bs), collection.alloc(55 * bs).position, "Wrong block near the hint");
+	TEST_ENSURE_EQUALITY(stream_size_type(100 * bs), collection.alloc(98 * bs).position, "The end of the file is closest");
+	TEST_ENSURE_EQUALITY(stream_size_type(10 * bs), collection.alloc().position, "The first free block should be used");
+	TEST_ENSURE_EQUALITY(stream_size_type(101 * bs), collection.size(), "Wrong size");
+
+	// Freeing the last blocks shrinks the file, also past free extents
+	collection.free(block_handle(99 * bs, bs));
+	TEST_ENSURE_EQUALITY(stream_size_type(101 * bs), collection.size(), "Only the last blocks shrink the file");
+	collection.free(block_handle(100 * bs, bs));
+	TEST_ENSURE_EQUALITY(stream_size_type(99 * bs), collection.size(), "The file should shrink");
+	for(memory_size_type i = 60; i < 99; ++i) collection.free(block_handle(i * bs, bs));
+	TEST_ENSURE_EQUALITY(stream_size_type(57 * bs), collection.size(), "The file should shrink past the free extent");
+	return true;
+}
+
+bool reopen_test() {
+	const memory_size_type bs = 1024;
+	temp_file file;
+	std::set<stream_size_type> used;
+	{
+		freespace_collection collection(file.path(), bs);
+		for(memory_size_type i = 0; i < 200; ++i) collection.alloc();
+		for(memory_size_type i = 0; i < 200; i += 3) collection.free(block_handle(i * bs, bs));
+		for(memory_size_type i = 0; i < 200; ++i) if (i % 3 != 0) used.insert(i * bs);
+	}
+	freespace_collection collection(file.path(), bs);
+	TEST_ENSURE_EQUALITY(stream_size_type(200 * bs), collection.size(), "Wrong size after reopen");
+	TEST_ENSURE_EQUALITY(stream_size_type(67), collection.free_blocks(), "Wrong number of free blocks after reopen");
+	for(memory_size_type i = 0; i < 67; ++i) {
+		block_handle h = collection.alloc(i * bs);
+		TEST_ENSURE(used.insert(h.position).second, "A used block was allocated");
+		TEST_ENSURE(h.position < 200 * bs, "The free blocks should be used first");
+	}
+	return true;
+}
+
+// A fragmented file keeps at most the given number of extents in memory,
+// and the blocks beyond them are still reused, also after reopening.
+bool bound_test() {
+	const memory_size_type bs = 1024;
+	temp_file file;
+	std::set<stream_size_type> freed;
+	{
+		freespace_collection collection(file.path(), bs, 4);
+		for(memory_size_type i = 0; i < 100; ++i) collection.alloc();
+		for(memory_size_type i = 0; i < 98; i += 2) {
+			collection.free(block_handle(i * bs, bs));
+			freed.insert(i * bs);
+		}
+		TEST_ENSURE_EQUALITY(memory_size_type(4), collection.extents(), "Too many extents");
+		TEST_ENSURE_EQUALITY(stream_size_type(49), collection.free_blocks(), "Wrong number of free blocks");
+		// Extents 0-2, 4, 6 and 11; a hint inside a full extent takes one of
+		// its ends
+		collection.free(block_handle(1 * bs, bs));
+		collection.free(block_handle(11 * bs, bs));
+		freed.insert(1 * bs);
+		freed.insert(11 * bs);
+		TEST_ENSURE_EQUALITY(memory_size_type(4), collection.extents(), "Wrong number of extents");
+		block_handle h = collection.alloc(1 * bs);
+		TEST_ENSURE_EQUALITY(stream_size_type(0), h.position, "Wrong block near the hint");
+		TEST_ENSURE_EQUALITY(memory_size_type(4), collection.extents(), "An extent was split");
+		freed.erase(h.position);
+	}
+	freespace_collection collection(file.path(), bs, 4);
+	TEST_ENSURE_EQUALITY(stream_size_type(100 * bs), collection.size(), "Wrong size after reopen");
+	TEST_ENSURE_EQUALITY(stream_size_type(freed.size()), collection.free_blocks(), "Wrong number of free blocks after reopen");
+	while (!freed.empty()) {
+		block_handle h = collection.alloc();
+		TEST_ENSURE(freed.erase(h.position) == 1, "A used block was allocated");
+	}
+	TEST_ENSURE_EQUALITY(stream_size_type(100 * bs), collection.alloc().position, "The file should grow last");
+	return true;
+}
+
+// Blocks can be taken at exact positions from the extents, the stack and
+// the end of the file, also when the extents are full.
+bool exact_test() {
+	const memory_size_type bs = 1024;
+	temp_file file;
+	freespace_collection collection(file.path(), bs, 4);
+	for(memory_size_type i = 0; i < 100; ++i) collection.alloc();
+	// Extents 0, 2, 4 and 10-29; the blocks 6 and 8 are on the stack
+	for(memory_size_type i = 10; i < 30; ++i) collection.free(block_handle(i * bs, bs));
+	for(memory_size_type i = 0; i < 10; i += 2) collection.free(block_handle(i * bs, bs));
+	TEST_ENSURE_EQUALITY(memory_size_type(4), collection.extents(), "Wrong number of extents");
+	stream_size_type free = collection.free_blocks();
+
+	TEST_ENSURE(!collection.take_exact(1 * bs), "A used block was taken");
+	TEST_ENSURE(!collection.take_exact(101 * bs), "A block past the end was taken");
+	TEST_ENSURE(collection.take_exact(6 * bs), "A block on the stack was not taken");
+	TEST_ENSURE(!collection.take_exact(6 * bs), "A block was taken twice");
+	// Splitting 10-29 moves 10-12 to the stack
+	TEST_ENSURE(collection.take_exact(13 * bs), "A block in an extent was not taken");
+	TEST_ENSURE_EQUALITY(memory_size_type(4), collection.extents(), "Too many extents");
+	TEST_ENSURE(collection.take_exact(11 * bs), "A block moved to the stack was not taken");
+	TEST_ENSURE(collection.take_exact(100 * bs), "The end of the file was not taken");
+	TEST_ENSURE_EQUALITY(stream_size_type(101 * bs), collection.size(), "The file did not grow");
+	TEST_ENSURE_EQUALITY(free - 3, collection.free_blocks(), "Wrong number of free blocks");
+
+	std::set<stream_size_type> freed;
+	for(stream_size_type i : {0, 2, 4, 8, 10, 12}) freed.insert(i * bs);
+	for(stream_size_type i = 14; i < 30; ++i) freed.insert(i * bs);
+	while (!freed.empty()) {
+		block_handle h = collection.alloc();
+		TEST_ENSURE(freed.erase(h.position) == 1, "A used block was allocated");
+	}
+	TEST_ENSURE_EQUALITY(stream_size_type(101 * bs), collection.alloc().position, "The file should grow last");
+	return true;
+}
+
 int main(int argc, char **argv) {
 	return tpie::tests(argc, argv)
 		.test(alloc_test, "alloc", "size", 1000, "block_size", 1024)
-		.test(size_test, "size", "size", 1000, "block_size", 1024);
+		.test(size_test, "size", "size", 1000, "block_size", 1024)
+		.test(hint_test, "hint")
+		.test(reopen_test, "reopen")
+		.test(bound_test, "bound")
+		.test(exact_test, "exact");
 }
\ No newline at end of file
@@ -21,6 +21,7 @@
 #include <tpie/hash_map.h>
 #include <tpie/tpie.h>
 #include <map>
+#include <set>
 #include <random>
 #include <unordered_map>
 #include "test_timer.h"
@@ -66,6 +67,103 @@ bool basic_test() {
 	return true;
 }
 
+// Keep the table near its capacity while replacing keys, so erased slots
+// pile up as tombstones and are cleared by rehashing in place.
+bool group_probing_churn_test() {
+	typedef tpie::hash_map<size_t, size_t, tpie::hash<size_t>, std::equal_to<size_t>, size_t, group_probing_hash_table> map_t;
+	const size_t capacity = 5000;
+	map_t q1(capacity);
+	map<size_t, size_t> q2;
+	std::mt19937_64 prng(7);
+	for (size_t i = 0; i < 200000; ++i) {
+		size_t k = prng() % 20000;
+		if (q2.size() < capacity && prng() % 2) {
+			bool inserted = q2.find(k) == q2.end();
+			q2[k] = i;
+			TEST_ENSURE_EQUALITY(inserted, q1.insert(k, i), "insert() returned the wrong value");
+			if (!inserted) q1[k] = i;
+		} else if (q2.count(k)) {
+			q1.erase(k);
+			q2.erase(k);
+		} else {
+			TEST_ENSURE(q1.find(k) == q1.end(), "Erased key found");
+		}
+		TEST_ENSURE_EQUALITY(q2.size(), q1.size(), "Sizes differ");
+	}
+	for (map<size_t, size_t>::iterator i = q2.begin(); i != q2.end(); ++i) {
+		map_t::iterator j = q1.find(i->first);
+		TEST_ENSURE(j != q1.end(), "Key missing");
+		TEST_ENSURE_EQUALITY(i->second, j.value(), "Value differs");
+	}
+	size_t n = 0;
+	for (map_t::iterator i = q1.begin(); i != q1.end(); ++i) ++n;
+	TEST_ENSURE_EQUALITY(q2.size(), n, "Iteration missed entries");
+	return true;
+}
+
+// Counts the key comparisons, which are about one per lookup when the keys
+// are spread over the table.
+struct counting_equal {
+	static size_t comparisons;
+	bool operator()(const std::string & a, const std::string & b) const {
+		++comparisons;
+		return a == b;
+	}
+};
+
+size_t counting_equal::comparisons = 0;
+
+// tpie::hash<std::string> gives 32-bit hash values, which must still spread
+// the keys over all groups.
+bool group_probing_strings_test() {
+	typedef tpie::hash_map<std::string, size_t, tpie::hash<std::string>, counting_equal, size_t, group_probing_hash_table> map_t;
+	const size_t n = 40000;
+	map_t q1(n);
+	for (size_t i = 0; i < n; ++i) q1[std::to_string(i * 7919)] = i;
+	TEST_ENSURE_EQUALITY(n, q1.size(), "Wrong size");
+	counting_equal::comparisons = 0;
+	for (size_t i = 0; i < n; ++i) {
+		TEST_ENSURE_EQUALITY(i, q1.find(std::to_string(i * 7919)).value(), "Value differs");
+		TEST_ENSURE(q1.find(std::to_string(i * 7919 + 1)) == q1.end(), "Element too much");
+	}
+	log_debug() << "Comparisons per lookup " << double(counting_equal::comparisons) / (2 * n) << std::endl;
+	TEST_ENSURE(counting_equal::comparisons < 2 * n * 2, "Too many comparisons");
+	return true;
+}
+
+bool fast_hash_test() {
+	// Every length and every single byte change gives a new string hash,
+	// and both string types agree.
+	std::string s(200, 'a');
+	std::set<size_t> seen;
+	for (size_t n = 0; n <= s.size(); ++n) {
+		std::string t = s.substr(0, n);
+		size_t v = tpie::fast_hash<std::string>()(t);
+		TEST_ENSURE(seen.insert(v).second, "Prefixes collide");
+		TEST_ENSURE_EQUALITY(v, tpie::fast_hash<const char *>()(t.c_str()), "String types differ");
+		for (size_t i = 0; i < n; ++i) {
+			t[i] = 'b';
+			TEST_ENSURE(tpie::fast_hash<std::string>()(t) != v, "Byte change not detected");
+			t[i] = 'a';
+		}
+	}
+
+	tpie::hash_map<std::string, size_t, tpie::fast_hash<std::string> > q1(10000);
+	tpie::hash_map<std::pair<int, int>, size_t, tpie::fast_hash<std::pair<int, int> > > q2(10000);
+	for (size_t i = 0; i < 10000; ++i) {
+		q1[std::to_string(i * 7919)] = i;
+		q2[std::make_pair(static_cast<int>(i / 100), static_cast<int>(i % 100))] = i;
+	}
+	TEST_ENSURE_EQUALITY(size_t(10000), q1.size(), "Wrong size");
+	TEST_ENSURE_EQUALITY(size_t(10000), q2.size(), "Wrong size");
+	for (size_t i = 0; i < 10000; ++i) {
+		TEST_ENSURE_EQUALITY(i, q1.find(std::to_string(i * 7919))->second, "Value differs");
+		TEST_ENSURE_EQUALITY(i, q2.find(std::make_pair(static_cast<int>(i / 100), static_cast<int>(i % 100)))->second, "Value differs");
+		TEST_ENSURE(q1.find(std::to_string(i * 7919 + 1)) == q1.end(), "Element too much");
+	}
+	return true;
+}
+
 struct charm_gen {
 	static inline size_t key(size_t i) {
 		return (i*21467) % 0x7FFFFFFF;
@@ -143,8 +241,10 @@ void test_speed() {
 	erase_unordered_map.output();
 }
 
+template <template <typename value_t, typename hash_t, typename equal_t, typename index_t> class table_t>
 bool iterator_test() {
-	tpie::hash_map<int, char> m(20);
+	typedef tpie::hash_map<int, char, tpie::hash<int>, std::equal_to<int>, size_t, table_t> map_t;
+	map_t m(20);
 	vector< std::pair<int,char> > d;
 	vector< std::pair<int,char> > r;
 	
@@ -154,7 +254,7 @@ bool iterator_test() {
 	d.push_back(make_pair(9,'e'));
 	d.push_back(make_pair(10,'x'));
 	for(size_t i=0; i < d.size(); ++i) m.insert(d[i].first, d[i].second);
-	for(tpie::hash_map<int, char>::iterator i=m.begin(); i != m.end(); ++i)
+	for(typename map_t::iterator i=m.begin(); i != m.end(); ++i)
 		r.push_back(*i);
 	sort(d.begin(), d.end());
 	sort(r.begin(), r.end());
@@ -162,12 +262,14 @@ bool iterator_test() {
 	return true;
 }
 
+template <template <typename value_t, typename hash_t, typename equal_t, typename index_t> class table_t>
 class hashmap_memory_test: public memory_test {
 public:
-	tpie::hash_map<int, char> * a;
-	virtual void alloc() {a = new tpie::hash_map<int, char>(123456);}
+	typedef tpie::hash_map<int, char, tpie::hash<int>, std::equal_to<int>, size_t, table_t> map_t;
+	map_t * a;
+	virtual void alloc() {a = new map_t(123456);}
 	virtual void free() {delete a;}
-	virtual size_type claimed_size() {return static_cast<size_type>(tpie::hash_map<int, char>::memory_usage(123456));}
+	virtual size_type claimed_size() {return static_cast<size_type>(map_t::memory_usage(123456));}
 };
 
 bool speed() {
@@ -179,6 +281,10 @@ bool speed() {
 	test_speed<identity_gen, linear_probing_hash_table>();
 	tpie::log_info() << "=======================> Chaining, Identity Dataset <=========================" << std::endl;
 	test_speed<identity_gen, chaining_hash_table>();
+	tpie::log_info() << "====================> Group Probing, Charm Dataset <==========================" << std::endl;
+	test_speed<charm_gen, group_probing_hash_table>();
+	tpie::log_info() << "===================> Group Probing, Identity Dataset <========================" << std::endl;
+	test_speed<identity_gen, group_probing_hash_table>();
 	return true;
 }
 
@@ -186,7 +292,13 @@ int main(int argc, char **argv) {
 	return tpie::tests(argc, argv)
 		.test(basic_test<chaining_hash_table>, "chaining")
 		.test(basic_test<linear_probing_hash_table>, "linear_probing")
+		.test(basic_test<group_probing_hash_table>, "group_probing")
+		.test(group_probing_churn_test, "group_probing_churn")
+		.test(group_probing_strings_test, "group_probing_strings")
+		.test(fast_hash_test, "fast_hash")
 		.test(speed, "speed")
-		.test(iterator_test, "iterators")
-		.test(hashmap_memory_test(), "memory");
+		.test(iterator_test<chaining_hash_table>, "iterators")
+		.test(iterator_test<group_probing_hash_table>, "group_probing_iterators")
+		.test(hashmap_memory_test<chaining_hash_table>(), "memory")
+		.test(hashmap_memory_test<group_probing_hash_table>(), "group_probing_memory");
 }
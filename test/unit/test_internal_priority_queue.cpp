@@ -18,6 +18,7 @@
 // along with TPIE.  If not, see <http://www.gnu.org/licenses/>
 #include "common.h"
 #include <tpie/internal_priority_queue.h>
+#include <tpie/internal_sequence_heap.h>
 #include <vector>
 #include "priority_queue.h"
 
@@ -27,12 +28,13 @@
 // ctor(max_size)            basic
 // ctor(max_size, IT, IT)    TODO
 // clear                     TODO
+// data                      dary4, dary8
 // empty                     TODO
 // get_array                 TODO
 // insert                    TODO
 // make_safe                 TODO
 // pop                       basic
-// pop_and_push              TODO
+// pop_and_push              pop_and_push
 // push                      basic
 // resize                    TODO
 // size                      basic
@@ -57,6 +59,57 @@ bool large_cycle(){
 	return cyclic_pq_test(pq, x, 20000000);
 }
 
+template <typename heap_t>
+bool dary_test() {
+	size_t z = 104729;
+	internal_priority_queue<uint64_t, bit_pertume_compare<std::greater<uint64_t> >, heap_t> pq(z);
+	// The children of the root start a cache line
+	TEST_ENSURE_EQUALITY(0u, reinterpret_cast<std::uintptr_t>(pq.data() + 1) % 64, "Heap not aligned");
+	return basic_pq_test(pq, z);
+}
+
+bool sequence_heap_test() {
+	size_t z = 1047290;
+	internal_sequence_heap<uint64_t, bit_pertume_compare<std::greater<uint64_t> > > pq(z);
+	return basic_pq_test(pq, z);
+}
+
+template <typename PQ>
+bool pop_and_push_test() {
+	const size_t z = 100000;
+	PQ pq(z);
+	std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<uint64_t> > pq2;
+	std::default_random_engine rnd;
+	for (size_t i = 0; i < z / 2; ++i) {
+		uint64_t r = rnd();
+		pq.push(r);
+		pq2.push(r);
+	}
+	for (size_t i = 0; i < 10 * z; ++i) {
+		TEST_ENSURE_EQUALITY(pq2.top(), pq.top(), "Top element differs");
+		uint64_t r = pq.top() + rnd() % 1000000;
+		pq.pop_and_push(r);
+		pq2.pop();
+		pq2.push(r);
+	}
+	TEST_ENSURE_EQUALITY(pq2.size(), pq.size(), "Size differs");
+	return true;
+}
+
+class sequence_heap_memory_test: public memory_test {
+public:
+	typedef internal_sequence_heap<int> pq_t;
+	pq_t * a;
+	virtual void alloc() {a = tpie_new<pq_t>(1234567);}
+	virtual void use() {
+		for (int i = 0; i < 1234567; ++i) a->push(static_cast<int>(i * uint64_t(104729) % 1234567));
+		for (int i = 0; i < 1000000; ++i) a->pop();
+		for (int i = 0; i < 1000000; ++i) a->push(i);
+	}
+	virtual void free() {tpie_delete(a);}
+	virtual size_type claimed_size() {return static_cast<size_type>(pq_t::memory_usage(1234567));}
+};
+
 class my_memory_test: public memory_test {
 public:
 	internal_priority_queue<int> * a;
@@ -69,5 +122,11 @@ int main(int argc, char **argv) {
 	return tpie::tests(argc, argv)
 		.test(basic_test, "basic")
 		.test(large_cycle, "large_cycle")
-		.test(my_memory_test(), "memory");
+		.test(my_memory_test(), "memory")
+		.test(dary_test<dary_heap<4> >, "dary4")
+		.test(dary_test<dary_heap<8> >, "dary8")
+		.test(sequence_heap_test, "sequence_heap")
+		.test(pop_and_push_test<internal_priority_queue<uint64_t, std::less<uint64_t>, dary_heap<4> > >, "pop_and_push")
+		.test(pop_and_push_test<internal_sequence_heap<uint64_t> >, "sequence_heap_pop_and_push")
+		.test(sequence_heap_memory_test(), "sequence_heap_memory");
 }
@@ -19,6 +19,7 @@
 
 #include "common.h"
 #include <tpie/pipelining/merge_sorter.h>
+#include <tpie/merge_kernels.h>
 #include <tpie/parallel_sort.h>
 #include <tpie/sysinfo.h>
 #include <random>
@@ -158,6 +159,84 @@ bool tall_tree_test(size_t fanout, size_t height) {
 	return true;
 }
 
+template <typename T>
+bool merge_kernel_test_type(merge_kernel_isa isa, std::mt19937 & rng) {
+	const T extremes[] = {std::numeric_limits<T>::min(), std::numeric_limits<T>::max(), 0};
+	for (size_t test = 0; test < 200; ++test) {
+		// Lengths around the vector widths, and some long blocks.
+		size_t na = test < 100 ? test % 40 : rng() % 5000;
+		size_t nb = test < 100 ? test / 3 : rng() % 5000;
+		// Few distinct keys in some tests to get many ties.
+		T mod = test % 4 == 0 ? 5 : 0;
+		std::vector<T> a(na), b(nb);
+		for (auto & x : a) x = mod ? static_cast<T>(rng() % mod) : (rng() % 16 == 0 ? extremes[rng() % 3] : static_cast<T>(rng()));
+		for (auto & x : b) x = mod ? static_cast<T>(rng() % mod) : (rng() % 16 == 0 ? extremes[rng() % 3] : static_cast<T>(rng()));
+		std::sort(a.begin(), a.end());
+		std::sort(b.begin(), b.end());
+		std::vector<T> expected(na + nb), actual(na + nb);
+		std::merge(a.begin(), a.end(), b.begin(), b.end(), expected.begin());
+		merge_sorted_blocks(a.data(), na, b.data(), nb, actual.data());
+		if (actual != expected) {
+			log_error() << merge_kernel_name(isa) << " kernel merged " << na << " and " << nb
+						<< " keys of size " << sizeof(T) << " wrongly" << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+bool merge_kernels_test() {
+	bool result = true;
+	std::mt19937 rng(1234);
+	merge_kernel_isa best = best_merge_kernel();
+	log_debug() << "Best merge kernel: " << merge_kernel_name(best) << std::endl;
+	for (int i = merge_kernel_scalar; i <= best; ++i) {
+		merge_kernel_isa isa = static_cast<merge_kernel_isa>(i);
+		set_merge_kernel(isa);
+		result = merge_kernel_test_type<int32_t>(isa, rng) && result;
+		result = merge_kernel_test_type<uint32_t>(isa, rng) && result;
+		result = merge_kernel_test_type<int64_t>(isa, rng) && result;
+		result = merge_kernel_test_type<uint64_t>(isa, rng) && result;
+		result = merge_kernel_test_type<long long>(isa, rng) && result;
+	}
+	set_merge_kernel(best);
+	return result;
+}
+
+bool block_merge_test(size_t fanout) {
+	static_assert(bits::use_block_merge<plain_store::specific<int32_t>, std::less<int32_t> >::value,
+				  "int32_t should be merged in blocks");
+	static_assert(!bits::use_block_merge<plain_store::specific<int32_t>, std::greater<int32_t> >::value,
+				  "std::greater is not supported by the merge kernels");
+	std::mt19937 rng(42);
+	std::vector<int32_t> expected;
+	merge_sorter<int32_t, false> s;
+	// Runs shorter than, equal to and longer than the merger's blocks.
+	s.set_parameters(1500, fanout);
+	s.begin();
+	for (size_t i = 0; i < 100000; ++i) {
+		int32_t x = static_cast<int32_t>(i % 7 == 0 ? rng() % 10 : rng());
+		expected.push_back(x);
+		s.push(x);
+	}
+	s.end();
+	dummy_progress_indicator pi;
+	s.calc(pi);
+	std::sort(expected.begin(), expected.end());
+	for (size_t i = 0; i < expected.size(); ++i) {
+		if (!s.can_pull()) {
+			log_error() << "Sorter ran out of items after " << i << std::endl;
+			return false;
+		}
+		if (s.pull() != expected[i]) {
+			log_error() << "Wrong item at position " << i << std::endl;
+			return false;
+		}
+	}
+	TEST_ENSURE(!s.can_pull(), "Sorter has too many items");
+	return true;
+}
+
 int main(int argc, char ** argv) {
 	tests t(argc, argv);
 	return
@@ -166,5 +245,7 @@ int main(int argc, char ** argv) {
 		.test(sort_faulty_upper_bound_test, "sort_faulty_upper_bound")
 		.test(temp_file_usage_test, "temp_file_usage")
 		.test(tall_tree_test, "tall_tree", "fanout", static_cast<size_t>(6), "height", static_cast<size_t>(1))
+		.test(merge_kernels_test, "merge_kernels")
+		.test(block_merge_test, "block_merge", "fanout", static_cast<size_t>(5))
 		;
 }
@@ -699,6 +699,27 @@ bool merger_memory_test(size_t n) {
 	return m();
 }
 
+bool merger_heap_test(size_t n) {
+	typedef int test_t;
+	typedef plain_store::specific<test_t> specific_store_t;
+	typedef std::greater<test_t> pred_t;
+	merger<specific_store_t, pred_t, dary_heap<4> > m{pred_t(), specific_store_t()};
+	array<file_stream<test_t> > inputs(n);
+	for (size_t i = 0; i < n; ++i) {
+		inputs[i].open();
+		for (size_t j = 0; j < n; ++j)
+			inputs[i].write(static_cast<test_t>((n - j) * n + i));
+		inputs[i].seek(0);
+	}
+	m.reset(inputs, n);
+	for (test_t expected = static_cast<test_t>(n * n + n - 1); expected >= static_cast<test_t>(n); --expected) {
+		TEST_ENSURE(m.can_pull(), "Merger ran out of items");
+		TEST_ENSURE_EQUALITY(expected, m.pull(), "Merger returns items out of order");
+	}
+	TEST_ENSURE(!m.can_pull(), "Merger has too many items");
+	return true;
+}
+
 struct my_item {
 	my_item() : v1(42), v2(9001) {}
 	short v1;
@@ -2529,6 +2550,7 @@ int main(int argc, char ** argv) {
 	.multi_test(memory_test_multi, "memory")
 	.test(fork_test, "fork")
 	.test(merger_memory_test, "merger_memory", "n", static_cast<size_t>(10))
+	.test(merger_heap_test, "merger_heap", "n", static_cast<size_t>(20))
 	.test(fetch_forward_test, "fetch_forward")
 	.test(bound_fetch_forward_test, "bound_fetch_forward")
 	.test(forward_unique_ptr_test, "forward_unique_ptr")
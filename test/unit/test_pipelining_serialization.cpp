@@ -187,10 +187,23 @@ bool sort_test(stream_size_type n) {
 	return result;
 }
 
+bool sort_compressed_test(stream_size_type n) {
+	bool result = false;
+	pipeline p =
+		random_strings(n)
+		| serialization_sort(compression_normal)
+		| sort_verifier(result)
+		;
+	progress_indicator_null pi;
+	p(n, pi, 20*1024*1024, TPIE_FSI);
+	return result;
+}
+
 int main(int argc, char ** argv) {
 	return tpie::tests(argc, argv)
 	.test(basic_test, "basic")
 	.test(reverse_test, "reverse")
 	.test(sort_test, "sort", "n", static_cast<stream_size_type>(1000))
+	.test(sort_compressed_test, "sort_compressed", "n", static_cast<stream_size_type>(1000000))
 	;
 }
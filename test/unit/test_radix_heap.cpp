@@ -0,0 +1,175 @@
+// -*- mode: c++; tab-width: 4; indent-tabs-mode: t; c-file-style: "stroustrup"; -*-
+// vi:set ts=4 sts=4 sw=4 noet :
+// Copyright 2026, The TPIE development team
+//
+// This file is part of TPIE.
+//
+// TPIE is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// TPIE is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with TPIE.  If not, see <http://www.gnu.org/licenses/>
+#include "common.h"
+#include <tpie/radix_heap.h>
+#include <queue>
+#include <random>
+#include <vector>
+
+using namespace tpie;
+
+// Blocks of 4 KiB, so that small buffers spill to disk.
+double block_factor() {
+	return file_stream<uint64_t>::calculate_block_factor(4 * 1024);
+}
+
+// Pop the minimum and push keys at most maxStep above it, as Dijkstra does
+// with integer edge weights, and compare against std::priority_queue.
+template <typename T>
+bool monotone_test(memory_size_type bufferItems, uint64_t items, uint64_t maxStep) {
+	typedef radix_heap<T> heap_t;
+	heap_t pq(heap_t::memory_usage(bufferItems, block_factor()), block_factor());
+	std::priority_queue<T, std::vector<T>, std::greater<T> > pq2;
+	std::mt19937_64 rnd(1234);
+	for (uint64_t i = 0; i < items; ++i) {
+		T x = static_cast<T>(rnd() % (maxStep + 1));
+		pq.push(x);
+		pq2.push(x);
+	}
+	for (uint64_t i = 0; i < 4 * items; ++i) {
+		TEST_ENSURE_EQUALITY(pq2.size(), pq.size(), "Sizes differ");
+		TEST_ENSURE_EQUALITY(pq2.top(), pq.top(), "Tops differ");
+		T t = pq.top();
+		pq.pop();
+		pq2.pop();
+		for (uint64_t j = rnd() % 3; j > 0; --j) {
+			T x = static_cast<T>(t + rnd() % (maxStep + 1));
+			pq.push(x);
+			pq2.push(x);
+		}
+		if (pq2.empty()) break;
+	}
+	while (!pq2.empty()) {
+		TEST_ENSURE_EQUALITY(pq2.top(), pq.top(), "Tops differ");
+		pq.pop();
+		pq2.pop();
+	}
+	TEST_ENSURE(pq.empty(), "Heap not empty");
+	return true;
+}
+
+bool basic_test() {
+	return monotone_test<uint64_t>(1 << 16, 10000, 1000);
+}
+
+bool external_test() {
+	return monotone_test<uint64_t>(64, 200000, uint64_t(1) << 40);
+}
+
+bool duplicates_test() {
+	// Many equal keys spill bucket 0 itself.
+	return monotone_test<uint32_t>(32, 100000, 3);
+}
+
+struct event {
+	uint64_t time;
+	uint64_t id;
+};
+
+struct event_time {
+	uint64_t operator()(const event & e) const {return e.time;}
+};
+
+bool key_extract_test() {
+	typedef radix_heap<event, event_time> heap_t;
+	heap_t pq(heap_t::memory_usage(32, block_factor()), block_factor());
+	std::vector<uint64_t> count(1000, 0);
+	for (uint64_t i = 0; i < 20000; ++i) {
+		event e;
+		e.time = (i * 7919) % 1000;
+		e.id = i;
+		pq.push(e);
+		++count[e.time];
+	}
+	uint64_t last = 0;
+	while (!pq.empty()) {
+		event e = pq.top();
+		pq.pop();
+		TEST_ENSURE(e.time >= last, "Not monotone");
+		TEST_ENSURE_EQUALITY((e.id * 7919) % 1000, e.time, "Item corrupted");
+		TEST_ENSURE(count[e.time] > 0, "Item popped twice");
+		--count[e.time];
+		last = e.time;
+	}
+	for (size_t i = 0; i < count.size(); ++i)
+		TEST_ENSURE_EQUALITY(uint64_t(0), count[i], "Item missing");
+	return true;
+}
+
+bool monotone_violation_test() {
+	typedef radix_heap<uint64_t> heap_t;
+	heap_t pq(heap_t::memory_usage(16, block_factor()), block_factor());
+	pq.push(10);
+	pq.push(20);
+	pq.pop();
+	pq.push(10);
+	try {
+		pq.push(9);
+	} catch (const exception &) {
+		return true;
+	}
+	TEST_FAIL("Pushing a key below the last key did not throw");
+	return false;
+}
+
+class radix_heap_memory_test : public memory_test {
+public:
+	typedef radix_heap<uint64_t> heap_t;
+
+	radix_heap_memory_test() : m_memory(1 << 20) {}
+
+	virtual void alloc() {
+		m_pq = tpie_new<heap_t>(m_memory, block_factor());
+	}
+
+	virtual void use() {
+		std::mt19937_64 rnd(5);
+		for (uint64_t i = 0; i < 400000; ++i) {
+			if (i % 3 == 2) {
+				uint64_t t = m_pq->top();
+				m_pq->pop();
+				m_pq->push(t + rnd() % 100000);
+			} else {
+				m_pq->push(m_pq->last_key() + rnd() % 100000);
+			}
+		}
+	}
+
+	virtual void free() {
+		tpie_delete(m_pq);
+	}
+
+	virtual size_type claimed_size() {
+		return m_memory;
+	}
+
+private:
+	const memory_size_type m_memory;
+	heap_t * m_pq;
+};
+
+int main(int argc, char ** argv) {
+	return tests(argc, argv)
+		.test(basic_test, "basic")
+		.test(external_test, "external")
+		.test(duplicates_test, "duplicates")
+		.test(key_extract_test, "key_extract")
+		.test(monotone_violation_test, "monotone_violation")
+		.test(radix_heap_memory_test(), "memory");
+}
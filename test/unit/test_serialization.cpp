@@ -22,6 +22,7 @@
 #include <tpie/serialization2.h>
 #include <tpie/serialization_stream.h>
 #include <map>
+#include <vector>
 
 using namespace tpie;
 using namespace std;
@@ -346,6 +347,55 @@ bool stream_reverse_test() {
 	return result;
 }
 
+bool stream_seek_test() {
+	// Strings of varying length over several blocks, so that some of the
+	// remembered offsets fall on or near block boundaries.
+	const memory_size_type N = 400000;
+	std::vector<stream_size_type> offsets;
+	std::vector<memory_size_type> indices;
+	temp_file f;
+	{
+		serialization_writer wr;
+		wr.open(f);
+		for (memory_size_type i = 0; i < N; ++i)
+			wr.serialize(std::string(i % 23, static_cast<char>('a' + i % 26)));
+		wr.close();
+	}
+	{
+		serialization_reader rd;
+		rd.open(f);
+		std::string s;
+		for (memory_size_type i = 0; i < N; ++i) {
+			if (i % 997 == 0 || rd.offset() % serialization_reader::block_size() == 0) {
+				offsets.push_back(rd.offset());
+				indices.push_back(i);
+			}
+			rd.unserialize(s);
+		}
+		offsets.push_back(rd.offset());
+		indices.push_back(N);
+		rd.close();
+	}
+	serialization_reader rd;
+	rd.open(f);
+	std::string s;
+	for (memory_size_type j = offsets.size(); j--;) {
+		rd.seek(offsets[j]);
+		TEST_ENSURE_EQUALITY(offsets[j], rd.offset(), "Wrong offset after seek");
+		if (indices[j] == N) {
+			TEST_ENSURE(!rd.can_read(), "Expected !can_read() at the end");
+			continue;
+		}
+		for (memory_size_type i = indices[j]; i < std::min(N, indices[j] + 3); ++i) {
+			TEST_ENSURE(rd.can_read(), "Expected can_read()");
+			rd.unserialize(s);
+			TEST_ENSURE(s == std::string(i % 23, static_cast<char>('a' + i % 26)), "Wrong item after seek");
+		}
+	}
+	rd.close();
+	return true;
+}
+
 bool stream_temp_test() {
 	stream_size_type tmpUsage1, tmpUsage2, tmpUsage3, tmpUsage4;
 	tmpUsage1 = get_temp_file_usage();
@@ -389,6 +439,7 @@ int main(int argc, char ** argv) {
 		.test(stream_dtor_test, "stream_dtor")
 		.test(stream_reopen_test, "stream_reopen")
 		.test(stream_reverse_test, "stream_reverse")
+		.test(stream_seek_test, "stream_seek")
 		.test(stream_temp_test, "stream_temp")
 		;
 }
@@ -0,0 +1,185 @@
+// -*- mode: c++; tab-width: 4; indent-tabs-mode: t; c-file-style: "stroustrup"; -*-
+// vi:set ts=4 sts=4 sw=4 noet :
+// Copyright 2026, The TPIE development team
+//
+// This file is part of TPIE.
+//
+// TPIE is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// TPIE is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with TPIE.  If not, see <http://www.gnu.org/licenses/>
+#include "common.h"
+#include <tpie/serialization_priority_queue.h>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace tpie;
+
+typedef serialization_priority_queue<std::string> spq_t;
+
+std::string random_string(std::mt19937_64 & rnd, memory_size_type maxLength) {
+	std::string s(rnd() % (maxLength + 1), 'a');
+	for (size_t i = 0; i < s.size(); ++i) s[i] = static_cast<char>('a' + rnd() % 26);
+	return s;
+}
+
+// Fill the queue, then alternate between phases that grow and shrink it,
+// comparing against std::priority_queue.
+bool random_test(memory_size_type memory, uint64_t fill, uint64_t operations, memory_size_type maxLength) {
+	spq_t pq(memory);
+	std::priority_queue<std::string, std::vector<std::string>, std::greater<std::string> > pq2;
+	std::mt19937_64 rnd(42);
+	for (uint64_t i = 0; i < fill; ++i) {
+		std::string s = random_string(rnd, maxLength);
+		pq.push(s);
+		pq2.push(s);
+	}
+	for (uint64_t i = 0; i < operations; ++i) {
+		bool growing = (i / (operations / 8)) % 2 == 0;
+		if (pq2.empty() || rnd() % 10 < (growing ? 7u : 3u)) {
+			std::string s = random_string(rnd, maxLength);
+			pq.push(s);
+			pq2.push(s);
+		} else {
+			TEST_ENSURE(pq.top() == pq2.top(), "Tops differ");
+			pq.pop();
+			pq2.pop();
+		}
+		TEST_ENSURE_EQUALITY(pq2.size(), pq.size(), "Sizes differ");
+	}
+	while (!pq2.empty()) {
+		TEST_ENSURE(pq.top() == pq2.top(), "Tops differ");
+		pq.pop();
+		pq2.pop();
+	}
+	TEST_ENSURE(pq.empty(), "Queue not empty");
+	return true;
+}
+
+bool basic_test() {
+	return random_test(spq_t::minimum_memory(), 0, 20000, 20);
+}
+
+bool external_test() {
+	return random_test(spq_t::minimum_memory(), 600000, 400000, 200);
+}
+
+struct job {
+	uint64_t priority;
+	std::string payload;
+
+	job() : priority(0) {}
+
+	template <typename D>
+	friend void serialize(D & dst, const job & j) {
+		using tpie::serialize;
+		serialize(dst, j.priority);
+		serialize(dst, j.payload);
+	}
+
+	template <typename S>
+	friend void unserialize(S & src, job & j) {
+		using tpie::unserialize;
+		unserialize(src, j.priority);
+		unserialize(src, j.payload);
+	}
+};
+
+struct job_priority {
+	bool operator()(const job & a, const job & b) const {return a.priority < b.priority;}
+};
+
+std::string job_payload(uint64_t id) {
+	// Payloads from a few bytes up to a few kilobytes
+	return std::string(static_cast<size_t>(id * 7919 % 4000), static_cast<char>('a' + id % 26));
+}
+
+bool payload_test() {
+	typedef serialization_priority_queue<job, job_priority> queue_t;
+	queue_t pq(32 * 1024 * 1024);
+	const uint64_t items = 40000;
+	std::vector<uint64_t> count(items / 4, 0);
+	for (uint64_t i = 0; i < items; ++i) {
+		job j;
+		j.priority = i * 104729 % (items / 4);
+		j.payload = job_payload(j.priority);
+		pq.push(j);
+		++count[j.priority];
+	}
+	uint64_t last = 0;
+	while (!pq.empty()) {
+		const job & j = pq.top();
+		TEST_ENSURE(j.priority >= last, "Not sorted");
+		TEST_ENSURE(j.payload == job_payload(j.priority), "Payload corrupted");
+		TEST_ENSURE(count[j.priority] > 0, "Item popped twice");
+		--count[j.priority];
+		last = j.priority;
+		pq.pop();
+	}
+	for (size_t i = 0; i < count.size(); ++i)
+		TEST_ENSURE_EQUALITY(uint64_t(0), count[i], "Item missing");
+	return true;
+}
+
+class spq_memory_test : public memory_test {
+public:
+	spq_memory_test() : m_memory(16 * 1024 * 1024) {}
+
+	virtual void alloc() {
+		m_pq = tpie_new<spq_t>(m_memory);
+	}
+
+	virtual void use() {
+		std::mt19937_64 rnd(5);
+		for (uint64_t i = 0; i < 400000; ++i) {
+			if (i % 3 == 2) m_pq->pop();
+			else m_pq->push(random_string(rnd, 100));
+		}
+	}
+
+	virtual void free() {
+		tpie_delete(m_pq);
+	}
+
+	virtual size_type claimed_size() {
+		return m_memory;
+	}
+
+private:
+	const memory_size_type m_memory;
+	spq_t * m_pq;
+};
+
+// With no file handles left the queue cannot be constructed.
+bool files_test() {
+	size_t limit = get_file_manager().limit();
+	get_file_manager().set_limit(get_file_manager().used());
+	bool thrown = false;
+	try {
+		spq_t pq(16 * 1024 * 1024);
+	} catch (const exception &) {
+		thrown = true;
+	}
+	get_file_manager().set_limit(limit);
+	TEST_ENSURE(thrown, "No exception without available files");
+	return true;
+}
+
+int main(int argc, char ** argv) {
+	return tests(argc, argv)
+		.test(basic_test, "basic")
+		.test(external_test, "external")
+		.test(payload_test, "payload")
+		.test(spq_memory_test(), "memory")
+		.test(files_test, "files");
+}
@@ -20,6 +20,7 @@
 #include "common.h"
 #include <tpie/parallel_sort.h>
 #include <tpie/serialization_sorter.h>
+#include <tpie/string_sort.h>
 #include <tpie/sysinfo.h>
 #include <random>
 
@@ -67,9 +68,91 @@ public:
 	};
 };
 
+// Keys with long shared prefixes, embedded zero bytes and keys that are
+// prefixes of other keys.
+std::string random_url(std::mt19937 & rng) {
+	static const char * hosts[] = {"http://example.com/", "http://example.com/a/b/c/", "https://www.example.org/"};
+	std::string res = hosts[rng() % 3];
+	size_t length = rng() % 20;
+	for (size_t i = 0; i < length; ++i) res += static_cast<char>(rng() % 4 == 0 ? '\0' : 'a' + rng() % 3);
+	return res;
+}
+
+bool multikey_quicksort_test(size_t n) {
+	std::mt19937 rng(42);
+	std::vector<std::string> items(n);
+	for (size_t i = 0; i < n; ++i) items[i] = random_url(rng);
+	std::vector<std::string> expected = items;
+	std::sort(expected.begin(), expected.end());
+	string_sort(items.data(), items.data() + items.size());
+	if (items != expected) {
+		log_error() << "string_sort disagrees with std::sort" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool url_sort_test(size_t n, compression_flags compression) {
+	std::mt19937 rng(43);
+	std::vector<std::string> expected;
+	serialization_sorter<std::string> s;
+	s.set_available_memory(4*1024*1024, 20*1024*1024, 20*1024*1024);
+	s.set_run_compression(compression);
+	s.begin();
+	for (size_t i = 0; i < n; ++i) {
+		std::string item = random_url(rng);
+		expected.push_back(item);
+		s.push(item);
+	}
+	s.end();
+	s.merge_runs();
+	std::sort(expected.begin(), expected.end());
+	for (size_t i = 0; i < n; ++i) {
+		if (!s.can_pull()) {
+			log_error() << "Sorter ran out of items after " << i << std::endl;
+			return false;
+		}
+		if (s.pull() != expected[i]) {
+			log_error() << "Wrong item at position " << i << std::endl;
+			return false;
+		}
+	}
+	if (s.can_pull()) {
+		log_error() << "Sorter has too many items" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool string_key_test(size_t n) {
+	static_assert(use_string_sort<std::string, std::less<std::string> >::value,
+				  "std::string should use string_sort");
+	return url_sort_test(n, compression_none);
+}
+
+bool compressed_runs_test(size_t n) {
+	return url_sort_test(n, compression_normal);
+}
+
+bool arena_test(size_t n) {
+	static_assert(std::is_same<serialization_bits::run_buffer<std::string, std::less<std::string> >::type,
+				  serialization_bits::arena_sort<std::string, std::less<std::string> > >::value,
+				  "std::string should be kept in the arena");
+	static_assert(std::is_same<serialization_bits::run_buffer<std::string, std::greater<std::string> >::type,
+				  serialization_bits::internal_sort<std::string, std::greater<std::string> > >::value,
+				  "std::greater<std::string> needs T objects");
+	// Small enough for internal reporting out of the arena.
+	return url_sort_test(n / 100, compression_none) && url_sort_test(n, compression_none);
+}
+
 int main(int argc, char ** argv) {
 	tests t(argc, argv);
 	sort_tester<use_serialization_sorter>::add_all(t);
 	sort_tester<use_serialization_sorter>::add_file_limit_test(t, 3);
-	return t;
+	return t
+		.test(multikey_quicksort_test, "multikey_quicksort", "n", static_cast<size_t>(100000))
+		.test(string_key_test, "string_key", "n", static_cast<size_t>(100000))
+		.test(compressed_runs_test, "compressed_runs", "n", static_cast<size_t>(100000))
+		.test(arena_test, "arena", "n", static_cast<size_t>(100000))
+		;
 }
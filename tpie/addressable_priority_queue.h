@@ -0,0 +1,681 @@
+// -*- mode: c++; tab-width: 4; indent-tabs-mode: t; eval: (progn (c-set-style "stroustrup") (c-set-offset 'innamespace 0)); -*-
+// vi:set ts=4 sts=4 sw=4 noet :
+// Copyright 2026, The TPIE development team
+//
+// This file is part of TPIE.
+//
+// TPIE is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// TPIE is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with TPIE.  If not, see <http://www.gnu.org/licenses/>
+
+///////////////////////////////////////////////////////////////////////////////
+/// \file addressable_priority_queue.h
+/// \brief External memory priority queue with update and erase by id.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TPIE_ADDRESSABLE_PRIORITY_QUEUE_H
+#define TPIE_ADDRESSABLE_PRIORITY_QUEUE_H
+
+#include <algorithm>
+#include <functional>
+#include <tpie/array.h>
+#include <tpie/exception.h>
+#include <tpie/file_stream.h>
+#include <tpie/hash_map.h>
+#include <tpie/tempname.h>
+#include <tpie/util.h>
+
+namespace tpie {
+
+///////////////////////////////////////////////////////////////////////////////
+/// \class addressable_priority_queue
+/// \brief External memory priority queue over the ids [0, ids) supporting
+/// update(id, priority) and erase(id), after the tournament tree of Kumar and
+/// Schwabe, "Improved algorithms and data structures for solving graph
+/// problems in external memory" (1996).
+///
+/// Every id is in the queue at most once, so graph searches such as Dijkstra
+/// and Prim can decrease keys instead of pushing duplicates.
+///
+/// The ids are split into ranges of at most C ids, where C is the number of
+/// elements a node can hold in memory, and a static binary tree is built
+/// over the ranges. Every node holds up to C elements, all with priorities
+/// no greater than the limit of the node, which is in turn no greater than
+/// any priority in the subtree below the node. The root is an in-memory
+/// heap. The other nodes keep their elements in a file, together with a
+/// file of signals (updates, inserts and erases) that have not yet been
+/// applied to the node. A signal that cannot be resolved at a node is
+/// passed on to the child on the path to its id, and a node applies its
+/// signals in one pass once it has C of them. When the root runs empty it
+/// is refilled with the smallest elements of its children.
+///
+/// Every signal and element travels down and up the tree at most once per
+/// level in blocks, so an operation costs O((1/B) log(N/C)) amortized I/Os
+/// for N ids.
+///
+/// \tparam T The type of priorities. Must be trivially copyable.
+/// \tparam comp_t Priority comparator; top() is the minimum with respect to
+/// comp_t.
+///////////////////////////////////////////////////////////////////////////////
+template <typename T, typename comp_t = std::less<T> >
+class addressable_priority_queue {
+public:
+	typedef stream_size_type id_type;
+	typedef T priority_type;
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Construct an empty queue.
+	///
+	/// \param ids The number of ids. Ids are in the range [0, ids).
+	/// \param memory The number of bytes the queue may use.
+	/// \param blockFactor Block factor of the node files.
+	/// \param comp Priority comparator.
+	///////////////////////////////////////////////////////////////////////////
+	addressable_priority_queue(stream_size_type ids, memory_size_type memory,
+							   double blockFactor = 1.0, comp_t comp = comp_t())
+		: m_ids(ids)
+		, m_blockFactor(blockFactor)
+		, m_comp(comp)
+		, m_rootSize(0)
+		, m_rootSignalCount(0)
+	{
+		m_capacity = capacity(ids, memory, blockFactor);
+		if (m_capacity < minimum_capacity)
+			throw exception("addressable_priority_queue: Not enough memory");
+		m_height = height(ids, m_capacity);
+		m_leafIds = leaf_ids(ids, m_height);
+		m_memory = memory_usage(ids, m_capacity, blockFactor);
+
+		memory_size_type nodes = node_count(m_height);
+		m_nodes.resize(nodes);
+		for (memory_size_type v = 0; v < nodes; ++v) {
+			m_nodes[v].elements = 0;
+			m_nodes[v].signals = 0;
+			m_nodes[v].limit = T();
+			m_nodes[v].bounded = false;
+		}
+		if (m_height > 0) {
+			m_elementFiles.resize(nodes);
+			m_signalFiles.resize(nodes);
+		}
+
+		m_root.resize(m_capacity + 1);
+		m_rootIndex.resize(m_capacity + 1);
+		m_rootSignals.resize(m_capacity);
+		m_a.resize(2 * m_capacity);
+		m_b.resize(2 * m_capacity);
+		m_c.resize(m_capacity);
+		m_signals.resize(m_capacity);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Return the number of bytes used by a queue over the given
+	/// number of ids whose nodes hold the given number of elements.
+	///////////////////////////////////////////////////////////////////////////
+	static memory_size_type memory_usage(stream_size_type ids, memory_size_type nodeCapacity,
+										 double blockFactor = 1.0) {
+		return sizeof(addressable_priority_queue)
+			+ node_overhead(node_count(height(ids, nodeCapacity)))
+			+ streams * file_stream<signal>::memory_usage(blockFactor)
+			+ capacity_usage(nodeCapacity);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Return the number of bytes used by this queue.
+	///////////////////////////////////////////////////////////////////////////
+	memory_size_type memory_usage() const {return m_memory;}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Return the number of elements a node holds.
+	///////////////////////////////////////////////////////////////////////////
+	memory_size_type node_capacity() const {return m_capacity;}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Return the number of levels of external nodes below the root.
+	///////////////////////////////////////////////////////////////////////////
+	memory_size_type height() const {return m_height;}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Set the priority of an id, inserting it if it is not in the
+	/// queue.
+	///////////////////////////////////////////////////////////////////////////
+	void update(id_type id, const T & priority) {
+		assert(id < m_ids);
+		const node_state & root = m_nodes[1];
+		const bool inRoot = fits(root, priority);
+		typename root_index_t::iterator i = m_rootIndex.find(id);
+		if (i != m_rootIndex.end()) {
+			memory_size_type pos = i.value();
+			if (inRoot) {
+				T old = m_root[pos].priority;
+				m_root[pos].priority = priority;
+				if (m_comp(priority, old)) root_sift_up(pos);
+				else root_sift_down(pos);
+			} else {
+				root_remove(pos);
+				send(id, priority, signal_insert);
+			}
+		} else if (inRoot) {
+			if (root.bounded) send(id, priority, signal_erase);
+			root_insert(id, priority);
+			if (m_rootSize > m_capacity) evict_root();
+		} else {
+			send(id, priority, signal_update);
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Remove an id from the queue. Does nothing if the id is not in
+	/// the queue.
+	///////////////////////////////////////////////////////////////////////////
+	void erase(id_type id) {
+		assert(id < m_ids);
+		typename root_index_t::iterator i = m_rootIndex.find(id);
+		if (i != m_rootIndex.end())
+			root_remove(i.value());
+		else if (m_nodes[1].bounded)
+			send(id, T(), signal_erase);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Is the queue empty?
+	///
+	/// Since updates and erases are applied lazily, this may have to refill
+	/// the root from disk.
+	///////////////////////////////////////////////////////////////////////////
+	bool empty() {
+		ensure_root();
+		return m_rootSize == 0;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Return the id with the minimum priority.
+	///////////////////////////////////////////////////////////////////////////
+	id_type top_id() {
+		ensure_root();
+		assert(m_rootSize != 0);
+		return m_root[0].id;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Return the minimum priority.
+	///////////////////////////////////////////////////////////////////////////
+	const T & top_priority() {
+		ensure_root();
+		assert(m_rootSize != 0);
+		return m_root[0].priority;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Remove the id with the minimum priority.
+	///////////////////////////////////////////////////////////////////////////
+	void pop() {
+		ensure_root();
+		assert(m_rootSize != 0);
+		root_remove(0);
+	}
+
+private:
+	struct element {
+		id_type id;
+		T priority;
+	};
+
+	enum signal_kind : unsigned char {
+		/** Set the priority of an id that may be in the subtree. */
+		signal_update,
+		/** Insert an id that is known not to be in the subtree. */
+		signal_insert,
+		/** Remove an id that may be in the subtree. */
+		signal_erase
+	};
+
+	struct signal {
+		id_type id;
+		T priority;
+		signal_kind kind;
+	};
+
+	struct node_state {
+		/** Number of elements in the element file. */
+		memory_size_type elements;
+		/** Number of signals in the signal file. */
+		stream_size_type signals;
+		/** Elements of the node are no greater than limit, and elements
+		 * below the node are no less. Only valid if bounded. */
+		T limit;
+		/** False if the subtree below the node is empty. */
+		bool bounded;
+	};
+
+	typedef hash_map<id_type, memory_size_type> root_index_t;
+
+	static const memory_size_type minimum_capacity = 16;
+	static const memory_size_type streams = 3;
+
+	struct id_less {
+		bool operator()(const element & a, const element & b) const {return a.id < b.id;}
+		bool operator()(const signal & a, const signal & b) const {return a.id < b.id;}
+	};
+
+	struct priority_less {
+		comp_t comp;
+		priority_less(comp_t c): comp(c) {}
+		bool operator()(const element & a, const element & b) const {return comp(a.priority, b.priority);}
+	};
+
+	static memory_size_type height(stream_size_type ids, memory_size_type capacity) {
+		memory_size_type h = 0;
+		while (((ids + (stream_size_type(1) << h) - 1) >> h) > capacity) ++h;
+		return h;
+	}
+
+	static memory_size_type leaf_ids(stream_size_type ids, memory_size_type h) {
+		return static_cast<memory_size_type>(std::max<stream_size_type>(1, (ids + (stream_size_type(1) << h) - 1) >> h));
+	}
+
+	// Nodes are numbered as in a binary heap, starting at 1.
+	static memory_size_type node_count(memory_size_type h) {
+		return memory_size_type(2) << h;
+	}
+
+	static memory_size_type node_overhead(memory_size_type nodes) {
+		return array<node_state>::memory_usage(nodes)
+			+ (nodes > 2 ? 2 * array<temp_file>::memory_usage(nodes) : 0);
+	}
+
+	static memory_size_type capacity_usage(memory_size_type capacity) {
+		return array<element>::memory_usage(capacity + 1) // m_root
+			+ root_index_t::memory_usage(capacity + 1)
+			+ array<signal>::memory_usage(capacity) // m_rootSignals
+			+ array<element>::memory_usage(5 * capacity) // m_a, m_b, m_c
+			+ array<signal>::memory_usage(2 * capacity); // m_signals, stable_sort
+	}
+
+	static memory_size_type capacity(stream_size_type ids, memory_size_type memory, double blockFactor) {
+		// The node state grows as the capacity shrinks, so first find the
+		// capacity that fits without it and then back off.
+		const memory_size_type fixed = sizeof(addressable_priority_queue)
+			+ streams * file_stream<signal>::memory_usage(blockFactor);
+		if (memory < fixed + capacity_usage(minimum_capacity)) return 0;
+		memory_size_type lo = minimum_capacity;
+		memory_size_type hi = static_cast<memory_size_type>(std::max<stream_size_type>(ids, lo));
+		if (fixed + capacity_usage(hi) > memory) {
+			while (lo + 1 < hi) {
+				memory_size_type mid = lo + (hi - lo) / 2;
+				if (fixed + capacity_usage(mid) <= memory) lo = mid;
+				else hi = mid;
+			}
+			hi = lo;
+		}
+		while (hi >= minimum_capacity && memory_usage(ids, hi, blockFactor) > memory)
+			hi -= std::max<memory_size_type>(1, hi / 64);
+		return hi;
+	}
+
+	bool is_leaf(memory_size_type v) const {return v >= (memory_size_type(1) << m_height);}
+
+	// The child of v on the path to the leaf of id.
+	memory_size_type child(memory_size_type v, id_type id) const {
+		memory_size_type leaf = (memory_size_type(1) << m_height) + static_cast<memory_size_type>(id / m_leafIds);
+		while ((leaf >> 1) != v) leaf >>= 1;
+		return leaf;
+	}
+
+	bool fits(const node_state & s, const T & priority) const {
+		return !s.bounded || !m_comp(s.limit, priority);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Root heap
+	///////////////////////////////////////////////////////////////////////////
+
+	void root_place(memory_size_type pos, const element & e) {
+		m_root[pos] = e;
+		m_rootIndex[e.id] = pos;
+	}
+
+	void root_sift_up(memory_size_type pos) {
+		element e = m_root[pos];
+		while (pos > 0) {
+			memory_size_type p = (pos - 1) / 2;
+			if (!m_comp(e.priority, m_root[p].priority)) break;
+			root_place(pos, m_root[p]);
+			pos = p;
+		}
+		root_place(pos, e);
+	}
+
+	void root_sift_down(memory_size_type pos) {
+		element e = m_root[pos];
+		for (;;) {
+			memory_size_type c = 2 * pos + 1;
+			if (c >= m_rootSize) break;
+			if (c + 1 < m_rootSize && m_comp(m_root[c + 1].priority, m_root[c].priority)) ++c;
+			if (!m_comp(m_root[c].priority, e.priority)) break;
+			root_place(pos, m_root[c]);
+			pos = c;
+		}
+		root_place(pos, e);
+	}
+
+	void root_insert(id_type id, const T & priority) {
+		element e;
+		e.id = id;
+		e.priority = priority;
+		root_place(m_rootSize, e);
+		root_sift_up(m_rootSize++);
+	}
+
+	void root_remove(memory_size_type pos) {
+		m_rootIndex.erase(m_root[pos].id);
+		if (pos == --m_rootSize) return;
+		T old = m_root[pos].priority;
+		root_place(pos, m_root[m_rootSize]);
+		if (m_comp(m_root[pos].priority, old)) root_sift_up(pos);
+		else root_sift_down(pos);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Keep the smallest half of the root and send the rest down.
+	///////////////////////////////////////////////////////////////////////////
+	void evict_root() {
+		memory_size_type n = m_rootSize;
+		memory_size_type keep = m_capacity / 2;
+		// Flushing processes nodes using m_a, so make room for the evicted
+		// elements first.
+		if (m_rootSignalCount + (n - keep) > m_rootSignals.size()) flush_root_signals();
+		std::copy(m_root.begin(), m_root.begin() + n, m_a.begin());
+		std::nth_element(m_a.begin(), m_a.begin() + keep, m_a.begin() + n, priority_less(m_comp));
+		node_state & root = m_nodes[1];
+		root.limit = std::max_element(m_a.begin(), m_a.begin() + keep, priority_less(m_comp))->priority;
+		root.bounded = true;
+		m_rootIndex.clear();
+		m_rootSize = 0;
+		for (memory_size_type i = 0; i < keep; ++i)
+			root_insert(m_a[i].id, m_a[i].priority);
+		for (memory_size_type i = keep; i < n; ++i)
+			send(m_a[i].id, m_a[i].priority, signal_insert);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Buffer a signal from the root to its children.
+	///////////////////////////////////////////////////////////////////////////
+	void send(id_type id, const T & priority, signal_kind kind) {
+		if (m_rootSignalCount == m_rootSignals.size()) flush_root_signals();
+		signal & s = m_rootSignals[m_rootSignalCount++];
+		s.id = id;
+		s.priority = priority;
+		s.kind = kind;
+	}
+
+	void flush_root_signals() {
+		if (m_rootSignalCount == 0) return;
+		for (memory_size_type c = 2; c < 4; ++c) {
+			file_stream<signal> out(m_blockFactor);
+			open_signals_for_append(out, c);
+			for (memory_size_type i = 0; i < m_rootSignalCount; ++i) {
+				if (child(1, m_rootSignals[i].id) != c) continue;
+				out.write(m_rootSignals[i]);
+				++m_nodes[c].signals;
+			}
+		}
+		m_rootSignalCount = 0;
+		for (memory_size_type c = 2; c < 4; ++c)
+			if (m_nodes[c].signals >= m_capacity) process(c);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Refill the root from its children if it is empty.
+	///////////////////////////////////////////////////////////////////////////
+	void ensure_root() {
+		if (m_rootSize != 0 || !m_nodes[1].bounded) return;
+		flush_root_signals();
+		memory_size_type n = pull_up(1);
+		for (memory_size_type i = 0; i < n; ++i)
+			root_insert(m_c[i].id, m_c[i].priority);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// External nodes
+	///////////////////////////////////////////////////////////////////////////
+
+	void open_signals_for_append(file_stream<signal> & out, memory_size_type v) {
+		if (m_nodes[v].signals == 0) {
+			out.open(m_signalFiles[v], access_write);
+		} else {
+			out.open(m_signalFiles[v], access_read_write);
+			out.seek(0, file_stream<signal>::end);
+		}
+	}
+
+	memory_size_type load(memory_size_type v, array<element> & to) {
+		memory_size_type n = m_nodes[v].elements;
+		if (n == 0) return 0;
+		file_stream<element> in(m_blockFactor);
+		in.open(m_elementFiles[v], access_read);
+		in.read(to.begin(), to.begin() + n);
+		return n;
+	}
+
+	void store(memory_size_type v, const element * from, memory_size_type n) {
+		m_nodes[v].elements = n;
+		if (n == 0) return;
+		file_stream<element> out(m_blockFactor);
+		out.open(m_elementFiles[v], access_write);
+		out.write(from, from + n);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Apply all buffered signals of a node to its elements, and
+	/// process the children that receive a full buffer in turn.
+	///////////////////////////////////////////////////////////////////////////
+	void process(memory_size_type v) {
+		node_state & s = m_nodes[v];
+		memory_size_type n = load(v, m_a);
+		std::sort(m_a.begin(), m_a.begin() + n, id_less());
+		{
+			file_stream<signal> in(m_blockFactor);
+			in.open(m_signalFiles[v], access_read);
+			file_stream<signal> left(m_blockFactor);
+			file_stream<signal> right(m_blockFactor);
+			file_stream<signal> * out[2] = {&left, &right};
+			if (!is_leaf(v)) {
+				open_signals_for_append(left, 2 * v);
+				open_signals_for_append(right, 2 * v + 1);
+			}
+			while (in.can_read()) {
+				memory_size_type k = static_cast<memory_size_type>(
+					std::min<stream_size_type>(m_signals.size(), in.size() - in.offset()));
+				in.read(m_signals.begin(), m_signals.begin() + k);
+				std::stable_sort(m_signals.begin(), m_signals.begin() + k, id_less());
+				n = apply(v, n, k, out);
+				if (n > m_capacity) n = evict(v, n, out);
+			}
+		}
+		s.signals = 0;
+		store(v, m_a.get(), n);
+		if (is_leaf(v)) return;
+		for (memory_size_type c = 2 * v; c < 2 * v + 2; ++c)
+			if (m_nodes[c].signals >= m_capacity) process(c);
+	}
+
+	void forward(memory_size_type v, file_stream<signal> ** out, id_type id, const T & priority, signal_kind kind) {
+		memory_size_type c = child(v, id);
+		signal s;
+		s.id = id;
+		s.priority = priority;
+		s.kind = kind;
+		out[c - 2 * v]->write(s);
+		++m_nodes[c].signals;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Apply m_signals[0, k), sorted stably by id, to the n elements
+	/// of v in m_a, sorted by id. The result is left in m_a, sorted by id.
+	///////////////////////////////////////////////////////////////////////////
+	memory_size_type apply(memory_size_type v, memory_size_type n, memory_size_type k,
+						   file_stream<signal> ** out) {
+		const node_state & s = m_nodes[v];
+		memory_size_type i = 0;
+		memory_size_type o = 0;
+		memory_size_type j = 0;
+		while (j < k) {
+			id_type id = m_signals[j].id;
+			while (i < n && m_a[i].id < id) m_b[o++] = m_a[i++];
+
+			// here: the id is in this node. below: the id may be in the
+			// subtree below this node.
+			bool here = i < n && m_a[i].id == id;
+			bool below = !here && s.bounded;
+			T priority = here ? m_a[i].priority : T();
+			if (here) ++i;
+
+			for (; j < k && m_signals[j].id == id; ++j) {
+				const signal & sig = m_signals[j];
+				switch (sig.kind) {
+				case signal_update:
+				case signal_insert:
+					if (fits(s, sig.priority)) {
+						if (below && sig.kind == signal_update)
+							forward(v, out, id, T(), signal_erase);
+						here = true;
+						below = false;
+						priority = sig.priority;
+					} else {
+						forward(v, out, id, sig.priority,
+								(below && sig.kind == signal_update) ? signal_update : signal_insert);
+						here = false;
+						below = true;
+					}
+					break;
+				case signal_erase:
+					if (below) forward(v, out, id, T(), signal_erase);
+					here = false;
+					below = false;
+					break;
+				}
+			}
+			if (here) {
+				m_b[o].id = id;
+				m_b[o].priority = priority;
+				++o;
+			}
+		}
+		while (i < n) m_b[o++] = m_a[i++];
+		m_a.swap(m_b);
+		return o;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Keep the smallest half of the n elements in m_a and send the
+	/// rest to the children.
+	///////////////////////////////////////////////////////////////////////////
+	memory_size_type evict(memory_size_type v, memory_size_type n, file_stream<signal> ** out) {
+		memory_size_type keep = m_capacity / 2;
+		std::nth_element(m_a.begin(), m_a.begin() + keep, m_a.begin() + n, priority_less(m_comp));
+		node_state & s = m_nodes[v];
+		s.limit = std::max_element(m_a.begin(), m_a.begin() + keep, priority_less(m_comp))->priority;
+		s.bounded = true;
+		for (memory_size_type i = keep; i < n; ++i)
+			forward(v, out, m_a[i].id, m_a[i].priority, signal_insert);
+		std::sort(m_a.begin(), m_a.begin() + keep, id_less());
+		return keep;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Make a node with no elements nonempty unless its subtree is
+	/// empty. The signals of the node must have been applied.
+	///////////////////////////////////////////////////////////////////////////
+	void fill(memory_size_type v) {
+		assert(m_nodes[v].elements == 0 && m_nodes[v].signals == 0);
+		if (is_leaf(v)) return;
+		memory_size_type n = pull_up(v);
+		store(v, m_c.get(), n);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Move the smallest elements of the children of v into m_c, up
+	/// to half the capacity. Returns the number of elements moved; zero only
+	/// if the subtree below v is empty.
+	///////////////////////////////////////////////////////////////////////////
+	memory_size_type pull_up(memory_size_type v) {
+		const memory_size_type l = 2 * v;
+		const memory_size_type r = 2 * v + 1;
+		for (memory_size_type c = l; c <= r; ++c) {
+			if (m_nodes[c].signals != 0) process(c);
+			if (m_nodes[c].elements == 0 && m_nodes[c].bounded) fill(c);
+			if (m_nodes[c].elements == 0) m_nodes[c].bounded = false;
+		}
+		node_state & s = m_nodes[v];
+		if (m_nodes[l].elements == 0 && m_nodes[r].elements == 0) {
+			s.bounded = false;
+			return 0;
+		}
+
+		memory_size_type nl = load(l, m_a);
+		memory_size_type nr = load(r, m_b);
+		std::sort(m_a.begin(), m_a.begin() + nl, priority_less(m_comp));
+		std::sort(m_b.begin(), m_b.begin() + nr, priority_less(m_comp));
+
+		// Stop when a child runs out while its subtree may hold more, since
+		// those could be smaller than the next element of the other child.
+		const bool lb = m_nodes[l].bounded;
+		const bool rb = m_nodes[r].bounded;
+		const memory_size_type want = m_capacity / 2;
+		memory_size_type i = 0, j = 0, n = 0;
+		while (n < want) {
+			bool hl = i < nl;
+			bool hr = j < nr;
+			if ((!hl && lb) || (!hr && rb) || (!hl && !hr)) break;
+			if (!hr || (hl && !m_comp(m_b[j].priority, m_a[i].priority)))
+				m_c[n++] = m_a[i++];
+			else
+				m_c[n++] = m_b[j++];
+		}
+		s.limit = m_c[n - 1].priority;
+		store(l, m_a.get() + i, nl - i);
+		store(r, m_b.get() + j, nr - j);
+		return n;
+	}
+
+	stream_size_type m_ids;
+	double m_blockFactor;
+	comp_t m_comp;
+	memory_size_type m_capacity;
+	memory_size_type m_height;
+	memory_size_type m_leafIds;
+	memory_size_type m_memory;
+
+	array<node_state> m_nodes;
+	array<temp_file> m_elementFiles;
+	array<temp_file> m_signalFiles;
+
+	/** The root elements as a binary heap. */
+	array<element> m_root;
+	memory_size_type m_rootSize;
+	/** Position of each root element in m_root. */
+	root_index_t m_rootIndex;
+	/** Signals from the root to its children. */
+	array<signal> m_rootSignals;
+	memory_size_type m_rootSignalCount;
+
+	/** Work space for processing and filling nodes. */
+	array<element> m_a;
+	array<element> m_b;
+	array<element> m_c;
+	array<signal> m_signals;
+};
+
+} // namespace tpie
+
+#endif // TPIE_ADDRESSABLE_PRIORITY_QUEUE_H
@@ -0,0 +1,72 @@
+// -*- mode: c++; tab-width: 4; indent-tabs-mode: t; c-file-style: "stroustrup"; -*-
+// vi:set ts=4 sts=4 sw=4 noet cino+=(0 :
+// Copyright 2026, The TPIE development team
+//
+// This file is part of TPIE.
+//
+// TPIE is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// TPIE is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with TPIE.  If not, see <http://www.gnu.org/licenses/>
+
+///////////////////////////////////////////////////////////////////////////////
+/// \file block_codec.h Translation between blocks on disk and in memory
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef _TPIE_BLOCKS_BLOCK_CODEC_H
+#define _TPIE_BLOCKS_BLOCK_CODEC_H
+
+#include <tpie/tpie.h>
+#include <tpie/blocks/block.h>
+
+namespace tpie {
+
+namespace blocks {
+
+/**
+ * \brief Translates the blocks of a block_collection between their form on
+ * disk and a possibly larger form in memory.
+ *
+ * A block collection with a codec decodes each block it reads into a
+ * buffer of memory_size() bytes, and encodes the buffer again when the
+ * block is written. The codec is called by one thread at a time.
+ */
+class block_codec {
+public:
+	virtual ~block_codec() {}
+
+	/**
+	 * \brief The size in memory of blocks of the given size on disk
+	 */
+	virtual memory_size_type memory_size(memory_size_type blockSize) const = 0;
+
+	/**
+	 * \brief Decode a block read from disk
+	 * \param src the content of the block on disk
+	 * \param blockSize the size of the block on disk
+	 * \param dst the block in memory, of memory_size(blockSize) bytes
+	 */
+	virtual void decode(const char * src, memory_size_type blockSize, block & dst) const = 0;
+
+	/**
+	 * \brief Encode a block to be written to disk
+	 * \param src the block in memory, of memory_size(blockSize) bytes
+	 * \param dst the buffer to fill with the content of the block on disk
+	 * \param blockSize the size of the block on disk
+	 */
+	virtual void encode(const block & src, char * dst, memory_size_type blockSize) const = 0;
+};
+
+} // blocks namespace
+
+} // tpie namespace
+
+#endif // _TPIE_BLOCKS_BLOCK_CODEC_H
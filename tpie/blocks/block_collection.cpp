@@ -17,6 +17,7 @@
 // You should have received a copy of the GNU Lesser General Public License
 // along with TPIE.  If not, see <http://www.gnu.org/licenses/>
 
+#include <tpie/exception.h>
 #include <tpie/tpie_assert.h>
 #include <tpie/blocks/block_collection.h>
 
@@ -24,8 +25,11 @@ namespace tpie {
 
 namespace blocks {
 
-block_collection::block_collection(std::string fileName, memory_size_type blockSize, bool writeable)
-	: m_collection(fileName + ".queue", blockSize)
+block_collection::block_collection(std::string fileName, memory_size_type blockSize, bool writeable,
+								   std::shared_ptr<block_codec> codec)
+	: m_collection(free_list_path(fileName), blockSize)
+	, m_codec(std::move(codec))
+	, m_buffer(m_codec ? blockSize : 0)
 	, m_writeable(writeable)
 {
 #if defined(TPIE_NDEBUG)
@@ -51,11 +55,26 @@ block_handle block_collection::get_free_block() {
 	return m_collection.alloc();
 }
 
+block_handle block_collection::get_free_block(stream_size_type hint) {
+	tp_assert(m_writeable, "get_free_block(): the block collection is read only");
+
+	return m_collection.alloc(hint);
+}
+
+block_handle block_collection::get_free_block_at(stream_size_type position) {
+	tp_assert(m_writeable, "get_free_block_at(): the block collection is read only");
+
+	if (!m_collection.take_exact(position))
+		throw exception("get_free_block_at(): the block is not free");
+	return block_handle(position, m_collection.block_size());
+}
+
 void block_collection::free_block(block_handle handle) {
 	tp_assert(m_writeable, "free_block(): the block collection is read only");
 
 	m_collection.free(handle);
 
+	std::lock_guard<std::mutex> lock(m_mutex);
 	if(m_accessor.file_size_i() > m_collection.size()) {
 		m_accessor.truncate_i(m_collection.size());
 	}
@@ -64,18 +83,32 @@ void block_collection::free_block(block_handle handle) {
 void block_collection::read_block(block_handle handle, block & b) {
 	tp_assert(handle.position + handle.size <= m_collection.size(), "the content of the given handle has not been written to disk");
 
-	b.resize(handle.size);
+	if (b.size() != memory_size(handle.size))
+		b.resize(memory_size(handle.size));
 
+	std::lock_guard<std::mutex> lock(m_mutex);
 	m_accessor.seek_i(handle.position);
-	m_accessor.read_i(static_cast<void*>(b.get()), handle.size);
+	if (!m_codec) {
+		m_accessor.read_i(static_cast<void*>(b.get()), handle.size);
+		return;
+	}
+	tp_assert(handle.size <= m_buffer.size(), "the block is larger than the buffer");
+	m_accessor.read_i(static_cast<void*>(m_buffer.get()), handle.size);
+	m_codec->decode(m_buffer.get(), handle.size, b);
 }
 
 void block_collection::write_block(block_handle handle, const block & b) {
 	tp_assert(m_writeable, "write_block(): the block collection is read only.");
-	tp_assert(handle.size >= b.size(), "the given block is not large enough.");
-
+	std::lock_guard<std::mutex> lock(m_mutex);
 	m_accessor.seek_i(handle.position);
-	m_accessor.write_i(static_cast<const void*>(b.get()), b.size());
+	if (!m_codec) {
+		tp_assert(handle.size >= b.size(), "the given block is not large enough.");
+		m_accessor.write_i(static_cast<const void*>(b.get()), b.size());
+		return;
+	}
+	tp_assert(handle.size <= m_buffer.size(), "the block is larger than the buffer");
+	m_codec->encode(b, m_buffer.get(), handle.size);
+	m_accessor.write_i(static_cast<const void*>(m_buffer.get()), handle.size);
 }
 
 } // namespace blocks
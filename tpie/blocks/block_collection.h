@@ -27,7 +27,10 @@
 #include <tpie/tpie.h>
 #include <tpie/file_accessor/file_accessor.h>
 #include <tpie/blocks/block.h>
+#include <tpie/blocks/block_codec.h>
 #include <tpie/blocks/freespace_collection.h>
+#include <memory>
+#include <mutex>
 
 namespace tpie {
 
@@ -35,6 +38,10 @@ namespace blocks {
 
 /**
  * \brief A class to manage writing and reading of block to disk.
+ *
+ * Reads and writes of blocks may come from several threads at once; they
+ * are serialized on the file. Given a block_codec, the collection decodes
+ * the blocks it reads and encodes the blocks it writes.
  */
 class block_collection {
 public:
@@ -43,8 +50,10 @@ public:
 	 * \param fileName the file in which blocks are saved
 	 * \param blockSize the size of the blocks
 	 * \param writeable indicates whether the collection is writeable
+	 * \param codec translates the blocks between disk and memory, if given
 	 */
-	block_collection(std::string fileName, memory_size_type blockSize, bool writeable);
+	block_collection(std::string fileName, memory_size_type blockSize, bool writeable,
+					 std::shared_ptr<block_codec> codec=std::shared_ptr<block_codec>());
 
 	~block_collection();
 
@@ -56,6 +65,22 @@ public:
 	 */
 	block_handle get_free_block();
 
+	/**
+	 * \brief Allocates a new block as close as possible to a position
+	 * \param hint the position of a block used together with the new one
+	 * \return the handle of the new block
+	 */
+	block_handle get_free_block(stream_size_type hint);
+
+	/**
+	 * \brief Allocates the block at a given position, which must be free
+	 *
+	 * Throws an exception if the block is in use.
+	 * \param position the position of the block
+	 * \return the handle of the new block
+	 */
+	block_handle get_free_block_at(stream_size_type position);
+
 	/**
 	 * \brief frees a block
 	 * \param handle the handle of the block to be freed
@@ -75,9 +100,42 @@ public:
 	 * \param b the block type in which the content is stored
 	 */
 	void write_block(block_handle handle, const block & b);
+
+	/**
+	 * \brief The size of the file spanned by the allocated blocks
+	 */
+	stream_size_type size() {return m_collection.size();}
+
+	/**
+	 * \brief The file in which the free blocks of a collection are saved
+	 * \param fileName the file in which blocks are saved
+	 */
+	static std::string free_list_path(const std::string & fileName) {
+		return fileName + ".queue";
+	}
+
+	/**
+	 * \brief Memory used by a collection, besides the buffer of a codec
+	 */
+	static memory_size_type memory_usage() {
+		return sizeof(block_collection) - sizeof(bits::freespace_collection)
+			+ bits::freespace_collection::memory_usage();
+	}
+
+	/**
+	 * \brief The size in memory of the blocks read of the given size
+	 */
+	memory_size_type memory_size(memory_size_type blockSize) const {
+		return m_codec ? m_codec->memory_size(blockSize) : blockSize;
+	}
 private:
 	bits::freespace_collection m_collection;
 	tpie::file_accessor::raw_file_accessor m_accessor;
+	// Guards the position of the file and the buffer
+	std::mutex m_mutex;
+	std::shared_ptr<block_codec> m_codec;
+	// The content on disk of a block being read or written with the codec
+	array<char> m_buffer;
 
 	bool m_writeable;
 };
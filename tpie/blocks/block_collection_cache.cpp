@@ -18,111 +18,166 @@
 // along with TPIE.  If not, see <http://www.gnu.org/licenses/>
 
 #include <tpie/blocks/block_collection_cache.h>
+#include <tpie/job.h>
+#include <algorithm>
+#include <atomic>
 
 namespace tpie {
 
 namespace blocks {
 
-block_collection_cache::block_collection_cache(std::string fileName, memory_size_type blockSize, memory_size_type maxSize, bool writeable)
-	: m_collection(fileName, blockSize, writeable)
-	, m_curSize(0)
-	, m_maxSize(maxSize)
-	, m_blockSize(blockSize)
-{}
+namespace {
 
-block_collection_cache::~block_collection_cache() {
-	// write the content of the cache to disk
-	block_map_t::iterator end = m_blockMap.end();
+// The block a thread read last, valid while the thread has made no other
+// operation on a pool
+struct last_read {
+	last_read() : cache(0), operations(0), position(0), b(0), dirty(false) {}
 
-	for(block_map_t::iterator i = m_blockMap.begin(); i != end; ++i) {
-		if(i->second.dirty) {
-			m_collection.write_block(i->first, *i->second.pointer);
-		}
-		tpie_delete(i->second.pointer);
-	}
+	stream_size_type cache;
+	stream_size_type operations;
+	stream_size_type position;
+	block * b;
+	// Whether the block was marked dirty since it was read
+	bool dirty;
+};
+
+thread_local last_read t_lastRead;
+
+std::atomic<stream_size_type> cacheCount(0);
+
+} // unnamed namespace
+
+block_collection_cache::block_collection_cache(std::string fileName, memory_size_type blockSize, memory_size_type maxSize, bool writeable,
+											   std::shared_ptr<block_codec> codec)
+	: m_collection(fileName, blockSize, writeable, std::move(codec))
+	, m_pool(std::make_shared<buffer_pool>(maxSize * buffer_pool::frame_memory(m_collection.memory_size(blockSize)),
+										   std::min<memory_size_type>(maxSize - 1, 16)))
+	, m_owner(m_pool->register_collection(&m_collection))
+	, m_blockSize(blockSize)
+	, m_id(++cacheCount)
+{
+	tp_assert(maxSize >= 2, "the cache must hold at least two blocks");
 }
 
-block_handle block_collection_cache::get_free_block() {
-	block_handle h = m_collection.get_free_block();
-	block * cache_b = tpie_new<block>(m_blockSize);
-	prepare_cache();
-	add_to_cache(h, cache_b, true);
-	return h;
+block_collection_cache::block_collection_cache(std::string fileName, memory_size_type blockSize, std::shared_ptr<buffer_pool> pool, bool writeable,
+											   std::shared_ptr<block_codec> codec)
+	: m_collection(fileName, blockSize, writeable, std::move(codec))
+	, m_pool(std::move(pool))
+	, m_owner(m_pool->register_collection(&m_collection))
+	, m_blockSize(blockSize)
+	, m_id(++cacheCount)
+{
 }
 
-void block_collection_cache::free_block(block_handle handle) {
-	tp_assert(handle.size == m_blockSize, "the size of the handle is not correct")
-	tp_assert(m_curSize > 0, "the current size of the cache is 0");
+block_collection_cache::~block_collection_cache() {
+	// write the content of the cache to disk
+	m_pool->unregister_collection(m_owner);
+}
 
-	block_map_t::iterator i = m_blockMap.find(handle);
+memory_size_type block_collection_cache::memory_usage(memory_size_type blockSize, memory_size_type maxSize) {
+	return sizeof(block_collection_cache)
+		+ bits::freespace_collection::extents_memory_usage()
+		+ buffer_pool::memory_usage(maxSize * buffer_pool::frame_memory(blockSize));
+}
 
-	if(i != m_blockMap.end()) {
-		m_blockList.erase(i->second.iterator);
-		tpie_delete(i->second.pointer);
-		--m_curSize;
-		m_blockMap.erase(i);
-	}
+memory_size_type block_collection_cache::max_size_for_memory(memory_size_type blockSize, memory_size_type memory) {
+	memory_size_type fixed = memory_usage(blockSize, 0);
+	memory_size_type maxSize = memory > fixed ? (memory - fixed) / buffer_pool::frame_memory(blockSize) : 0;
+	return std::max<memory_size_type>(maxSize, 2);
+}
 
-	m_collection.free_block(handle);
+memory_size_type block_collection_cache::max_size() const {
+	return m_pool->memory() / buffer_pool::frame_memory(m_collection.memory_size(m_blockSize));
 }
 
-void block_collection_cache::prepare_cache() {
-	if(m_curSize < m_maxSize)
-		return;
+block_handle block_collection_cache::get_free_block() {
+	return add_free_block(m_collection.get_free_block());
+}
 
-	// write the last accessed block to disk
-	block_handle handle = m_blockList.front();
-	m_blockList.pop_front();
+block_handle block_collection_cache::get_free_block(stream_size_type hint) {
+	return add_free_block(m_collection.get_free_block(hint));
+}
 
-	block_map_t::iterator i = m_blockMap.find(handle);
-	if(i->second.dirty)
-		m_collection.write_block(i->first, *(i->second.pointer));
-	tpie_delete(i->second.pointer);
-	--m_curSize;
-	m_blockMap.erase(i);
+block_handle block_collection_cache::get_free_block_at(stream_size_type position) {
+	return add_free_block(m_collection.get_free_block_at(position));
 }
 
-void block_collection_cache::add_to_cache(block_handle handle, block * b, bool dirty) {
-	tp_assert(m_curSize < m_maxSize, "must not be full");
+block_handle block_collection_cache::add_free_block(block_handle h) {
+	block * b = m_pool->add(m_owner, h, true);
+	// A new block starts out zeroed, as if freshly allocated
+	std::fill(b->begin(), b->end(), 0);
+	return h;
+}
 
-	m_blockList.push_back(handle);
-	block_list_t::iterator list_pos = m_blockList.end();
-	--list_pos;
+void block_collection_cache::free_block(block_handle handle) {
+	tp_assert(handle.size == m_blockSize, "the size of the handle is not correct")
 
-	m_blockMap[handle] = block_information_t(b, list_pos, dirty);
-	++m_curSize;
+	m_pool->drop(m_owner, handle);
+	m_collection.free_block(handle);
 }
 
-void block_collection_cache::used(block_information_t& item) {
-	// Move the item's list node to the end.
-	m_blockList.splice(m_blockList.end(), m_blockList, item.iterator);
+block * block_collection_cache::read_block(block_handle handle) {
+	last_read & l = t_lastRead;
+	if (l.cache == m_id && l.position == handle.position && l.operations == buffer_pool::thread_operations())
+		return l.b;
+
+	block * b = m_pool->read(m_owner, handle);
+	l.cache = m_id;
+	l.position = handle.position;
+	l.operations = buffer_pool::thread_operations();
+	l.b = b;
+	l.dirty = false;
+	return b;
 }
 
-block * block_collection_cache::read_block(block_handle handle) {
-	block_map_t::iterator i = m_blockMap.find(handle);
+// Reads a block into the pool and deletes itself when done. It holds on to
+// the cache, so the collection outlives the read.
+class block_collection_cache::prefetch_job : public job {
+public:
+	// noexcept, so tpie_new has no cleanup path for a throwing constructor
+	prefetch_job(std::shared_ptr<block_collection_cache> cache, block_handle handle) noexcept
+		: m_cache(std::move(cache))
+		, m_handle(handle)
+	{
+	}
 
-	if(i != m_blockMap.end()) { // the block is already in the cache
-		used(i->second);
-		return i->second.pointer;
+	void operator()() override {
+		buffer_pool & pool = *m_cache->m_pool;
+		try {
+			pool.read(m_cache->m_owner, m_handle);
+		} catch (...) {
+			// The block is not cached, so the reader hits the error again
+		}
+		// Job threads keep no blocks pinned
+		pool.release_thread();
 	}
 
-	// the block isn't in the cache
-	prepare_cache(); // make space in the cache for the new block
+protected:
+	void on_done() override {
+		tpie_delete(this);
+	}
 
-	block * cache_b = tpie_new<block>();
-	m_collection.read_block(handle, *cache_b);
-	add_to_cache(handle, cache_b, false);
+private:
+	std::shared_ptr<block_collection_cache> m_cache;
+	block_handle m_handle;
+};
 
-	return cache_b;
+void block_collection_cache::prefetch_block(block_handle handle) {
+	if (m_pool->contains(m_owner, handle)) return;
+	tpie_new<prefetch_job>(shared_from_this(), handle)->enqueue();
 }
 
 void block_collection_cache::write_block(block_handle handle) {
-	block_map_t::iterator i = m_blockMap.find(handle);
-
-	tp_assert(i != m_blockMap.end(), "the given handle does not exist in the cache.");
-
-	used(i->second);
-	i->second.dirty = true;
+	// The last read block stays pinned until this thread pins another, so
+	// a block already marked dirty stays dirty
+	last_read & l = t_lastRead;
+	bool last = l.cache == m_id && l.position == handle.position && l.operations == buffer_pool::thread_operations();
+	if (last && l.dirty) return;
+
+	m_pool->mark_dirty(m_owner, handle);
+	if (!last) return;
+	l.operations = buffer_pool::thread_operations();
+	l.dirty = true;
 }
 
 } // namespace blocks
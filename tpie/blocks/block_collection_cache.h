@@ -26,11 +26,12 @@
 
 #include <tpie/tpie.h>
 #include <tpie/tpie_assert.h>
+#include <tpie/array.h>
 #include <tpie/file_accessor/file_accessor.h>
 #include <tpie/blocks/block.h>
 #include <tpie/blocks/block_collection.h>
-#include <list>
-#include <map>
+#include <tpie/blocks/buffer_pool.h>
+#include <memory>
 
 namespace tpie {
 
@@ -38,45 +39,64 @@ namespace blocks {
 
 /**
  * \brief A class to manage writing and reading of block to disk. 
- * Blocks are stored in an internal cache with a static size.
+ * Blocks are stored in a buffer_pool, either private to the cache and
+ * holding a static number of blocks, or shared with other caches.
+ *
+ * Cached blocks are found through a hash table on their position and
+ * evicted by the policy of the pool. The blocks of the last few accesses
+ * of each thread are never evicted, so a pointer returned by read_block()
+ * stays valid while the same thread reads a handful of other blocks.
+ *
+ * Any number of threads may call read_block() at the same time, as long as
+ * no thread changes the collection meanwhile. A thread reading the same
+ * block again, as a search within a node does, gets it without locking the
+ * pool.
+ *
+ * prefetch_block() reads blocks on a job thread ahead of their use, which
+ * needs the cache to be owned by a std::shared_ptr.
  */
-class block_collection_cache {
-private:
-	struct position_comparator {
-		bool operator()(const block_handle & a, const block_handle & b) const {
-			return a.position < b.position;
-		}
-	};
-
-	typedef std::list<block_handle> block_list_t;
-
-	struct block_information_t {
-		block_information_t() {}
-
-		block_information_t(block * pointer, block_list_t::iterator iterator, bool dirty)
-			: pointer(pointer)
-			, iterator(iterator)
-			, dirty(dirty)
-		{}
-
-		block * pointer;
-		block_list_t::iterator iterator;
-		bool dirty;
-	};
-
-	typedef std::map<block_handle, block_information_t, position_comparator> block_map_t;
+class block_collection_cache : public std::enable_shared_from_this<block_collection_cache> {
 public:
 	/**
-	 * \brief Create a block collection
+	 * \brief Create a block collection with a private cache
 	 * \param fileName the file in which blocks are saved
 	 * \param blockSize the size of blocks constructed
 	 * \param writeable indicates whether the collection is writeable
 	 * \param maxSize the size of the cache given in number of blocks
+	 * \param codec translates the blocks between disk and memory, if given
+	 */
+	block_collection_cache(std::string fileName, memory_size_type blockSize, memory_size_type maxSize, bool writeable,
+						   std::shared_ptr<block_codec> codec=std::shared_ptr<block_codec>());
+
+	/**
+	 * \brief Create a block collection caching its blocks in a shared pool
+	 * \param fileName the file in which blocks are saved
+	 * \param blockSize the size of blocks constructed
+	 * \param pool the pool holding the cached blocks
+	 * \param writeable indicates whether the collection is writeable
+	 * \param codec translates the blocks between disk and memory, if given
 	 */
-	block_collection_cache(std::string fileName, memory_size_type blockSize, memory_size_type maxSize, bool writeable);
+	block_collection_cache(std::string fileName, memory_size_type blockSize, std::shared_ptr<buffer_pool> pool, bool writeable,
+						   std::shared_ptr<block_codec> codec=std::shared_ptr<block_codec>());
 
 	~block_collection_cache();
 
+	/**
+	 * \brief Memory used by a private cache of the given number of blocks,
+	 * including the free extents the block collection keeps in memory but
+	 * not the buffer of its stack of free blocks
+	 * \param blockSize the size of blocks in memory
+	 * \param maxSize the size of the cache given in number of blocks
+	 */
+	static memory_size_type memory_usage(memory_size_type blockSize, memory_size_type maxSize);
+
+	/**
+	 * \brief The largest number of blocks a private cache may hold within
+	 * the given memory, and at least two
+	 * \param blockSize the size of blocks in memory
+	 * \param memory the memory available to the cache
+	 */
+	static memory_size_type max_size_for_memory(memory_size_type blockSize, memory_size_type memory);
 
 	/**
 	 * \brief Allocates a new block
@@ -84,22 +104,28 @@ public:
 	 */
 	block_handle get_free_block();
 
+	/**
+	 * \brief Allocates a new block as close as possible to a position
+	 * \param hint the position of a block used together with the new one
+	 * \return the handle of the new block
+	 */
+	block_handle get_free_block(stream_size_type hint);
+
+	/**
+	 * \brief Allocates the block at a given position, which must be free
+	 *
+	 * Throws an exception if the block is in use.
+	 * \param position the position of the block
+	 * \return the handle of the new block
+	 */
+	block_handle get_free_block_at(stream_size_type position);
+
 	/**
 	 * \brief frees a block
 	 * \param handle the handle of the block to be freed
 	 */
 	void free_block(block_handle handle);
 
-private:
-	// make space for a new block in the cache
-	void prepare_cache();
-
-	void add_to_cache(block_handle handle, block * b, bool dirty);
-
-	// Register that item is now the most recently used one.
-	void used(block_information_t& item);
-
-public:
 	/**
 	 * \brief Reads the content of a block from disk
 	 * \param handle the handle of the block to read
@@ -107,6 +133,18 @@ public:
 	 */
 	block * read_block(block_handle handle);
 
+	/**
+	 * \brief Start reading a block into the cache on a job thread
+	 *
+	 * Returns at once. A later read_block() of the block finds it in the
+	 * cache unless it was evicted meanwhile, and waits for it if it is
+	 * still being read. Errors are reported by that read_block().
+	 * \param handle the handle of the block to read
+	 * \pre the cache is owned by a std::shared_ptr and the job manager is
+	 * running, as it is after tpie_init()
+	 */
+	void prefetch_block(block_handle handle);
+
 	/**
 	 * \brief Writes the content of a block to disk
 	 * \param handle the handle of the block to write
@@ -114,13 +152,53 @@ public:
 	 */
 	void write_block(block_handle handle);
 
+	/**
+	 * \brief The number of blocks the cache holds at most, which for a
+	 * shared pool is the number of blocks of this size that fit in the pool
+	 */
+	memory_size_type max_size() const;
+
+	/**
+	 * \brief The size of the file spanned by the allocated blocks
+	 */
+	stream_size_type size() {return m_collection.size();}
+
+	/**
+	 * \brief The number of blocks of this collection in the cache
+	 */
+	memory_size_type cached_blocks() const {return m_pool->blocks(m_owner);}
+
+	/**
+	 * \brief The pool holding the cached blocks
+	 */
+	const std::shared_ptr<buffer_pool> & pool() const {return m_pool;}
+
+	/**
+	 * \brief The number of calls to read_block() that found the block in the
+	 * cache, not counting those that read the block the same thread read
+	 * just before
+	 */
+	stream_size_type hits() const {return m_pool->hits(m_owner);}
+
+	/**
+	 * \brief The number of calls to read_block() and prefetches that read
+	 * the block from disk
+	 */
+	stream_size_type misses() const {return m_pool->misses(m_owner);}
+
 private:
+	class prefetch_job;
+
+	// Put a newly allocated block into the pool, zeroed
+	block_handle add_free_block(block_handle handle);
+
 	block_collection m_collection;
-	block_list_t m_blockList;
-	block_map_t m_blockMap;
-	memory_size_type m_curSize;
-	memory_size_type m_maxSize;
+	std::shared_ptr<buffer_pool> m_pool;
+	memory_size_type m_owner;
 	memory_size_type m_blockSize;
+	// Unique among all caches created, to recognize the last block read by
+	// a thread
+	stream_size_type m_id;
 };
 
 } // blocks namespace
@@ -0,0 +1,467 @@
+// -*- mode: c++; tab-width: 4; indent-tabs-mode: t; c-file-style: "stroustrup"; -*-
+// vi:set ts=4 sts=4 sw=4 noet :
+// Copyright 2026, The TPIE development team
+//
+// This file is part of TPIE.
+//
+// TPIE is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// TPIE is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with TPIE.  If not, see <http://www.gnu.org/licenses/>
+
+#include <tpie/blocks/buffer_pool.h>
+#include <tpie/tpie_assert.h>
+#include <algorithm>
+
+namespace tpie {
+
+namespace blocks {
+
+namespace {
+
+thread_local stream_size_type t_operations = 0;
+
+} // unnamed namespace
+
+class buffer_pool::thread_exit {
+public:
+	~thread_exit() {
+		for (memory_size_type i = 0; i < m_pools.size(); ++i) {
+			std::lock_guard<std::mutex> lock(m_pools[i]->mutex);
+			buffer_pool * pool = m_pools[i]->pool;
+			if (pool) pool->release_thread();
+		}
+	}
+
+	void add(const std::shared_ptr<link> & l) {
+		// Forget the pools that are gone, so a thread that uses many pools
+		// in turn keeps a short list
+		memory_size_type j = 0;
+		for (memory_size_type i = 0; i < m_pools.size(); ++i) {
+			if (m_pools[i] == l) return;
+			if (m_pools[i]->pool) m_pools[j++] = m_pools[i];
+		}
+		m_pools.resize(j);
+		m_pools.push_back(l);
+	}
+
+private:
+	std::vector<std::shared_ptr<link> > m_pools;
+};
+
+buffer_pool::buffer_pool(memory_size_type memory, memory_size_type recent)
+	: m_link(std::make_shared<link>(this))
+	, m_ghostFront(0)
+	, m_ghostTick(0)
+	, m_probationHead(no_frame)
+	, m_probationTail(no_frame)
+	, m_probation(0)
+	, m_registered(0)
+	, m_hand(0)
+	, m_tick(0)
+	, m_recent(recent)
+	, m_memory(memory)
+	, m_used(0)
+	, m_blocks(0)
+	, m_hits(0)
+	, m_misses(0)
+	, m_evictions(0)
+{
+}
+
+buffer_pool::~buffer_pool() {
+	tp_assert(m_registered == 0, "a collection is still registered with the buffer pool");
+	// Wait for a thread that is unpinning its blocks as it exits
+	std::lock_guard<std::mutex> lock(m_link->mutex);
+	m_link->pool = 0;
+}
+
+std::shared_ptr<buffer_pool> buffer_pool::global() {
+	static std::shared_ptr<buffer_pool> pool = std::make_shared<buffer_pool>(0);
+	return pool;
+}
+
+memory_size_type buffer_pool::frame_memory(memory_size_type blockSize) {
+	// The frame table and the free list at most double their size when they
+	// grow, and the queue of remembered blocks also keeps up to as many
+	// entries that left it. An entry of the index or of
+	// the remembered blocks is a node of two pointers besides the entry,
+	// plus a bucket pointer at a load factor of at least one half.
+	return block::memory_usage(blockSize)
+		+ 2 * sizeof(frame)
+		+ 2 * sizeof(memory_size_type)
+		+ 4 * sizeof(ghost_order_t::value_type)
+		+ sizeof(index_t::value_type) + 4 * sizeof(void *)
+		+ sizeof(ghost_t::value_type) + 4 * sizeof(void *);
+}
+
+memory_size_type buffer_pool::memory_usage(memory_size_type memory, memory_size_type collections) {
+	return sizeof(buffer_pool)
+		+ 2 * collections * (sizeof(owner_t) + sizeof(memory_size_type))
+		+ memory;
+}
+
+void buffer_pool::set_memory(memory_size_type memory) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_memory = memory;
+	while (m_used > m_memory) {
+		memory_size_type i = evict();
+		if (i == no_frame) break;
+		m_free.push_back(i);
+		tpie_delete(m_frames[i].b);
+		m_frames[i].b = 0;
+	}
+}
+
+memory_size_type buffer_pool::register_collection(block_collection * collection) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	memory_size_type owner;
+	if (m_freeOwners.empty()) {
+		owner = m_owners.size();
+		m_owners.push_back(owner_t());
+	} else {
+		owner = m_freeOwners.back();
+		m_freeOwners.pop_back();
+	}
+	m_owners[owner].collection = collection;
+	++m_registered;
+	return owner;
+}
+
+void buffer_pool::unregister_collection(memory_size_type owner) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (memory_size_type i = 0; i < m_frames.size() && m_owners[owner].blocks > 0; ++i) {
+		frame & f = m_frames[i];
+		if (!f.used || f.owner != owner) continue;
+		if (f.dirty)
+			m_owners[owner].collection->write_block(f.handle, *f.b);
+		discard(i);
+	}
+	m_owners[owner] = owner_t();
+	m_freeOwners.push_back(owner);
+
+	if (--m_registered == 0) {
+		// Give back all memory, so an unused pool owns none
+		std::vector<frame, allocator<frame> >().swap(m_frames);
+		std::vector<memory_size_type, allocator<memory_size_type> >().swap(m_free);
+		index_t().swap(m_index);
+		ghost_t().swap(m_ghost);
+		ghost_order_t().swap(m_ghostOrder);
+		m_ghostFront = 0;
+		std::vector<owner_t, allocator<owner_t> >().swap(m_owners);
+		std::vector<memory_size_type, allocator<memory_size_type> >().swap(m_freeOwners);
+		readers_t().swap(m_readers);
+		m_hand = 0;
+	}
+}
+
+block * buffer_pool::read(memory_size_type owner, block_handle handle) {
+	key_t key(owner, handle.position);
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;) {
+		index_t::iterator j = m_index.find(key);
+		if (j == m_index.end()) break;
+		memory_size_type i = j->second;
+		if (m_frames[i].loading) {
+			// Another thread is reading the block from disk
+			m_loaded.wait(lock);
+			continue;
+		}
+		++m_hits;
+		++m_owners[owner].hits;
+		use(i);
+		return m_frames[i].b;
+	}
+
+	++m_misses;
+	++m_owners[owner].misses;
+	memory_size_type i = insert(owner, handle, false);
+	m_frames[i].loading = true;
+	block * b = m_frames[i].b;
+	block_collection * collection = m_owners[owner].collection;
+
+	// The frame is pinned, so it stays while the block is read
+	lock.unlock();
+	try {
+		collection->read_block(handle, *b);
+	} catch (...) {
+		lock.lock();
+		m_frames[i].loading = false;
+		discard(i);
+		m_loaded.notify_all();
+		throw;
+	}
+	lock.lock();
+	m_frames[i].loading = false;
+	m_loaded.notify_all();
+	return b;
+}
+
+block * buffer_pool::add(memory_size_type owner, block_handle handle, bool dirty) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_frames[insert(owner, handle, dirty)].b;
+}
+
+void buffer_pool::mark_dirty(memory_size_type owner, block_handle handle) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	index_t::iterator j = m_index.find(key_t(owner, handle.position));
+
+	tp_assert(j != m_index.end(), "the given handle does not exist in the pool.");
+
+	frame & f = m_frames[j->second];
+	touch(f);
+	pin(j->second);
+	f.dirty = true;
+}
+
+void buffer_pool::drop(memory_size_type owner, block_handle handle) {
+	key_t key(owner, handle.position);
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;) {
+		index_t::iterator j = m_index.find(key);
+		if (j == m_index.end()) return;
+		if (m_frames[j->second].loading) {
+			// A reader or prefetch job is reading into the frame's buffer
+			m_loaded.wait(lock);
+			continue;
+		}
+		++t_operations;
+		discard(j->second);
+		return;
+	}
+}
+
+stream_size_type buffer_pool::thread_operations() {
+	return t_operations;
+}
+
+void buffer_pool::release_thread() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	++t_operations;
+	readers_t::iterator j = m_readers.find(std::this_thread::get_id());
+	if (j == m_readers.end()) return;
+	for (memory_size_type k = 0; k < j->second.pinned.size(); ++k)
+		unpin(j->second.pinned[k]);
+	m_readers.erase(j);
+}
+
+memory_size_type buffer_pool::insert(memory_size_type owner, block_handle handle, bool dirty) {
+	key_t key(owner, handle.position);
+	tp_assert(m_index.count(key) == 0, "the block is already in the pool");
+	memory_size_type i = acquire_frame(m_owners[owner].collection->memory_size(handle.size));
+	frame & f = m_frames[i];
+	f.owner = owner;
+	f.handle = handle;
+	f.count = 0;
+	f.dirty = dirty;
+	f.used = true;
+	m_index.insert(std::make_pair(key, i));
+	++m_owners[owner].blocks;
+	++m_blocks;
+
+	ghost_t::iterator j = m_ghost.find(key);
+	if (j == m_ghost.end()) {
+		push_probation(i);
+		f.lastUse = ++m_tick;
+	} else {
+		// Evicted from probation a short while ago
+		m_ghost.erase(j);
+		touch(f);
+	}
+	pin(i);
+	return i;
+}
+
+void buffer_pool::use(memory_size_type i) {
+	frame & f = m_frames[i];
+	if (f.probation && m_tick - f.lastUse >= m_recent) {
+		// Used again, not just right after it was read, so move it to the
+		// main part
+		unlink_probation(i);
+		f.count = 0;
+	}
+	touch(f);
+	pin(i);
+}
+
+void buffer_pool::discard(memory_size_type i) {
+	remove(i);
+	m_free.push_back(i);
+	tpie_delete(m_frames[i].b);
+	m_frames[i].b = 0;
+}
+
+memory_size_type buffer_pool::acquire_frame(memory_size_type blockSize) {
+	memory_size_type need = frame_memory(blockSize);
+	memory_size_type reuse = no_frame;
+
+	// When every block is pinned the pool goes over its memory rather than
+	// invalidate a block in use.
+	while (m_used + need > m_memory) {
+		memory_size_type i = evict();
+		if (i == no_frame) break;
+		if (reuse == no_frame && m_frames[i].b->size() == blockSize) {
+			reuse = i;
+			continue;
+		}
+		tpie_delete(m_frames[i].b);
+		m_frames[i].b = 0;
+		m_free.push_back(i);
+	}
+
+	if (reuse == no_frame) {
+		if (m_free.empty()) {
+			reuse = m_frames.size();
+			m_frames.push_back(frame());
+		} else {
+			reuse = m_free.back();
+			m_free.pop_back();
+		}
+		m_frames[reuse].b = tpie_new<block>(blockSize);
+	}
+	m_used += need;
+	return reuse;
+}
+
+memory_size_type buffer_pool::evict() {
+	memory_size_type i = no_frame;
+	if (4 * m_probation > m_blocks || m_probation == m_blocks)
+		i = evict_probation();
+	if (i == no_frame)
+		i = evict_main();
+	if (i == no_frame)
+		i = evict_probation();
+	return i;
+}
+
+memory_size_type buffer_pool::evict_probation() {
+	for (memory_size_type i = m_probationHead; i != no_frame; i = m_frames[i].next) {
+		frame & f = m_frames[i];
+		if (f.pins > 0) continue;
+		remember(key_t(f.owner, f.handle.position));
+		evict_frame(i);
+		return i;
+	}
+	return no_frame;
+}
+
+memory_size_type buffer_pool::evict_main() {
+	// Every pass of the hand lowers the count of each block that is not
+	// pinned, so some block reaches zero within maxCount() + 1 passes
+	// unless all blocks are pinned.
+	memory_size_type n = m_frames.size();
+	if (m_probation == m_blocks) return no_frame;
+	for (memory_size_type step = 0; step < (maxCount() + 2) * n; ++step) {
+		memory_size_type i = m_hand;
+		m_hand = m_hand + 1 == n ? 0 : m_hand + 1;
+		frame & f = m_frames[i];
+		if (!f.used || f.probation || f.pins > 0) continue;
+		if (f.count > 0) {
+			--f.count;
+			continue;
+		}
+		evict_frame(i);
+		return i;
+	}
+	return no_frame;
+}
+
+void buffer_pool::evict_frame(memory_size_type i) {
+	frame & f = m_frames[i];
+	if (f.dirty)
+		m_owners[f.owner].collection->write_block(f.handle, *f.b);
+	remove(i);
+	++m_evictions;
+}
+
+void buffer_pool::remove(memory_size_type i) {
+	frame & f = m_frames[i];
+	m_index.erase(key_t(f.owner, f.handle.position));
+	if (f.probation) unlink_probation(i);
+	--m_owners[f.owner].blocks;
+	--m_blocks;
+	m_used -= frame_memory(f.b->size());
+	f.pins = 0;
+	++f.generation;
+	f.used = false;
+	f.dirty = false;
+}
+
+void buffer_pool::push_probation(memory_size_type i) {
+	frame & f = m_frames[i];
+	f.probation = true;
+	f.prev = m_probationTail;
+	f.next = no_frame;
+	if (m_probationTail == no_frame) m_probationHead = i;
+	else m_frames[m_probationTail].next = i;
+	m_probationTail = i;
+	++m_probation;
+}
+
+void buffer_pool::unlink_probation(memory_size_type i) {
+	frame & f = m_frames[i];
+	if (f.prev == no_frame) m_probationHead = f.next;
+	else m_frames[f.prev].next = f.next;
+	if (f.next == no_frame) m_probationTail = f.prev;
+	else m_frames[f.next].prev = f.prev;
+	f.probation = false;
+	--m_probation;
+}
+
+void buffer_pool::remember(const key_t & key) {
+	// Remember as many blocks as the pool holds. Entries of blocks read
+	// again since are left in the order and skipped when they are reached.
+	m_ghost[key] = ++m_ghostTick;
+	m_ghostOrder.push_back(std::make_pair(key, m_ghostTick));
+	while (m_ghostOrder.size() - m_ghostFront > std::max<memory_size_type>(m_blocks, 1)) {
+		const std::pair<key_t, stream_size_type> & e = m_ghostOrder[m_ghostFront++];
+		ghost_t::iterator j = m_ghost.find(e.first);
+		if (j != m_ghost.end() && j->second == e.second)
+			m_ghost.erase(j);
+	}
+	if (2 * m_ghostFront >= m_ghostOrder.size()) {
+		m_ghostOrder.erase(m_ghostOrder.begin(), m_ghostOrder.begin() + m_ghostFront);
+		m_ghostFront = 0;
+	}
+}
+
+void buffer_pool::touch(frame & f) {
+	f.lastUse = ++m_tick;
+	if (f.count < maxCount()) ++f.count;
+}
+
+void buffer_pool::pin(memory_size_type i) {
+	++t_operations;
+	if (m_recent == 0) return;
+	frame & f = m_frames[i];
+	++f.pins;
+	pin_t p(i, f.generation);
+	reader & r = m_readers[std::this_thread::get_id()];
+	if (r.pinned.empty()) {
+		thread_local thread_exit exiting;
+		exiting.add(m_link);
+	}
+	if (r.pinned.size() < m_recent) {
+		r.pinned.push_back(p);
+		return;
+	}
+	unpin(r.pinned[r.next]);
+	r.pinned[r.next] = p;
+	r.next = r.next + 1 == m_recent ? 0 : r.next + 1;
+}
+
+void buffer_pool::unpin(const pin_t & p) {
+	frame & f = m_frames[p.first];
+	if (f.generation == p.second) --f.pins;
+}
+
+} // namespace blocks
+} // namespace tpie
@@ -0,0 +1,421 @@
+// -*- mode: c++; tab-width: 4; indent-tabs-mode: t; c-file-style: "stroustrup"; -*-
+// vi:set ts=4 sts=4 sw=4 noet cino+=(0 :
+// Copyright 2026, The TPIE development team
+//
+// This file is part of TPIE.
+//
+// TPIE is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// TPIE is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with TPIE.  If not, see <http://www.gnu.org/licenses/>
+
+///////////////////////////////////////////////////////////////////////////////
+/// \file buffer_pool.h Block buffers shared by several block collections
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef _TPIE_BLOCKS_BUFFER_POOL_H
+#define _TPIE_BLOCKS_BUFFER_POOL_H
+
+#include <tpie/tpie.h>
+#include <tpie/memory.h>
+#include <tpie/hash.h>
+#include <tpie/blocks/block.h>
+#include <tpie/blocks/block_collection.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace tpie {
+
+namespace blocks {
+
+/**
+ * \brief Cached blocks of any number of block collections within one
+ * memory limit.
+ *
+ * Collections register with the pool and then look up, add and drop blocks
+ * by their handle. When a new block does not fit in the memory of the pool,
+ * a block of any collection is evicted, chosen by recency and frequency of
+ * use in the manner of 2Q and GCLOCK:
+ *
+ * A block read for the first time is put on probation. Probation is a FIFO
+ * that holds about a quarter of the blocks, so blocks read once, as by a
+ * scan, are evicted soon after they are read. A block used again later on
+ * probation, or read again shortly after being evicted from it (the pool
+ * remembers the positions of as many evicted blocks as it holds), moves to
+ * the main part of the pool. There every use raises a small use count of
+ * the block, and a clock hand lowers the counts of the blocks it passes and
+ * evicts the first block whose count is zero. Collections whose blocks are
+ * used often thus get a larger part of the pool.
+ *
+ * Each thread pins the blocks of its last few accesses to the pool, so a
+ * pointer returned by read() or add() stays valid while the same thread
+ * uses a handful of other blocks.
+ *
+ * block_collection_cache uses a private pool unless it is given one. The
+ * pool returned by global() is shared by all external B-trees when its
+ * memory is set, for instance to a part of the memory manager limit:
+ * \code
+ * blocks::buffer_pool::global()->set_memory(get_memory_manager().limit() / 4);
+ * \endcode
+ *
+ * The pool is guarded by a mutex, and a block missing from the pool is read
+ * from disk without holding it, so any number of threads may read blocks
+ * at the same time. Blocks of a collection must not be added, changed or
+ * dropped while other threads read the collection. A thread that stops
+ * using the pool for good may call release_thread() to unpin its blocks;
+ * otherwise they are unpinned when the thread exits.
+ */
+class buffer_pool {
+private:
+	struct frame {
+		frame()
+			: owner(0), b(0), lastUse(0), count(0), pins(0), generation(0), prev(0), next(0)
+			, dirty(false), used(false), probation(false), loading(false) {}
+
+		memory_size_type owner;
+		block_handle handle;
+		block * b;
+		stream_size_type lastUse;
+		memory_size_type count;
+		// Number of threads that pinned the block, and the number of blocks
+		// the frame held before it, to tell stale pins apart
+		memory_size_type pins;
+		stream_size_type generation;
+		// Neighbours in the probation FIFO
+		memory_size_type prev;
+		memory_size_type next;
+		bool dirty;
+		bool used;
+		bool probation;
+		// The block is being read from disk
+		bool loading;
+	};
+
+	struct owner_t {
+		owner_t() : collection(0), blocks(0), hits(0), misses(0) {}
+
+		block_collection * collection;
+		memory_size_type blocks;
+		stream_size_type hits;
+		stream_size_type misses;
+	};
+
+	typedef std::pair<memory_size_type, stream_size_type> pin_t;
+
+	// The blocks pinned by a thread, oldest first from next
+	struct reader {
+		reader() : next(0) {}
+
+		std::vector<pin_t, allocator<pin_t> > pinned;
+		memory_size_type next;
+	};
+
+	typedef std::unordered_map<std::thread::id, reader, std::hash<std::thread::id>, std::equal_to<std::thread::id>,
+							   allocator<std::pair<const std::thread::id, reader> > > readers_t;
+
+	typedef std::pair<memory_size_type, stream_size_type> key_t;
+
+	typedef std::unordered_map<key_t, memory_size_type, fast_hash<key_t>, std::equal_to<key_t>,
+							   allocator<std::pair<const key_t, memory_size_type> > > index_t;
+
+	// Blocks evicted from probation, and the order they were evicted in
+	typedef std::unordered_map<key_t, stream_size_type, fast_hash<key_t>, std::equal_to<key_t>,
+							   allocator<std::pair<const key_t, stream_size_type> > > ghost_t;
+	typedef std::vector<std::pair<key_t, stream_size_type>,
+						allocator<std::pair<key_t, stream_size_type> > > ghost_order_t;
+
+	static const memory_size_type no_frame = static_cast<memory_size_type>(-1);
+
+	// Shared with the threads that pinned blocks of the pool, so a thread
+	// that exits can unpin them unless the pool was destroyed first.
+	struct link {
+		link(buffer_pool * p) : pool(p) {}
+
+		std::mutex mutex;
+		std::atomic<buffer_pool *> pool;
+	};
+
+	// Unpins the blocks of the calling thread in every pool when it exits
+	class thread_exit;
+public:
+	/**
+	 * \brief The largest use count of a block in the main part of the pool
+	 */
+	static constexpr memory_size_type maxCount() {return 3;}
+
+	/**
+	 * \brief Create a pool
+	 * \param memory the memory the cached blocks may use
+	 * \param recent the number of latest accesses of each thread whose blocks
+	 * are never evicted
+	 */
+	explicit buffer_pool(memory_size_type memory, memory_size_type recent=16);
+
+	~buffer_pool();
+
+	buffer_pool(const buffer_pool &) = delete;
+	buffer_pool & operator=(const buffer_pool &) = delete;
+
+	/**
+	 * \brief The process-wide pool. It has no memory until set_memory() is
+	 * called, and then serves the external B-trees not given a cache memory
+	 * of their own.
+	 */
+	static std::shared_ptr<buffer_pool> global();
+
+	/**
+	 * \brief The memory a pool charges for caching one block, including its
+	 * share of the frame table and the index
+	 * \param blockSize the size of the block
+	 */
+	static memory_size_type frame_memory(memory_size_type blockSize);
+
+	/**
+	 * \brief Memory used by a pool of the given memory, including the
+	 * bookkeeping of the registered collections
+	 * \param memory the memory the cached blocks may use
+	 * \param collections the number of registered collections
+	 */
+	static memory_size_type memory_usage(memory_size_type memory, memory_size_type collections=1);
+
+	/**
+	 * \brief Change the memory the cached blocks may use, evicting blocks
+	 * if it shrinks
+	 */
+	void set_memory(memory_size_type memory);
+
+	/**
+	 * \brief The memory the cached blocks may use
+	 */
+	memory_size_type memory() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_memory;
+	}
+
+	/**
+	 * \brief The memory the cached blocks use now
+	 */
+	memory_size_type used() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_used;
+	}
+
+	/**
+	 * \brief The number of blocks in the pool
+	 */
+	memory_size_type blocks() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_blocks;
+	}
+
+	/**
+	 * \brief The number of accesses that found the block in the pool
+	 */
+	stream_size_type hits() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_hits;
+	}
+
+	/**
+	 * \brief The number of accesses that did not find the block in the pool
+	 */
+	stream_size_type misses() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_misses;
+	}
+
+	/**
+	 * \brief The number of blocks evicted to make room for other blocks
+	 */
+	stream_size_type evictions() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_evictions;
+	}
+
+	/**
+	 * \brief Register a collection with the pool
+	 * \return the id to pass when using the pool for the collection
+	 */
+	memory_size_type register_collection(block_collection * collection);
+
+	/**
+	 * \brief Write the changed blocks of a collection and drop all its blocks
+	 * from the pool
+	 * \param owner the id returned by register_collection()
+	 */
+	void unregister_collection(memory_size_type owner);
+
+	/**
+	 * \brief The number of blocks of a collection in the pool
+	 * \param owner the id returned by register_collection()
+	 */
+	memory_size_type blocks(memory_size_type owner) const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_owners[owner].blocks;
+	}
+
+	/**
+	 * \brief The number of reads of a collection that found the block in the
+	 * pool
+	 * \param owner the id returned by register_collection()
+	 */
+	stream_size_type hits(memory_size_type owner) const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_owners[owner].hits;
+	}
+
+	/**
+	 * \brief The number of reads of a collection that read the block from
+	 * disk
+	 * \param owner the id returned by register_collection()
+	 */
+	stream_size_type misses(memory_size_type owner) const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_owners[owner].misses;
+	}
+
+	/**
+	 * \brief Whether a block is in the pool or being read into it
+	 * \param owner the id returned by register_collection()
+	 * \param handle the handle of the block
+	 */
+	bool contains(memory_size_type owner, block_handle handle) const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_index.count(key_t(owner, handle.position)) != 0;
+	}
+
+	/**
+	 * \brief Return a block, reading it from disk if it is not in the pool
+	 * \param owner the id returned by register_collection()
+	 * \param handle the handle of the block
+	 */
+	block * read(memory_size_type owner, block_handle handle);
+
+	/**
+	 * \brief Add a block that is not in the pool, evicting other blocks to
+	 * make room
+	 * \param owner the id returned by register_collection()
+	 * \param handle the handle of the block
+	 * \param dirty whether the block must be written when it is evicted
+	 * \return a buffer of the size of the block in memory that the caller
+	 * fills
+	 */
+	block * add(memory_size_type owner, block_handle handle, bool dirty);
+
+	/**
+	 * \brief Mark a cached block as changed and register that it was used
+	 * \pre the block is in the pool
+	 */
+	void mark_dirty(memory_size_type owner, block_handle handle);
+
+	/**
+	 * \brief Drop a block from the pool without writing it, after any read
+	 * of it in progress
+	 */
+	void drop(memory_size_type owner, block_handle handle);
+
+	/**
+	 * \brief Unpin the blocks of the calling thread. This happens by itself
+	 * when the thread exits.
+	 */
+	void release_thread();
+
+	/**
+	 * \brief The number of operations of the calling thread on any pool
+	 * that pinned, unpinned or dropped a block. While it is unchanged, the
+	 * block the thread used last is still pinned.
+	 */
+	static stream_size_type thread_operations();
+
+private:
+	// Evict blocks until a block of the given size fits, and return a frame
+	// with a buffer of that size.
+	memory_size_type acquire_frame(memory_size_type blockSize);
+
+	// Put a block that is not in the pool into a frame pinned by the
+	// calling thread.
+	memory_size_type insert(memory_size_type owner, block_handle handle, bool dirty);
+
+	// Register that the calling thread used the block in frame i.
+	void use(memory_size_type i);
+
+	// Remove the block in frame i from the pool and free its buffer.
+	void discard(memory_size_type i);
+
+	// Evict a block, or return no_frame if every block is pinned.
+	memory_size_type evict();
+
+	// Evict the oldest block on probation that is not pinned.
+	memory_size_type evict_probation();
+
+	// Evict the next block in the main part chosen by the clock hand.
+	memory_size_type evict_main();
+
+	// Write the block in frame i if it changed and remove it from the pool,
+	// keeping its buffer.
+	void evict_frame(memory_size_type i);
+
+	// Remove the block in frame i from the pool, keeping its buffer.
+	void remove(memory_size_type i);
+
+	void push_probation(memory_size_type i);
+	void unlink_probation(memory_size_type i);
+
+	void remember(const key_t & key);
+
+	void touch(frame & f);
+
+	void pin(memory_size_type i);
+	void unpin(const pin_t & p);
+
+	std::shared_ptr<link> m_link;
+	mutable std::mutex m_mutex;
+	// Notified when a block has been read from disk
+	std::condition_variable m_loaded;
+	std::vector<frame, allocator<frame> > m_frames;
+	// Frames that hold no buffer
+	std::vector<memory_size_type, allocator<memory_size_type> > m_free;
+	index_t m_index;
+	ghost_t m_ghost;
+	// A queue of the remembered blocks from m_ghostFront to the end
+	ghost_order_t m_ghostOrder;
+	memory_size_type m_ghostFront;
+	stream_size_type m_ghostTick;
+	memory_size_type m_probationHead;
+	memory_size_type m_probationTail;
+	memory_size_type m_probation;
+	std::vector<owner_t, allocator<owner_t> > m_owners;
+	std::vector<memory_size_type, allocator<memory_size_type> > m_freeOwners;
+	readers_t m_readers;
+	memory_size_type m_registered;
+	memory_size_type m_hand;
+	// Number of accesses so far
+	stream_size_type m_tick;
+	// Number of blocks each thread keeps pinned
+	memory_size_type m_recent;
+	memory_size_type m_memory;
+	memory_size_type m_used;
+	memory_size_type m_blocks;
+	stream_size_type m_hits;
+	stream_size_type m_misses;
+	stream_size_type m_evictions;
+};
+
+} // blocks namespace
+
+}  //  tpie namespace
+
+#endif // _TPIE_BLOCKS_BUFFER_POOL_H
@@ -27,8 +27,13 @@
 #include <tpie/tpie.h>
 #include <tpie/tpie_assert.h>
 #include <tpie/blocks/block.h>
+#include <tpie/memory.h>
 #include <tpie/stack.h>
+#include <algorithm>
+#include <functional>
+#include <iterator>
 #include <limits>
+#include <map>
 
 namespace tpie {
 
@@ -36,44 +41,253 @@ namespace blocks {
 
 namespace bits {
 
+/**
+ * \brief The free blocks of a file of equally sized blocks
+ *
+ * Free blocks are kept as extents of adjacent blocks, and freeing the last
+ * blocks of the file shrinks it. A new block may be placed as close as
+ * possible to a hint, such as the position of a sibling node, so blocks
+ * used together end up near each other on disk.
+ *
+ * At most maxExtents extents are kept in memory, so the memory used is
+ * bounded by memory_usage(maxExtents) however fragmented the file gets.
+ * A freed block that would start another extent beyond that is kept on the
+ * stack on disk instead. Blocks on the stack are reused before the file
+ * grows, but they neither merge nor follow placement hints.
+ *
+ * When closed the free blocks are saved one by one on a stack in the given
+ * file.
+ */
 class freespace_collection {
 private:
+	// First position of each extent of free blocks and its length in bytes
+	typedef std::map<stream_size_type, stream_size_type, std::less<stream_size_type>,
+					 allocator<std::pair<const stream_size_type, stream_size_type> > > extents_t;
+
+	// Estimated size of a node of extents_t
+	static const memory_size_type extent_memory = 4 * sizeof(void *) + sizeof(extents_t::value_type);
+
 	tpie::stack<block_handle> m_free;
+	extents_t m_extents;
 	stream_size_type m_end;
 	memory_size_type m_blockSize;
+	memory_size_type m_maxExtents;
+
+	// Take the block at position out of the extent i holding it
+	void take(extents_t::iterator i, stream_size_type position) {
+		stream_size_type start = i->first;
+		stream_size_type end = i->first + i->second;
+		m_extents.erase(i);
+		if (start < position) m_extents.insert(std::make_pair(start, position - start));
+		if (position + m_blockSize < end)
+			m_extents.insert(std::make_pair(position + m_blockSize, end - position - m_blockSize));
+	}
+
+	// A new block at the end of the file, or one left on the stack
+	block_handle grow() {
+		if (!m_free.empty()) return m_free.pop();
+		block_handle h(m_end, m_blockSize);
+		m_end += m_blockSize;
+		return h;
+	}
+
 public:
-	freespace_collection(const std::string & path, const memory_size_type blockSize) 
+	/**
+	 * \brief The default number of extents kept in memory
+	 */
+	static const memory_size_type default_max_extents = 4096;
+
+	/**
+	 * \brief Memory used by a collection keeping at most maxExtents extents
+	 * in memory
+	 */
+	static memory_size_type memory_usage(memory_size_type maxExtents = default_max_extents) {
+		return sizeof(freespace_collection) - sizeof(tpie::stack<block_handle>)
+			+ tpie::stack<block_handle>::memory_usage()
+			+ extents_memory_usage(maxExtents);
+	}
+
+	/**
+	 * \brief Memory used by at most maxExtents extents in memory
+	 */
+	static memory_size_type extents_memory_usage(memory_size_type maxExtents = default_max_extents) {
+		return maxExtents * extent_memory;
+	}
+
+	freespace_collection(const std::string & path, const memory_size_type blockSize,
+						 const memory_size_type maxExtents = default_max_extents)
 	: m_free(path)
 	, m_end(0)
 	, m_blockSize(blockSize)
+	, m_maxExtents(std::max<memory_size_type>(maxExtents, 1))
 	{
 		if(m_free.size() > 0) { // when closed the top element of the stacked is an infinitely large block representing the end of the file
 			m_end = m_free.pop().position;
 		}
+		// The blocks left when the extents are full stay on the stack
+		while(!m_free.empty() && m_extents.size() < m_maxExtents)
+			free(m_free.pop());
 	}
 
 	~freespace_collection() {
+		for(extents_t::iterator i = m_extents.begin(); i != m_extents.end(); ++i)
+			for(stream_size_type p = i->first; p < i->first + i->second; p += m_blockSize)
+				m_free.push(block_handle(p, m_blockSize));
 		// when closed the top element of the stacked is an infinitely large block representing the end of the file
 		m_free.push(block_handle(m_end, std::numeric_limits<stream_size_type>::max()));
 	}
 
 	void free(block_handle handle) {
 		tp_assert(handle.size == m_blockSize, "the size of the given handle is incorrect");
-		m_free.push(handle);
+		stream_size_type start = handle.position;
+		stream_size_type end = handle.position + m_blockSize;
+
+		// Merge with the adjacent extents
+		extents_t::iterator next = m_extents.lower_bound(start);
+		tp_assert(next == m_extents.end() || next->first >= end, "the block is already free");
+		if (next != m_extents.end() && next->first == end) {
+			end += next->second;
+			next = m_extents.erase(next);
+		}
+		if (next != m_extents.begin()) {
+			extents_t::iterator prev = std::prev(next);
+			tp_assert(prev->first + prev->second <= start, "the block is already free");
+			if (prev->first + prev->second == start) {
+				start = prev->first;
+				m_extents.erase(prev);
+			}
+		}
+
+		// Free space at the end shrinks the file
+		if (end == m_end) {
+			m_end = start;
+			return;
+		}
+		if (end - start == m_blockSize && m_extents.size() >= m_maxExtents) {
+			m_free.push(handle);
+			return;
+		}
+		m_extents.insert(std::make_pair(start, end - start));
 	}
 
+	/**
+	 * \brief Allocate the first free block
+	 */
 	block_handle alloc() {
-		if(!m_free.empty())
-			return m_free.pop();
+		if(!m_extents.empty()) {
+			stream_size_type position = m_extents.begin()->first;
+			take(m_extents.begin(), position);
+			return block_handle(position, m_blockSize);
+		}
+		return grow();
+	}
 
-		block_handle h(m_end, m_blockSize);
-		m_end += m_blockSize;
-		return h;
+	/**
+	 * \brief Allocate the free block closest to the given position,
+	 * preferring the one after it on ties
+	 */
+	block_handle alloc(stream_size_type hint) {
+		hint = std::min(hint - hint % m_blockSize, m_end);
+
+		// Candidates are the first free block at or after the hint, which
+		// may be the end of the file, and the last one before it
+		extents_t::iterator next = m_extents.lower_bound(hint);
+		stream_size_type after = next == m_extents.end() ? m_end : next->first;
+		if (next != m_extents.begin()) {
+			extents_t::iterator prev = std::prev(next);
+			stream_size_type last = prev->first + prev->second - m_blockSize;
+			// The hint lies in prev, or prev ends before it
+			stream_size_type before = std::min(last, hint);
+			if (before == hint && prev->first < hint && hint < last && m_extents.size() >= m_maxExtents) {
+				// Splitting prev would exceed the extents, so take its
+				// closest end
+				before = hint - prev->first <= last - hint ? prev->first : last;
+				take(prev, before);
+				return block_handle(before, m_blockSize);
+			}
+			if (before == hint || hint - before < after - hint) {
+				take(prev, before);
+				return block_handle(before, m_blockSize);
+			}
+		}
+		if (next == m_extents.end()) return grow();
+		take(next, after);
+		return block_handle(after, m_blockSize);
+	}
+
+	/**
+	 * \brief Allocate the block at the given position if it is free
+	 *
+	 * The block may be in an extent, on the stack on disk or at the end of
+	 * the file. Searching the stack takes time linear in its size.
+	 * \return whether the block was free
+	 */
+	bool take_exact(stream_size_type position) {
+		tp_assert(position % m_blockSize == 0, "the position is not the start of a block");
+		if (position == m_end) {
+			m_end += m_blockSize;
+			return true;
+		}
+		if (position > m_end) return false;
+
+		extents_t::iterator i = m_extents.upper_bound(position);
+		if (i != m_extents.begin() && position < std::prev(i)->first + std::prev(i)->second) {
+			--i;
+			stream_size_type start = i->first;
+			stream_size_type end = i->first + i->second;
+			take(i, position);
+			if (m_extents.size() > m_maxExtents) {
+				// Splitting the extent exceeded the bound, so the shorter
+				// part goes on the stack
+				bool front = position - start <= end - position - m_blockSize;
+				stream_size_type first = front ? start : position + m_blockSize;
+				stream_size_type last = front ? position : end;
+				m_extents.erase(first);
+				for (stream_size_type p = first; p < last; p += m_blockSize)
+					m_free.push(block_handle(p, m_blockSize));
+			}
+			return true;
+		}
+
+		// Put back the blocks above it on the stack in the same order
+		tpie::stack<block_handle> above;
+		bool found = false;
+		while (!m_free.empty()) {
+			block_handle h = m_free.pop();
+			if (h.position == position) {
+				found = true;
+				break;
+			}
+			above.push(h);
+		}
+		while (!above.empty()) m_free.push(above.pop());
+		return found;
+	}
+
+	/**
+	 * \brief Number of free blocks before the end of the file
+	 */
+	stream_size_type free_blocks() const {
+		stream_size_type n = m_free.size();
+		for(extents_t::const_iterator i = m_extents.begin(); i != m_extents.end(); ++i)
+			n += i->second / m_blockSize;
+		return n;
+	}
+
+	/**
+	 * \brief Number of extents of free blocks kept in memory
+	 */
+	memory_size_type extents() const {
+		return m_extents.size();
 	}
 
 	stream_size_type size() {
 		return m_end;
 	}
+
+	memory_size_type block_size() const {
+		return m_blockSize;
+	}
 };
 
 } // bits namespace
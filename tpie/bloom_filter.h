@@ -0,0 +1,263 @@
+// -*- mode: c++; tab-width: 4; indent-tabs-mode: t; eval: (progn (c-set-style "stroustrup") (c-set-offset 'innamespace 0)); -*-
+// vi:set ts=4 sts=4 sw=4 noet :
+// Copyright 2026, The TPIE development team
+//
+// This file is part of TPIE.
+//
+// TPIE is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// TPIE is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with TPIE.  If not, see <http://www.gnu.org/licenses/>
+
+///////////////////////////////////////////////////////////////////////////////
+/// \file bloom_filter.h
+/// \brief Blocked Bloom filter stored on disk.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TPIE_BLOOM_FILTER_H
+#define TPIE_BLOOM_FILTER_H
+
+#include <algorithm>
+#include <cmath>
+#include <tpie/array.h>
+#include <tpie/array_view.h>
+#include <tpie/exception.h>
+#include <tpie/file_accessor/file_accessor.h>
+#include <tpie/hash.h>
+#include <tpie/tempname.h>
+
+namespace tpie {
+
+///////////////////////////////////////////////////////////////////////////////
+/// \class external_bloom_filter
+/// \brief Approximate set membership for a large set of items, with the
+/// filter bits on disk.
+///
+/// The filter is split into blocks of block_size() bytes. The hash value of
+/// an item picks a block, and all hashes() bits of the item are set in that
+/// block, so a lookup reads at most one block. The block last read is kept
+/// in memory, and reading it again costs nothing.
+///
+/// contains() never reports an inserted item absent; an item that was not
+/// inserted is reported present with a probability of about 1% at the
+/// default ten bits per item.
+///
+/// Inserting one item reads and writes a block. Use insert_hashes(), or the
+/// pipelining::bloom_filter_output node, to build the filter in batches
+/// that touch each block once.
+///
+/// \tparam T Item type.
+/// \tparam hash_t Hash function. All bits of its values must be well mixed.
+///////////////////////////////////////////////////////////////////////////////
+template <typename T, typename hash_t = fast_hash<T> >
+class external_bloom_filter {
+public:
+	typedef T item_type;
+
+	/** \brief Default number of bytes in a block. */
+	static const memory_size_type default_block_size = 4096;
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Construct an empty filter in a temporary file.
+	///
+	/// \param n The number of items the filter is sized for.
+	/// \param bitsPerItem Number of filter bits per item. More bits lower the
+	/// false positive rate.
+	/// \param blockSize Number of bytes in a block. Must be a power of two
+	/// of at least 64.
+	/// \param hash Hash function.
+	///////////////////////////////////////////////////////////////////////////
+	external_bloom_filter(stream_size_type n, double bitsPerItem = 10.0,
+						  memory_size_type blockSize = default_block_size,
+						  const hash_t & hash = hash_t())
+		: m_hash(hash)
+		, m_blockSize(blockSize)
+		, m_size(0)
+		, m_blockReads(0)
+		, m_blockWrites(0)
+	{
+		if (blockSize < 64 || (blockSize & (blockSize - 1)) != 0)
+			throw exception("external_bloom_filter: The block size must be a power of two of at least 64");
+		if (!(bitsPerItem >= 1.0))
+			throw exception("external_bloom_filter: At least one bit per item is needed");
+
+		double bits = static_cast<double>(std::max<stream_size_type>(n, 1)) * bitsPerItem;
+		m_blocks = static_cast<stream_size_type>(std::ceil(bits / (8.0 * static_cast<double>(blockSize))));
+		// The number of bits set per item that minimizes the false positive rate
+		double k = std::floor(bitsPerItem * std::log(2.0) + 0.5);
+		m_hashes = static_cast<memory_size_type>(std::min(16.0, std::max(1.0, k)));
+
+		m_block.resize(blockSize / sizeof(uint64_t));
+		m_current = m_blocks;
+		m_accessor.open_rw_new(m_file.path());
+		// Extending the file fills it with zero bits
+		m_accessor.truncate_i(m_blocks * blockSize);
+	}
+
+	~external_bloom_filter() {
+		m_accessor.close_i();
+	}
+
+	external_bloom_filter(const external_bloom_filter &) = delete;
+	external_bloom_filter & operator=(const external_bloom_filter &) = delete;
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Memory used by a filter with the given block size.
+	///////////////////////////////////////////////////////////////////////////
+	static memory_size_type memory_usage(memory_size_type blockSize = default_block_size) {
+		return sizeof(external_bloom_filter) + array<uint64_t>::memory_usage(blockSize / sizeof(uint64_t));
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief The hash value of an item, as passed to insert_hashes().
+	///////////////////////////////////////////////////////////////////////////
+	size_t hash_value(const T & item) const {
+		return m_hash(item);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Insert an item, reading and writing its block.
+	///////////////////////////////////////////////////////////////////////////
+	void insert(const T & item) {
+		size_t h = hash_value(item);
+		stream_size_type b = block_of(h);
+		read_block(b);
+		set_bits(h);
+		write_block(b);
+		++m_size;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Insert a batch of items given by their hash values, reading
+	/// and writing each block they touch once.
+	///
+	/// The hash values are sorted by block in place.
+	///////////////////////////////////////////////////////////////////////////
+	void insert_hashes(array_view<size_t> hashes) {
+		std::sort(hashes.begin(), hashes.end(), [this](size_t a, size_t b) {
+			return block_of(a) < block_of(b);
+		});
+		for (size_t i = 0; i < hashes.size();) {
+			stream_size_type b = block_of(hashes[i]);
+			read_block(b);
+			for (; i < hashes.size() && block_of(hashes[i]) == b; ++i)
+				set_bits(hashes[i]);
+			write_block(b);
+		}
+		m_size += hashes.size();
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Whether the item may have been inserted, reading at most one
+	/// block.
+	///////////////////////////////////////////////////////////////////////////
+	bool contains(const T & item) {
+		size_t h = hash_value(item);
+		read_block(block_of(h));
+		return test_bits(h);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Number of items inserted, counting repeated items repeatedly.
+	///////////////////////////////////////////////////////////////////////////
+	stream_size_type size() const {return m_size;}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Number of blocks in the filter.
+	///////////////////////////////////////////////////////////////////////////
+	stream_size_type blocks() const {return m_blocks;}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Number of bytes in a block.
+	///////////////////////////////////////////////////////////////////////////
+	memory_size_type block_size() const {return m_blockSize;}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Number of bits set per item.
+	///////////////////////////////////////////////////////////////////////////
+	memory_size_type hashes() const {return m_hashes;}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Number of blocks read from disk so far.
+	///////////////////////////////////////////////////////////////////////////
+	stream_size_type block_reads() const {return m_blockReads;}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Number of blocks written to disk so far.
+	///////////////////////////////////////////////////////////////////////////
+	stream_size_type block_writes() const {return m_blockWrites;}
+
+private:
+	// The high bits of the hash value pick the block, so that blocks are
+	// in the order of the hash values.
+	stream_size_type block_of(size_t h) const {
+#ifdef __SIZEOF_INT128__
+		return static_cast<stream_size_type>((static_cast<unsigned __int128>(h) * m_blocks) >> (8 * sizeof(size_t)));
+#else
+		return static_cast<stream_size_type>(h % m_blocks);
+#endif
+	}
+
+	// The bits within the block come from a remixed hash value, using
+	// double hashing to derive the positions.
+	template <typename F>
+	bool for_each_bit(size_t h, F f) {
+		uint64_t g = hash_bits::multiply_mix(static_cast<uint64_t>(h) ^ hash_bits::fast_secret[2],
+											 hash_bits::fast_secret[3]);
+		uint64_t mask = static_cast<uint64_t>(m_blockSize) * 8 - 1;
+		uint64_t a = g & 0xFFFFFFFF;
+		uint64_t step = (g >> 32) | 1;
+		for (memory_size_type i = 0; i < m_hashes; ++i) {
+			uint64_t p = (a + i * step) & mask;
+			if (!f(m_block[static_cast<size_t>(p >> 6)], static_cast<uint64_t>(1) << (p & 63))) return false;
+		}
+		return true;
+	}
+
+	void set_bits(size_t h) {
+		for_each_bit(h, [](uint64_t & word, uint64_t bit) {word |= bit; return true;});
+	}
+
+	bool test_bits(size_t h) {
+		return for_each_bit(h, [](uint64_t & word, uint64_t bit) {return (word & bit) != 0;});
+	}
+
+	void read_block(stream_size_type b) {
+		if (b == m_current) return;
+		m_accessor.seek_i(b * m_blockSize);
+		m_accessor.read_i(m_block.get(), m_blockSize);
+		m_current = b;
+		++m_blockReads;
+	}
+
+	void write_block(stream_size_type b) {
+		m_accessor.seek_i(b * m_blockSize);
+		m_accessor.write_i(m_block.get(), m_blockSize);
+		++m_blockWrites;
+	}
+
+	hash_t m_hash;
+	memory_size_type m_blockSize;
+	memory_size_type m_hashes;
+	stream_size_type m_blocks;
+	stream_size_type m_size;
+	stream_size_type m_blockReads;
+	stream_size_type m_blockWrites;
+	// The block held in m_block, or m_blocks if none
+	stream_size_type m_current;
+	array<uint64_t> m_block;
+	temp_file m_file;
+	file_accessor::raw_file_accessor m_accessor;
+};
+
+} // namespace tpie
+
+#endif // TPIE_BLOOM_FILTER_H
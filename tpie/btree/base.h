@@ -20,7 +20,10 @@
 #ifndef _TPIE_BTREE_BASE_H_
 #define _TPIE_BTREE_BASE_H_
 #include <tpie/portability.h>
+#include <algorithm>
+#include <cstddef>
 #include <functional>
+#include <type_traits>
 namespace tpie {
 
 /**
@@ -38,6 +41,37 @@ struct empty_augmenter {
     empty_augment operator()(const T &) {return empty_augment();}
 };
 
+/**
+ * \brief Augmentation struct holding the number of items below a node
+ */
+struct count_augment {
+	size_t count;
+	explicit operator size_t() const noexcept {return count;}
+};
+
+/**
+ * \brief Functor augmenting a btree with the number of items below each
+ * node, for use with rank() and select()
+ */
+struct count_augmenter {
+	template <typename N>
+	count_augment operator()(const N & node) {
+		count_augment ans{0};
+		if (node.is_leaf()) ans.count = node.count();
+		else for (size_t i=0; i < node.count(); ++i) ans.count += node.get_augmentation(i).count;
+		return ans;
+	}
+};
+
+/**
+ * \brief Functor giving the number of items below a node from an augment
+ * that converts to that count, such as count_augment
+ */
+struct augment_count {
+	template <typename A>
+	size_t operator()(const A & a) const noexcept {return static_cast<size_t>(a);}
+};
+
 /**
  * \brief Functor used to extract the key from a value in case 
  * keys and values are the same
@@ -72,6 +106,33 @@ static const int f_internal = 1;
 static const int f_static = 2;
 static const int f_unordered = 4;
 static const int f_serialized = 8;
+static const int f_compressed = 16;
+
+/**
+ * \brief Count the keys of a node that are less than k, or with upper, the
+ * keys that are not greater than k, comparing with <.
+ *
+ * The keys are sorted and lie stride bytes apart starting at first, as keys
+ * stored in an array of node entries do. A branchless binary search narrows
+ * the range to a few keys, which are then counted without branches; for
+ * keys stored back to back the compiler may vectorize the count.
+ */
+template <bool upper, typename K>
+inline size_t sorted_count(const char * first, size_t stride, size_t count, K k) {
+	size_t base = 0;
+	while (count > 16) {
+		size_t half = count / 2;
+		K x = *reinterpret_cast<const K *>(first + (base + half) * stride);
+		base = (upper ? !(k < x) : x < k) ? base + half : base;
+		count -= half;
+	}
+	size_t n = base;
+	for (size_t i = 0; i < count; ++i) {
+		K x = *reinterpret_cast<const K *>(first + (base + i) * stride);
+		n += upper ? !(k < x) : x < k;
+	}
+	return n;
+}
 
 } //namespace bbits
 
@@ -107,6 +168,13 @@ using btree_ordered = bbits::int_opt<0>;
 using btree_serialized = bbits::int_opt<bbits::f_serialized>;
 using btree_not_serialized = bbits::int_opt<0>;
 
+/**
+ * \brief Store the leaves of an external btree packed on disk, leaving out
+ * the bytes that all values of a leaf share
+ */
+using btree_compressed = bbits::int_opt<bbits::f_compressed>;
+using btree_uncompressed = bbits::int_opt<0>;
+
 enum btree_flags : uint64_t {
 	compress_none = 0x0,
 	compress_lz4 = 0x1,
@@ -140,6 +208,9 @@ enum btree_flags : uint64_t {
 	compress_default = compress_level_default | compress_lz4,
 	read = 0x010000,
 	write = 0x020000,
+	// Serialize and compress the nodes of a serialized tree being built on
+	// job threads; see bbits::serialized_store
+	build_parallel = 0x040000,
 	defaults = read | write,
 	defaults_v0 = read | write
 };
@@ -224,6 +295,9 @@ class btree_node;
 template <typename S>
 class btree_iterator;
 
+template <typename S>
+class btree_scanner;
+
 namespace bbits {
 
 /**
@@ -253,7 +327,7 @@ struct block_size_getter;
 template <typename T, typename A, std::size_t a, std::size_t b>
 class internal_store;
 
-template <typename T, typename A, std::size_t a, std::size_t b, std::size_t bs>
+template <typename T, typename A, std::size_t a, std::size_t b, std::size_t bs, bool compressed>
 class external_store;
 
 template <typename T, typename A, std::size_t a, std::size_t b, std::size_t bs>
@@ -277,7 +351,9 @@ public:
 	static const bool is_static = O::O & bbits::f_static;
 	static const bool is_ordered = ! (O::O & bbits::f_unordered);
 	static const bool is_serialized = O::O & bbits::f_serialized;
+	static const bool is_compressed = O::O & bbits::f_compressed;
 	static_assert(!is_serialized || is_static, "Serialized B-tree cannot be dynamic.");
+	static_assert(!is_compressed || (!is_internal && !is_serialized), "Only external B-trees that are not serialized can be compressed.");
 	
 	typedef typename std::conditional<
 		is_ordered,
@@ -330,7 +406,7 @@ public:
 		typename std::conditional<
 			is_serialized,
 			bbits::serialized_store<value_type, combined_augment, O::a, O::b, O::bs>,
-			bbits::external_store<value_type, combined_augment, O::a, O::b, O::bs>
+			bbits::external_store<value_type, combined_augment, O::a, O::b, O::bs, is_compressed>
 			>::type
 		>::type store_type;
 	
@@ -357,6 +433,41 @@ public:
 		return min_key(v, 0);
 	}
 
+	/**
+	 * \brief The number of values from the start of [first, last) that fit
+	 * in one leaf
+	 */
+	template <typename IT>
+	size_t leaf_prefix(IT first, IT last) const {
+		return leaf_prefix(first, last, std::integral_constant<bool, is_compressed>());
+	}
+
+	/**
+	 * \brief Whether v can be inserted into leaf l without splitting it
+	 */
+	bool leaf_has_room(leaf_type l, const value_type & v) const {
+		return leaf_has_room(l, v, std::integral_constant<bool, is_compressed>());
+	}
+
+	/**
+	 * \brief The least number of leaves that hold the values in
+	 * [first, last) when they are split evenly
+	 */
+	template <typename IT>
+	size_t leaf_parts(IT first, IT last) const {
+		const size_t n = static_cast<size_t>(last - first);
+		const size_t maxLeaf = m_store.max_leaf_size();
+		for (size_t k = (n + maxLeaf - 1) / maxLeaf;; ++k) {
+			bool fits = true;
+			for (size_t j=0, t=0; fits && j < k; ++j) {
+				const size_t s = n / k + (j < n % k);
+				fits = leaf_prefix(first + t, first + t + s) == s;
+				t += s;
+			}
+			if (fits) return k;
+		}
+	}
+
 	const store_type & store() const {
 		return m_store;
 	}
@@ -375,6 +486,25 @@ public:
 
 	combined_augmenter m_augmenter;
 	store_type m_store;
+
+private:
+	template <typename IT>
+	size_t leaf_prefix(IT first, IT last, std::false_type) const {
+		return std::min(static_cast<size_t>(last - first), m_store.max_leaf_size());
+	}
+
+	template <typename IT>
+	size_t leaf_prefix(IT first, IT last, std::true_type) const {
+		return m_store.leaf_prefix(first, last);
+	}
+
+	bool leaf_has_room(leaf_type l, const value_type &, std::false_type) const {
+		return m_store.count(l) != m_store.max_leaf_size();
+	}
+
+	bool leaf_has_room(leaf_type l, const value_type & v, std::true_type) const {
+		return m_store.leaf_has_room(l, v);
+	}
 };
 
 
@@ -25,6 +25,7 @@
 #include <tpie/btree/node.h>
 #include <tpie/memory.h>
 #include <cstddef>
+#include <type_traits>
 #include <vector>
 
 namespace tpie {
@@ -33,6 +34,9 @@ namespace bbits {
 /**
  * \brief External or internal augmented btree
  *
+ * The const members of an external btree (find(), lower_bound(), iterators,
+ * root() and the nodes below it) may be used from several threads at once,
+ * as long as no thread modifies the tree meanwhile.
  */
 template <typename T, typename O>
 class tree {
@@ -78,6 +82,11 @@ public:
 	 * \brief Iterator type
 	 */
 	typedef btree_iterator<state_type> iterator;
+
+	/**
+	 * \brief Range scan type
+	 */
+	typedef btree_scanner<state_type> scanner;
 private:
 	typedef typename store_type::leaf_type leaf_type;
 	typedef typename store_type::internal_type internal_type;
@@ -99,6 +108,55 @@ private:
 		return m_state.store().get_child_leaf(node, i);
 	}
 
+	// Whether keys of type K are searched in the nodes directly: arithmetic
+	// keys compared by <, and in leaves only when the values are the keys.
+	template <typename N, typename K>
+	struct direct_search : std::integral_constant<bool,
+		std::is_arithmetic<key_type>::value
+		&& std::is_same<typename std::decay<K>::type, key_type>::value
+		&& (std::is_same<comp_type, default_comp>::value || std::is_same<comp_type, std::less<key_type> >::value)
+		&& (std::is_same<N, internal_type>::value
+			|| (std::is_same<keyextract_type, identity_key>::value && std::is_same<value_type, key_type>::value))> {};
+
+	const char * key_address(internal_type n, size_t i) const {
+		return reinterpret_cast<const char *>(
+			&static_cast<const typename state_type::key_augment *>(&m_state.store().augment(n, i))->key);
+	}
+
+	const char * key_address(leaf_type n, size_t i) const {
+		return reinterpret_cast<const char *>(&m_state.store().get(n, i));
+	}
+
+	/**
+	 * \brief Index of the first entry in [from, to) of a node whose key is
+	 * not less than k, or with upper, greater than k, or to if there is none
+	 */
+	template <bool upper, typename N, typename K>
+	size_t search(N n, size_t from, size_t to, const K & k) const {
+		return search<upper>(n, from, to, k, direct_search<N, K>());
+	}
+
+	template <bool upper, typename N, typename K>
+	size_t search(N n, size_t from, size_t to, const K & k, std::true_type) const {
+		if (from >= to) return from;
+		// The stores keep the entries of a node in an array
+		const char * first = key_address(n, from);
+		size_t stride = to - from > 1 ? static_cast<size_t>(key_address(n, from + 1) - first) : 0;
+		return from + sorted_count<upper>(first, stride, to - from, k);
+	}
+
+	template <bool upper, typename N, typename K>
+	size_t search(N n, size_t from, size_t to, const K & k, std::false_type) const {
+		while (from < to) {
+			size_t mid = from + (to - from) / 2;
+			if (upper ? !m_comp(k, m_state.min_key(n, mid)) : m_comp(m_state.min_key(n, mid), k))
+				from = mid + 1;
+			else
+				to = mid;
+		}
+		return from;
+	}
+
 	template <bool upper_bound = false, typename K>
 	leaf_type find_leaf(std::vector<internal_type> & path, K k) const {
 		path.clear();
@@ -106,19 +164,56 @@ private:
 		internal_type n = m_state.store().get_root_internal();
 		for (size_t i=2;; ++i) {
 			path.push_back(n);
-			for (size_t j=0; ; ++j) {
- 				if (j+1 == m_state.store().count(n) ||
-					(upper_bound
-					 ? m_comp(k, m_state.min_key(n, j+1))
-					 : !m_comp(m_state.min_key(n, j+1), k))) {
-					if (i == m_state.store().height()) return m_state.store().get_child_leaf(n, j);
-					n = m_state.store().get_child_internal(n, j);
-					break;
-				}
-			}
+			// The child before the first later child whose minimum key is
+			// not less than (with upper_bound: greater than) k
+			size_t j = search<upper_bound>(n, 1, m_state.store().count(n), k) - 1;
+			if (i == m_state.store().height()) return m_state.store().get_child_leaf(n, j);
+			n = m_state.store().get_child_internal(n, j);
 		}
 	}
 
+	// Fold the items of a leaf with keys in [*lo, *hi) into r, where a null
+	// bound leaves that side of the range open
+	template <typename K, typename R, typename VF, typename AF>
+	void aggregate(leaf_type l, size_t, const K * lo, const K * hi, R & r, VF & value_fn, AF &) const {
+		size_t z = m_state.store().count(l);
+		size_t i = lo ? search<false>(l, 0, z, *lo) : 0;
+		size_t j = hi ? search<false>(l, i, z, *hi) : z;
+		for (; i < j; ++i) r = value_fn(r, m_state.store().get(l, i));
+	}
+
+	// Fold the items below an internal node at the given depth with keys in
+	// [*lo, *hi) into r. Only the children holding a bound are visited, the
+	// children between them contribute their augments.
+	template <typename K, typename R, typename VF, typename AF>
+	void aggregate(internal_type n, size_t depth, const K * lo, const K * hi, R & r, VF & value_fn, AF & augment_fn) const {
+		size_t z = m_state.store().count(n);
+		size_t a = lo ? search<false>(n, 1, z, *lo) - 1 : 0;
+		size_t b = hi ? search<false>(n, a + 1, z, *hi) - 1 : z - 1;
+		aggregate_child(n, a, depth, lo, a == b ? hi : nullptr, r, value_fn, augment_fn);
+		for (size_t i = a + 1; i < b; ++i)
+			r = augment_fn(r, state_type::user_augment(m_state.store().augment(n, i)));
+		if (a < b) aggregate_child(n, b, depth, static_cast<const K *>(nullptr), hi, r, value_fn, augment_fn);
+	}
+
+	template <typename K, typename R, typename VF, typename AF>
+	void aggregate_child(internal_type n, size_t i, size_t depth, const K * lo, const K * hi, R & r, VF & value_fn, AF & augment_fn) const {
+		if (!lo && !hi)
+			r = augment_fn(r, state_type::user_augment(m_state.store().augment(n, i)));
+		else if (depth + 1 == m_state.store().height())
+			aggregate(m_state.store().get_child_leaf(n, i), depth + 1, lo, hi, r, value_fn, augment_fn);
+		else
+			aggregate(m_state.store().get_child_internal(n, i), depth + 1, lo, hi, r, value_fn, augment_fn);
+	}
+
+	template <typename K, typename R, typename VF, typename AF>
+	void aggregate_root(const K * lo, const K * hi, R & r, VF & value_fn, AF & augment_fn) const {
+		if (m_state.store().height() == 1)
+			aggregate(m_state.store().get_root_leaf(), 1, lo, hi, r, value_fn, augment_fn);
+		else if (m_state.store().height() > 1)
+			aggregate(m_state.store().get_root_internal(), 1, lo, hi, r, value_fn, augment_fn);
+	}
+
 	void augment(leaf_type l, internal_type p) {
 		m_state.store().set_augment(l, p, m_state.m_augmenter(node_type(&m_state, l)));
 	}
@@ -179,6 +274,118 @@ private:
 		return right;
 	}
 
+	/**
+	 * \brief Make a root above the given nodes, adding as many levels as
+	 * needed
+	 */
+	template <typename NT>
+	void grow_root(const std::vector<NT> & nodes) {
+		const size_t n = nodes.size();
+		const size_t k = (n + m_state.store().max_internal_size() - 1) / m_state.store().max_internal_size();
+		std::vector<internal_type> parents;
+		for (size_t j=0, t=0; j < k; ++j) {
+			internal_type p = m_state.store().create_internal();
+			const size_t z = n / k + (j < n % k);
+			for (size_t i=0; i < z; ++i)
+				m_state.store().set(p, i, nodes[t+i]);
+			m_state.store().set_count(p, z);
+			for (size_t i=0; i < z; ++i)
+				augment(nodes[t+i], p);
+			t += z;
+			parents.push_back(p);
+		}
+		m_state.store().set_height(m_state.store().height()+1);
+		if (k == 1) {
+			m_state.store().set_root(parents[0]);
+			return;
+		}
+		grow_root(parents);
+	}
+
+	/**
+	 * \brief Insert the new nodes extra right after node, whose ancestors
+	 * are path[0..level), splitting the ancestors as needed
+	 *
+	 * A parent receiving too many children is split into as few nodes as
+	 * possible, which share the children evenly.
+	 */
+	template <typename NT>
+	void insert_children(const std::vector<internal_type> & path, size_t level,
+						 NT node, std::vector<NT> & extra) {
+		if (level == 0) {
+			if (extra.empty()) return;
+			extra.insert(extra.begin(), node);
+			grow_root(extra);
+			return;
+		}
+		internal_type p = path[level-1];
+		augment(node, p);
+		if (extra.empty()) {
+			augment_path(path.data(), level-1);
+			return;
+		}
+
+		const size_t index = m_state.store().index(node, p) + 1;
+		const size_t e = extra.size();
+		const size_t n = m_state.store().count(p) + e;
+		const size_t k = (n + max_size(p) - 1) / max_size(p);
+		std::vector<internal_type> parts(1, p);
+		for (size_t j=1; j < k; ++j)
+			parts.push_back(m_state.store().create(parts.back()));
+
+		// Fill the parts from the back, so every entry of p is moved
+		// before its slot is overwritten
+		std::vector<internal_type> owners(e);
+		size_t part = k-1;
+		size_t begin = n - (n / k + (part < n % k));
+		for (size_t t=n; t-- > 0;) {
+			while (t < begin) {
+				--part;
+				begin -= n / k + (part < n % k);
+			}
+			size_t i = t - begin;
+			if (t < index) {
+				if (part != 0) m_state.store().move(p, t, parts[part], i);
+			} else if (t < index + e) {
+				m_state.store().set(parts[part], i, extra[t-index]);
+				owners[t-index] = parts[part];
+			} else
+				m_state.store().move(p, t-e, parts[part], i);
+		}
+		for (size_t j=0; j < k; ++j)
+			m_state.store().set_count(parts[j], n / k + (j < n % k));
+		for (size_t j=0; j < e; ++j)
+			augment(extra[j], owners[j]);
+
+		parts.erase(parts.begin());
+		insert_children(path, level-1, p, parts);
+	}
+
+	/**
+	 * \brief Replace the items of leaf l, whose ancestors are path, by the
+	 * given items, spread evenly over l and as few new leaves after it as
+	 * they fit in
+	 */
+	void spread(const std::vector<internal_type> & path, leaf_type l, const std::vector<value_type> & items) {
+		const size_t n = items.size();
+		const size_t parts = m_state.leaf_parts(items.begin(), items.end());
+		// Empty l first, so it never holds a mix of old and new items that
+		// a compressed store could not write
+		m_state.store().set_count(l, 0);
+		std::vector<leaf_type> leaves;
+		for (size_t j=0, t=0; j < parts; ++j) {
+			// Each new leaf is placed after the one before it if possible
+			leaf_type d = j == 0 ? l : m_state.store().create(leaves.empty() ? l : leaves.back());
+			const size_t s = n / parts + (j < n % parts);
+			for (size_t x=0; x < s; ++x)
+				m_state.store().set(d, x, items[t+x]);
+			m_state.store().set_count(d, s);
+			t += s;
+			if (j != 0) leaves.push_back(d);
+		}
+		insert_children(path, path.size(), l, leaves);
+	}
+
 	void augment_path(leaf_type) {
 		//NOOP
 	}
@@ -317,7 +524,7 @@ public:
 		auto level = itr.m_path.size();
 		
 		//If there is room in the leaf
-		if (m_state.store().count(itr.m_leaf) != m_state.store().max_leaf_size()) {
+		if (m_state.leaf_has_room(itr.m_leaf, v)) {
 			insert_part(itr.m_leaf, v, index);
 			if (level != 0) {
 				augment(itr.m_leaf, path[level-1]);
@@ -325,6 +532,21 @@ public:
 			}
 			return;
 		}
+
+		// A compressed leaf may be full before it has max_leaf_size() items,
+		// and its items may not fit in two leaves of half as many
+		if (state_type::is_compressed) {
+			const size_t z = m_state.store().count(itr.m_leaf);
+			std::vector<value_type> items;
+			items.reserve(z+1);
+			for (size_t i=0; i < z; ++i) {
+				if (i == index) items.push_back(v);
+				items.push_back(m_state.store().get(itr.m_leaf, i));
+			}
+			if (index == z) items.push_back(v);
+			spread(itr.m_path, itr.m_leaf, items);
+			return;
+		}
 		
 		// We split the leaf
 		leaf_type l2 = split_and_insert(v, itr.m_leaf, index);
@@ -372,6 +594,107 @@ public:
 		insert_before(v, upper_bound(m_state.m_augmenter.m_key_extract(v)));
 	}
 
+	/**
+	 * \brief Insert the values in [first, last), which must be sorted by
+	 * key, into the btree
+	 *
+	 * The values are merged into the tree a leaf at a time: each leaf is
+	 * visited once for all the values that go into it, and overfull leaves
+	 * and internal nodes are split into as few nodes as needed in one go.
+	 * As with insert(), values go after the items with equal keys already
+	 * in the tree. A long sorted stream, such as the output of a sort, may
+	 * be inserted in consecutive chunks.
+	 */
+	template <typename IT, typename X=enab>
+	void insert_sorted(IT first, IT last, enable<X, !is_static && is_ordered> =enab()) {
+		if (first == last) return;
+		if (m_state.store().height() == 0) {
+			insert(*first);
+			++first;
+		}
+
+		// Bound the values held in memory at once
+		const size_t batch = 16 * m_state.store().max_leaf_size();
+
+		std::vector<internal_type> path;
+		std::vector<value_type> items;
+		while (first != last) {
+			// Find the leaf of the next value and the smallest key of the
+			// leaves after it
+			key_type k = m_state.m_augmenter.m_key_extract(*first);
+			key_type fence = k;
+			bool bounded = false;
+			leaf_type l;
+			path.clear();
+			if (m_state.store().height() == 1)
+				l = m_state.store().get_root_leaf();
+			else {
+				internal_type n = m_state.store().get_root_internal();
+				for (size_t h=2;; ++h) {
+					path.push_back(n);
+					size_t z = m_state.store().count(n);
+					size_t j = search<true>(n, 1, z, k) - 1;
+					if (j + 1 < z) {
+						fence = m_state.min_key(n, j+1);
+						bounded = true;
+					}
+					if (h == m_state.store().height()) {
+						l = m_state.store().get_child_leaf(n, j);
+						break;
+					}
+					n = m_state.store().get_child_internal(n, j);
+				}
+			}
+
+			// Merge the values below the fence with the leaf
+			const size_t z = m_state.store().count(l);
+			size_t i = 0;
+			size_t added = 0;
+			items.clear();
+			do {
+				k = m_state.m_augmenter.m_key_extract(*first);
+				if (bounded && !m_comp(k, fence)) break;
+				while (i < z && !m_comp(k, m_state.min_key(l, i)))
+					items.push_back(m_state.store().get(l, i++));
+				items.push_back(*first);
+				++first;
+				++added;
+			} while (first != last && added < batch);
+			while (i < z)
+				items.push_back(m_state.store().get(l, i++));
+
+			m_state.store().set_size(m_state.store().size() + added);
+			spread(path, l, items);
+		}
+	}
+
+	/**
+	 * \brief Return a scan of the items in [first, last) that yields
+	 * them a leaf at a time
+	 *
+	 * \param ahead Number of leaves after the current one that an external
+	 * btree reads on job threads ahead of the scan
+	 */
+	template <typename X=enab>
+	scanner scan(const iterator & first, const iterator & last, size_t ahead=8,
+				 enable<X, !state_type::is_serialized> =enab()) const {
+		return scanner(&m_state, first, last, ahead);
+	}
+
+	/**
+	 * \brief Return a scan of the items with keys in [from, to) that yields
+	 * them a leaf at a time
+	 *
+	 * \param ahead Number of leaves after the current one that an external
+	 * btree reads on job threads ahead of the scan
+	 */
+	template <typename K, typename X=enab>
+	scanner scan_range(K from, K to, size_t ahead=8,
+					   enable<X, is_ordered && !state_type::is_serialized> =enab()) const {
+		iterator first = lower_bound(from);
+		return scanner(&m_state, first, m_comp(to, from) ? first : lower_bound(to), ahead);
+	}
+
 	/**
 	 * \brief Return an iterator to the first item with the given key
 	 */
@@ -387,16 +710,11 @@ public:
 		std::vector<internal_type> path;
 		leaf_type l = find_leaf<true>(path, v);
 	
-		size_t i=0;
 		size_t z = m_state.store().count(l);
-		while (true) {
-			if (i == z) {
-				itr.goto_end();
-				return itr;
-			}
-			if (!m_comp(m_state.min_key(l, i), v) &&
-				!m_comp(v, m_state.min_key(l, i))) break;
-			++i;
+		size_t i = search<false>(l, 0, z, v);
+		if (i == z || m_comp(v, m_state.min_key(l, i))) {
+			itr.goto_end();
+			return itr;
 		}
 		itr.goto_item(path, l, i);
 		return itr;
@@ -418,11 +736,10 @@ public:
 		leaf_type l = find_leaf(path, v);
 		
 		const size_t z = m_state.store().count(l);
-		for (size_t i = 0 ; i < z ; ++i) {
-			if (!m_comp(m_state.min_key(l, i), v)) {
-				itr.goto_item(path, l, i);
-				return itr;
-			}
+		size_t i = search<false>(l, 0, z, v);
+		if (i < z) {
+			itr.goto_item(path, l, i);
+			return itr;
 		}
 		itr.goto_item(path, l, z-1);
 		return ++itr;
@@ -444,16 +761,85 @@ public:
 		leaf_type l = find_leaf<true>(path, v);
 		
 		const size_t z = m_state.store().count(l);
-		for (size_t i = 0 ; i < z ; ++i) {
-			if (m_comp(v, m_state.min_key(l, i))) {
-				itr.goto_item(path, l, i);
-				return itr;
-			}
+		size_t i = search<true>(l, 0, z, v);
+		if (i < z) {
+			itr.goto_item(path, l, i);
+			return itr;
 		}
 		itr.goto_item(path, l, z-1);
 		return ++itr;
 	}
 
+	/**
+	 * \brief Combine the items with keys in [lo, hi) from left to right
+	 *
+	 * Children of a node that lie entirely inside the range contribute their
+	 * augments without being read, so only the nodes on the paths to lo and
+	 * hi are visited.
+	 *
+	 * \param init The aggregate of no items
+	 * \param value_fn Called as value_fn(r, v) to add the value v to the
+	 * aggregate r
+	 * \param augment_fn Called as augment_fn(r, a) to add the items below a
+	 * child with augment a to the aggregate r
+	 */
+	template <typename K, typename R, typename VF, typename AF, typename X=enab>
+	R aggregate(K lo, K hi, R init, VF value_fn, AF augment_fn, enable<X, is_ordered> =enab()) const {
+		if (m_comp(hi, lo)) return init;
+		aggregate_root(&lo, &hi, init, value_fn, augment_fn);
+		return init;
+	}
+
+	/**
+	 * \brief Return the number of items with keys less than k
+	 *
+	 * \param count Gives the number of items below a child from its augment
+	 */
+	template <typename K, typename C=augment_count, typename X=enab>
+	size_type rank(K k, C count=C(), enable<X, is_ordered> =enab()) const {
+		size_type r = 0;
+		auto value_fn = [](size_type r, const value_type &) {return r + 1;};
+		auto augment_fn = [&count](size_type r, const augment_type & a) {return r + count(a);};
+		aggregate_root(static_cast<const K *>(nullptr), &k, r, value_fn, augment_fn);
+		return r;
+	}
+
+	/**
+	 * \brief Return an iterator to the item with k items before it, or end()
+	 * if there are not that many items
+	 *
+	 * \param count Gives the number of items below a child from its augment
+	 */
+	template <typename C=augment_count>
+	iterator select(size_type k, C count=C()) const {
+		iterator itr(&m_state);
+		if (k >= size()) {
+			itr.goto_end();
+			return itr;
+		}
+		std::vector<internal_type> path;
+		if (m_state.store().height() == 1) {
+			itr.goto_item(path, m_state.store().get_root_leaf(), k);
+			return itr;
+		}
+		internal_type n = m_state.store().get_root_internal();
+		for (size_t depth=1;; ++depth) {
+			path.push_back(n);
+			size_t i = 0;
+			for (;; ++i) {
+				tp_assert(i < m_state.store().count(n), "The augments count too few items");
+				size_t c = count(state_type::user_augment(m_state.store().augment(n, i)));
+				if (k < c) break;
+				k -= c;
+			}
+			if (depth + 1 == m_state.store().height()) {
+				itr.goto_item(path, m_state.store().get_child_leaf(n, i), k);
+				return itr;
+			}
+			n = m_state.store().get_child_internal(n, i);
+		}
+	}
+
 	/**
 	 * \brief remove item at iterator
 	 */
@@ -559,6 +945,18 @@ public:
 		return count;
 	}
 
+	/**
+	 * \brief Move the nodes of an external btree to the start of its file
+	 * in depth first order and shrink the file
+	 *
+	 * Afterwards the leaves lie in key order, each internal node before its
+	 * subtree, so scans read the file sequentially. Invalidates iterators.
+	 */
+	template <typename X=enab>
+	void defragment(enable<X, !is_internal && !state_type::is_serialized> =enab()) {
+		m_state.store().defragment();
+	}
+
 	/**
 	 * \brief Return the root node
 	 * \pre !empty()
@@ -592,10 +990,15 @@ public:
 	
 	/**
 	 * Construct a btree with the given storage
+	 *
+	 * \param cacheMemory Memory for the block cache of an external btree,
+	 * or 0 for the global buffer pool if its memory is set and the default
+	 * cache otherwise
 	 */
 	template <typename X=enab>
-	explicit tree(std::string path, comp_type comp=comp_type(), augmenter_type augmenter=augmenter_type(), enable<X, !is_internal> =enab() ): 
-		m_state(store_type(path), std::move(augmenter), keyextract_type()),
+	explicit tree(std::string path, comp_type comp=comp_type(), augmenter_type augmenter=augmenter_type(),
+				  memory_size_type cacheMemory=0, enable<X, !is_internal> =enab() ):
+		m_state(store_type(path, btree_flags::defaults, cacheMemory), std::move(augmenter), keyextract_type()),
 		m_comp(comp) {}
 
 	/**
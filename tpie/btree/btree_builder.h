@@ -193,7 +193,9 @@ private:
 	* \brief Constructs a leaf. If possible, also constructs internal nodes.
 	*/
 	void extract_nodes() {
-        construct_leaf(is_serialized?m_items.size() : desired_leaf_size());
+        // A compressed leaf may take fewer items than desired
+        construct_leaf(is_serialized ? m_items.size()
+                       : m_state.leaf_prefix(m_items.begin(), m_items.begin() + desired_leaf_size()));
 
         if(m_leaves.size() < internal_tipping_point()) return;
         construct_internal_from_leaves(desired_internal_size());
@@ -258,11 +260,13 @@ public:
 		m_state.store().set_size(m_size);
 
         // finish building the tree by traversing all levels and constructing leaves/nodes
-        // construct one or two leaves if neccesary
+        // construct one or more leaves if neccesary
         if(m_items.size() > 0) {
-            if(!is_serialized && m_items.size() > S::max_leaf_size()) // construct two leaves if necessary
-                construct_leaf(m_items.size()/2);
-            construct_leaf(m_items.size()); // construct a leaf with the remaining items
+            // split the items evenly, over more than two leaves if a compressed store needs it
+            const size_t n = m_items.size();
+            const size_t parts = is_serialized ? 1 : m_state.leaf_parts(m_items.begin(), m_items.end());
+            for(size_t j = 0; j < parts; ++j)
+                construct_leaf(n / parts + (j < n % parts));
         }
 
         // if there already exists internal nodes and there are leaves left: construct a new internal node(since there is guaranteed to be atleast S::min_internal_size leaves)
@@ -23,11 +23,16 @@
 #include <tpie/portability.h>
 #include <tpie/btree/base.h>
 #include <tpie/tpie_assert.h>
+#include <tpie/blocks/block_codec.h>
 #include <tpie/blocks/block_collection_cache.h>
 #include <tpie/btree/external_store_base.h>
+#include <algorithm>
 #include <memory>
 
 #include <cstddef>
+#include <cstring>
+#include <limits>
+#include <vector>
 
 namespace tpie {
 namespace bbits {
@@ -38,12 +43,24 @@ namespace bbits {
  * 
  * \tparam T the type of value stored
  * \tparam A the type of augmentation
+ * \tparam compressed whether leaves that do not fit in a block as they are
+ * are packed on disk
+ *
+ * A compressed store keeps its leaves as they are in memory, in blocks
+ * large enough for max_leaf_size() values. On disk, a leaf that does not
+ * fit in a block stores the bytes that all its values share once, followed
+ * by the other bytes of each value; for sorted keys these are mostly the
+ * bytes that follow their common prefix. A leaf takes values while it fits
+ * in a block this way, so leaves hold up to four times as many values as
+ * they would otherwise. Values are compared as bytes, so T should have no
+ * padding. Internal nodes are stored as they are.
  */
 template <typename T,
 		  typename A,
 		  std::size_t fanout_a,
 		  std::size_t fanout_b,
-		  std::size_t bs>
+		  std::size_t bs,
+		  bool compressed>
 class external_store : public external_store_base {
 public:
 	/**
@@ -58,8 +75,35 @@ public:
 
 	typedef size_t size_type;
 
+	/**
+	 * \brief Number of blocks cached when no cache memory is given, and the
+	 * least number cached otherwise
+	 */
 	static constexpr memory_size_type cacheSize() {return 32;}
 	static constexpr memory_size_type blockSize() {return bs?bs:7000;}
+
+	/**
+	 * \brief Size of the header of a node, its count and, when compressed,
+	 * its kind
+	 */
+	static constexpr memory_size_type headerSize() {
+		return compressed ? 2 * sizeof(memory_size_type) : sizeof(memory_size_type);
+	}
+
+	/**
+	 * \brief Size on disk of a packed leaf of n values that differ in v
+	 * bytes
+	 */
+	static constexpr memory_size_type packed_size(size_t n, size_t v) {
+		return headerSize() + (sizeof(T) + 7) / 8 + sizeof(T) + n * v;
+	}
+
+	/**
+	 * \brief Number of values that fit in a leaf stored as it is
+	 */
+	static constexpr size_t unpacked_leaf_size() {
+		return (blockSize() - headerSize()) / sizeof(T);
+	}
 	
 	struct internal_content {
 		blocks::block_handle handle;
@@ -69,7 +113,7 @@ public:
 	struct internal {
 		internal(blocks::block * b) {
 			count = reinterpret_cast<memory_size_type *>(b->get());
-			values = reinterpret_cast<internal_content *>(b->get() + sizeof(memory_size_type));
+			values = reinterpret_cast<internal_content *>(b->get() + headerSize());
 		}
 
 		memory_size_type * count;
@@ -79,7 +123,7 @@ public:
 	struct leaf {
 		leaf(blocks::block * b) {
 			count = reinterpret_cast<memory_size_type *>(b->get());
-			values = reinterpret_cast<T *>(b->get() + sizeof(memory_size_type));
+			values = reinterpret_cast<T *>(b->get() + headerSize());
 		}
 
 		memory_size_type * count;
@@ -110,12 +154,27 @@ public:
 
 	/**
 	 * \brief Construct a new empty btree storage
+	 *
+	 * \param cacheMemory Memory for a block cache of this tree. If 0, the
+	 * blocks are cached in blocks::buffer_pool::global() when its memory is
+	 * set, and otherwise in a cache of cacheSize() blocks.
 	 */
-	explicit external_store(const std::string & path, btree_flags /*flags*/=btree_flags::defaults)
+	explicit external_store(const std::string & path, btree_flags /*flags*/=btree_flags::defaults,
+							memory_size_type cacheMemory=0)
 	: external_store_base(path)
 		{
+			std::shared_ptr<blocks::block_codec> codec;
+			if (compressed) codec = std::make_shared<leaf_codec>();
+			std::shared_ptr<blocks::buffer_pool> pool = blocks::buffer_pool::global();
+			if (cacheMemory == 0 && pool->memory() > 0) {
+				m_collection = std::make_shared<blocks::block_collection_cache>(
+					path, blockSize(), pool, true, codec);
+				return;
+			}
+			memory_size_type cacheBlocks = std::max(
+				cacheSize(), blocks::block_collection_cache::max_size_for_memory(memoryBlockSize(), cacheMemory));
 			m_collection = std::make_shared<blocks::block_collection_cache>(
-				path, blockSize(), cacheSize(), true);
+				path, blockSize(), cacheBlocks, true, codec);
 		}
 			
 	external_store(external_store&& other) noexcept = default;
@@ -124,20 +183,89 @@ public:
 		m_collection.reset();
 	}
 
+	/**
+	 * \brief Number of blocks the cache holds at most, or for the global
+	 * pool the number of blocks of this tree that would fill it
+	 */
+	memory_size_type cache_blocks() const {return m_collection->max_size();}
+
+	/**
+	 * \brief Number of block reads served from the cache
+	 */
+	stream_size_type cache_hits() const {return m_collection->hits();}
+
+	/**
+	 * \brief Number of block reads that went to disk
+	 */
+	stream_size_type cache_misses() const {return m_collection->misses();}
+
+	/**
+	 * \brief Number of blocks of this tree in the cache
+	 */
+	memory_size_type cached_blocks() const {return m_collection->cached_blocks();}
+
 	static constexpr size_t min_internal_size() {
 		return fanout_a?fanout_a:(max_internal_size() + 3) / 4;
 	}
 
 	static constexpr size_t max_internal_size() {
-		return fanout_b?fanout_b:(blockSize() - sizeof(memory_size_type)) / sizeof(internal_content);
+		return fanout_b?fanout_b:(blockSize() - headerSize()) / sizeof(internal_content);
 	}
 
+	static_assert(headerSize() + max_internal_size() * sizeof(internal_content) <= blockSize(),
+				  "Full internal nodes must fit in a block");
+
 	static constexpr size_t min_leaf_size() {
-		return fanout_a?fanout_a:(max_leaf_size() + 3) / 4;
+		// Two compressed leaves are merged when the smaller has fewer, so
+		// the merged leaf fits in a block as it is
+		return fanout_a?fanout_a:compressed?unpacked_leaf_size() / 2:(max_leaf_size() + 3) / 4;
 	}
 
 	static constexpr size_t max_leaf_size() {
-		return fanout_b?fanout_b:(blockSize() - sizeof(memory_size_type)) / sizeof(T);
+		return fanout_b?fanout_b:compressed
+			? std::min(4 * unpacked_leaf_size(), blockSize() - packed_size(0, 0))
+			: unpacked_leaf_size();
+	}
+
+	static_assert(!compressed || 2 * min_leaf_size() <= unpacked_leaf_size(),
+				  "Merged compressed leaves must fit in a block unpacked");
+
+	/**
+	 * \brief Size of a node in memory
+	 */
+	static constexpr memory_size_type memoryBlockSize() {
+		return compressed ? std::max(blockSize(), headerSize() + max_leaf_size() * sizeof(T)) : blockSize();
+	}
+
+	/**
+	 * \brief The number of values from the start of [first, last) that fit
+	 * in one leaf
+	 */
+	template <typename IT>
+	size_t leaf_prefix(IT first, IT last) const {
+		const size_t n = std::min(static_cast<size_t>(last - first), max_leaf_size());
+		if (!compressed || n <= unpacked_leaf_size()) return n;
+		unsigned char diff[sizeof(T)] = {};
+		const T & ref = *first;
+		for (size_t i=0; i < n; ++i, ++first) {
+			mark_diff(ref, *first, diff);
+			if (i >= unpacked_leaf_size() && packed_size(i+1, count_diff(diff)) > blockSize()) return i;
+		}
+		return n;
+	}
+
+	/**
+	 * \brief Whether v can be inserted into leaf l without splitting it
+	 */
+	bool leaf_has_room(leaf_type l, const T & v) const {
+		leaf n(m_collection->read_block(l.handle));
+		const size_t z = *n.count;
+		if (z >= max_leaf_size()) return false;
+		if (!compressed || z < unpacked_leaf_size()) return true;
+		unsigned char diff[sizeof(T)] = {};
+		for (size_t i=0; i < z; ++i)
+			mark_diff(v, n.values[i], diff);
+		return packed_size(z+1, count_diff(diff)) <= blockSize();
 	}
 	
 	void move(internal_type src, size_t src_i,
@@ -259,8 +387,12 @@ public:
 		return leaf_type(h);
 	}
 
-	leaf_type create(leaf_type) {
-		return create_leaf();
+	/**
+	 * \brief Create a leaf placed right after its sibling if possible
+	 */
+	leaf_type create(leaf_type sibling) {
+		// New blocks are zeroed, so the leaf is empty
+		return leaf_type(m_collection->get_free_block(sibling.handle.position + blockSize()));
 	}
 
 	internal_type create_internal() {
@@ -268,12 +400,89 @@ public:
 		blocks::block * b = m_collection->read_block(h);
 		internal i(b);
 		(*i.count) = 0;
+		if (compressed) i.count[1] = internalKind;
 		m_collection->write_block(h);
 		return internal_type(h);
 	}
 
-	internal_type create(internal_type) {
-		return create_internal();
+	/**
+	 * \brief Create an internal node placed right after its sibling if
+	 * possible
+	 */
+	internal_type create(internal_type sibling) {
+		blocks::block_handle h = m_collection->get_free_block(sibling.handle.position + blockSize());
+		if (compressed) {
+			internal i(m_collection->read_block(h));
+			i.count[1] = internalKind;
+			m_collection->write_block(h);
+		}
+		return internal_type(h);
+	}
+
+	/**
+	 * \brief Move the nodes to the start of the file in depth first order
+	 *
+	 * Node k in depth first order goes to the k'th block. Its block is
+	 * swapped with the node there, if any, and the references to both
+	 * nodes in their parents are updated.
+	 */
+	void defragment() {
+		if (m_height == 0) return;
+		const memory_size_type step = blockSize();
+		const size_t none = std::numeric_limits<size_t>::max();
+
+		struct node_info {
+			stream_size_type position;
+			size_t parent;
+			size_t slot;
+			size_t depth;
+		};
+		std::vector<node_info, allocator<node_info> > nodes;
+		std::vector<node_info, allocator<node_info> > stack;
+		stack.push_back(node_info{m_root.position, none, 0, 1});
+		while (!stack.empty()) {
+			node_info n = stack.back();
+			stack.pop_back();
+			nodes.push_back(n);
+			if (n.depth == m_height) continue;
+			internal in(m_collection->read_block(blocks::block_handle(n.position, step)));
+			for (size_t i = *in.count; i-- > 0;)
+				stack.push_back(node_info{in.values[i].handle.position, nodes.size() - 1, i, n.depth + 1});
+		}
+
+		// The node in each block of the file
+		array<size_t> owner(static_cast<size_t>(m_collection->size() / step), none);
+		for (size_t k = 0; k < nodes.size(); ++k)
+			owner[nodes[k].position / step] = k;
+
+		array<char> first(memoryBlockSize());
+		array<char> second(memoryBlockSize());
+		for (size_t k = 0; k < nodes.size(); ++k) {
+			stream_size_type target = static_cast<stream_size_type>(k) * step;
+			blocks::block_handle from(nodes[k].position, step);
+			blocks::block_handle to(target, step);
+			if (from.position == target) continue;
+
+			size_t other = owner[target / step];
+			copy_block(from, first);
+			if (other == none) {
+				to = m_collection->get_free_block_at(target);
+				paste_block(to, first);
+				m_collection->free_block(from);
+				owner[from.position / step] = none;
+			} else {
+				copy_block(to, second);
+				paste_block(to, first);
+				paste_block(from, second);
+				owner[from.position / step] = other;
+				nodes[other].position = from.position;
+			}
+			owner[target / step] = k;
+			nodes[k].position = target;
+			// The parent of the other node may be node k
+			relink(nodes, k);
+			if (other != none) relink(nodes, other);
+		}
 	}
 
 	void destroy(internal_type node) {
@@ -314,6 +523,13 @@ public:
 		return leaf_type(dstInter.values[i].handle);
 	}
 
+	/**
+	 * \brief Start reading a leaf into the cache on a job thread
+	 */
+	void prefetch(leaf_type l) const {
+		m_collection->prefetch_block(l.handle);
+	}
+
 	size_t index(leaf_type child, internal_type node) const {
 		blocks::block * nodeBlock = m_collection->read_block(node.handle);
 		internal dstInter(nodeBlock);
@@ -394,6 +610,133 @@ public:
 		throw exception("Not yet implemnted.");
 	}
 
+	// Copy the content of a block to a buffer of the size of a node
+	void copy_block(blocks::block_handle h, array<char> & buffer) const {
+		blocks::block * b = m_collection->read_block(h);
+		std::copy(b->begin(), b->end(), buffer.get());
+	}
+
+	// Overwrite the content of a block with a buffer of the size of a node
+	void paste_block(blocks::block_handle h, const array<char> & buffer) {
+		blocks::block * b = m_collection->read_block(h);
+		std::copy(buffer.get(), buffer.get() + b->size(), b->get());
+		m_collection->write_block(h);
+	}
+
+	// The kinds of nodes in the header of a compressed store, and the flag
+	// of a packed leaf on disk
+	static const memory_size_type leafKind = 0;
+	static const memory_size_type internalKind = 1;
+	static const memory_size_type packedFlag = 2;
+
+	// Mark the bytes in which x differs from ref
+	static void mark_diff(const T & ref, const T & x, unsigned char * diff) {
+		const unsigned char * a = reinterpret_cast<const unsigned char *>(&ref);
+		const unsigned char * b = reinterpret_cast<const unsigned char *>(&x);
+		for (size_t j=0; j < sizeof(T); ++j)
+			diff[j] |= a[j] ^ b[j];
+	}
+
+	// The number of bytes marked
+	static size_t count_diff(const unsigned char * diff) {
+		size_t v = 0;
+		for (size_t j=0; j < sizeof(T); ++j)
+			v += diff[j] != 0;
+		return v;
+	}
+
+	// Packs the leaves that do not fit in a block as they are. A packed leaf
+	// is its header, a bit mask of the bytes in which its values differ,
+	// the first value, and the differing bytes of each value.
+	class leaf_codec : public blocks::block_codec {
+	public:
+		memory_size_type memory_size(memory_size_type) const override {
+			return memoryBlockSize();
+		}
+
+		void decode(const char * src, memory_size_type size, blocks::block & dst) const override {
+			const memory_size_type * header = reinterpret_cast<const memory_size_type *>(src);
+			if (!(header[1] & packedFlag)) {
+				std::copy(src, src + size, dst.get());
+				return;
+			}
+			const memory_size_type n = header[0];
+			memory_size_type * out = reinterpret_cast<memory_size_type *>(dst.get());
+			out[0] = n;
+			out[1] = leafKind;
+
+			const unsigned char * mask = reinterpret_cast<const unsigned char *>(src + headerSize());
+			const char * ref = src + headerSize() + (sizeof(T) + 7) / 8;
+			size_t offsets[sizeof(T)];
+			size_t v = 0;
+			for (size_t j=0; j < sizeof(T); ++j)
+				if (mask[j / 8] & (1 << j % 8)) offsets[v++] = j;
+
+			const char * in = ref + sizeof(T);
+			char * values = dst.get() + headerSize();
+			for (size_t i=0; i < n; ++i) {
+				char * p = values + i * sizeof(T);
+				std::memcpy(p, ref, sizeof(T));
+				for (size_t j=0; j < v; ++j)
+					p[offsets[j]] = *in++;
+			}
+		}
+
+		void encode(const blocks::block & src, char * dst, memory_size_type size) const override {
+			const memory_size_type * header = reinterpret_cast<const memory_size_type *>(src.get());
+			const memory_size_type n = header[0];
+			if (header[1] == internalKind || headerSize() + n * sizeof(T) <= size) {
+				std::copy(src.get(), src.get() + size, dst);
+				return;
+			}
+
+			const T * values = reinterpret_cast<const T *>(src.get() + headerSize());
+			unsigned char diff[sizeof(T)] = {};
+			for (size_t i=1; i < n; ++i)
+				mark_diff(values[0], values[i], diff);
+			size_t v = count_diff(diff);
+			if (packed_size(n, v) > size)
+				throw exception("A compressed leaf does not fit in a block");
+
+			std::fill(dst, dst + size, 0);
+			memory_size_type * out = reinterpret_cast<memory_size_type *>(dst);
+			out[0] = n;
+			out[1] = leafKind | packedFlag;
+			unsigned char * mask = reinterpret_cast<unsigned char *>(dst + headerSize());
+			size_t offsets[sizeof(T)];
+			v = 0;
+			for (size_t j=0; j < sizeof(T); ++j) {
+				if (!diff[j]) continue;
+				mask[j / 8] |= static_cast<unsigned char>(1 << j % 8);
+				offsets[v++] = j;
+			}
+			char * ref = dst + headerSize() + (sizeof(T) + 7) / 8;
+			std::memcpy(ref, &values[0], sizeof(T));
+
+			char * o = ref + sizeof(T);
+			for (size_t i=0; i < n; ++i) {
+				const char * p = reinterpret_cast<const char *>(&values[i]);
+				for (size_t j=0; j < v; ++j)
+					*o++ = p[offsets[j]];
+			}
+		}
+	};
+
+	// Point the reference to node k in its parent, or the root, at the
+	// block of the node
+	template <typename N>
+	void relink(const N & nodes, size_t k) {
+		blocks::block_handle h(nodes[k].position, blockSize());
+		if (nodes[k].parent == std::numeric_limits<size_t>::max()) {
+			m_root = h;
+			return;
+		}
+		blocks::block_handle p(nodes[nodes[k].parent].position, blockSize());
+		internal in(m_collection->read_block(p));
+		in.values[nodes[k].slot].handle = h;
+		m_collection->write_block(p);
+	}
+
 	std::shared_ptr<blocks::block_collection_cache> m_collection;
 
 	template <typename>
@@ -402,6 +745,9 @@ public:
 	template <typename>
 	friend class btree_iterator;
 
+	template <typename>
+	friend class btree_scanner;
+
 	template <typename, typename>
 	friend class bbits::tree_state;
 	
@@ -229,6 +229,10 @@ private:
 		return static_cast<leaf_type>(node->values[i].ptr);
 	}
 
+	void prefetch(leaf_type) const {
+		// Leaves are in memory
+	}
+
 	size_t index(void * child, internal_type node) const {
 		for (size_t i=0; i < node->count; ++i)
 			if (node->values[i].ptr == child) return i;
@@ -284,6 +288,9 @@ private:
 	template <typename>
 	friend class ::tpie::btree_iterator;
 
+	template <typename>
+	friend class ::tpie::btree_scanner;
+
 	template <typename, typename>
 	friend class bbits::tree;
 
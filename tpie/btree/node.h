@@ -23,7 +23,10 @@
 #include <tpie/portability.h>
 #include <tpie/tpie_assert.h>
 #include <tpie/btree/base.h>
+#include <tpie/array_view.h>
 #include <boost/iterator/iterator_facade.hpp>
+#include <algorithm>
+#include <deque>
 #include <vector>
 
 namespace tpie {
@@ -243,6 +246,9 @@ private:
 	template <typename, typename>
 	friend class bbits::tree;
 
+	template <typename>
+	friend class btree_scanner;
+
 	btree_iterator(const state_type * state): m_state(state) {}
 
 	void goto_item(const std::vector<internal_type> & p, leaf_type l, size_t i) {
@@ -371,5 +377,115 @@ public:
 };
 
 
+/**
+ * \brief Scan of a range of a btree a leaf at a time
+ *
+ * The leaves ahead of the current one are looked up in their parents and,
+ * in an external btree, read into the block cache on job threads, so a long
+ * scan does not wait for each leaf in turn.
+ */
+template <typename S>
+class btree_scanner {
+public:
+	typedef typename S::value_type value_type;
+
+	btree_scanner(): m_state(nullptr), m_ahead(0), m_begin(0), m_endIndex(0), m_cursorDone(true) {}
+
+	/**
+	 * \brief Return the items of the range in the next leaf, or an empty
+	 * view when the scan is done
+	 *
+	 * The view is valid until the next call or any other use of the tree
+	 * by this thread.
+	 */
+	array_view<const value_type> next() {
+		while (!m_pending.empty()) {
+			leaf_type l = m_pending.front();
+			m_pending.pop_front();
+			fill();
+			size_t b = m_begin;
+			m_begin = 0;
+			size_t e;
+			if (l == m_end) {
+				e = m_endIndex;
+				m_pending.clear();
+			} else
+				e = m_state->store().count(l);
+			if (b < e) return array_view<const value_type>(&m_state->store().get(l, b), e - b);
+		}
+		return array_view<const value_type>(static_cast<const value_type *>(nullptr), size_t(0));
+	}
+
+private:
+	typedef S state_type;
+	typedef typename S::store_type store_type;
+	typedef typename store_type::internal_type internal_type;
+	typedef typename store_type::leaf_type leaf_type;
+
+	// Queue the leaves after the last queued one until ahead leaves, and at
+	// least the next one, are queued
+	void fill() {
+		while (m_pending.size() < std::max<size_t>(m_ahead, 1) && !m_cursorDone) {
+			// The next leaf is found through the parents, without reading
+			// the current leaf
+			size_t h = m_path.size();
+			while (h > 0 && m_child[h-1] + 1 == m_state->store().count(m_path[h-1])) --h;
+			if (h == 0) {
+				m_cursorDone = true;
+				return;
+			}
+			++m_child[h-1];
+			m_path.resize(h);
+			m_child.resize(h);
+			while (m_path.size() + 1 < m_state->store().height()) {
+				m_path.push_back(m_state->store().get_child_internal(m_path.back(), m_child.back()));
+				m_child.push_back(0);
+			}
+			leaf_type l = m_state->store().get_child_leaf(m_path.back(), m_child.back());
+			if (m_ahead != 0) m_state->store().prefetch(l);
+			m_pending.push_back(l);
+			if (l == m_end) m_cursorDone = true;
+		}
+	}
+
+	btree_scanner(const state_type * state, const btree_iterator<S> & first,
+				  const btree_iterator<S> & last, size_t ahead)
+		: m_state(state)
+		, m_path(first.m_path)
+		, m_ahead(ahead)
+		, m_begin(first.m_index)
+		, m_end(last.m_leaf)
+		, m_endIndex(last.m_index)
+		, m_cursorDone(first.m_leaf == last.m_leaf)
+	{
+		if (state->store().height() == 0) return;
+		for (size_t i=0; i < m_path.size(); ++i) {
+			if (i + 1 < m_path.size())
+				m_child.push_back(state->store().index(m_path[i+1], m_path[i]));
+			else
+				m_child.push_back(state->store().index(first.m_leaf, m_path[i]));
+		}
+		m_pending.push_back(first.m_leaf);
+	}
+
+	const state_type * m_state;
+	// The position of the last queued leaf: its ancestors and the index of
+	// each in its parent
+	std::vector<internal_type> m_path;
+	std::vector<size_t> m_child;
+	// Leaves queued for the scan, the first being the next one
+	std::deque<leaf_type> m_pending;
+	size_t m_ahead;
+	// Index of the first item in the next leaf
+	size_t m_begin;
+	leaf_type m_end;
+	size_t m_endIndex;
+	bool m_cursorDone;
+
+	template <typename, typename>
+	friend class bbits::tree;
+};
+
+
 } //namespace tpie
 #endif //_TPIE_BTREE_NODE_H_
@@ -24,8 +24,12 @@
 #include <tpie/btree/base.h>
 #include <tpie/tpie_assert.h>
 #include <tpie/serialization2.h>
+#include <tpie/job.h>
 #include <cstddef>
+#include <deque>
+#include <exception>
 #include <fstream>
+#include <unordered_map>
 
 #ifdef TPIE_HAS_LZ4
 #include <lz4.h>
@@ -43,6 +47,12 @@ namespace bbits {
 /**
  * \brief Serializing store
  *
+ * When built with btree_flags::build_parallel, leaves are serialized and
+ * compressed by job threads while the builder constructs the following
+ * nodes. Nodes are then given sequence numbers instead of file offsets when
+ * created, and are written in the order they were created, at which point
+ * the children of internal nodes are translated to their offsets.
+ *
  * \tparam T the type of value stored
  * \tparam A the type of augmentation
  * \tparam a the minimum fanout of a node
@@ -129,10 +139,10 @@ private:
 	};
 
 	template <typename S, typename N>
-	void serialize(S & s, const N & i) const {
+	static void serialize(S & s, const N & i, btree_flags flags) {
 		using tpie::serialize;
 
-		auto compression_type = m_flags & btree_flags::compression_mask;
+		auto compression_type = flags & btree_flags::compression_mask;
 
 		if (compression_type == btree_flags::compress_none) {
 			serialize(s, i.count);
@@ -168,7 +178,7 @@ private:
 					auto max_compressed_size = ZSTD_compressBound((size_t)uncompressed_size);
 					compressed_buffer.resize(max_compressed_size);
 
-					int level = (int)((uint64_t)(m_flags & btree_flags::compression_level_mask) >> 8);
+					int level = (int)((uint64_t)(flags & btree_flags::compression_level_mask) >> 8);
 					if (level == 0) level = 5;
 
 					size_t r = ZSTD_compress(compressed_buffer.data(), max_compressed_size, uncompressed_buffer.data(), uncompressed_size, level);
@@ -330,6 +340,48 @@ private:
 	
 	typedef std::shared_ptr<internal> internal_type;
 
+	/**
+	 * \brief Serialize a leaf into a buffer on a job thread
+	 */
+	class serialize_job : public job {
+	public:
+		// noexcept, so tpie_new has no cleanup path for a throwing constructor
+		serialize_job(leaf_type l, btree_flags flags) noexcept
+			: m_leaf(std::move(l)), m_flags(flags) {}
+
+		void operator()() override {
+			try {
+				serialize(m_buffer, *m_leaf, m_flags);
+			} catch (...) {
+				m_error = std::current_exception();
+			}
+		}
+
+		leaf_type m_leaf;
+		btree_flags m_flags;
+		serilization_buffer m_buffer;
+		std::exception_ptr m_error;
+	};
+
+	/**
+	 * \brief A node of a parallel build that is not yet written
+	 *
+	 * Leaves have a job serializing them, internal nodes are serialized when
+	 * written since their children must be written first.
+	 */
+	struct pending_node {
+		off_t id;
+		internal_type internal;
+		tpie::unique_ptr<serialize_job> job;
+	};
+
+	/**
+	 * \brief The number of nodes a parallel build may have in flight
+	 */
+	static size_t max_pending() {
+		return 2 * default_worker_count() + 2;
+	}
+
 	void set_flags(btree_flags flags) {
 		m_flags = flags;
 		switch (flags & btree_flags::compression_mask) {
@@ -358,10 +410,13 @@ private:
 	/**
 	 * \brief Construct a new empty btree storage
 	 *
-	 * flags are currently ignored when write_only is false
+	 * flags are currently ignored when write_only is false, and there is no
+	 * block cache to give memory to
 	 */
-	explicit serialized_store(const std::string & path, btree_flags flags=btree_flags::defaults):
-		m_height(0), m_size(0), metadata_offset(0), metadata_size(0), path(path) {
+	explicit serialized_store(const std::string & path, btree_flags flags=btree_flags::defaults,
+							  memory_size_type /*cacheMemory*/=0):
+		m_height(0), m_size(0), metadata_offset(0), metadata_size(0),
+		m_parallel(false), m_nextId(0), path(path) {
 		f.reset(new std::fstream());
 		header h;
 		if ((flags & btree_flags::read) == 0) {
@@ -371,6 +426,8 @@ private:
 			if (!f->is_open())
 				throw invalid_file_exception("Open failed");
 			memset(&h, 0, sizeof(h));
+			m_parallel = (flags & btree_flags::build_parallel) != 0;
+			flags &= ~btree_flags::build_parallel;
 			h.flags = flags;
 			set_flags(flags);
 			f->write(reinterpret_cast<char *>(&h), sizeof(h));
@@ -413,7 +470,11 @@ private:
 		}
 	}
 
-	
+	~serialized_store() {
+		for (pending_node & p : m_pending)
+			if (p.job) p.job->join();
+	}
+
 	void move(internal_type src, size_t src_i,
 			  internal_type dst, size_t dst_i) {
 		dst->values[dst_i] = src->values[src_i];
@@ -461,14 +522,14 @@ private:
 
 	leaf_type create_leaf() {
 		assert(!current_internal && !current_leaf);
-		current_leaf = leaf_type((off_t)f->tellp());
+		current_leaf = leaf_type(next_offset());
 		return current_leaf;
 	}
 	leaf_type create(leaf_type) {return create_leaf();}
 	internal_type create_internal() {
 		assert(!current_internal && !current_leaf);
 		current_internal = std::make_shared<internal>();
-		current_internal->my_offset = (stream_size_type)f->tellp();
+		current_internal->my_offset = next_offset();
 		return current_internal;
 	}
 	internal_type create(internal_type) {return create_internal();}
@@ -546,23 +607,84 @@ private:
 		m_size = size;
 	}
 	
+	/**
+	 * \brief The offset of a new node, or its sequence number in a parallel
+	 * build
+	 */
+	off_t next_offset() {
+		if (m_parallel) return ++m_nextId;
+		return (off_t)f->tellp();
+	}
+
 	void flush() {
+		if (m_parallel) {
+			if (current_internal) {
+				assert(!current_leaf);
+				m_pending.push_back(pending_node{current_internal->my_offset, current_internal, nullptr});
+				current_internal.reset();
+			}
+			if (current_leaf) {
+				m_pending.push_back(pending_node{current_leaf->my_offset, internal_type(),
+												 tpie::make_unique<serialize_job>(current_leaf, m_flags)});
+				m_pending.back().job->enqueue();
+				current_leaf.reset();
+			}
+			while (m_pending.size() > max_pending()) write_pending();
+			return;
+		}
 		if (current_internal) {
 			assert(!current_leaf);
 			assert((stream_size_type)f->tellp() == current_internal->my_offset);
-			serialize(*f, *current_internal);
+			serialize(*f, *current_internal, m_flags);
 			current_internal.reset();
 		}
 		if (current_leaf) {
 			assert((stream_size_type)f->tellp() == current_leaf->my_offset);
-			serialize(*f, *current_leaf);
+			serialize(*f, *current_leaf, m_flags);
 			current_leaf.reset();
 		}
 	}
-	
+
+	/**
+	 * \brief Write the oldest pending node of a parallel build
+	 */
+	void write_pending() {
+		pending_node p = std::move(m_pending.front());
+		m_pending.pop_front();
+		off_t offset = (off_t)f->tellp();
+		if (p.job) {
+			p.job->join();
+			if (p.job->m_error) std::rethrow_exception(p.job->m_error);
+			f->write(p.job->m_buffer.data(), p.job->m_buffer.size());
+		} else {
+			for (size_t i=0; i < p.internal->count; ++i) {
+				auto c = m_offsets.find(p.internal->values[i].offset);
+				assert(c != m_offsets.end());
+				p.internal->values[i].offset = c->second;
+				m_offsets.erase(c);
+			}
+			serialize(*f, *p.internal, m_flags);
+		}
+		m_offsets[p.id] = offset;
+	}
+
+	/**
+	 * \brief Write all pending nodes of a parallel build, and give the root
+	 * its offset
+	 */
+	void write_all_pending() {
+		if (!m_parallel) return;
+		while (!m_pending.empty()) write_pending();
+		if (root_internal) root_internal->my_offset = m_offsets[root_internal->my_offset];
+		if (root_leaf) root_leaf->my_offset = m_offsets[root_leaf->my_offset];
+		m_offsets.clear();
+		m_parallel = false;
+	}
+
 	void finalize_build() {
 		// Should call flush() first.
 		assert(!current_internal && !current_leaf);
+		write_all_pending();
 
 		header h;
 		h.magic = header::good_magic;
@@ -592,6 +714,7 @@ private:
 	void set_metadata(const std::string & data) {
 		assert(!current_internal && !current_leaf);
 		assert(f->is_open());
+		write_all_pending();
 		metadata_offset = (stream_size_type)f->tellp();
 		metadata_size = data.size();
 		f->write(data.c_str(), data.size());
@@ -602,6 +725,7 @@ private:
 		if (metadata_offset == 0 || metadata_size == 0)
 			return {};
 		std::string data(metadata_size, '\0');
+		f->seekg(metadata_offset);
 		f->read(&data[0], metadata_size);
 		return data;
 	}
@@ -610,6 +734,10 @@ private:
 	size_t m_size;
 	off_t metadata_offset, metadata_size;
 	btree_flags m_flags;
+	bool m_parallel;
+	off_t m_nextId;
+	std::deque<pending_node> m_pending;
+	std::unordered_map<off_t, off_t> m_offsets;
 	
 	std::string path;
 	std::unique_ptr<std::fstream> f;
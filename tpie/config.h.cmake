@@ -60,6 +60,9 @@
 #cmakedefine TPIE_HAS_LZ4
 #cmakedefine TPIE_HAS_ZSTD
 
+#cmakedefine TPIE_HAS_AVX2
+#cmakedefine TPIE_HAS_AVX512
+
 // See https://github.com/lz4/lz4/pull/459
 #if __cplusplus >= 201402
 	#define LZ4_DISABLE_DEPRECATE_WARNINGS
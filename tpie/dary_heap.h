@@ -0,0 +1,148 @@
+// -*- mode: c++; tab-width: 4; indent-tabs-mode: t; eval: (progn (c-set-style "stroustrup") (c-set-offset 'innamespace 0)); -*-
+// vi:set ts=4 sts=4 sw=4 noet :
+// Copyright 2026, The TPIE development team
+//
+// This file is part of TPIE.
+//
+// TPIE is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// TPIE is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with TPIE.  If not, see <http://www.gnu.org/licenses/>
+
+///////////////////////////////////////////////////////////////////////////////
+/// \file dary_heap.h
+/// \brief Heap algorithms on d-ary heaps, used as the layout parameter of
+/// internal_priority_queue.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TPIE_DARY_HEAP_H
+#define TPIE_DARY_HEAP_H
+
+#include <algorithm>
+#include <iterator>
+#include <tpie/types.h>
+#include <tpie/util.h>
+
+namespace tpie {
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Heap algorithms for a D-ary max-heap on [a, b) with respect to lt,
+/// with the same semantics as std::make_heap, std::push_heap, std::pop_heap
+/// and tpie::pop_and_push_heap.
+///
+/// The children of element i are the D consecutive elements starting at
+/// D*i+1, so a sift-down step reads one contiguous group of siblings. When
+/// the element after the root starts a cache line, as internal_priority_queue
+/// places it, and D*sizeof(T) is the cache line size, each group fills one
+/// line. Each level then costs one cache miss, and the heap is half (D = 4)
+/// or a third (D = 8) as deep as a binary heap.
+///////////////////////////////////////////////////////////////////////////////
+template <memory_size_type D>
+struct dary_heap {
+	static_assert(D >= 2, "dary_heap requires D >= 2");
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief The number of children of each element.
+	///////////////////////////////////////////////////////////////////////////
+	static const memory_size_type arity = D;
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief The address alignment in bytes for the element after the root.
+	///////////////////////////////////////////////////////////////////////////
+	static const memory_size_type group_alignment = 64;
+
+	template <typename IT, typename C>
+	static void make_heap(IT a, IT b, C lt) {
+		memory_size_type n = static_cast<memory_size_type>(b - a);
+		if (n < 2) return;
+		for (memory_size_type i = (n - 2) / D + 1; i-- > 0;)
+			sift_down(a, i, n, lt);
+	}
+
+	template <typename IT, typename C>
+	static void push_heap(IT a, IT b, C lt) {
+		typedef typename std::iterator_traits<IT>::value_type T;
+		memory_size_type i = static_cast<memory_size_type>(b - a) - 1;
+		T v = std::move(*(a + i));
+		while (i > 0) {
+			memory_size_type p = (i - 1) / D;
+			if (!lt(*(a + p), v)) break;
+			*(a + i) = std::move(*(a + p));
+			i = p;
+		}
+		*(a + i) = std::move(v);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Move the top element to b-1 and make [a, b-1) a heap.
+	///////////////////////////////////////////////////////////////////////////
+	template <typename IT, typename C>
+	static void pop_heap(IT a, IT b, C lt) {
+		memory_size_type n = static_cast<memory_size_type>(b - a);
+		if (n < 2) return;
+		std::swap(*a, *(b - 1));
+		sift_down(a, 0, n - 1, lt);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Restore the heap after the top element has been replaced.
+	///////////////////////////////////////////////////////////////////////////
+	template <typename IT, typename C>
+	static void pop_and_push_heap(IT a, IT b, C lt) {
+		sift_down(a, 0, static_cast<memory_size_type>(b - a), lt);
+	}
+
+private:
+	template <typename IT, typename C>
+	static void sift_down(IT a, memory_size_type i, memory_size_type n, C lt) {
+		typedef typename std::iterator_traits<IT>::value_type T;
+		T v = std::move(*(a + i));
+		for (;;) {
+			memory_size_type c = D * i + 1;
+			if (c >= n) break;
+			memory_size_type end = std::min(c + D, n);
+			memory_size_type best = c;
+			for (memory_size_type j = c + 1; j < end; ++j)
+				if (lt(*(a + best), *(a + j))) best = j;
+			if (!lt(v, *(a + best))) break;
+			*(a + i) = std::move(*(a + best));
+			i = best;
+		}
+		*(a + i) = std::move(v);
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief The binary heap uses the standard library heap algorithms.
+///////////////////////////////////////////////////////////////////////////////
+template <>
+struct dary_heap<2> {
+	static const memory_size_type arity = 2;
+	static const memory_size_type group_alignment = 0;
+
+	template <typename IT, typename C>
+	static void make_heap(IT a, IT b, C lt) {std::make_heap(a, b, lt);}
+
+	template <typename IT, typename C>
+	static void push_heap(IT a, IT b, C lt) {std::push_heap(a, b, lt);}
+
+	template <typename IT, typename C>
+	static void pop_heap(IT a, IT b, C lt) {std::pop_heap(a, b, lt);}
+
+	template <typename IT, typename C>
+	static void pop_and_push_heap(IT a, IT b, C lt) {tpie::pop_and_push_heap(a, b, lt);}
+};
+
+typedef dary_heap<2> binary_heap;
+
+} // namespace tpie
+
+#endif // TPIE_DARY_HEAP_H
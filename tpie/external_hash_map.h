@@ -0,0 +1,470 @@
+// -*- mode: c++; tab-width: 4; indent-tabs-mode: t; eval: (progn (c-set-style "stroustrup") (c-set-offset 'innamespace 0)); -*-
+// vi:set ts=4 sts=4 sw=4 noet :
+// Copyright 2026, The TPIE development team
+//
+// This file is part of TPIE.
+//
+// TPIE is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// TPIE is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with TPIE.  If not, see <http://www.gnu.org/licenses/>
+
+///////////////////////////////////////////////////////////////////////////////
+/// \file external_hash_map.h
+/// \brief Hash map that spills to disk when it outgrows its memory.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TPIE_EXTERNAL_HASH_MAP_H
+#define TPIE_EXTERNAL_HASH_MAP_H
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <tpie/array.h>
+#include <tpie/array_view.h>
+#include <tpie/blocks/block_collection_cache.h>
+#include <tpie/exception.h>
+#include <tpie/hash.h>
+#include <tpie/stack.h>
+#include <tpie/tempname.h>
+#include <tpie/tpie_log.h>
+
+namespace tpie {
+
+///////////////////////////////////////////////////////////////////////////////
+/// \class external_hash_map
+/// \brief Hash map whose contents may exceed the memory it is given.
+///
+/// Keys are partitioned by the low bits of their hash. A partition is a
+/// table of pages indexed by the following hash bits, and when a page
+/// overflows the partition doubles its number of pages, splitting every
+/// page in two.
+///
+/// Partitions are kept in memory until the pages no longer fit in the
+/// memory given; then the largest partitions are spilled to a block
+/// collection on disk, and their pages are accessed through a
+/// blocks::block_collection_cache of bounded size.
+///
+/// The batched insert() and find() sort their requests by partition and
+/// page, so each page of a spilled partition is read once per batch.
+///
+/// \tparam key_t Key type. Must be trivially copyable.
+/// \tparam data_t Data type. Must be trivially copyable.
+/// \tparam hash_t Hash function.
+/// \tparam equal_t Key equality predicate.
+///////////////////////////////////////////////////////////////////////////////
+template <typename key_t,
+		  typename data_t,
+		  typename hash_t = hash<key_t>,
+		  typename equal_t = std::equal_to<key_t> >
+class external_hash_map {
+public:
+	typedef std::pair<key_t, data_t> value_t;
+
+	static_assert(std::is_trivially_copyable<key_t>::value, "external_hash_map requires trivially copyable keys");
+	static_assert(std::is_trivially_copyable<data_t>::value, "external_hash_map requires trivially copyable data");
+
+	/** \brief Number of bytes in a page. */
+	static const memory_size_type page_bytes = 16 * 1024;
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Construct an empty hash map.
+	///
+	/// \param memory The number of bytes the map may use, not counting the
+	/// requests of batched operations.
+	/// \param partitions The number of partitions, rounded down to a power
+	/// of two, or 0 to choose it from the memory.
+	/// \param hash Hash function.
+	/// \param equal Key equality predicate.
+	///////////////////////////////////////////////////////////////////////////
+	external_hash_map(memory_size_type memory, memory_size_type partitions = 0,
+					  const hash_t & hash = hash_t(), const equal_t & equal = equal_t())
+		: m_hash(hash)
+		, m_equal(equal)
+		, m_size(0)
+		, m_spilled(0)
+		, m_residentBytes(0)
+	{
+		m_cachePages = std::max(minimum_cache_pages, memory / 8 / cache_page_memory());
+		memory_size_type fixed = sizeof(external_hash_map)
+			+ blocks::block_collection_cache::memory_usage(sizeof(page), m_cachePages)
+			// the buffer of the stack of free blocks, which the cache does not count
+			+ stack<blocks::block_handle>::memory_usage()
+			+ array<page>::memory_usage(1);
+		if (memory < fixed + 2 * sizeof(page))
+			throw exception("external_hash_map: Not enough memory");
+
+		if (partitions == 0) {
+			partitions = std::max<memory_size_type>(1, (memory - fixed) / (4 * sizeof(page)));
+			partitions = std::min(partitions, max_partitions);
+		}
+		m_partitionBits = 0;
+		while (static_cast<memory_size_type>(2) << m_partitionBits <= partitions) ++m_partitionBits;
+		partitions = static_cast<memory_size_type>(1) << m_partitionBits;
+
+		fixed += array<partition_t>::memory_usage(partitions);
+		if (memory < fixed + partitions * sizeof(page))
+			throw exception("external_hash_map: Not enough memory for the partitions");
+		m_residentBudget = memory - fixed;
+
+		m_partitions.resize(partitions);
+		m_scratch.resize(1);
+		for (memory_size_type p = 0; p < partitions; ++p) {
+			m_partitions[p].resident.resize(1);
+			m_residentBytes += sizeof(page);
+		}
+	}
+
+	~external_hash_map() {
+		// Close the block collection before its files are removed
+		m_cache.reset();
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Insert a key, or overwrite its data if it is present.
+	/// \return Whether the key was inserted.
+	///////////////////////////////////////////////////////////////////////////
+	bool insert(const key_t & key, const data_t & data) {
+		return insert_hashed(m_hash(key), key, data);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Look up a key.
+	/// \param key The key to look up.
+	/// \param data Set to the data of the key if it is present.
+	/// \return Whether the key is present.
+	///////////////////////////////////////////////////////////////////////////
+	bool find(const key_t & key, data_t & data) {
+		return find_hashed(m_hash(key), key, data);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Return whether the key is present.
+	///////////////////////////////////////////////////////////////////////////
+	bool contains(const key_t & key) {
+		data_t data;
+		return find(key, data);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Erase a key.
+	/// \return Whether the key was present.
+	///////////////////////////////////////////////////////////////////////////
+	bool erase(const key_t & key) {
+		size_t h = m_hash(key);
+		partition_t & part = m_partitions[partition_of(h)];
+		memory_size_type i = page_of(part, h);
+		page & pg = load(part, i);
+		for (memory_size_type j = 0; j < pg.count; ++j) {
+			if (!m_equal(pg.entries[j].first, key)) continue;
+			pg.entries[j] = pg.entries[--pg.count];
+			dirty(part, i);
+			--part.size;
+			--m_size;
+			return true;
+		}
+		return false;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Insert a batch of key and data pairs, overwriting the data of
+	/// keys that are present.
+	///
+	/// Uses memory for 32 bytes per item beyond the memory of the map.
+	/// \return The number of keys inserted.
+	///////////////////////////////////////////////////////////////////////////
+	memory_size_type insert(array_view<const value_t> items) {
+		array<request> requests;
+		make_requests(items.size(), [&](memory_size_type i) -> const key_t & {return items[i].first;}, requests);
+		memory_size_type inserted = 0;
+		for (memory_size_type i = 0; i < requests.size(); ++i) {
+			const value_t & v = items[requests[i].index];
+			if (insert_hashed(requests[i].hash, v.first, v.second)) ++inserted;
+		}
+		return inserted;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Look up a batch of keys.
+	///
+	/// found[i] is set to whether keys[i] is present, and if so, data[i] to
+	/// its data. Uses memory for 32 bytes per key beyond the memory of the
+	/// map.
+	/// \return The number of keys found.
+	///////////////////////////////////////////////////////////////////////////
+	memory_size_type find(array_view<const key_t> keys, array_view<data_t> data, array_view<bool> found) {
+		tp_assert(data.size() == keys.size() && found.size() == keys.size(), "Batch sizes differ");
+		array<request> requests;
+		make_requests(keys.size(), [&](memory_size_type i) -> const key_t & {return keys[i];}, requests);
+		memory_size_type hits = 0;
+		for (memory_size_type i = 0; i < requests.size(); ++i) {
+			memory_size_type j = requests[i].index;
+			found[j] = find_hashed(requests[i].hash, keys[j], data[j]);
+			if (found[j]) ++hits;
+		}
+		return hits;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Return the number of keys in the map.
+	///////////////////////////////////////////////////////////////////////////
+	stream_size_type size() const {return m_size;}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Is the map empty?
+	///////////////////////////////////////////////////////////////////////////
+	bool empty() const {return m_size == 0;}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Return the number of partitions.
+	///////////////////////////////////////////////////////////////////////////
+	memory_size_type partitions() const {return m_partitions.size();}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Return the number of partitions that have been spilled to disk.
+	///////////////////////////////////////////////////////////////////////////
+	memory_size_type spilled_partitions() const {return m_spilled;}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Return the number of pages the page cache holds.
+	///////////////////////////////////////////////////////////////////////////
+	memory_size_type cache_pages() const {return m_cachePages;}
+
+private:
+	static const memory_size_type page_entries = (page_bytes - sizeof(memory_size_type)) / sizeof(value_t);
+	static_assert(page_entries > 0, "external_hash_map: value_t does not fit in a page");
+
+	static const memory_size_type minimum_cache_pages = 4;
+	static const memory_size_type max_partitions = 256;
+
+	struct page {
+		page() : count(0) {}
+		memory_size_type count;
+		value_t entries[page_entries];
+	};
+
+	struct partition_t {
+		partition_t() : pages(1), size(0), spilled(false) {}
+		/** Number of pages; a power of two. */
+		memory_size_type pages;
+		stream_size_type size;
+		bool spilled;
+		/** The pages of a partition in memory. */
+		array<page> resident;
+		/** The blocks of a spilled partition. */
+		array<blocks::block_handle> handles;
+	};
+
+	struct request {
+		memory_size_type partition;
+		memory_size_type page;
+		size_t hash;
+		memory_size_type index;
+
+		bool operator<(const request & other) const {
+			if (partition != other.partition) return partition < other.partition;
+			return page < other.page;
+		}
+	};
+
+	// The memory the buffer pool charges for a cached page
+	static memory_size_type cache_page_memory() {
+		return blocks::buffer_pool::frame_memory(sizeof(page));
+	}
+
+	memory_size_type partition_of(size_t h) const {
+		return static_cast<memory_size_type>(h & (m_partitions.size() - 1));
+	}
+
+	memory_size_type page_of(const partition_t & part, size_t h) const {
+		return static_cast<memory_size_type>((h >> m_partitionBits) & (part.pages - 1));
+	}
+
+	template <typename F>
+	void make_requests(memory_size_type n, F key, array<request> & requests) {
+		requests.resize(n);
+		for (memory_size_type i = 0; i < n; ++i) {
+			size_t h = m_hash(key(i));
+			requests[i].partition = partition_of(h);
+			requests[i].page = page_of(m_partitions[requests[i].partition], h);
+			requests[i].hash = h;
+			requests[i].index = i;
+		}
+		std::sort(requests.begin(), requests.end());
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Return a page of a partition. A page of a spilled partition is
+	/// valid until the next page is loaded.
+	///////////////////////////////////////////////////////////////////////////
+	page & load(partition_t & part, memory_size_type i) {
+		if (!part.spilled) return part.resident[i];
+		return *reinterpret_cast<page *>(m_cache->read_block(part.handles[i])->get());
+	}
+
+	// Record that a loaded page was changed.
+	void dirty(partition_t & part, memory_size_type i) {
+		if (part.spilled) m_cache->write_block(part.handles[i]);
+	}
+
+	page & new_block(blocks::block_handle & handle) {
+		handle = m_cache->get_free_block();
+		page & pg = *reinterpret_cast<page *>(m_cache->read_block(handle)->get());
+		pg.count = 0;
+		return pg;
+	}
+
+	bool find_hashed(size_t h, const key_t & key, data_t & data) {
+		partition_t & part = m_partitions[partition_of(h)];
+		const page & pg = load(part, page_of(part, h));
+		for (memory_size_type j = 0; j < pg.count; ++j) {
+			if (m_equal(pg.entries[j].first, key)) {
+				data = pg.entries[j].second;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool insert_hashed(size_t h, const key_t & key, const data_t & data) {
+		partition_t & part = m_partitions[partition_of(h)];
+		while (true) {
+			memory_size_type i = page_of(part, h);
+			page & pg = load(part, i);
+			for (memory_size_type j = 0; j < pg.count; ++j) {
+				if (m_equal(pg.entries[j].first, key)) {
+					pg.entries[j].second = data;
+					dirty(part, i);
+					return false;
+				}
+			}
+			if (pg.count < page_entries) {
+				pg.entries[pg.count++] = value_t(key, data);
+				dirty(part, i);
+				++part.size;
+				++m_size;
+				return true;
+			}
+			// Splitting the page does not help when all of its keys have the
+			// same hash as the new key.
+			bool collide = true;
+			for (memory_size_type j = 0; j < pg.count && collide; ++j)
+				collide = m_hash(pg.entries[j].first) == h;
+			if (collide)
+				throw exception("external_hash_map: Too many keys with the same hash");
+			grow(part);
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Double the number of pages of a partition.
+	///////////////////////////////////////////////////////////////////////////
+	void grow(partition_t & part) {
+		memory_size_type n = part.pages;
+		if (!part.spilled) {
+			// The old and new pages are in memory at the same time
+			reserve(2 * n * sizeof(page));
+		}
+		if (!part.spilled) {
+			array<page> pages(2 * n);
+			for (memory_size_type i = 0; i < n; ++i) {
+				const page & from = part.resident[i];
+				for (memory_size_type j = 0; j < from.count; ++j) {
+					page & to = pages[static_cast<memory_size_type>((m_hash(from.entries[j].first) >> m_partitionBits) & (2 * n - 1))];
+					to.entries[to.count++] = from.entries[j];
+				}
+			}
+			part.resident.swap(pages);
+			m_residentBytes += n * sizeof(page);
+		} else {
+			reserve(n * sizeof(blocks::block_handle));
+			array<blocks::block_handle> handles(2 * n);
+			page & from = m_scratch[0];
+			for (memory_size_type i = 0; i < n; ++i) {
+				from = load(part, i);
+				m_cache->free_block(part.handles[i]);
+				for (memory_size_type half = 0; half < 2; ++half) {
+					memory_size_type target = i + half * n;
+					page & to = new_block(handles[target]);
+					for (memory_size_type j = 0; j < from.count; ++j) {
+						if (((m_hash(from.entries[j].first) >> m_partitionBits) & (2 * n - 1)) == target)
+							to.entries[to.count++] = from.entries[j];
+					}
+					m_cache->write_block(handles[target]);
+				}
+			}
+			part.handles.swap(handles);
+			m_residentBytes += n * sizeof(blocks::block_handle);
+		}
+		part.pages = 2 * n;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Spill the largest partitions in memory until the given number
+	/// of bytes more fits in the memory.
+	///////////////////////////////////////////////////////////////////////////
+	void reserve(memory_size_type bytes) {
+		while (m_residentBytes + bytes > m_residentBudget) {
+			partition_t * largest = 0;
+			for (memory_size_type p = 0; p < m_partitions.size(); ++p) {
+				partition_t & part = m_partitions[p];
+				if (!part.spilled && (largest == 0 || part.pages > largest->pages)) largest = &part;
+			}
+			if (largest == 0) return;
+			spill(*largest);
+		}
+	}
+
+	void spill(partition_t & part) {
+		if (!m_cache) {
+			m_queueFile.set_path(blocks::block_collection::free_list_path(m_file.path()));
+			m_cache.reset(new blocks::block_collection_cache(m_file.path(), sizeof(page), m_cachePages, true));
+		}
+		part.handles.resize(part.pages);
+		for (memory_size_type i = 0; i < part.pages; ++i) {
+			new_block(part.handles[i]) = part.resident[i];
+			m_cache->write_block(part.handles[i]);
+		}
+		part.resident.resize(0);
+		part.spilled = true;
+		m_residentBytes -= part.pages * (sizeof(page) - sizeof(blocks::block_handle));
+		++m_spilled;
+		TP_LOG_DEBUG("external_hash_map: spilled a partition of " << part.size << " keys\n");
+	}
+
+	hash_t m_hash;
+	equal_t m_equal;
+	stream_size_type m_size;
+	memory_size_type m_partitionBits;
+	memory_size_type m_spilled;
+	memory_size_type m_cachePages;
+
+	/** Memory for the pages of partitions in memory and the block handles of
+	 * spilled partitions. */
+	memory_size_type m_residentBudget;
+	memory_size_type m_residentBytes;
+
+	array<partition_t> m_partitions;
+	/** Copy of the page being split while the new pages are loaded. */
+	array<page> m_scratch;
+
+	temp_file m_file;
+	/** Free list of the block collection, stored next to it. */
+	temp_file m_queueFile;
+	std::unique_ptr<blocks::block_collection_cache> m_cache;
+};
+
+} // namespace tpie
+
+#endif // TPIE_EXTERNAL_HASH_MAP_H
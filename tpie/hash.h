@@ -39,9 +39,6 @@ void init_hash();
 ///////////////////////////////////////////////////////////////////////////////
 template <typename T>
 struct hash {
-private:
-	size_t m_matrix[sizeof(size_t)][256];
-public:
 	///////////////////////////////////////////////////////////////////////////
 	/// \brief Calculate integer hash using tabulation hashing
 	///////////////////////////////////////////////////////////////////////////
@@ -111,6 +108,176 @@ struct hash<std::string> {
 };
 
 
+namespace hash_bits {
+
+/** \brief Constants of the fast_hash family, from wyhash. */
+const uint64_t fast_secret[4] = {
+	0xa0761d6478bd642full, 0xe7037ed1a0b428dbull,
+	0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull};
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Replace a and b by the low and high word of their 128-bit product.
+///////////////////////////////////////////////////////////////////////////////
+inline void multiply(uint64_t & a, uint64_t & b) {
+#ifdef __SIZEOF_INT128__
+	unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+	a = static_cast<uint64_t>(r);
+	b = static_cast<uint64_t>(r >> 64);
+#else
+	uint64_t ha = a >> 32, hb = b >> 32, la = static_cast<uint32_t>(a), lb = static_cast<uint32_t>(b);
+	uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+	uint64_t t = rl + (rm0 << 32);
+	uint64_t c = t < rl;
+	uint64_t lo = t + (rm1 << 32);
+	c += lo < t;
+	a = lo;
+	b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Fold the 128-bit product of a and b to 64 bits, so that every
+/// bit of the result depends on every bit of a and b.
+///////////////////////////////////////////////////////////////////////////////
+inline uint64_t multiply_mix(uint64_t a, uint64_t b) {
+	multiply(a, b);
+	return a ^ b;
+}
+
+inline uint64_t read64(const char * p) {
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+inline uint64_t read32(const char * p) {
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Hash n bytes at p a word at a time, as wyhash does.
+///
+/// Up to 16 bytes are read as two possibly overlapping words; longer inputs
+/// are consumed 48 bytes per round in three independent lanes.
+///////////////////////////////////////////////////////////////////////////////
+inline uint64_t hash_bytes(const char * p, size_t n, uint64_t seed) {
+	seed ^= multiply_mix(seed ^ fast_secret[0], fast_secret[1]);
+	uint64_t a, b;
+	if (n <= 16) {
+		if (n >= 4) {
+			size_t d = (n >> 3) << 2;
+			a = (read32(p) << 32) | read32(p + d);
+			b = (read32(p + n - 4) << 32) | read32(p + n - 4 - d);
+		} else if (n > 0) {
+			const unsigned char * u = reinterpret_cast<const unsigned char *>(p);
+			a = (static_cast<uint64_t>(u[0]) << 16) | (static_cast<uint64_t>(u[n >> 1]) << 8) | u[n - 1];
+			b = 0;
+		} else {
+			a = b = 0;
+		}
+	} else {
+		size_t i = n;
+		if (i > 48) {
+			uint64_t s1 = seed, s2 = seed;
+			do {
+				seed = multiply_mix(read64(p) ^ fast_secret[1], read64(p + 8) ^ seed);
+				s1 = multiply_mix(read64(p + 16) ^ fast_secret[2], read64(p + 24) ^ s1);
+				s2 = multiply_mix(read64(p + 32) ^ fast_secret[3], read64(p + 40) ^ s2);
+				p += 48;
+				i -= 48;
+			} while (i > 48);
+			seed ^= s1 ^ s2;
+		}
+		while (i > 16) {
+			seed = multiply_mix(read64(p) ^ fast_secret[1], read64(p + 8) ^ seed);
+			p += 16;
+			i -= 16;
+		}
+		a = read64(p + i - 16);
+		b = read64(p + i - 8);
+	}
+	a ^= fast_secret[1];
+	b ^= seed;
+	multiply(a, b);
+	return multiply_mix(a ^ fast_secret[0] ^ n, b ^ fast_secret[1]);
+}
+
+} // namespace hash_bits
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Fast hashing function for integral (uint64_t-castable) types.
+///
+/// A single 64-bit multiplication by a random odd constant, with the high
+/// half of the product folded into the low half (multiply-shift hashing
+/// without the shift, so the result is usable by any table size). Cheaper
+/// than the table lookups of tpie::hash, but without its independence
+/// guarantees. Select it per hash_map through the hash_t parameter.
+/// \tparam T Type of value to hash.
+///////////////////////////////////////////////////////////////////////////////
+template <typename T>
+struct fast_hash {
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Calculate integer hash.
+	///////////////////////////////////////////////////////////////////////////
+	inline size_t operator()(const T & e) const {
+		return static_cast<size_t>(hash_bits::multiply_mix(
+			static_cast<uint64_t>(e) ^ hash_bits::fast_secret[0], hash_bits::fast_secret[1]));
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Fast hashing function for std::pair.
+/// \tparam T1 First part of std::pair.
+/// \tparam T2 Second part of std::pair.
+///////////////////////////////////////////////////////////////////////////////
+template <typename T1, typename T2>
+struct fast_hash<std::pair<T1,T2> > {
+	fast_hash<T1> h1;
+	fast_hash<T2> h2;
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Calculate std::pair hash by mixing the hashes of both parts.
+	/// \param e Pair to hash.
+	///////////////////////////////////////////////////////////////////////////
+	inline size_t operator()(const std::pair<T1,T2> & e) const {
+		return static_cast<size_t>(hash_bits::multiply_mix(
+			h1(e.first) ^ hash_bits::fast_secret[2], h2(e.second) ^ hash_bits::fast_secret[3]));
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Fast hashing function for C-style strings, reading eight bytes
+/// at a time.
+///////////////////////////////////////////////////////////////////////////////
+template <>
+struct fast_hash<const char *> {
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Calculate string hash.
+	/// \param s String to hash.
+	///////////////////////////////////////////////////////////////////////////
+	inline size_t operator()(const char * s) const {
+		return static_cast<size_t>(hash_bits::hash_bytes(s, strlen(s), 0));
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Fast hashing function for std::string, reading eight bytes at a
+/// time. Equal to fast_hash<const char *> on strings without NUL bytes.
+///////////////////////////////////////////////////////////////////////////////
+template <>
+struct fast_hash<std::string> {
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Calculate string hash.
+	/// \param s String to hash.
+	///////////////////////////////////////////////////////////////////////////
+	inline size_t operator()(const std::string & s) const {
+		return static_cast<size_t>(hash_bits::hash_bytes(s.data(), s.size(), 0));
+	}
+};
+
+
 // Predeclare reflect
 template <typename R, typename T, typename ... TT>
 bool reflect(R & r, T && v, TT && ... vs);
@@ -30,6 +30,11 @@
 #include <iostream>
 #include <tpie/prime.h>
 #include <tpie/hash.h>
+#include <tpie/exception.h>
+#include <cstdint>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace tpie {
 
@@ -357,6 +362,295 @@ public:
  	}
 };
 
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Hash table handling hash collisions by probing groups of slots.
+///
+/// In the style of Swiss tables, every slot has a control byte holding seven
+/// bits of the hash of its value, or a marker for an empty or erased slot. A
+/// probe compares the control bytes of a group of 16 slots at once (with SSE2
+/// when available) and only compares the values whose control byte matches,
+/// so most lookups touch one group and call the equality predicate once.
+///
+/// Erasing from a group that has never been full empties the slot; otherwise
+/// the slot becomes a tombstone. Tombstones are cleared by rehashing in place
+/// once values and tombstones fill more than 7/8 of the table.
+/// \tparam value_t Value to store.
+/// \tparam hash_t Hash function to use.
+/// \tparam equal_t Equality predicate.
+/// \tparam index_t Index type into bucket array. Always size_t.
+///////////////////////////////////////////////////////////////////////////////
+template <typename value_t, typename hash_t, typename equal_t, typename index_t>
+class group_probing_hash_table {
+private:
+	static const float sc;
+	enum {group_size = 16};
+	enum {empty_ctrl = -128, deleted_ctrl = -2};
+
+	array<value_t> elements;
+	array<int8_t> ctrl;
+	size_t groups;
+	size_t deleted;
+	size_t max_load;
+	hash_t h;
+	equal_t e;
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Bit mask of the slots in group g with control byte c.
+	///////////////////////////////////////////////////////////////////////////
+	inline unsigned int match(size_t g, int8_t c) const {
+#ifdef __SSE2__
+		__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&ctrl[g * group_size]));
+		return static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8(c))));
+#else
+		unsigned int r = 0;
+		for (size_t i = 0; i < group_size; ++i)
+			if (ctrl[g * group_size + i] == c) r |= 1u << i;
+		return r;
+#endif
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Bit mask of the empty and erased slots in group g, whose
+	/// control bytes are the negative ones.
+	///////////////////////////////////////////////////////////////////////////
+	inline unsigned int match_free(size_t g) const {
+#ifdef __SSE2__
+		__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&ctrl[g * group_size]));
+		return static_cast<unsigned int>(_mm_movemask_epi8(x));
+#else
+		unsigned int r = 0;
+		for (size_t i = 0; i < group_size; ++i)
+			if (ctrl[g * group_size + i] < 0) r |= 1u << i;
+		return r;
+#endif
+	}
+
+	static inline size_t lowest_bit(unsigned int mask) {
+#ifdef __GNUC__
+		return static_cast<size_t>(__builtin_ctz(mask));
+#else
+		size_t i = 0;
+		while (!(mask & 1u)) {
+			mask >>= 1;
+			++i;
+		}
+		return i;
+#endif
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief First group to probe, from the high bits of the mixed hash
+	/// value.
+	///
+	/// Some hash functions, such as tpie::hash<std::string>, give 32-bit
+	/// values, so the hash value is mixed before its high bits are used.
+	///////////////////////////////////////////////////////////////////////////
+	inline size_t home_group(size_t hv) const {
+		uint64_t m = hash_bits::multiply_mix(hv, hash_bits::fast_secret[0]);
+#ifdef __SIZEOF_INT128__
+		// Multiply and shift in place of a division
+		return static_cast<size_t>((static_cast<unsigned __int128>(m) * groups) >> 64);
+#else
+		return static_cast<size_t>(m % groups);
+#endif
+	}
+
+	static inline int8_t control_byte(size_t hv) {return static_cast<int8_t>(hv & 0x7F);}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Clear all tombstones without extra memory.
+	///
+	/// Every value is marked as erased and the old tombstones as empty. Each
+	/// marked value then moves to the first free slot on its probe sequence,
+	/// unless that is in the group it is already in; when the slot holds
+	/// another marked value the two are swapped and the swapped-in value is
+	/// placed next.
+	///////////////////////////////////////////////////////////////////////////
+	void rehash() {
+		for (size_t i = 0; i < ctrl.size(); ++i)
+			ctrl[i] = static_cast<int8_t>(ctrl[i] < 0 ? empty_ctrl : deleted_ctrl);
+		for (size_t i = 0; i < ctrl.size(); ++i) {
+			while (ctrl[i] == deleted_ctrl) {
+				size_t hv = h(elements[i]);
+				size_t home = home_group(hv);
+				size_t g = home;
+				unsigned int f;
+				while (!(f = match_free(g)))
+					if (++g == groups) g = 0;
+				size_t slot = g * group_size + lowest_bit(f);
+				if ((g + groups - home) % groups == (i / group_size + groups - home) % groups) {
+					ctrl[i] = control_byte(hv);
+				} else if (ctrl[slot] == empty_ctrl) {
+					elements[slot] = elements[i];
+					ctrl[slot] = control_byte(hv);
+					elements[i] = unused;
+					ctrl[i] = static_cast<int8_t>(empty_ctrl);
+				} else {
+					std::swap(elements[slot], elements[i]);
+					ctrl[slot] = control_byte(hv);
+				}
+			}
+		}
+		deleted = 0;
+	}
+public:
+	/** \brief Number of values in hash table. */
+	size_t size;
+
+	/** \brief Special constant indicating an unused table entry. */
+	value_t unused;
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \copybrief linear_memory_structure_doc::memory_coefficient()
+	/// \copydetails linear_memory_structure_doc::memory_coefficient()
+	///////////////////////////////////////////////////////////////////////////
+	static double memory_coefficient() {
+		return (array<value_t>::memory_coefficient() + array<int8_t>::memory_coefficient()) * sc;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \copybrief linear_memory_structure_doc::memory_overhead()
+	/// \copydetails linear_memory_structure_doc::memory_overhead()
+	///////////////////////////////////////////////////////////////////////////
+	static double memory_overhead() {
+		return (array<value_t>::memory_coefficient() + array<int8_t>::memory_coefficient()) * group_size
+			+ array<value_t>::memory_overhead() + array<int8_t>::memory_overhead()
+			+ sizeof(group_probing_hash_table) - sizeof(array<value_t>) - sizeof(array<int8_t>);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \copybrief chaining_hash_table::clear()
+	/// \copydetails chaining_hash_table::clear()
+	///////////////////////////////////////////////////////////////////////////
+	void clear() {
+		std::fill(elements.begin(), elements.end(), unused);
+		std::fill(ctrl.begin(), ctrl.end(), static_cast<int8_t>(empty_ctrl));
+		size = 0;
+		deleted = 0;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \copybrief chaining_hash_table::resize(size_t)
+	/// \copydetails chaining_hash_table::resize(size_t)
+	///////////////////////////////////////////////////////////////////////////
+	void resize(size_t z) {
+		groups = (static_cast<size_t>(static_cast<float>(z) * sc) + group_size) / group_size;
+		elements.resize(groups * group_size, unused);
+		ctrl.resize(groups * group_size, static_cast<int8_t>(empty_ctrl));
+		max_load = groups * group_size - groups * group_size / 8;
+		size = 0;
+		deleted = 0;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \copybrief chaining_hash_table::chaining_hash_table
+	/// \copydetails chaining_hash_table::chaining_hash_table
+	///////////////////////////////////////////////////////////////////////////
+	group_probing_hash_table(size_t ee, value_t u,
+							 const hash_t & hash, const equal_t & equal):
+		h(hash), e(equal), size(0), unused(u) {resize(ee);}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \copybrief chaining_hash_table::find
+	/// \copydetails chaining_hash_table::find
+	///////////////////////////////////////////////////////////////////////////
+	inline size_t find(const value_t & value) const {
+		size_t hv = h(value);
+		int8_t c = control_byte(hv);
+		size_t g = home_group(hv);
+		for (size_t i = 0; i < groups; ++i) {
+			for (unsigned int m = match(g, c); m; m &= m - 1) {
+				size_t idx = g * group_size + lowest_bit(m);
+				if (e(elements[idx], value)) return idx;
+			}
+			if (match(g, static_cast<int8_t>(empty_ctrl))) break;
+			if (++g == groups) g = 0;
+		}
+		return end();
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \copybrief chaining_hash_table::end()
+	/// \copydetails chaining_hash_table::end()
+	///////////////////////////////////////////////////////////////////////////
+	inline size_t end() const {return elements.size();}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \copybrief chaining_hash_table::begin()
+	/// \copydetails chaining_hash_table::begin()
+	///////////////////////////////////////////////////////////////////////////
+	inline size_t begin() const {
+		if (size == 0) return elements.size();
+		for(size_t i=0; true; ++i)
+			if (ctrl[i] >= 0) return i;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \copybrief chaining_hash_table::get(size_t)
+	/// \copydetails chaining_hash_table::get(size_t)
+	///////////////////////////////////////////////////////////////////////////
+	value_t & get(size_t idx) {return elements[idx];}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \copybrief chaining_hash_table::get(size_t)
+	/// \copydetails chaining_hash_table::get(size_t)
+	///////////////////////////////////////////////////////////////////////////
+	const value_t & get(size_t idx) const {return elements[idx];}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \copybrief chaining_hash_table::insert
+	/// \copydetails chaining_hash_table::insert
+	///////////////////////////////////////////////////////////////////////////
+	inline std::pair<size_t, bool> insert(const value_t & val) {
+		size_t hv = h(val);
+		int8_t c = control_byte(hv);
+		size_t g = home_group(hv);
+		size_t slot = end();
+		for (size_t i = 0; i < groups; ++i) {
+			for (unsigned int m = match(g, c); m; m &= m - 1) {
+				size_t idx = g * group_size + lowest_bit(m);
+				if (e(elements[idx], val)) return std::make_pair(idx, false);
+			}
+			if (slot == end()) {
+				unsigned int f = match_free(g);
+				if (f) slot = g * group_size + lowest_bit(f);
+			}
+			if (match(g, static_cast<int8_t>(empty_ctrl))) break;
+			if (++g == groups) g = 0;
+		}
+		if (slot == end()) throw exception("Hash table is full");
+		if (ctrl[slot] == deleted_ctrl) {
+			--deleted;
+		} else if (deleted > 0 && size + deleted >= max_load
+				   && (16 * deleted >= ctrl.size() || 16 * (size + deleted) >= 15 * ctrl.size())) {
+			// Rehash only once it frees a sixteenth of the table, or the
+			// table is nearly full, so the cost is amortized over the inserts.
+			rehash();
+			return insert(val);
+		}
+		ctrl[slot] = c;
+		elements[slot] = val;
+		++size;
+		return std::make_pair(slot, true);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \copybrief chaining_hash_table::erase
+	/// \copydetails chaining_hash_table::erase
+	///////////////////////////////////////////////////////////////////////////
+	inline void erase(const value_t & val) {
+		size_t slot = find(val);
+		if (match(slot / group_size, static_cast<int8_t>(empty_ctrl))) {
+			ctrl[slot] = static_cast<int8_t>(empty_ctrl);
+		} else {
+			ctrl[slot] = static_cast<int8_t>(deleted_ctrl);
+			++deleted;
+		}
+		elements[slot] = unused;
+		--size;
+	}
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 /// \brief Hash map implementation backed by a template parameterized hash
 /// table.
@@ -448,8 +742,8 @@ public:
 		using p_t::tbl;
 		using p_t::cur;
  	public:
- 		inline key_t & key() {return tbl.get(cur)->first;}
- 		inline data_t & value() {return tbl.get(cur)->second;}
+ 		inline key_t & key() {return tbl.get(cur).first;}
+ 		inline data_t & value() {return tbl.get(cur).second;}
  		inline value_t & operator*() {return tbl.get(cur);}
 		inline value_t * operator->() {return &tbl.get(cur);}
  		inline operator const_iterator() const {return const_iterator(tbl, cur);}
@@ -789,5 +1083,8 @@ const float linear_probing_hash_table<value_t, hash_t, equal_t, index_t>::sc = 2
 template <typename value_t, typename hash_t, typename equal_t, typename index_t>
 const float chaining_hash_table<value_t, hash_t, equal_t, index_t>::sc = 2.f;
 
+template <typename value_t, typename hash_t, typename equal_t, typename index_t>
+const float group_probing_hash_table<value_t, hash_t, equal_t, index_t>::sc = 8.f / 7.f;
+
 }
 #endif //__TPIE_HASHMAP_H__
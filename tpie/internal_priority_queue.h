@@ -22,6 +22,8 @@
 #include <tpie/array.h>
 #include <algorithm>
 #include <tpie/util.h>
+#include <tpie/dary_heap.h>
+#include <cstdint>
 namespace tpie {
 ///////////////////////////////////////////////////////////////////////////////
 /// \file internal_priority_queue.h
@@ -32,9 +34,13 @@ namespace tpie {
 /// \class internal_priority_queue
 /// \author Lars Hvam Petersen, Jakob Truelsen
 /// \brief Standard binary internal heap.
+///
+/// \tparam heap_t The heap layout: binary_heap (the default), or
+/// dary_heap<4> or dary_heap<8> for shallower heaps whose siblings share a
+/// cache line. See also internal_sequence_heap for very large queues.
 ///////////////////////////////////////////////////////////////////////////////
-template <typename T, typename comp_t = std::less<T> >
-class internal_priority_queue: public linear_memory_base< internal_priority_queue<T, comp_t> > {
+template <typename T, typename comp_t = std::less<T>, typename heap_t = binary_heap>
+class internal_priority_queue: public linear_memory_base< internal_priority_queue<T, comp_t, heap_t> > {
 public:
 	typedef memory_size_type size_type;
 
@@ -44,7 +50,9 @@ public:
 	///////////////////////////////////////////////////////////////////////////
     internal_priority_queue(size_type max_size, comp_t c=comp_t(),
 							memory_bucket_ref bucket = memory_bucket_ref())
-		: pq(max_size, bucket), sz(0), comp(c) {}
+		: pq(max_size + slack(), bucket), sz(0), comp(c) {
+		align();
+	}
 
 	///////////////////////////////////////////////////////////////////////////
 	/// \brief Construct a priority queue with given elements.
@@ -53,7 +61,8 @@ public:
 	internal_priority_queue(size_type max_size, const IT & start, const IT & end,
 							comp_t c=comp_t(),
 							memory_bucket_ref bucket = memory_bucket_ref())
-		: pq(max_size, bucket), sz(0), comp(c) {
+		: pq(max_size + slack(), bucket), sz(0), comp(c) {
+		align();
 		insert(start, end);
 	}
 
@@ -62,7 +71,7 @@ public:
 	///////////////////////////////////////////////////////////////////////////
 	template <typename IT>
 	void insert(const IT & start, const IT & end) {
-		std::copy(start, end, pq.find(sz));
+		std::copy(start, end, pq.find(m_offset + sz));
 		sz += (end - start);
 		make_safe();
 	}
@@ -74,11 +83,11 @@ public:
     /// \param v The element that should be inserted.
 	///////////////////////////////////////////////////////////////////////////
 	void unsafe_push(const T & v) { 
-		pq[sz++] = v;
+		pq[m_offset + sz++] = v;
 	}
 
 	void unsafe_push(T && v) {
-		pq[sz++] = std::move(v);
+		pq[m_offset + sz++] = std::move(v);
 	}
 
 	///////////////////////////////////////////////////////////////////////////
@@ -86,7 +95,7 @@ public:
 	/// unsafe_push.
 	///////////////////////////////////////////////////////////////////////////
 	void make_safe() {
-		std::make_heap(pq.begin(), pq.find(sz), comp);
+		heap_t::make_heap(pq.find(m_offset), pq.find(m_offset + sz), comp);
 	}
   
 	///////////////////////////////////////////////////////////////////////////
@@ -107,15 +116,15 @@ public:
     /// \param v The element that should be inserted.
 	///////////////////////////////////////////////////////////////////////////
     void push(const T & v) { 
-		assert(size() < pq.size());
-		pq[sz++] = v; 
-		std::push_heap(pq.begin(), pq.find(sz), comp);
+		assert(size() + slack() < pq.size());
+		pq[m_offset + sz++] = v;
+		heap_t::push_heap(pq.find(m_offset), pq.find(m_offset + sz), comp);
     }
 
 	void push(T && v) {
-		assert(size() < pq.size());
-		pq[sz++] = std::move(v);
-		std::push_heap(pq.begin(), pq.find(sz), comp);
+		assert(size() + slack() < pq.size());
+		pq[m_offset + sz++] = std::move(v);
+		heap_t::push_heap(pq.find(m_offset), pq.find(m_offset + sz), comp);
     }
 
 	///////////////////////////////////////////////////////////////////////////
@@ -123,7 +132,7 @@ public:
 	///////////////////////////////////////////////////////////////////////////
     void pop() { 
 		assert(!empty());
-		std::pop_heap(pq.begin(), pq.find(sz), comp);
+		heap_t::pop_heap(pq.find(m_offset), pq.find(m_offset + sz), comp);
 		--sz;
     }
 
@@ -132,14 +141,14 @@ public:
 	///////////////////////////////////////////////////////////////////////////
 	void pop_and_push(const T & v) {
 		assert(!empty());
-		pq[0] = v;
-		pop_and_push_heap(pq.begin(), pq.find(sz), comp);
+		pq[m_offset] = v;
+		heap_t::pop_and_push_heap(pq.find(m_offset), pq.find(m_offset + sz), comp);
 	}
 
 	void pop_and_push(T && v) {
 		assert(!empty());
-		pq[0] = std::move(v);
-		pop_and_push_heap(pq.begin(), pq.find(sz), comp);
+		pq[m_offset] = std::move(v);
+		heap_t::pop_and_push_heap(pq.find(m_offset), pq.find(m_offset + sz), comp);
 	}
 
 	///////////////////////////////////////////////////////////////////////////
@@ -147,9 +156,9 @@ public:
     ///
     /// \return The minimum element.
 	///////////////////////////////////////////////////////////////////////////
-    const T & top() const {return pq[0];}
+    const T & top() const {return pq[m_offset];}
 
-	T & top() {return pq[0];}
+	T & top() {return pq[m_offset];}
 
 	///////////////////////////////////////////////////////////////////////////
 	/// \copybrief linear_memory_structure_doc::memory_coefficient()
@@ -164,18 +173,26 @@ public:
 	/// \copydetails linear_memory_structure_doc::memory_overhead()
 	///////////////////////////////////////////////////////////////////////////
 	static constexpr double memory_overhead() noexcept {
-		return tpie::array<T>::memory_overhead() - sizeof(tpie::array<T>) + sizeof(internal_priority_queue);
+		return tpie::array<T>::memory_overhead() - sizeof(tpie::array<T>) + sizeof(internal_priority_queue)
+			+ static_cast<double>(slack() * sizeof(T));
 	}
 
 	///////////////////////////////////////////////////////////////////////////
     /// \brief Return the underlying array.
-	/// Make sure you know what you are doing.
+	/// Make sure you know what you are doing: the elements start at data().
     /// \return The underlying array.
 	///////////////////////////////////////////////////////////////////////////
 	tpie::array<T> & get_array() {
 		return pq;
 	}
 
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Return the size() elements of the queue, in heap order.
+	///////////////////////////////////////////////////////////////////////////
+	T * data() {
+		return pq.get() + m_offset;
+	}
+
 	///////////////////////////////////////////////////////////////////////////
 	/// \brief Clear the structure of all elements.
 	///////////////////////////////////////////////////////////////////////////
@@ -185,9 +202,31 @@ public:
 	/// \brief Resize priority queue to given size.
 	/// \param s New size of priority queue.
 	///////////////////////////////////////////////////////////////////////////
-	void resize(size_t s) {sz=0; pq.resize(s);}
-private:	
-	tpie::array<T> pq; 
+	void resize(size_t s) {sz=0; pq.resize(s + slack()); align();}
+private:
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Number of extra elements allocated to align the heap.
+	///////////////////////////////////////////////////////////////////////////
+	static constexpr memory_size_type slack() noexcept {
+		return heap_t::group_alignment ? heap_t::group_alignment / sizeof(T) + 1 : 0;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Place the root so that the element after it, and with it every
+	/// group of siblings, starts on a multiple of the heap's group alignment.
+	///////////////////////////////////////////////////////////////////////////
+	void align() {
+		m_offset = 0;
+		for (memory_size_type i = 0; i < slack(); ++i) {
+			if (reinterpret_cast<std::uintptr_t>(pq.get() + i + 1) % heap_t::group_alignment == 0) {
+				m_offset = i;
+				return;
+			}
+		}
+	}
+
+	tpie::array<T> pq;
+	memory_size_type m_offset;
     size_type sz;
 	binary_argument_swap<comp_t> comp;
 };
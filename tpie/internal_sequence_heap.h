@@ -0,0 +1,344 @@
+// -*- mode: c++; tab-width: 4; indent-tabs-mode: t; eval: (progn (c-set-style "stroustrup") (c-set-offset 'innamespace 0)); -*-
+// vi:set ts=4 sts=4 sw=4 noet :
+// Copyright 2026, The TPIE development team
+//
+// This file is part of TPIE.
+//
+// TPIE is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// TPIE is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with TPIE.  If not, see <http://www.gnu.org/licenses/>
+
+///////////////////////////////////////////////////////////////////////////////
+/// \file internal_sequence_heap.h
+/// \brief In-memory sequence heap for large priority queues.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TPIE_INTERNAL_SEQUENCE_HEAP_H
+#define TPIE_INTERNAL_SEQUENCE_HEAP_H
+
+#include <algorithm>
+#include <tpie/array.h>
+#include <tpie/internal_priority_queue.h>
+#include <tpie/util.h>
+
+namespace tpie {
+
+///////////////////////////////////////////////////////////////////////////////
+/// \class internal_sequence_heap
+/// \brief In-memory priority queue after Sanders, "Fast priority queues for
+/// cached memory" (1999), with the push/pop/top interface of
+/// internal_priority_queue.
+///
+/// Elements are pushed into a small insertion heap that fits in the L1
+/// cache. When it is full it is sorted into a run. Runs are kept in levels
+/// of up to k runs; a full level is merged into a single run on the next
+/// level. The smallest elements of all runs are merged into a deletion
+/// buffer, so pops mostly read a sorted array sequentially. Compared to a
+/// binary heap on the same elements this trades random accesses across the
+/// whole heap for sequential merges, which pays off once the queue is much
+/// larger than the cache.
+///
+/// The elements in the deletion buffer are never greater than those in the
+/// runs, and the deletion buffer is only empty if there are no runs.
+///////////////////////////////////////////////////////////////////////////////
+template <typename T, typename comp_t = std::less<T> >
+class internal_sequence_heap: public linear_memory_base< internal_sequence_heap<T, comp_t> > {
+public:
+	typedef memory_size_type size_type;
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Construct a priority queue.
+	/// \param max_size Maximum size of queue.
+	///////////////////////////////////////////////////////////////////////////
+	internal_sequence_heap(size_type max_size, comp_t c=comp_t(),
+						   memory_bucket_ref bucket = memory_bucket_ref())
+		: m_bufferSize(std::max<size_type>(1, std::min(max_size, buffer_bytes / sizeof(T))))
+		, m_levels(levels(max_size, m_bufferSize))
+		, m_insertion(m_bufferSize, c, bucket)
+		, m_deletion(m_bufferSize, bucket)
+		, m_deletionStart(0)
+		, m_deletionSize(0)
+		, m_runs(m_levels * fanout, bucket)
+		, m_levelRuns(m_levels, bucket)
+		, m_runIndex(m_levels * fanout, bucket)
+		, m_mergeHeap(m_levels * fanout, head_compare(c), bucket)
+		, m_size(0)
+		, m_bucket(bucket)
+		, comp(c)
+	{
+		std::fill(m_levelRuns.begin(), m_levelRuns.end(), 0);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Is the queue empty?
+	/// \return True if the queue is empty.
+	///////////////////////////////////////////////////////////////////////////
+	bool empty() const {return m_size == 0;}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Returns the size of the queue.
+	/// \return Queue size.
+	///////////////////////////////////////////////////////////////////////////
+	size_type size() const {return m_size;}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Insert an element into the priority queue.
+	///
+	/// \param v The element that should be inserted.
+	///////////////////////////////////////////////////////////////////////////
+	void push(const T & v) {
+		if (m_insertion.size() == m_bufferSize) flush_insertion();
+		m_insertion.push(v);
+		++m_size;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Remove the minimum element from heap.
+	///////////////////////////////////////////////////////////////////////////
+	void pop() {
+		assert(!empty());
+		if (top_in_deletion()) {
+			++m_deletionStart;
+			if (--m_deletionSize == 0) {
+				m_deletionStart = 0;
+				fill_deletion();
+			}
+		} else {
+			m_insertion.pop();
+		}
+		--m_size;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Remove the minimum element and insert a new element.
+	///////////////////////////////////////////////////////////////////////////
+	void pop_and_push(const T & v) {
+		if (top_in_deletion()) {
+			pop();
+			push(v);
+		} else {
+			m_insertion.pop_and_push(v);
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Return the minimum element.
+	///
+	/// \return The minimum element.
+	///////////////////////////////////////////////////////////////////////////
+	const T & top() const {
+		return top_in_deletion() ? m_deletion[m_deletionStart] : m_insertion.top();
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Clear the structure of all elements.
+	///////////////////////////////////////////////////////////////////////////
+	void clear() {
+		m_insertion.clear();
+		m_deletionStart = m_deletionSize = 0;
+		for (size_type i = 0; i < m_runs.size(); ++i) m_runs[i] = run_type();
+		std::fill(m_levelRuns.begin(), m_levelRuns.end(), 0);
+		m_size = 0;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \copybrief linear_memory_structure_doc::memory_coefficient()
+	/// \copydetails linear_memory_structure_doc::memory_coefficient()
+	///
+	/// Merging a level holds both the merged runs and the result.
+	///////////////////////////////////////////////////////////////////////////
+	static constexpr double memory_coefficient() noexcept {
+		return 2 * tpie::array<T>::memory_coefficient();
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \copybrief linear_memory_structure_doc::memory_overhead()
+	/// \copydetails linear_memory_structure_doc::memory_overhead()
+	///////////////////////////////////////////////////////////////////////////
+	static constexpr double memory_overhead() noexcept {
+		// Insertion heap and deletion buffer, and the run tables for at most
+		// max_levels levels.
+		return sizeof(internal_sequence_heap)
+			+ 2 * (static_cast<double>(buffer_bytes) + sizeof(T) + tpie::array<T>::memory_overhead())
+			+ max_levels * fanout * (sizeof(run_type) + sizeof(size_type)
+									 + sizeof(std::pair<T, size_type>))
+			+ max_levels * sizeof(size_type)
+			+ 4 * tpie::array<T>::memory_overhead();
+	}
+
+private:
+	/** Bytes in the insertion heap and the deletion buffer. */
+	static const size_type buffer_bytes = 16 * 1024;
+	/** Number of runs per level. */
+	static const size_type fanout = 8;
+	/** Bound on the number of levels; each level multiplies the capacity by fanout. */
+	static const size_type max_levels = 24;
+
+	struct run_type {
+		tpie::array<T> data;
+		size_type start;
+		run_type(): start(0) {}
+		size_type size() const {return data.size() - start;}
+	};
+
+	struct head_compare {
+		comp_t comp;
+		head_compare(comp_t c): comp(c) {}
+		bool operator()(const std::pair<T, size_type> & a, const std::pair<T, size_type> & b) const {
+			return comp(a.first, b.first);
+		}
+	};
+
+	// Enough levels that the full levels hold max_size elements.
+	static size_type levels(size_type maxSize, size_type bufferSize) {
+		size_type l = 1;
+		long double capacity = static_cast<long double>(bufferSize) * fanout;
+		long double runSize = static_cast<long double>(bufferSize) * fanout;
+		while (capacity < static_cast<long double>(maxSize) && l < max_levels) {
+			runSize *= fanout;
+			capacity += runSize * fanout;
+			++l;
+		}
+		return l;
+	}
+
+	bool top_in_deletion() const {
+		return m_deletionSize != 0
+			&& (m_insertion.empty() || !comp(m_insertion.top(), m_deletion[m_deletionStart]));
+	}
+
+	run_type & run(size_type level, size_type i) {return m_runs[level * fanout + i];}
+
+	// Sort the insertion heap into a run on level 0. Its smallest elements
+	// are swapped into the deletion buffer to keep it below the runs.
+	void flush_insertion() {
+		T * a = m_insertion.data();
+		size_type n = m_insertion.size();
+		std::sort(a, a + n, comp);
+
+		run_type r;
+		r.data = tpie::array<T>(n + m_deletionSize, m_bucket);
+		std::merge(a, a + n,
+				   m_deletion.find(m_deletionStart), m_deletion.find(m_deletionStart + m_deletionSize),
+				   r.data.begin(), comp);
+		std::copy(r.data.begin(), r.data.find(m_deletionSize), m_deletion.begin());
+		m_deletionStart = 0;
+		r.start = m_deletionSize;
+		m_insertion.clear();
+
+		insert_run(0, r);
+		if (m_deletionSize == 0) fill_deletion();
+	}
+
+	void insert_run(size_type level, run_type & r) {
+		if (m_levelRuns[level] == fanout) merge_level(level);
+		run_type & slot = run(level, m_levelRuns[level]++);
+		slot = std::move(r);
+	}
+
+	// Merge the runs of a full level into one run on the next level, or into
+	// the first slot of the level itself if it is the last. Runs are merged
+	// pairwise, which is faster than a k-way merge through m_mergeHeap.
+	void merge_level(size_type level) {
+		size_type runs = m_levelRuns[level];
+		while (runs > 1) {
+			size_type merged = 0;
+			for (size_type i = 0; i + 1 < runs; i += 2) {
+				run_type & a = run(level, i);
+				run_type & b = run(level, i + 1);
+				run_type r;
+				r.data = tpie::array<T>(a.size() + b.size(), m_bucket);
+				std::merge(a.data.find(a.start), a.data.end(),
+						   b.data.find(b.start), b.data.end(),
+						   r.data.begin(), comp);
+				a = run_type();
+				b = run_type();
+				run(level, merged++) = std::move(r);
+			}
+			if (runs % 2 == 1) run(level, merged++) = std::move(run(level, runs - 1));
+			runs = merged;
+		}
+
+		if (level + 1 < m_levels) {
+			m_levelRuns[level] = 0;
+			insert_run(level + 1, run(level, 0));
+		} else {
+			m_levelRuns[level] = 1;
+		}
+	}
+
+	// Merge the smallest elements of all runs into the deletion buffer.
+	void fill_deletion() {
+		size_type runs = 0;
+		for (size_type level = 0; level < m_levels; ++level)
+			for (size_type i = 0; i < m_levelRuns[level]; ++i)
+				m_runIndex[runs++] = level * fanout + i;
+		if (runs == 0) return;
+		m_deletionSize = merge_runs(runs, m_deletion.begin(), m_bufferSize);
+		m_deletionStart = 0;
+
+		// Drop exhausted runs.
+		for (size_type level = 0; level < m_levels; ++level) {
+			for (size_type i = 0; i < m_levelRuns[level];) {
+				if (run(level, i).size() == 0) {
+					size_type last = --m_levelRuns[level];
+					run(level, i) = std::move(run(level, last));
+					run(level, last) = run_type();
+				} else {
+					++i;
+				}
+			}
+		}
+	}
+
+	// Merge at most limit elements from the runs m_runIndex[0, runs) to out,
+	// and return the number of elements written.
+	template <typename IT>
+	size_type merge_runs(size_type runs, IT out, size_type limit) {
+		m_mergeHeap.clear();
+		for (size_type i = 0; i < runs; ++i) {
+			run_type & r = m_runs[m_runIndex[i]];
+			if (r.size() != 0) m_mergeHeap.push(std::make_pair(r.data[r.start], m_runIndex[i]));
+		}
+		size_type n = 0;
+		while (n < limit && !m_mergeHeap.empty()) {
+			size_type i = m_mergeHeap.top().second;
+			*out = m_mergeHeap.top().first;
+			++out;
+			++n;
+			run_type & r = m_runs[i];
+			if (++r.start == r.data.size())
+				m_mergeHeap.pop();
+			else
+				m_mergeHeap.pop_and_push(std::make_pair(r.data[r.start], i));
+		}
+		return n;
+	}
+
+	size_type m_bufferSize;
+	size_type m_levels;
+	internal_priority_queue<T, comp_t, dary_heap<4> > m_insertion;
+	tpie::array<T> m_deletion;
+	size_type m_deletionStart;
+	size_type m_deletionSize;
+	tpie::array<run_type> m_runs;
+	tpie::array<size_type> m_levelRuns;
+	tpie::array<size_type> m_runIndex;
+	internal_priority_queue<std::pair<T, size_type>, head_compare, dary_heap<4> > m_mergeHeap;
+	size_type m_size;
+	memory_bucket_ref m_bucket;
+	comp_t comp;
+};
+
+} // namespace tpie
+
+#endif // TPIE_INTERNAL_SEQUENCE_HEAP_H
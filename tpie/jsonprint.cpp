@@ -73,7 +73,28 @@ public:
 
 	void name(const char * name) {
 		next(true);
-		o << name << ": ";
+		quoted(name);
+		o << ": ";
+	}
+
+	void quoted(const std::string & v) {
+		o << '"';
+		for (char c : v) {
+			switch (c) {
+				case '"': o << "\\\""; break;
+				case '\\': o << "\\\\"; break;
+				case '\n': o << "\\n"; break;
+				case '\t': o << "\\t"; break;
+				default:
+					if (static_cast<unsigned char>(c) < 0x20) {
+						static const char hex[] = "0123456789abcdef";
+						o << "\\u00" << hex[(c >> 4) & 0xf] << hex[c & 0xf];
+					} else {
+						o << c;
+					}
+			}
+		}
+		o << '"';
 	}
 
 	template <typename T>
@@ -84,7 +105,12 @@ public:
 	
 	void value(const std::string & v) {
 		next(false);
-		o << '"' << v << '"';
+		quoted(v);
+	}
+
+	void value(bool v) {
+		next(false);
+		o << (v ? "true" : "false");
 	}
 
 };
@@ -134,4 +160,8 @@ void JSONReflector::writeString(const std::string & v) {
 	p->value(v);
 }
 
+void JSONReflector::writeBool(bool v) {
+	p->value(v);
+}
+
 } //namespace tpie
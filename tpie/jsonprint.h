@@ -63,11 +63,13 @@ public:
 	bool operator()(const float & v) {writeDouble(v); return true;}
 	bool operator()(const double & v) {writeDouble(v); return true;}
 	bool operator()(const std::string & v) {writeString(v); return true;}
+	bool operator()(const bool & v) {writeBool(v); return true;}
 private:
 	void writeUint(uint64_t v);
 	void writeInt(int64_t v);
 	void writeDouble(double v);
 	void writeString(const std::string & v);
+	void writeBool(bool v);
 	
 	JSONReflectorP * p;
 };
@@ -0,0 +1,149 @@
+// -*- mode: c++; tab-width: 4; indent-tabs-mode: t; c-file-style: "stroustrup"; -*-
+// vi:set ts=4 sts=4 sw=4 noet :
+// Copyright 2026, The TPIE development team
+//
+// This file is part of TPIE.
+//
+// TPIE is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// TPIE is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with TPIE.  If not, see <http://www.gnu.org/licenses/>
+
+#include <algorithm>
+#include <atomic>
+#include <tpie/config.h>
+#include <tpie/exception.h>
+#include <tpie/merge_kernels.h>
+#include <tpie/merge_kernels_simd.h>
+
+namespace {
+
+using namespace tpie;
+
+merge_kernel_isa detect_merge_kernel() {
+#ifdef TPIE_HAS_AVX512
+	if (__builtin_cpu_supports("avx512f")) return merge_kernel_avx512;
+#endif
+#ifdef TPIE_HAS_AVX2
+	if (__builtin_cpu_supports("avx2")) return merge_kernel_avx2;
+#endif
+	return merge_kernel_scalar;
+}
+
+std::atomic<int> & active_kernel() {
+	static std::atomic<int> isa(detect_merge_kernel());
+	return isa;
+}
+
+// Branch-free merge: the comparison selects the key and which input
+// advances, so unpredictable inputs cause no mispredictions.
+template <typename T>
+void merge_scalar(const T *& a, const T * aEnd,
+				  const T *& b, const T * bEnd,
+				  T *& out) {
+	while (a != aEnd && b != bEnd) {
+		bool takeB = *b < *a;
+		*out++ = takeB ? *b : *a;
+		b += takeB;
+		a += !takeB;
+	}
+}
+
+template <typename T>
+void merge_blocks(const T * a, memory_size_type na,
+				  const T * b, memory_size_type nb, T * out) {
+	const T * aEnd = a + na;
+	const T * bEnd = b + nb;
+	T tail[merge_kernel_bits::max_lanes];
+	memory_size_type tailSize = 0;
+	switch (static_cast<merge_kernel_isa>(active_kernel().load(std::memory_order_relaxed))) {
+#ifdef TPIE_HAS_AVX512
+		case merge_kernel_avx512:
+			tailSize = merge_kernel_bits::merge_avx512(a, aEnd, b, bEnd, out, tail);
+			break;
+#endif
+#ifdef TPIE_HAS_AVX2
+		case merge_kernel_avx2:
+			tailSize = merge_kernel_bits::merge_avx2(a, aEnd, b, bEnd, out, tail);
+			break;
+#endif
+		default:
+			break;
+	}
+	if (tailSize == 0) {
+		merge_scalar(a, aEnd, b, bEnd, out);
+	} else {
+		// Three-way merge of the keys the vector kernel left behind.
+		const T * t = tail;
+		const T * tEnd = tail + tailSize;
+		while (t != tEnd && a != aEnd && b != bEnd) {
+			if (*a <= *b && *a <= *t) *out++ = *a++;
+			else if (*b <= *t) *out++ = *b++;
+			else *out++ = *t++;
+		}
+		if (t == tEnd) merge_scalar(a, aEnd, b, bEnd, out);
+		else if (a == aEnd) merge_scalar(t, tEnd, b, bEnd, out);
+		else merge_scalar(t, tEnd, a, aEnd, out);
+		out = std::copy(t, tEnd, out);
+	}
+	out = std::copy(a, aEnd, out);
+	std::copy(b, bEnd, out);
+}
+
+} // unnamed namespace
+
+namespace tpie {
+
+merge_kernel_isa best_merge_kernel() {
+	static merge_kernel_isa isa = detect_merge_kernel();
+	return isa;
+}
+
+merge_kernel_isa get_merge_kernel() {
+	return static_cast<merge_kernel_isa>(active_kernel().load());
+}
+
+void set_merge_kernel(merge_kernel_isa isa) {
+	if (isa > best_merge_kernel())
+		throw exception(std::string("set_merge_kernel: ") + merge_kernel_name(isa) + " is not supported");
+	active_kernel().store(isa);
+}
+
+const char * merge_kernel_name(merge_kernel_isa isa) {
+	switch (isa) {
+		case merge_kernel_scalar: return "scalar";
+		case merge_kernel_avx2: return "avx2";
+		case merge_kernel_avx512: return "avx512";
+	}
+	return "unknown";
+}
+
+void merge_sorted_blocks(const std::int32_t * a, memory_size_type na,
+						 const std::int32_t * b, memory_size_type nb, std::int32_t * out) {
+	merge_blocks(a, na, b, nb, out);
+}
+
+void merge_sorted_blocks(const std::uint32_t * a, memory_size_type na,
+						 const std::uint32_t * b, memory_size_type nb, std::uint32_t * out) {
+	merge_blocks(a, na, b, nb, out);
+}
+
+void merge_sorted_blocks(const std::int64_t * a, memory_size_type na,
+						 const std::int64_t * b, memory_size_type nb, std::int64_t * out) {
+	merge_blocks(a, na, b, nb, out);
+}
+
+void merge_sorted_blocks(const std::uint64_t * a, memory_size_type na,
+						 const std::uint64_t * b, memory_size_type nb, std::uint64_t * out) {
+	merge_blocks(a, na, b, nb, out);
+}
+
+} // namespace tpie
@@ -0,0 +1,120 @@
+// -*- mode: c++; tab-width: 4; indent-tabs-mode: t; eval: (progn (c-set-style "stroustrup") (c-set-offset 'innamespace 0)); -*-
+// vi:set ts=4 sts=4 sw=4 noet :
+// Copyright 2026, The TPIE development team
+//
+// This file is part of TPIE.
+//
+// TPIE is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// TPIE is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with TPIE.  If not, see <http://www.gnu.org/licenses/>
+
+///////////////////////////////////////////////////////////////////////////////
+/// \file merge_kernels.h
+/// Two-way merging of sorted blocks of 32- and 64-bit integer keys.
+///
+/// Blocks are merged with AVX-512 or AVX2 bitonic merge networks when TPIE
+/// is built with a compiler supporting them and the CPU has the
+/// instructions, and with a branch-free scalar loop otherwise. The kernel is
+/// chosen at runtime on first use.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TPIE_MERGE_KERNELS_H
+#define TPIE_MERGE_KERNELS_H
+
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <tpie/types.h>
+
+namespace tpie {
+
+enum merge_kernel_isa {
+	merge_kernel_scalar,
+	merge_kernel_avx2,
+	merge_kernel_avx512
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief The fastest merge kernel supported by the build and the CPU.
+///////////////////////////////////////////////////////////////////////////////
+merge_kernel_isa best_merge_kernel();
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief The merge kernel used by merge_sorted_blocks().
+///////////////////////////////////////////////////////////////////////////////
+merge_kernel_isa get_merge_kernel();
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Select the merge kernel used by merge_sorted_blocks(), for
+/// instance to compare kernels in tests and benchmarks.
+///
+/// Throws tpie::exception if the kernel is not supported.
+///////////////////////////////////////////////////////////////////////////////
+void set_merge_kernel(merge_kernel_isa isa);
+
+const char * merge_kernel_name(merge_kernel_isa isa);
+
+void merge_sorted_blocks(const std::int32_t * a, memory_size_type na,
+						 const std::int32_t * b, memory_size_type nb, std::int32_t * out);
+void merge_sorted_blocks(const std::uint32_t * a, memory_size_type na,
+						 const std::uint32_t * b, memory_size_type nb, std::uint32_t * out);
+void merge_sorted_blocks(const std::int64_t * a, memory_size_type na,
+						 const std::int64_t * b, memory_size_type nb, std::int64_t * out);
+void merge_sorted_blocks(const std::uint64_t * a, memory_size_type na,
+						 const std::uint64_t * b, memory_size_type nb, std::uint64_t * out);
+
+namespace merge_kernel_bits {
+
+template <typename T>
+struct fixed_width {
+	typedef typename std::conditional<sizeof(T) == 4,
+		typename std::conditional<std::is_signed<T>::value, std::int32_t, std::uint32_t>::type,
+		typename std::conditional<std::is_signed<T>::value, std::int64_t, std::uint64_t>::type
+		>::type type;
+};
+
+} // namespace merge_kernel_bits
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief True if items of type T ordered by pred_t can be merged with
+/// merge_sorted_blocks(): T is a 32- or 64-bit integer and pred_t is
+/// std::less<T>.
+///////////////////////////////////////////////////////////////////////////////
+template <typename T, typename pred_t>
+struct use_merge_kernel : public std::integral_constant<bool,
+	std::is_integral<T>::value
+	&& !std::is_same<T, bool>::value
+	&& (sizeof(T) == 4 || sizeof(T) == 8)
+	&& std::is_same<pred_t, std::less<T> >::value> {
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Merge the sorted ranges [a, a + na) and [b, b + nb) into
+/// [out, out + na + nb).
+///
+/// T must be a 32- or 64-bit integer type. The output must not overlap
+/// the inputs.
+///////////////////////////////////////////////////////////////////////////////
+template <typename T>
+void merge_sorted_blocks(const T * a, memory_size_type na,
+						 const T * b, memory_size_type nb, T * out) {
+	static_assert(std::is_integral<T>::value && (sizeof(T) == 4 || sizeof(T) == 8),
+				  "merge_sorted_blocks requires 32- or 64-bit integers");
+	typedef typename merge_kernel_bits::fixed_width<T>::type F;
+	merge_sorted_blocks(reinterpret_cast<const F *>(a), na,
+						reinterpret_cast<const F *>(b), nb,
+						reinterpret_cast<F *>(out));
+}
+
+} // namespace tpie
+
+#endif // TPIE_MERGE_KERNELS_H
@@ -0,0 +1,137 @@
+// -*- mode: c++; tab-width: 4; indent-tabs-mode: t; c-file-style: "stroustrup"; -*-
+// vi:set ts=4 sts=4 sw=4 noet :
+// Copyright 2026, The TPIE development team
+//
+// This file is part of TPIE.
+//
+// TPIE is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// TPIE is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with TPIE.  If not, see <http://www.gnu.org/licenses/>
+
+// Compiled with -mavx2; see merge_kernels_simd.h before adding includes.
+
+#include <immintrin.h>
+#include <tpie/merge_kernels_simd.h>
+
+namespace {
+
+// Bitonic networks on eight 32-bit lanes.
+template <bool isSigned>
+struct avx2_32 {
+	typedef __m256i vec;
+	static const std::size_t lanes = 8;
+
+	static vec min(vec a, vec b) { return isSigned ? _mm256_min_epi32(a, b) : _mm256_min_epu32(a, b); }
+	static vec max(vec a, vec b) { return isSigned ? _mm256_max_epi32(a, b) : _mm256_max_epu32(a, b); }
+
+	static vec reverse(vec v) {
+		return _mm256_permutevar8x32_epi32(v, _mm256_set_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+	}
+
+	// Sort a bitonic sequence.
+	static vec bitonic_sort(vec v) {
+		vec p = _mm256_permute2x128_si256(v, v, 1);
+		v = _mm256_blend_epi32(min(v, p), max(v, p), 0xF0);
+		p = _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+		v = _mm256_blend_epi32(min(v, p), max(v, p), 0xCC);
+		p = _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+		return _mm256_blend_epi32(min(v, p), max(v, p), 0xAA);
+	}
+};
+
+// Bitonic networks on four 64-bit lanes. AVX2 has no 64-bit min and max, so
+// they are blends on a signed comparison, with the sign bit flipped first for
+// unsigned keys.
+template <bool isSigned>
+struct avx2_64 {
+	typedef __m256i vec;
+	static const std::size_t lanes = 4;
+
+	static vec greater(vec a, vec b) {
+		if (!isSigned) {
+			const vec sign = _mm256_set1_epi64x(static_cast<long long>(0x8000000000000000ULL));
+			a = _mm256_xor_si256(a, sign);
+			b = _mm256_xor_si256(b, sign);
+		}
+		return _mm256_cmpgt_epi64(a, b);
+	}
+
+	static vec min(vec a, vec b) { return _mm256_blendv_epi8(a, b, greater(a, b)); }
+	static vec max(vec a, vec b) { return _mm256_blendv_epi8(b, a, greater(a, b)); }
+
+	static vec reverse(vec v) {
+		return _mm256_permute4x64_epi64(v, _MM_SHUFFLE(0, 1, 2, 3));
+	}
+
+	static vec bitonic_sort(vec v) {
+		vec p = _mm256_permute2x128_si256(v, v, 1);
+		v = _mm256_blend_epi32(min(v, p), max(v, p), 0xF0);
+		p = _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+		return _mm256_blend_epi32(min(v, p), max(v, p), 0xCC);
+	}
+};
+
+template <typename V, typename T>
+std::size_t merge(const T *& a, const T * aEnd,
+				  const T *& b, const T * bEnd,
+				  T *& out, T * tail) {
+	typedef typename V::vec vec;
+	const std::ptrdiff_t lanes = static_cast<std::ptrdiff_t>(V::lanes);
+	if (aEnd - a < lanes || bEnd - b < lanes) return 0;
+
+	vec lo = _mm256_loadu_si256(reinterpret_cast<const vec *>(a));
+	vec hi = _mm256_loadu_si256(reinterpret_cast<const vec *>(b));
+	a += lanes;
+	b += lanes;
+	for (;;) {
+		// Merge two sorted vectors: the lane-wise minimum and maximum of lo
+		// and reversed hi are bitonic and hold the smaller and larger halves.
+		vec r = V::reverse(hi);
+		vec l = V::min(lo, r);
+		hi = V::bitonic_sort(V::max(lo, r));
+		_mm256_storeu_si256(reinterpret_cast<vec *>(out), V::bitonic_sort(l));
+		out += lanes;
+
+		// Continue with the input whose next key is smaller.
+		bool takeA = b == bEnd || (a != aEnd && *a <= *b);
+		const T *& src = takeA ? a : b;
+		if ((takeA ? aEnd : bEnd) - src < lanes) break;
+		lo = _mm256_loadu_si256(reinterpret_cast<const vec *>(src));
+		src += lanes;
+	}
+	_mm256_storeu_si256(reinterpret_cast<vec *>(tail), hi);
+	return V::lanes;
+}
+
+} // unnamed namespace
+
+namespace tpie {
+
+namespace merge_kernel_bits {
+
+#define TPIE_DEFINE_MERGE_KERNEL(T, V) \
+std::size_t merge_avx2(const T *& a, const T * aEnd, \
+					   const T *& b, const T * bEnd, \
+					   T *& out, T * tail) { \
+	return merge<V>(a, aEnd, b, bEnd, out, tail); \
+}
+
+TPIE_DEFINE_MERGE_KERNEL(std::int32_t, avx2_32<true>)
+TPIE_DEFINE_MERGE_KERNEL(std::uint32_t, avx2_32<false>)
+TPIE_DEFINE_MERGE_KERNEL(std::int64_t, avx2_64<true>)
+TPIE_DEFINE_MERGE_KERNEL(std::uint64_t, avx2_64<false>)
+
+#undef TPIE_DEFINE_MERGE_KERNEL
+
+} // namespace merge_kernel_bits
+
+} // namespace tpie
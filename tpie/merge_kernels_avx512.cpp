@@ -0,0 +1,138 @@
+// -*- mode: c++; tab-width: 4; indent-tabs-mode: t; c-file-style: "stroustrup"; -*-
+// vi:set ts=4 sts=4 sw=4 noet :
+// Copyright 2026, The TPIE development team
+//
+// This file is part of TPIE.
+//
+// TPIE is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// TPIE is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with TPIE.  If not, see <http://www.gnu.org/licenses/>
+
+// Compiled with -mavx512f; see merge_kernels_simd.h before adding includes.
+
+#if defined(__GNUC__) && !defined(__clang__)
+// GCC flags the _mm512_undefined_epi32() in its own AVX-512 intrinsics
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+#include <immintrin.h>
+#include <tpie/merge_kernels_simd.h>
+
+namespace {
+
+// Bitonic networks on sixteen 32-bit lanes.
+template <bool isSigned>
+struct avx512_32 {
+	typedef __m512i vec;
+	static const std::size_t lanes = 16;
+
+	static vec min(vec a, vec b) { return isSigned ? _mm512_min_epi32(a, b) : _mm512_min_epu32(a, b); }
+	static vec max(vec a, vec b) { return isSigned ? _mm512_max_epi32(a, b) : _mm512_max_epu32(a, b); }
+
+	// Lanes whose bit in mask is set take the maximum.
+	static vec exchange(vec v, vec p, __mmask16 mask) {
+		return _mm512_mask_blend_epi32(mask, min(v, p), max(v, p));
+	}
+
+	static vec reverse(vec v) {
+		return _mm512_permutexvar_epi32(
+			_mm512_set_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15), v);
+	}
+
+	// Sort a bitonic sequence.
+	static vec bitonic_sort(vec v) {
+		v = exchange(v, _mm512_shuffle_i64x2(v, v, _MM_SHUFFLE(1, 0, 3, 2)), 0xFF00);
+		v = exchange(v, _mm512_shuffle_i64x2(v, v, _MM_SHUFFLE(2, 3, 0, 1)), 0xF0F0);
+		v = exchange(v, _mm512_shuffle_epi32(v, _MM_PERM_BADC), 0xCCCC);
+		return exchange(v, _mm512_shuffle_epi32(v, _MM_PERM_CDAB), 0xAAAA);
+	}
+};
+
+// Bitonic networks on eight 64-bit lanes.
+template <bool isSigned>
+struct avx512_64 {
+	typedef __m512i vec;
+	static const std::size_t lanes = 8;
+
+	static vec min(vec a, vec b) { return isSigned ? _mm512_min_epi64(a, b) : _mm512_min_epu64(a, b); }
+	static vec max(vec a, vec b) { return isSigned ? _mm512_max_epi64(a, b) : _mm512_max_epu64(a, b); }
+
+	static vec exchange(vec v, vec p, __mmask8 mask) {
+		return _mm512_mask_blend_epi64(mask, min(v, p), max(v, p));
+	}
+
+	static vec reverse(vec v) {
+		return _mm512_permutexvar_epi64(_mm512_set_epi64(0, 1, 2, 3, 4, 5, 6, 7), v);
+	}
+
+	static vec bitonic_sort(vec v) {
+		v = exchange(v, _mm512_shuffle_i64x2(v, v, _MM_SHUFFLE(1, 0, 3, 2)), 0xF0);
+		v = exchange(v, _mm512_shuffle_i64x2(v, v, _MM_SHUFFLE(2, 3, 0, 1)), 0xCC);
+		return exchange(v, _mm512_shuffle_epi32(v, _MM_PERM_BADC), 0xAA);
+	}
+};
+
+template <typename V, typename T>
+std::size_t merge(const T *& a, const T * aEnd,
+				  const T *& b, const T * bEnd,
+				  T *& out, T * tail) {
+	typedef typename V::vec vec;
+	const std::ptrdiff_t lanes = static_cast<std::ptrdiff_t>(V::lanes);
+	if (aEnd - a < lanes || bEnd - b < lanes) return 0;
+
+	vec lo = _mm512_loadu_si512(reinterpret_cast<const vec *>(a));
+	vec hi = _mm512_loadu_si512(reinterpret_cast<const vec *>(b));
+	a += lanes;
+	b += lanes;
+	for (;;) {
+		// Merge two sorted vectors: the lane-wise minimum and maximum of lo
+		// and reversed hi are bitonic and hold the smaller and larger halves.
+		vec r = V::reverse(hi);
+		vec l = V::min(lo, r);
+		hi = V::bitonic_sort(V::max(lo, r));
+		_mm512_storeu_si512(reinterpret_cast<vec *>(out), V::bitonic_sort(l));
+		out += lanes;
+
+		// Continue with the input whose next key is smaller.
+		bool takeA = b == bEnd || (a != aEnd && *a <= *b);
+		const T *& src = takeA ? a : b;
+		if ((takeA ? aEnd : bEnd) - src < lanes) break;
+		lo = _mm512_loadu_si512(reinterpret_cast<const vec *>(src));
+		src += lanes;
+	}
+	_mm512_storeu_si512(reinterpret_cast<vec *>(tail), hi);
+	return V::lanes;
+}
+
+} // unnamed namespace
+
+namespace tpie {
+
+namespace merge_kernel_bits {
+
+#define TPIE_DEFINE_MERGE_KERNEL(T, V) \
+std::size_t merge_avx512(const T *& a, const T * aEnd, \
+						 const T *& b, const T * bEnd, \
+						 T *& out, T * tail) { \
+	return merge<V>(a, aEnd, b, bEnd, out, tail); \
+}
+
+TPIE_DEFINE_MERGE_KERNEL(std::int32_t, avx512_32<true>)
+TPIE_DEFINE_MERGE_KERNEL(std::uint32_t, avx512_32<false>)
+TPIE_DEFINE_MERGE_KERNEL(std::int64_t, avx512_64<true>)
+TPIE_DEFINE_MERGE_KERNEL(std::uint64_t, avx512_64<false>)
+
+#undef TPIE_DEFINE_MERGE_KERNEL
+
+} // namespace merge_kernel_bits
+
+} // namespace tpie
@@ -0,0 +1,73 @@
+// -*- mode: c++; tab-width: 4; indent-tabs-mode: t; eval: (progn (c-set-style "stroustrup") (c-set-offset 'innamespace 0)); -*-
+// vi:set ts=4 sts=4 sw=4 noet :
+// Copyright 2026, The TPIE development team
+//
+// This file is part of TPIE.
+//
+// TPIE is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// TPIE is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with TPIE.  If not, see <http://www.gnu.org/licenses/>
+
+///////////////////////////////////////////////////////////////////////////////
+/// \file merge_kernels_simd.h
+/// \internal Vector merge kernels implemented in merge_kernels_avx2.cpp and
+/// merge_kernels_avx512.cpp.
+///
+/// Those translation units are compiled with instruction set flags, so they
+/// include nothing but this header and the intrinsics: an inline function
+/// instantiated there could otherwise be picked by the linker for callers on
+/// CPUs without the instructions.
+///
+/// Each kernel merges vectors of keys from [a, aEnd) and [b, bEnd) to out
+/// with a bitonic merge network, advancing the three pointers. It stops when
+/// the input that would supply the next vector has less than a vector left,
+/// and stores the keys still held in registers (sorted) in tail. All keys
+/// left in tail, [a, aEnd) and [b, bEnd) are at least as large as those
+/// written to out. Returns the number of keys stored in tail, which is zero
+/// if an input is shorter than a vector to begin with.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TPIE_MERGE_KERNELS_SIMD_H
+#define TPIE_MERGE_KERNELS_SIMD_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace tpie {
+
+namespace merge_kernel_bits {
+
+/** Largest number of keys in a vector register, and so in a tail. */
+const std::size_t max_lanes = 16;
+
+#define TPIE_DECLARE_MERGE_KERNEL(isa, T) \
+std::size_t merge_##isa(const T *& a, const T * aEnd, \
+						const T *& b, const T * bEnd, \
+						T *& out, T * tail)
+
+TPIE_DECLARE_MERGE_KERNEL(avx2, std::int32_t);
+TPIE_DECLARE_MERGE_KERNEL(avx2, std::uint32_t);
+TPIE_DECLARE_MERGE_KERNEL(avx2, std::int64_t);
+TPIE_DECLARE_MERGE_KERNEL(avx2, std::uint64_t);
+
+TPIE_DECLARE_MERGE_KERNEL(avx512, std::int32_t);
+TPIE_DECLARE_MERGE_KERNEL(avx512, std::uint32_t);
+TPIE_DECLARE_MERGE_KERNEL(avx512, std::int64_t);
+TPIE_DECLARE_MERGE_KERNEL(avx512, std::uint64_t);
+
+#undef TPIE_DECLARE_MERGE_KERNEL
+
+} // namespace merge_kernel_bits
+
+} // namespace tpie
+
+#endif // TPIE_MERGE_KERNELS_SIMD_H
@@ -0,0 +1,146 @@
+// -*- mode: c++; tab-width: 4; indent-tabs-mode: t; eval: (progn (c-set-style "stroustrup") (c-set-offset 'innamespace 0)); -*-
+// vi:set ts=4 sts=4 sw=4 noet :
+// Copyright 2026, The TPIE development team
+//
+// This file is part of TPIE.
+//
+// TPIE is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// TPIE is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with TPIE.  If not, see <http://www.gnu.org/licenses/>
+
+#ifndef TPIE_PIPELINING_BLOOM_FILTER_H
+#define TPIE_PIPELINING_BLOOM_FILTER_H
+
+#include <tpie/bloom_filter.h>
+#include <tpie/pipelining/node.h>
+#include <tpie/pipelining/pipe_base.h>
+#include <tpie/pipelining/factory_helpers.h>
+
+namespace tpie {
+namespace pipelining {
+namespace bits {
+
+///////////////////////////////////////////////////////////////////////////////
+/// \class bloom_filter_output_t
+///
+/// Inserts the pushed items into a filter, buffering their hash values in
+/// the memory assigned to the node.
+///////////////////////////////////////////////////////////////////////////////
+template <typename filter_t>
+class bloom_filter_output_t : public node {
+public:
+	typedef typename filter_t::item_type item_type;
+
+	bloom_filter_output_t(filter_t & filter) : m_filter(filter), m_count(0) {
+		set_name("Build Bloom filter", PRIORITY_INSIGNIFICANT);
+		set_minimum_memory(array<size_t>::memory_usage(minimum_buffer));
+		set_memory_fraction(1.0);
+	}
+
+	void begin() override {
+		memory_size_type available = get_available_memory();
+		memory_size_type overhead = array<size_t>::memory_usage(0);
+		memory_size_type items = available > overhead ? (available - overhead) / sizeof(size_t) : 0;
+		m_buffer.resize(items > minimum_buffer ? items : minimum_buffer);
+		m_count = 0;
+	}
+
+	void push(const item_type & item) {
+		m_buffer[m_count++] = m_filter.hash_value(item);
+		if (m_count == m_buffer.size()) flush();
+	}
+
+	void end() override {
+		flush();
+		m_buffer.resize(0);
+	}
+
+private:
+	static const memory_size_type minimum_buffer = 1024;
+
+	void flush() {
+		m_filter.insert_hashes(array_view<size_t>(m_buffer, 0, m_count));
+		m_count = 0;
+	}
+
+	filter_t & m_filter;
+	array<size_t> m_buffer;
+	memory_size_type m_count;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/// \class bloom_filter_query_t
+///
+/// Pushes the items that the filter may contain, or with absent set, the
+/// items it does not contain.
+///////////////////////////////////////////////////////////////////////////////
+template <typename dest_t, typename filter_t>
+class bloom_filter_query_t : public node {
+public:
+	typedef typename filter_t::item_type item_type;
+
+	bloom_filter_query_t(dest_t dest, filter_t & filter, bool absent)
+		: m_filter(filter)
+		, m_absent(absent)
+		, dest(std::move(dest))
+	{
+		set_name(absent ? "Keep absent from Bloom filter" : "Keep present in Bloom filter", PRIORITY_INSIGNIFICANT);
+	}
+
+	void push(const item_type & item) {
+		if (m_filter.contains(item) != m_absent)
+			dest.push(item);
+	}
+
+private:
+	filter_t & m_filter;
+	bool m_absent;
+	dest_t dest;
+};
+
+} // namespace bits
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief A pipelining node that inserts the pushed items into an
+/// external_bloom_filter. Items are inserted in batches as large as the
+/// memory assigned to the node allows.
+/// \param filter The filter to build
+///////////////////////////////////////////////////////////////////////////////
+template <typename filter_t>
+inline pipe_end<termfactory<bits::bloom_filter_output_t<filter_t>, filter_t &> > bloom_filter_output(filter_t & filter) {
+	return {filter};
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief A pipelining node that keeps the items an external_bloom_filter
+/// may contain, dropping those that were certainly not inserted.
+/// \param filter The filter to query
+///////////////////////////////////////////////////////////////////////////////
+template <typename filter_t>
+inline pipe_middle<tfactory<bits::bloom_filter_query_t, Args<filter_t>, filter_t &, bool> > bloom_filter_contains(filter_t & filter) {
+	return {filter, false};
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief A pipelining node that keeps the items that were certainly not
+/// inserted into an external_bloom_filter.
+/// \param filter The filter to query
+///////////////////////////////////////////////////////////////////////////////
+template <typename filter_t>
+inline pipe_middle<tfactory<bits::bloom_filter_query_t, Args<filter_t>, filter_t &, bool> > bloom_filter_absent(filter_t & filter) {
+	return {filter, true};
+}
+
+} // namespace pipelining
+} // namespace tpie
+
+#endif // TPIE_PIPELINING_BLOOM_FILTER_H
@@ -0,0 +1,65 @@
+// -*- mode: c++; tab-width: 4; indent-tabs-mode: t; eval: (progn (c-set-style "stroustrup") (c-set-offset 'innamespace 0)); -*-
+// vi:set ts=4 sts=4 sw=4 noet :
+// Copyright 2026, The TPIE development team
+//
+// This file is part of TPIE.
+//
+// TPIE is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// TPIE is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with TPIE.  If not, see <http://www.gnu.org/licenses/>
+
+#ifndef TPIE_PIPELINING_BTREE_BUILDER_H
+#define TPIE_PIPELINING_BTREE_BUILDER_H
+
+#include <tpie/btree.h>
+#include <tpie/pipelining/node.h>
+#include <tpie/pipelining/pipe_base.h>
+#include <tpie/pipelining/factory_helpers.h>
+
+namespace tpie {
+namespace pipelining {
+namespace bits {
+
+template <typename T, typename O>
+class btree_builder_output_t : public node {
+public:
+	typedef T item_type;
+	typedef bbits::builder<T, O> builder_t;
+
+	btree_builder_output_t(builder_t & builder) : m_builder(builder) {
+		set_name("Build B-tree", PRIORITY_INSIGNIFICANT);
+	}
+
+	void push(const item_type & item) {
+		m_builder.push(item);
+	}
+
+private:
+	builder_t & m_builder;
+};
+
+} // namespace bits
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief A pipelining node that pushes sorted items into a B-tree builder.
+/// The tree is obtained with builder.build() once the pipeline has run.
+///////////////////////////////////////////////////////////////////////////////
+template <typename T, typename O>
+inline pipe_end<termfactory<bits::btree_builder_output_t<T, O>, bbits::builder<T, O> &> >
+btree_builder_output(bbits::builder<T, O> & builder) {
+	return {builder};
+}
+
+} // namespace pipelining
+} // namespace tpie
+
+#endif // TPIE_PIPELINING_BTREE_BUILDER_H
@@ -24,10 +24,30 @@
 #include <tpie/compressed/stream.h>
 #include <tpie/file_stream.h>
 #include <tpie/tpie_assert.h>
+#include <tpie/merge_kernels.h>
 #include <tpie/pipelining/store.h>
 namespace tpie {
 
+namespace bits {
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief True if runs are merged in blocks with merge_sorted_blocks():
+/// the items are stored plainly and use_merge_kernel holds for them.
+///////////////////////////////////////////////////////////////////////////////
 template <typename specific_store_t, typename pred_t>
+struct use_block_merge : public std::integral_constant<bool,
+	std::is_base_of<plain_store::specific<typename specific_store_t::element_type>, specific_store_t>::value
+	&& use_merge_kernel<typename specific_store_t::element_type, pred_t>::value> {
+};
+
+} // namespace bits
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Merges sorted runs with an internal_priority_queue of the given
+/// heap layout.
+///////////////////////////////////////////////////////////////////////////////
+template <typename specific_store_t, typename pred_t, typename heap_t = binary_heap,
+		  bool blockMerge = bits::use_block_merge<specific_store_t, pred_t>::value>
 class merger {
 private:
 	typedef typename specific_store_t::store_type store_type;
@@ -95,11 +115,11 @@ public:
 			linear_memory_usage(-sizeof(file_stream<element_type>) //in filestreams,
 								+ file_stream<element_type>::memory_usage(), //in filestreams
 								sizeof(merger) 
-								- sizeof(internal_priority_queue<std::pair<store_type, size_t>, predwrap>) //pq
+								- sizeof(internal_priority_queue<std::pair<store_type, size_t>, predwrap, heap_t>) //pq
 								- sizeof(array<file_stream<element_type> >) //in
 								- sizeof(array<size_t>)) // itemsRead
 			+ array<size_t>::memory_usage() //itemsRead
-			+ internal_priority_queue<std::pair<store_type, size_t>, predwrap>::memory_usage() //pq
+			+ internal_priority_queue<std::pair<store_type, size_t>, predwrap, heap_t>::memory_usage() //pq
 			+ array<file_stream<element_type> >::memory_usage(); //in
 	}
 	
@@ -129,13 +149,212 @@ public:
 	};
 
 private:
-	internal_priority_queue<std::pair<store_type, size_t>, predwrap> pq;
+	internal_priority_queue<std::pair<store_type, size_t>, predwrap, heap_t> pq;
 	array<file_stream<element_type> > in;
 	array<stream_size_type> itemsRead;
 	stream_size_type runLength;
 	specific_store_t m_store;
 };
 
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Merger for integer keys that merges blocks of keys at a time.
+///
+/// Up to blockItems keys of each run are buffered. All buffered keys not
+/// larger than the smallest last key of a buffer whose run has more keys on
+/// disk are known to precede every unread key, so they are merged into the
+/// output buffer at once by a tree of two-way merge_sorted_blocks() calls.
+/// Each such step empties at least one buffer. No heap is used, so heap_t is
+/// ignored.
+///////////////////////////////////////////////////////////////////////////////
+template <typename specific_store_t, typename pred_t, typename heap_t>
+class merger<specific_store_t, pred_t, heap_t, true> {
+private:
+	typedef typename specific_store_t::store_type store_type;
+	typedef typename specific_store_t::element_type element_type;
+
+	/** Keys buffered per run. */
+	static const memory_size_type blockItems = 1024;
+
+	struct run_state {
+		// Unmerged keys of the run are [begin, end) of its buffer.
+		element_type * begin;
+		element_type * end;
+		stream_size_type itemsRead;
+	};
+
+	struct segment {
+		const element_type * begin;
+		const element_type * end;
+	};
+
+public:
+	inline merger(pred_t /*pred*/, specific_store_t /*store*/,
+				  memory_bucket_ref bucket = memory_bucket_ref())
+		: in(bucket)
+		, runs(bucket)
+		, segments(bucket)
+		, buffers(bucket)
+		, output(bucket)
+		, scratch(bucket)
+		, outBegin(nullptr)
+		, outEnd(nullptr)
+		, runLength(0) {
+	}
+
+	inline bool can_pull() {
+		return outBegin != outEnd;
+	}
+
+	inline store_type pull() {
+		tp_assert(can_pull(), "pull() while !can_pull()");
+		store_type el = *outBegin++;
+		if (outBegin == outEnd) {
+			merge_block();
+			if (!can_pull()) reset();
+		}
+		return el;
+	}
+
+	inline void reset() {
+		in.resize(0);
+		runs.resize(0);
+		segments.resize(0);
+		buffers.resize(0);
+		output.resize(0);
+		scratch.resize(0);
+		outBegin = outEnd = nullptr;
+	}
+
+	// Initialize merger with given sorted input runs. Each file stream is
+	// assumed to have a stream offset pointing to the first item in the run,
+	// and runLength items are read from each stream (unless end of stream
+	// occurs earlier).
+	// Precondition: !can_pull()
+	void reset(array<file_stream<element_type> > & inputs, stream_size_type runLength) {
+		this->runLength = runLength;
+		tp_assert(!can_pull(), "Reset before we are done");
+		in.swap(inputs);
+		memory_size_type fanout = in.size();
+		runs.resize(fanout);
+		segments.resize(fanout);
+		buffers.resize(fanout * blockItems);
+		output.resize(fanout * blockItems);
+		scratch.resize(fanout * blockItems);
+		for (memory_size_type i = 0; i < fanout; ++i) {
+			runs[i].begin = runs[i].end = buffers.get() + i * blockItems;
+			runs[i].itemsRead = 0;
+		}
+		merge_block();
+	}
+
+	// Compute memory usage as a function of the fanout
+	static constexpr linear_memory_usage memory_usage() noexcept {
+		return
+			linear_memory_usage(-sizeof(file_stream<element_type>) //in filestreams,
+								+ file_stream<element_type>::memory_usage() //in filestreams
+								+ 3 * blockItems * sizeof(element_type), // buffers, output, scratch
+								sizeof(merger)
+								- sizeof(array<file_stream<element_type> >) //in
+								- sizeof(array<run_state>) //runs
+								- sizeof(array<segment>)) //segments
+			+ array<file_stream<element_type> >::memory_usage() //in
+			+ array<run_state>::memory_usage() //runs
+			+ array<segment>::memory_usage(); //segments
+	}
+
+	static constexpr memory_size_type memory_usage(memory_size_type fanout) noexcept {
+		return memory_usage()(fanout);
+	}
+
+private:
+	stream_size_type remaining_on_disk(memory_size_type i) {
+		return std::min(runLength - runs[i].itemsRead,
+						in[i].size() - in[i].offset());
+	}
+
+	// Fill the output buffer with the next keys in sorted order.
+	void merge_block() {
+		outBegin = outEnd = nullptr;
+		memory_size_type fanout = in.size();
+
+		bool bounded = false;
+		element_type bound = element_type();
+		for (memory_size_type i = 0; i < fanout; ++i) {
+			run_state & r = runs[i];
+			if (r.begin == r.end) {
+				memory_size_type n = static_cast<memory_size_type>(
+					std::min(remaining_on_disk(i), static_cast<stream_size_type>(blockItems)));
+				r.begin = r.end = buffers.get() + i * blockItems;
+				in[i].read(r.begin, r.begin + n);
+				r.end += n;
+				r.itemsRead += n;
+			}
+			if (r.begin != r.end && remaining_on_disk(i) > 0
+				&& (!bounded || *(r.end - 1) < bound)) {
+				bound = *(r.end - 1);
+				bounded = true;
+			}
+		}
+
+		memory_size_type n = 0;
+		for (memory_size_type i = 0; i < fanout; ++i) {
+			run_state & r = runs[i];
+			element_type * cut = bounded ? std::upper_bound(r.begin, r.end, bound) : r.end;
+			if (cut == r.begin) continue;
+			segments[n].begin = r.begin;
+			segments[n].end = cut;
+			++n;
+			r.begin = cut;
+		}
+		if (n == 0) return;
+
+		if (n == 1) {
+			// A single segment is pulled directly from the run buffer, which
+			// is not refilled before the segment is used up.
+			outBegin = segments[0].begin;
+			outEnd = segments[0].end;
+			return;
+		}
+
+		element_type * target = output.get();
+		element_type * other = scratch.get();
+		while (n > 1) {
+			element_type * dest = target;
+			memory_size_type m = 0;
+			for (memory_size_type i = 0; i < n; i += 2) {
+				const segment & s1 = segments[i];
+				element_type * begin = dest;
+				if (i + 1 == n) {
+					dest = std::copy(s1.begin, s1.end, dest);
+				} else {
+					const segment & s2 = segments[i+1];
+					merge_sorted_blocks(s1.begin, static_cast<memory_size_type>(s1.end - s1.begin),
+										s2.begin, static_cast<memory_size_type>(s2.end - s2.begin),
+										dest);
+					dest += (s1.end - s1.begin) + (s2.end - s2.begin);
+				}
+				segments[m].begin = begin;
+				segments[m].end = dest;
+				++m;
+			}
+			n = m;
+			std::swap(target, other);
+		}
+		outBegin = segments[0].begin;
+		outEnd = segments[0].end;
+	}
+
+	array<file_stream<element_type> > in;
+	array<run_state> runs;
+	array<segment> segments;
+	array<element_type> buffers;
+	array<element_type> output;
+	array<element_type> scratch;
+	const element_type * outBegin;
+	const element_type * outEnd;
+	stream_size_type runLength;
+};
+
 } // namespace tpie
 
 #endif // __TPIE_PIPELINING_MERGER_H__
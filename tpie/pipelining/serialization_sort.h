@@ -95,10 +95,11 @@ protected:
 			m_sorter->set_phase_3_memory(availableMemory);
 	}
 
-	sort_output_base(pred_type pred)
+	sort_output_base(pred_type pred, compression_flags compression)
 		: m_sorter(new sorter_t(sizeof(item_type), pred))
 		, m_propagate_called(false)
 	{
+		m_sorter->set_run_compression(compression);
 	}
 
 	sort_output_base(sorterptr p)
@@ -163,8 +164,8 @@ public:
 	typedef typename Traits::sorter_t sorter_t;
 	typedef typename Traits::sorterptr sorterptr;
 
-	sort_output_t(dest_t dest, pred_type pred)
-		: p_t(pred)
+	sort_output_t(dest_t dest, pred_type pred, compression_flags compression)
+		: p_t(pred, compression)
 		, dest(std::move(dest))
 	{
 		this->add_push_destination(dest);
@@ -344,7 +345,13 @@ private:
 template <typename child_t>
 class sort_factory_base : public factory_base {
 	const child_t & self() const { return *static_cast<const child_t *>(this); }
+	compression_flags m_compression;
 public:
+	sort_factory_base(compression_flags compression)
+		: m_compression(compression)
+	{
+	}
+
 	template <typename dest_t>
 	struct constructed {
 	private:
@@ -361,7 +368,7 @@ public:
 		typedef typename push_type<dest_t>::type item_type;
 		typedef typename constructed<dest_t>::Traits Traits;
 
-		sort_output_t<Traits, dest_t> output(std::move(dest), self().template get_pred<item_type>());
+		sort_output_t<Traits, dest_t> output(std::move(dest), self().template get_pred<item_type>(), m_compression);
 		this->init_sub_node(output);
 		sort_calc_t<Traits> calc(std::move(output));
 		this->init_sub_node(calc);
@@ -377,6 +384,11 @@ public:
 ///////////////////////////////////////////////////////////////////////////////
 class default_pred_sort_factory : public sort_factory_base<default_pred_sort_factory> {
 public:
+	default_pred_sort_factory(compression_flags compression = compression_none)
+		: sort_factory_base<default_pred_sort_factory>(compression)
+	{
+	}
+
 	template <typename item_type>
 	class predicate {
 	public:
@@ -401,8 +413,9 @@ public:
 		typedef pred_t type;
 	};
 
-	sort_factory(const pred_t & p)
-		: pred(p)
+	sort_factory(const pred_t & p, compression_flags compression = compression_none)
+		: sort_factory_base<sort_factory<pred_t> >(compression)
+		, pred(p)
 	{
 	}
 
@@ -426,6 +439,16 @@ serialization_sort() {
 	return pipe_middle<fact>(fact()).name("Sort");
 }
 
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Pipelining sorter using std::less, storing its runs with the
+/// given compression.
+///////////////////////////////////////////////////////////////////////////////
+inline pipe_middle<serialization_bits::default_pred_sort_factory>
+serialization_sort(compression_flags compression) {
+	typedef serialization_bits::default_pred_sort_factory fact;
+	return pipe_middle<fact>(fact(compression)).name("Sort");
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 /// \brief Pipelining sorter using the given predicate.
 ///////////////////////////////////////////////////////////////////////////////
@@ -436,6 +459,17 @@ serialization_sort(const pred_t & p) {
 	return pipe_middle<fact>(fact(p)).name("Sort");
 }
 
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Pipelining sorter using the given predicate, storing its runs
+/// with the given compression.
+///////////////////////////////////////////////////////////////////////////////
+template <typename pred_t>
+pipe_middle<serialization_bits::sort_factory<pred_t> >
+serialization_sort(const pred_t & p, compression_flags compression) {
+	typedef serialization_bits::sort_factory<pred_t> fact;
+	return pipe_middle<fact>(fact(p, compression)).name("Sort");
+}
+
 template <typename T, typename pred_t=std::less<T> >
 class serialization_passive_sorter;
 
@@ -524,10 +558,12 @@ public:
 	typedef pipe_end<serialization_bits::passive_sorter_factory_input<Traits> > input_pipe_t;
 	typedef pullpipe_begin<serialization_bits::passive_sorter_factory_output<Traits> > output_pipe_t;
 
-	serialization_passive_sorter(pred_t pred = pred_t())
+	serialization_passive_sorter(pred_t pred = pred_t(),
+								 compression_flags compression = compression_none)
 		: m_sorter_input(new sorter_t(sizeof(T), pred))
 		, m_sorter_output(m_sorter_input)
 	{
+		m_sorter_input->set_run_compression(compression);
 	}
 
 	serialization_passive_sorter(const serialization_passive_sorter &) = delete;
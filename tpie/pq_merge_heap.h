@@ -26,7 +26,9 @@
 #define _TPIE_PQ_MERGE_HEAP_H_
 
 #include "tpie_log.h"
+#include <algorithm>
 #include <cassert>
+#include <tpie/dary_heap.h>
 #include <tpie/memory.h>
 
 namespace tpie{
@@ -36,8 +38,12 @@ namespace tpie{
 /// \author Lars Hvam Petersen
 ///
 /// pq_merge_heap
+///
+/// \tparam heap_t The heap layout, binary_heap or dary_heap<D>. Items and
+/// run numbers are kept in separate arrays, so only the arity of the layout
+/// is used.
 ///////////////////////////////////////////////////////////////////////////////
-template<typename T, typename Comparator = std::less<T> >
+template<typename T, typename Comparator = std::less<T>, typename heap_t = binary_heap>
 class pq_merge_heap {
 	public:
 		typedef memory_size_type run_type;
@@ -105,6 +111,8 @@ class pq_merge_heap {
 		bool empty() const;
 
 	private:
+		static const memory_size_type D = heap_t::arity;
+
 		void fixDown();
 		void validate();
 		void dump();
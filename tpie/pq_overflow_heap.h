@@ -34,8 +34,10 @@ namespace tpie {
 /// \author Lars Hvam Petersen
 ///
 /// \brief Overflow Priority Queue, based on a simple Heap.
+///
+/// \tparam heap_t The heap layout of the underlying internal_priority_queue.
 ///////////////////////////////////////////////////////////////////////////////
-template<typename T, typename Comparator = std::less<T> >
+template<typename T, typename Comparator = std::less<T>, typename heap_t = binary_heap>
 class pq_overflow_heap {
 public:
     ///////////////////////////////////////////////////////////////////////////
@@ -112,13 +114,13 @@ public:
 
 private:
     Comparator comp;
-	internal_priority_queue<T, Comparator> h;
+	internal_priority_queue<T, Comparator, heap_t> h;
     memory_size_type maxsize;
     //T dummy;
 };
 	
-	template<typename T, typename Comparator>
-	const double pq_overflow_heap<T,Comparator>::sorted_factor = 1.0;
+	template<typename T, typename Comparator, typename heap_t>
+	const double pq_overflow_heap<T, Comparator, heap_t>::sorted_factor = 1.0;
 
 #include "pq_overflow_heap.inl"
 
@@ -18,12 +18,12 @@
 // along with TPIE.  If not, see <http://www.gnu.org/licenses/>
 
 
-template<typename T, typename Comparator>
-pq_overflow_heap<T, Comparator>::pq_overflow_heap(memory_size_type m, Comparator c):
+template<typename T, typename Comparator, typename heap_t>
+pq_overflow_heap<T, Comparator, heap_t>::pq_overflow_heap(memory_size_type m, Comparator c):
   comp(c), h(m, comp), maxsize(m) {}
 
-template<typename T, typename Comparator>
-inline void pq_overflow_heap<T, Comparator>::push(const T& x) {
+template<typename T, typename Comparator, typename heap_t>
+inline void pq_overflow_heap<T, Comparator, heap_t>::push(const T& x) {
 #ifndef NDEBUG
 	if(h.size() == maxsize) {
 		TP_LOG_FATAL_ID("pq_overflow_heap: push error");
@@ -33,46 +33,46 @@ inline void pq_overflow_heap<T, Comparator>::push(const T& x) {
 	h.push(x);
 }
 
-template<typename T, typename Comparator>
-inline void pq_overflow_heap<T, Comparator>::pop() {
+template<typename T, typename Comparator, typename heap_t>
+inline void pq_overflow_heap<T, Comparator, heap_t>::pop() {
 	assert(!empty());
 	h.pop();
 }
 
-template<typename T, typename Comparator>
-inline const T& pq_overflow_heap<T, Comparator>::top() {
+template<typename T, typename Comparator, typename heap_t>
+inline const T& pq_overflow_heap<T, Comparator, heap_t>::top() {
 	assert(!empty());
 	return h.top();
 }
 
-template<typename T, typename Comparator>
-inline stream_size_type pq_overflow_heap<T, Comparator>::size() const {
+template<typename T, typename Comparator, typename heap_t>
+inline stream_size_type pq_overflow_heap<T, Comparator, heap_t>::size() const {
 	return h.size();
 }
 
-template<typename T, typename Comparator>
-inline bool pq_overflow_heap<T, Comparator>::full() const {
+template<typename T, typename Comparator, typename heap_t>
+inline bool pq_overflow_heap<T, Comparator, heap_t>::full() const {
 	return maxsize == h.size();
 }
 
-template<typename T, typename Comparator>
-inline T* pq_overflow_heap<T, Comparator>::sorted_array() {
-	tpie::array<T> & a = h.get_array();
-	std::sort(a.begin(), a.begin() + h.size(), comp);
-	return a.get();
+template<typename T, typename Comparator, typename heap_t>
+inline T* pq_overflow_heap<T, Comparator, heap_t>::sorted_array() {
+	T * a = h.data();
+	std::sort(a, a + h.size(), comp);
+	return a;
 }
 
-template<typename T, typename Comparator>
-inline memory_size_type pq_overflow_heap<T, Comparator>::sorted_size() const{
+template<typename T, typename Comparator, typename heap_t>
+inline memory_size_type pq_overflow_heap<T, Comparator, heap_t>::sorted_size() const{
 	return maxsize;
 }
 
-template<typename T, typename Comparator>
-inline void pq_overflow_heap<T, Comparator>::sorted_pop() {
+template<typename T, typename Comparator, typename heap_t>
+inline void pq_overflow_heap<T, Comparator, heap_t>::sorted_pop() {
 	h.clear();
 }
 
-template<typename T, typename Comparator>
-inline bool pq_overflow_heap<T, Comparator>::empty() const {
+template<typename T, typename Comparator, typename heap_t>
+inline bool pq_overflow_heap<T, Comparator, heap_t>::empty() const {
 	return h.empty();
 } 
@@ -41,6 +41,7 @@
 #include <tpie/err.h>
 #include <tpie/stream.h>
 #include <tpie/array.h>
+#include <tpie/array_view.h>
 #include <boost/filesystem.hpp>
 
 namespace tpie {
@@ -72,9 +73,15 @@ namespace tpie {
 /// However, even with as little as 8 MB of memory, this maximum capacity in
 /// practice exceeds 2**48, corresponding to a petabyte-sized dataset of 32-bit
 /// integers.
+///
+/// \tparam OPQType The overflow heap, e.g. pq_overflow_heap<T, Comparator,
+/// dary_heap<4> > for a shallower heap.
+/// \tparam merge_heap_t The heap layout of the pq_merge_heap that merges
+/// slots and groups.
 ///////////////////////////////////////////////////////////////////////////////
 
-template<typename T, typename Comparator = std::less<T>, typename OPQType = pq_overflow_heap<T, Comparator> >
+template<typename T, typename Comparator = std::less<T>, typename OPQType = pq_overflow_heap<T, Comparator>,
+		 typename merge_heap_t = binary_heap>
 class priority_queue {
 	typedef memory_size_type group_type;
 	typedef memory_size_type slot_type;
@@ -86,19 +93,28 @@ public:
 	///
 	/// \param f Factor of memory that the priority queue is allowed to use.
 	/// \param b Block factor
+	/// \param compressionFlags Compression of the slot files. Slots hold
+	/// sorted runs and are written and read sequentially, so they compress
+	/// well. Group buffers are cyclic and always uncompressed.
 	///////////////////////////////////////////////////////////////////////////
-	priority_queue(double f=1.0, float b=default_blocksize, stream_size_type n = std::numeric_limits<stream_size_type>::max());
+	priority_queue(double f=1.0, float b=default_blocksize, stream_size_type n = std::numeric_limits<stream_size_type>::max(),
+				   compression_flags compressionFlags=compression_none);
 
 #ifndef DOXYGEN
 	// \param mmavail Number of bytes the priority queue is allowed to use.
 	// \param b Block factor
-	priority_queue(memory_size_type mm_avail, float b=default_blocksize, stream_size_type n = std::numeric_limits<stream_size_type>::max());
+	priority_queue(memory_size_type mm_avail, float b=default_blocksize, stream_size_type n = std::numeric_limits<stream_size_type>::max(),
+				   compression_flags compressionFlags=compression_none);
 #endif
 
 	/////////////////////////////////////////////////////////
     ///
     /// Compute the maximal amount of memory it makes sence
 	/// to give a queue that will contain atmount n elements
+    ///
+	/// The estimate does not depend on the compression flags. It counts
+	/// n uncompressed items, so with compressed slots it overestimates
+	/// the memory needed to hold the queue in internal memory.
     ///
     /////////////////////////////////////////////////////////
 	static memory_size_type memory_usage(stream_size_type n, float b=default_blocksize);
@@ -119,6 +135,20 @@ public:
     /////////////////////////////////////////////////////////
     void push(const T& x);
 
+    /////////////////////////////////////////////////////////
+    ///
+    /// Insert a batch of elements into the priority queue
+    ///
+    /// Whenever the batch holds at least a full insertion buffer
+    /// of elements, those are sorted and written directly to a
+    /// new group 0 slot instead of going through the insertion
+    /// buffer one at a time.
+    ///
+    /// \param items The elements to insert
+    ///
+    /////////////////////////////////////////////////////////
+    void push_batch(array_view<const T> items);
+
     /////////////////////////////////////////////////////////
     ///
     /// Remove the top element from the priority queue
@@ -166,6 +196,37 @@ public:
     /////////////////////////////////////////////////////////
     template <typename F> F pop_equals(F f);
 
+    /////////////////////////////////////////////////////////
+    ///
+    /// Pop all elements less than the given threshold in the
+    /// specified ordering, in order, writing them to out.
+    ///
+    /// Runs of elements in the deletion buffer are copied out
+    /// in one go.
+    ///
+    /// \param threshold Elements not less than this are kept
+    /// \param out Output iterator receiving the elements
+    ///
+    /// \return The output iterator past the last element written
+    ///
+    /////////////////////////////////////////////////////////
+    template <typename OutputIterator>
+    OutputIterator pop_until(const T & threshold, OutputIterator out);
+
+    /////////////////////////////////////////////////////////
+    ///
+    /// Pop the n top elements (or all, if there are fewer),
+    /// in order, writing them to out.
+    ///
+    /// \param n Number of elements to pop
+    /// \param out Output iterator receiving the elements
+    ///
+    /// \return The output iterator past the last element written
+    ///
+    /////////////////////////////////////////////////////////
+    template <typename OutputIterator>
+    OutputIterator pop_batch(stream_size_type n, OutputIterator out);
+
 private:
     Comparator comp_;
     T dummy;
@@ -193,6 +254,14 @@ private:
 	 * Its data is in data file index slot_state[3*i+2]. */
 	tpie::array<memory_size_type> slot_state;
 
+	/** Compression of slot files. */
+	compression_flags m_compression;
+
+	/** For compressed slots, the stream position of the first element of
+	 * each slot that has been partially read (slot_start > 0), since
+	 * compressed streams cannot seek to an offset. */
+	tpie::array<stream_position> slot_position;
+
 	/** 2*(#groups) integers. Group buffer i has its elements in cyclic ascending order,
 	 * starting at index group_state[2*i]. Gbuffer i contains group_state[2*i+1] elements. */
 	tpie::array<memory_size_type> group_state;
@@ -233,6 +302,12 @@ private:
     temp_file & group_data(group_type groupid);
     memory_size_type slot_max_size(slot_type slotid);
     void write_slot(slot_type slotid, T* arr, memory_size_type len);
+    void open_slot_read(file_stream<T> & stream, slot_type slotid);
+    void open_slot_write(file_stream<T> & stream, slot_type slotid);
+    void save_slot_position(file_stream<T> & stream, slot_type slotid);
+    void write_run(slot_type slotid, memory_size_type len);
+    template <typename OutputIterator>
+    OutputIterator pop_bulk(const T * threshold, stream_size_type n, OutputIterator out);
     slot_type free_slot(group_type group);
     void empty_group(group_type group);
     void fill_buffer();
@@ -17,9 +17,9 @@
 // You should have received a copy of the GNU Lesser General Public License
 // along with TPIE.  If not, see <http://www.gnu.org/licenses/>
 
-template<typename T, typename Comparator, typename OPQType>
-priority_queue<T, Comparator, OPQType>::priority_queue(double f, float b, stream_size_type n) :
-block_factor(b) { // constructor mem fraction
+template<typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+priority_queue<T, Comparator, OPQType, merge_heap_t>::priority_queue(double f, float b, stream_size_type n, compression_flags compressionFlags) :
+m_compression(compressionFlags), block_factor(b) { // constructor mem fraction
 	assert(f<= 1.0 && f > 0);
 	assert(b > 0.0);
 	memory_size_type mm_avail = consecutive_memory_available();
@@ -31,9 +31,9 @@ block_factor(b) { // constructor mem fraction
 }
 
 #ifndef DOXYGEN
-template<typename T, typename Comparator, typename OPQType>
-priority_queue<T, Comparator, OPQType>::priority_queue(memory_size_type mm_avail, float b, stream_size_type n) :
-block_factor(b) { // constructor absolute mem
+template<typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+priority_queue<T, Comparator, OPQType, merge_heap_t>::priority_queue(memory_size_type mm_avail, float b, stream_size_type n, compression_flags compressionFlags) :
+m_compression(compressionFlags), block_factor(b) { // constructor absolute mem
 	assert(mm_avail <= get_memory_manager().limit() && mm_avail > 0);
 	assert(b > 0.0);
 	TP_LOG_DEBUG("priority_queue: Memory limit: " 
@@ -44,8 +44,8 @@ block_factor(b) { // constructor absolute mem
 #endif
 
 
-template<typename T, typename Comparator, typename OPQType>
-memory_size_type priority_queue<T, Comparator, OPQType>::memory_usage(stream_size_type n, float) {
+template<typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+memory_size_type priority_queue<T, Comparator, OPQType, merge_heap_t>::memory_usage(stream_size_type n, float) {
 	if ( std::numeric_limits<memory_size_type>::max() / sizeof(T) < n)
 		return std::numeric_limits<memory_size_type>::max();
 
@@ -53,8 +53,8 @@ memory_size_type priority_queue<T, Comparator, OPQType>::memory_usage(stream_siz
 }
 
 
-template<typename T, typename Comparator, typename OPQType>
-void priority_queue<T, Comparator, OPQType>::init(memory_size_type mm_avail, stream_size_type n) { // init
+template<typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+void priority_queue<T, Comparator, OPQType, merge_heap_t>::init(memory_size_type mm_avail, stream_size_type n) { // init
 #ifdef _WIN32
 #ifndef _WIN64
 	mm_avail = std::min(mm_avail, static_cast<memory_size_type>(1024*1024*512));
@@ -88,7 +88,8 @@ void priority_queue<T, Comparator, OPQType>::init(memory_size_type mm_avail, str
 		const memory_size_type fanout_overhead = 2*sizeof(stream_size_type)// group state
 			+ (usage+sizeof(file_stream<T>*)+alloc_overhead) //temporary streams
 			+ (sizeof(T)+sizeof(group_type)); //mergeheap
-		const memory_size_type sq_fanout_overhead = 3*sizeof(stream_size_type); //slot_state
+		const memory_size_type sq_fanout_overhead = 3*sizeof(stream_size_type) //slot_state
+			+ (m_compression == compression_none ? 0 : sizeof(stream_position)); //slot_position
 		const memory_size_type heap_m_overhead = sizeof(T) //opg
 			+ sizeof(T) //gbuffer0
 			+ sizeof(T) //extra buffer for remove_group_buffer
@@ -200,6 +201,9 @@ void priority_queue<T, Comparator, OPQType>::init(memory_size_type mm_avail, str
 
 	// state arrays contain: start + size
 	slot_state.resize(setting_k*setting_k*3);
+	if(m_compression != compression_none) {
+		slot_position.resize(setting_k*setting_k);
+	}
 	group_state.resize(setting_k*2);
 
 	buffer.resize(setting_mmark);
@@ -226,8 +230,8 @@ void priority_queue<T, Comparator, OPQType>::init(memory_size_type mm_avail, str
 				 << get_memory_manager().available() << "b" << "\n");
 }
 
-template <typename T, typename Comparator, typename OPQType>
-priority_queue<T, Comparator, OPQType>::~priority_queue() { // destructor
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+priority_queue<T, Comparator, OPQType, merge_heap_t>::~priority_queue() { // destructor
 	datafiles.resize(0); // unlink slots
 	groupdatafiles.resize(0); // unlink groups 
 
@@ -236,74 +240,19 @@ priority_queue<T, Comparator, OPQType>::~priority_queue() { // destructor
 	mergebuffer.resize(0);
 }
 
-template <typename T, typename Comparator, typename OPQType>
-void priority_queue<T, Comparator, OPQType>::push(const T& x) {
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+void priority_queue<T, Comparator, OPQType, merge_heap_t>::push(const T& x) {
 
 	if(opq->full()) {
 		// When the overflow priority queue (aka. insertion buffer) is full,
 		// insert its contents into a new slot in group 0.
-		//
-		// To maintain the heap invariant
-		//     deletion buffer <= group buffer 0 <= group 0 slots
-		// we bubble lesser elements from insertion buffer down into
-		// deletion buffer and group buffer 0.
 
 		slot_type slot = free_slot(0); // (if group 0 is full, we recursively empty group i
 		                               // by merging it into a slot in group i+1)
 
 		assert(opq->sorted_size() == setting_m);
-		T* arr = opq->sorted_array();
-
-		// Bubble lesser elements down into deletion buffer
-		if(buffer_size > 0) {
-
-			// fetch insertion buffer
-			memcpy(&mergebuffer[0], &arr[0], sizeof(T)*opq->sorted_size());
-
-			// fetch deletion buffer
-			memcpy(&mergebuffer[opq->sorted_size()], &buffer[buffer_start], sizeof(T)*buffer_size);
-
-			// sort buffer elements
-			std::sort(mergebuffer.get(), mergebuffer.get()+(buffer_size+opq->sorted_size()), comp_);
-
-			// smaller elements go in deletion buffer
-			memcpy(buffer.get()+buffer_start, mergebuffer.get(), sizeof(T)*buffer_size);
-
-			// larger elements go in insertion buffer
-			memcpy(&arr[0], mergebuffer.get()+buffer_size, sizeof(T)*opq->sorted_size());
-		}
-
-		// Bubble lesser elements down into group buffer 0
-		if(group_size(0)> 0) {
-
-			// Merge insertion buffer and group buffer 0
-			assert(group_size(0)+opq->sorted_size() <= setting_m*2);
-			memory_size_type j = 0;
-
-			// fetch gbuffer0
-			for(stream_size_type i = group_start(0); i < group_start(0)+group_size(0); i++) {
-				mergebuffer[j] = gbuffer0[static_cast<memory_size_type>(i%setting_m)];
-				++j;
-			}
-
-			// fetch insertion buffer
-			memcpy(&mergebuffer[j], &arr[0], sizeof(T)*opq->sorted_size());
-
-			// sort
-			std::sort(mergebuffer.get(), mergebuffer.get()+(group_size(0)+opq->sorted_size()), comp_);
-
-			// smaller elements go in gbuffer0
-			memcpy(gbuffer0.get(), mergebuffer.get(), static_cast<size_t>(sizeof(T)*group_size(0)));
-			group_start_set(0,0);
-
-			// larger elements go in insertion buffer (actually a free group 0 slot)
-			memcpy(&arr[0], &mergebuffer[group_size(0)], sizeof(T)*opq->sorted_size());
-		}
-
-		// move insertion buffer (which has elements larger than all of
-		// gbuffer0 and deletion buffer) into a free group 0 slot
-
-		write_slot(slot, arr, opq->sorted_size());
+		memcpy(mergebuffer.get(), opq->sorted_array(), sizeof(T)*opq->sorted_size());
+		write_run(slot, opq->sorted_size());
 		opq->sorted_pop();
 
 		// insertion buffer is now empty
@@ -318,8 +267,29 @@ void priority_queue<T, Comparator, OPQType>::push(const T& x) {
 #endif
 }
 
-template <typename T, typename Comparator, typename OPQType>
-void priority_queue<T, Comparator, OPQType>::pop() {
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+void priority_queue<T, Comparator, OPQType, merge_heap_t>::push_batch(array_view<const T> items) {
+	memory_size_type i = 0;
+	// Full runs go straight to slots in group 0 through mergebuffer, which
+	// is only released within the operations that empty or fill groups.
+	while(items.size() - i >= setting_m) {
+		slot_type slot = free_slot(0);
+		memcpy(mergebuffer.get(), &items[i], sizeof(T)*setting_m);
+		std::sort(mergebuffer.get(), mergebuffer.get()+setting_m, comp_);
+		write_run(slot, setting_m);
+		i += setting_m;
+		m_size += setting_m;
+	}
+	for(; i < items.size(); i++) {
+		push(items[i]);
+	}
+#ifndef NDEBUG
+	validate();
+#endif
+}
+
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+void priority_queue<T, Comparator, OPQType, merge_heap_t>::pop() {
 	if(empty()) {
 		throw priority_queue_error("pop() invoked on empty priority queue");
 	}
@@ -344,8 +314,8 @@ void priority_queue<T, Comparator, OPQType>::pop() {
 #endif
 }
 
-template <typename T, typename Comparator, typename OPQType>
-const T& priority_queue<T, Comparator, OPQType>::top() {
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+const T& priority_queue<T, Comparator, OPQType, merge_heap_t>::top() {
 	// If the deletion buffer is empty, refill it with elements from the group buffers
 	if(buffer_size == 0 && opq->size() != m_size) {
 		fill_buffer();
@@ -372,18 +342,18 @@ const T& priority_queue<T, Comparator, OPQType>::top() {
 	return min;
 }
 
-template <typename T, typename Comparator, typename OPQType>
-stream_size_type priority_queue<T, Comparator, OPQType>::size() const {
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+stream_size_type priority_queue<T, Comparator, OPQType, merge_heap_t>::size() const {
 	return m_size;
 }
 
-template <typename T, typename Comparator, typename OPQType>
-bool priority_queue<T, Comparator, OPQType>::empty() const {
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+bool priority_queue<T, Comparator, OPQType, merge_heap_t>::empty() const {
 	return m_size == 0;
 }
 
-template <typename T, typename Comparator, typename OPQType> template <typename F>
-F priority_queue<T, Comparator, OPQType>::pop_equals(F f) {
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t> template <typename F>
+F priority_queue<T, Comparator, OPQType, merge_heap_t>::pop_equals(F f) {
 	T a = top();
 	f(a);
 	pop();
@@ -398,8 +368,18 @@ F priority_queue<T, Comparator, OPQType>::pop_equals(F f) {
 	return f;
 }
 
-template <typename T, typename Comparator, typename OPQType>
-void priority_queue<T, Comparator, OPQType>::dump() {
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t> template <typename OutputIterator>
+OutputIterator priority_queue<T, Comparator, OPQType, merge_heap_t>::pop_until(const T & threshold, OutputIterator out) {
+	return pop_bulk(&threshold, std::numeric_limits<stream_size_type>::max(), out);
+}
+
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t> template <typename OutputIterator>
+OutputIterator priority_queue<T, Comparator, OPQType, merge_heap_t>::pop_batch(stream_size_type n, OutputIterator out) {
+	return pop_bulk(0, n, out);
+}
+
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+void priority_queue<T, Comparator, OPQType, merge_heap_t>::dump() {
 	TP_LOG_DEBUG( "--------------------------------------------------------------" << "\n"
 			<< "DUMP:\tTotal size: "
 			<< m_size << ", OPQ size: "
@@ -464,12 +444,22 @@ void priority_queue<T, Comparator, OPQType>::dump() {
 					<< " start: " << slot_start(j) << "):");
 
 			file_stream<T> instream(block_factor);
-			instream.open(slot_data(j));
 			stream_size_type k;
-			for(k = 0; k < slot_start(j)+slot_size(j); k++) {
-				TP_LOG_DEBUG((k>=slot_start(j)?"":"(") <<
-						instream.read() <<
-						(k>=slot_start(j)?"":")") << " ");
+			if(m_compression == compression_none) {
+				instream.open(slot_data(j));
+				for(k = 0; k < slot_start(j)+slot_size(j); k++) {
+					TP_LOG_DEBUG((k>=slot_start(j)?"":"(") <<
+							instream.read() <<
+							(k>=slot_start(j)?"":")") << " ");
+				}
+			} else {
+				// compressed slots cannot be read from an item offset, so
+				// only the items from the saved slot position are shown
+				if(slot_size(j) > 0) open_slot_read(instream, j);
+				for(k = 0; k < slot_size(j); k++) {
+					TP_LOG_DEBUG(instream.read() << " ");
+				}
+				k += slot_start(j);
 			}
 			for(stream_size_type l = k; l < slot_max_size(j); l++) {
 				TP_LOG_DEBUG("() ");
@@ -488,9 +478,9 @@ void priority_queue<T, Comparator, OPQType>::dump() {
 // Find a free slot in given group.
 // If the group is full, call empty_group,
 // which calls remove_group_buffer, which calls free_slot(0)
-template <typename T, typename Comparator, typename OPQType>
-typename priority_queue<T, Comparator, OPQType>::slot_type
-priority_queue<T, Comparator, OPQType>::free_slot(group_type group) {
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+typename priority_queue<T, Comparator, OPQType, merge_heap_t>::slot_type
+priority_queue<T, Comparator, OPQType, merge_heap_t>::free_slot(group_type group) {
 
 	slot_type i;
 	if(group>=setting_k) {
@@ -523,8 +513,8 @@ priority_queue<T, Comparator, OPQType>::free_slot(group_type group) {
 	return i;
 }
 
-template <typename T, typename Comparator, typename OPQType>
-void priority_queue<T, Comparator, OPQType>::fill_buffer() {
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+void priority_queue<T, Comparator, OPQType, merge_heap_t>::fill_buffer() {
 	if(buffer_size !=0) {
 		return;
 	}
@@ -550,7 +540,7 @@ void priority_queue<T, Comparator, OPQType>::fill_buffer() {
 #endif
 
 	{
-	pq_merge_heap<T, Comparator> heap(current_r);
+	pq_merge_heap<T, Comparator, merge_heap_t> heap(current_r);
 
 	tpie::array<tpie::unique_ptr<file_stream<T> > > data(current_r);
 	for(memory_size_type i = 0; i<current_r; i++) {
@@ -595,8 +585,8 @@ void priority_queue<T, Comparator, OPQType>::fill_buffer() {
 	mergebuffer.resize(setting_m*2);
 }
 
-template <typename T, typename Comparator, typename OPQType>
-void priority_queue<T, Comparator, OPQType>::fill_group_buffer(group_type group) {
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+void priority_queue<T, Comparator, OPQType, merge_heap_t>::fill_group_buffer(group_type group) {
 	assert(group_size(group) < static_cast<stream_size_type>(setting_mmark));
 	// max k + 1 open streams
 	// 1 merge heap
@@ -623,7 +613,7 @@ void priority_queue<T, Comparator, OPQType>::fill_group_buffer(group_type group)
 		}
 
 		//merge heap for the setting_k slots
-		pq_merge_heap<T, Comparator> heap(setting_k);
+		pq_merge_heap<T, Comparator, merge_heap_t> heap(setting_k);
 
 		//Create streams for the non-empty slots and initialize
 		//internal heap with one element per slot
@@ -633,12 +623,9 @@ void priority_queue<T, Comparator, OPQType>::fill_group_buffer(group_type group)
 			data[i].reset(tpie_new<file_stream<T> >(block_factor));
 
 			if(slot_size(group*setting_k+i)>0) {
-				//slot is non-empry, opening stream
+				//slot is non-empry, opening stream at start of slot
 				slot_type slotid = group*setting_k+i;
-				data[i]->open(slot_data(slotid));
-
-				//seek to start of slot
-				data[i]->seek(slot_start(slotid));
+				open_slot_read(*data[i], slotid);
 
 				//push first item of slot on the stream
 				heap.push(data[i]->read(), slotid);
@@ -677,6 +664,12 @@ void priority_queue<T, Comparator, OPQType>::fill_group_buffer(group_type group)
 			}
 		}
 
+		// remember where the remaining slots continue
+		for(memory_size_type i = 0; i<setting_k; i++) {
+			if(slot_size(group*setting_k+i) > 0) {
+				save_slot_position(*data[i], group*setting_k+i);
+			}
+		}
 	}
 
 	//restore mergebuffer
@@ -694,8 +687,8 @@ void priority_queue<T, Comparator, OPQType>::fill_group_buffer(group_type group)
 // Opens old streams       : setting_k * sizeof(file_stream<T>)
 // Reallocates mergebuffer : +2*setting_m
 // (no net heap usage since 2*setting_m > temporary heap usage)
-template <typename T, typename Comparator, typename OPQType>
-void priority_queue<T, Comparator, OPQType>::empty_group(group_type group) {
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+void priority_queue<T, Comparator, OPQType, merge_heap_t>::empty_group(group_type group) {
 	if(group > setting_k) {
 		TP_LOG_FATAL_ID("Error: Priority queue is full");
 		throw exception("Priority queue is full");
@@ -725,20 +718,19 @@ void priority_queue<T, Comparator, OPQType>::empty_group(group_type group) {
 	{
 
 		file_stream<T> newstream(block_factor);
-		newstream.open(slot_data(newslot));
-		pq_merge_heap<T, Comparator> heap(setting_k);
+		open_slot_write(newstream, newslot);
+		pq_merge_heap<T, Comparator, merge_heap_t> heap(setting_k);
 
 		// Open streams to slots in group `group', push top element to merge heap
 		tpie::array<tpie::unique_ptr<file_stream<T> > > data(setting_k);
 		for(memory_size_type i = 0; i<setting_k; i++) {
 			data[i].reset(tpie_new<file_stream<T> >(block_factor));
-			data[i]->open(slot_data(group*setting_k+i));
 			if(slot_size(group*setting_k+i) == 0) {
 				ret = true;
 				break;
 			}
 			assert(slot_size(group*setting_k+i)>0);
-			data[i]->seek(slot_start(group*setting_k+i));
+			open_slot_read(*data[i], group*setting_k+i);
 			heap.push(data[i]->read(), group*setting_k+i);
 		}
 
@@ -775,8 +767,8 @@ void priority_queue<T, Comparator, OPQType>::empty_group(group_type group) {
 	}
 }
 
-template <typename T, typename Comparator, typename OPQType>
-void priority_queue<T, Comparator, OPQType>::validate() {
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+void priority_queue<T, Comparator, OPQType, merge_heap_t>::validate() {
 #ifndef NDEBUG
 #ifdef PQ_VALIDATE
 	cout << "validate start" << "\n";
@@ -834,8 +826,7 @@ void priority_queue<T, Comparator, OPQType>::validate() {
 	for(stream_size_type i = 0; i < setting_k*setting_k; i++) { // slots
 		if(slot_size(i) > 0){
 			file_stream<T> stream;
-			stream.open(slot_data(i));
-			stream.seek(slot_start(i));
+			open_slot_read(stream, i);
 			T last = stream.read();
 			for(stream_size_type j = 1; j < slot_size(i); j++) {
 				T read = stream.read();
@@ -882,8 +873,7 @@ void priority_queue<T, Comparator, OPQType>::validate() {
 			for(stream_size_type j = i*setting_k; j<i*setting_k+setting_k;j++) {
 				if(slot_size(j) > 0) {
 					file_stream<T> stream;
-					stream.open(slot_data(j));
-					stream.seek(slot_start(j));
+					open_slot_read(stream, j);
 					T item_slot = stream.read();
 					
 					if(comp_(item_slot, item_group)) { // compare
@@ -906,8 +896,8 @@ void priority_queue<T, Comparator, OPQType>::validate() {
 // To maintain the invariant
 //     group buffer 0 elements <= group 0 slot elements,
 // merge the given group buffer with group buffer 0 before writing the slot out.
-template <typename T, typename Comparator, typename OPQType>
-void priority_queue<T, Comparator, OPQType>::remove_group_buffer(group_type group) {
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+void priority_queue<T, Comparator, OPQType, merge_heap_t>::remove_group_buffer(group_type group) {
 #ifndef NDEBUG
 	if(group == 0) {
 		TP_LOG_FATAL_ID("Attempt to remove group buffer 0");
@@ -963,76 +953,174 @@ void priority_queue<T, Comparator, OPQType>::remove_group_buffer(group_type grou
 
 //////////////////
 // TPIE wrappers
-template <typename T, typename Comparator, typename OPQType>
-void priority_queue<T, Comparator, OPQType>::slot_start_set(slot_type slot, memory_size_type n) {
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+void priority_queue<T, Comparator, OPQType, merge_heap_t>::slot_start_set(slot_type slot, memory_size_type n) {
 	slot_state[slot*3] = n;
 }
 
-template <typename T, typename Comparator, typename OPQType>
-memory_size_type priority_queue<T, Comparator, OPQType>::slot_start(slot_type slot) const {
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+memory_size_type priority_queue<T, Comparator, OPQType, merge_heap_t>::slot_start(slot_type slot) const {
 	return slot_state[slot*3];
 }
 
-template <typename T, typename Comparator, typename OPQType>
-void priority_queue<T, Comparator, OPQType>::slot_size_set(slot_type slot, memory_size_type n) {
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+void priority_queue<T, Comparator, OPQType, merge_heap_t>::slot_size_set(slot_type slot, memory_size_type n) {
 	assert(slot<setting_k*setting_k);
 	slot_state[slot*3+1] = n;
 }
 
-template <typename T, typename Comparator, typename OPQType>
-memory_size_type priority_queue<T, Comparator, OPQType>::slot_size(slot_type slot) const {
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+memory_size_type priority_queue<T, Comparator, OPQType, merge_heap_t>::slot_size(slot_type slot) const {
 	return slot_state[slot*3+1];
 }
 
-template <typename T, typename Comparator, typename OPQType>
-void priority_queue<T, Comparator, OPQType>::group_start_set(group_type group, memory_size_type n) {
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+void priority_queue<T, Comparator, OPQType, merge_heap_t>::group_start_set(group_type group, memory_size_type n) {
 	group_state[group*2] = n;
 }
 
-template <typename T, typename Comparator, typename OPQType>
-memory_size_type priority_queue<T, Comparator, OPQType>::group_start(group_type group) const {
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+memory_size_type priority_queue<T, Comparator, OPQType, merge_heap_t>::group_start(group_type group) const {
 	return group_state[group*2];
 }
 
-template <typename T, typename Comparator, typename OPQType>
-void priority_queue<T, Comparator, OPQType>::group_size_set(group_type group, memory_size_type n) {
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+void priority_queue<T, Comparator, OPQType, merge_heap_t>::group_size_set(group_type group, memory_size_type n) {
 	assert(group<setting_k);
 	group_state[group*2+1] = n;
 }
 
-template <typename T, typename Comparator, typename OPQType>
-memory_size_type priority_queue<T, Comparator, OPQType>::group_size(group_type group) const {
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+memory_size_type priority_queue<T, Comparator, OPQType, merge_heap_t>::group_size(group_type group) const {
 	return group_state[group*2+1];
 }
 
-template <typename T, typename Comparator, typename OPQType>
-temp_file & priority_queue<T, Comparator, OPQType>::slot_data(slot_type slotid) {
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+temp_file & priority_queue<T, Comparator, OPQType, merge_heap_t>::slot_data(slot_type slotid) {
 	return datafiles[slot_state[slotid*3+2]];
 }
 
-template <typename T, typename Comparator, typename OPQType>
-void priority_queue<T, Comparator, OPQType>::slot_data_set(slot_type slotid, memory_size_type n) {
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+void priority_queue<T, Comparator, OPQType, merge_heap_t>::slot_data_set(slot_type slotid, memory_size_type n) {
 	slot_state[slotid*3+2] = n;
 }
 
-template <typename T, typename Comparator, typename OPQType>
-temp_file & priority_queue<T, Comparator, OPQType>::group_data(group_type groupid) {
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+temp_file & priority_queue<T, Comparator, OPQType, merge_heap_t>::group_data(group_type groupid) {
 	return groupdatafiles[groupid];
 }
 
-template <typename T, typename Comparator, typename OPQType>
-memory_size_type priority_queue<T, Comparator, OPQType>::slot_max_size(slot_type slotid) {
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+memory_size_type priority_queue<T, Comparator, OPQType, merge_heap_t>::slot_max_size(slot_type slotid) {
 	// todo, too many casts
 	return setting_m
 		*static_cast<memory_size_type>(pow((long double)setting_k,
 										   (long double)(slotid/setting_k)));
 }
 
-template <typename T, typename Comparator, typename OPQType>
-void priority_queue<T, Comparator, OPQType>::write_slot(slot_type slotid, T* arr, memory_size_type len) {
+// Pop at most n elements less than *threshold (if given) to out.
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t> template <typename OutputIterator>
+OutputIterator priority_queue<T, Comparator, OPQType, merge_heap_t>::pop_bulk(const T * threshold, stream_size_type n, OutputIterator out) {
+	while(n > 0 && !empty()) {
+		const T & t = top();
+		if(threshold && !comp_(t, *threshold)) break;
+
+		if(!min_in_buffer) {
+			// Top element in insertion buffer
+			*out = t;
+			++out;
+			opq->pop();
+			m_size--;
+			n--;
+			continue;
+		}
+
+		// Top element in deletion buffer. All elements of the deletion buffer
+		// that precede both the threshold and the top of the insertion buffer
+		// can be popped at once.
+		T * first = buffer.get()+buffer_start;
+		T * last = first+static_cast<memory_size_type>(std::min<stream_size_type>(buffer_size, n));
+		if(threshold) last = std::lower_bound(first, last, *threshold, comp_);
+		if(opq->size() > 0) last = std::lower_bound(first, last, opq->top(), comp_);
+		assert(last != first);
+
+		memory_size_type count = static_cast<memory_size_type>(last-first);
+		out = std::copy(first, last, out);
+		buffer_size -= count;
+		buffer_start += count;
+		if(buffer_size == 0) {
+			buffer_start = 0;
+		}
+		m_size -= count;
+		n -= count;
+	}
+#ifndef NDEBUG
+	validate();
+#endif
+	return out;
+}
+
+// Write the sorted elements in mergebuffer[0, len) to the given free group 0
+// slot.
+//
+// To maintain the heap invariant
+//     deletion buffer <= group buffer 0 <= group 0 slots
+// we bubble lesser elements from the run down into deletion buffer and
+// group buffer 0.
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+void priority_queue<T, Comparator, OPQType, merge_heap_t>::write_run(slot_type slotid, memory_size_type len) {
+	assert(len <= setting_m);
+
+	// Bubble lesser elements down into deletion buffer
+	if(buffer_size > 0) {
+
+		// fetch deletion buffer
+		memcpy(&mergebuffer[len], &buffer[buffer_start], sizeof(T)*buffer_size);
+
+		// sort buffer elements
+		std::sort(mergebuffer.get(), mergebuffer.get()+(buffer_size+len), comp_);
+
+		// smaller elements go in deletion buffer
+		memcpy(buffer.get()+buffer_start, mergebuffer.get(), sizeof(T)*buffer_size);
+
+		// larger elements are the run
+		memmove(mergebuffer.get(), mergebuffer.get()+buffer_size, sizeof(T)*len);
+	}
+
+	// Bubble lesser elements down into group buffer 0
+	if(group_size(0)> 0) {
+
+		// Merge run and group buffer 0
+		assert(group_size(0)+len <= setting_m*2);
+		memory_size_type j = len;
+
+		// fetch gbuffer0
+		for(stream_size_type i = group_start(0); i < group_start(0)+group_size(0); i++) {
+			mergebuffer[j] = gbuffer0[static_cast<memory_size_type>(i%setting_m)];
+			++j;
+		}
+
+		// sort
+		std::sort(mergebuffer.get(), mergebuffer.get()+(group_size(0)+len), comp_);
+
+		// smaller elements go in gbuffer0
+		memcpy(gbuffer0.get(), mergebuffer.get(), static_cast<size_t>(sizeof(T)*group_size(0)));
+		group_start_set(0,0);
+
+		// larger elements are the run
+		memmove(mergebuffer.get(), &mergebuffer[group_size(0)], sizeof(T)*len);
+	}
+
+	// the run now has elements larger than all of gbuffer0 and
+	// deletion buffer
+	write_slot(slotid, mergebuffer.get(), len);
+}
+
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+void priority_queue<T, Comparator, OPQType, merge_heap_t>::write_slot(slot_type slotid, T* arr, memory_size_type len) {
 	assert(len > 0);
 	file_stream<T> data(block_factor);
-	data.open(slot_data(slotid));
+	open_slot_write(data, slotid);
 	data.write(arr+0, arr+len);
 	slot_start_set(slotid, 0);
 	slot_size_set(slotid, len);
@@ -1041,4 +1129,36 @@ void priority_queue<T, Comparator, OPQType>::write_slot(slot_type slotid, T* arr
 	}
 }
 
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+void priority_queue<T, Comparator, OPQType, merge_heap_t>::open_slot_read(file_stream<T> & stream, slot_type slotid) {
+	if(m_compression == compression_none) {
+		stream.open(slot_data(slotid));
+		stream.seek(slot_start(slotid));
+		return;
+	}
+	stream.open(slot_data(slotid), access_read);
+	if(slot_start(slotid) > 0) {
+		stream.set_position(slot_position[slotid]);
+	}
+}
+
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+void priority_queue<T, Comparator, OPQType, merge_heap_t>::open_slot_write(file_stream<T> & stream, slot_type slotid) {
+	if(m_compression == compression_none) {
+		stream.open(slot_data(slotid));
+		return;
+	}
+	// compressed streams only append, so the old slot contents are truncated
+	stream.open(slot_data(slotid), access_write, 0, access_sequential, m_compression);
+}
+
+template <typename T, typename Comparator, typename OPQType, typename merge_heap_t>
+void priority_queue<T, Comparator, OPQType, merge_heap_t>::save_slot_position(file_stream<T> & stream, slot_type slotid) {
+	if(m_compression == compression_none) return;
+	// the merge heap holds the item last read from the slot, which is the
+	// new first item of the slot
+	stream.read_back();
+	slot_position[slotid] = stream.get_position();
+}
+
 /////////////////////
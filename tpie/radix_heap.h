@@ -0,0 +1,291 @@
+// -*- mode: c++; tab-width: 4; indent-tabs-mode: t; eval: (progn (c-set-style "stroustrup") (c-set-offset 'innamespace 0)); -*-
+// vi:set ts=4 sts=4 sw=4 noet :
+// Copyright 2026, The TPIE development team
+//
+// This file is part of TPIE.
+//
+// TPIE is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// TPIE is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with TPIE.  If not, see <http://www.gnu.org/licenses/>
+
+///////////////////////////////////////////////////////////////////////////////
+/// \file radix_heap.h
+/// \brief External memory radix heap for monotone integer priorities.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TPIE_RADIX_HEAP_H
+#define TPIE_RADIX_HEAP_H
+
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <tpie/array.h>
+#include <tpie/exception.h>
+#include <tpie/file_stream.h>
+#include <tpie/tempname.h>
+#include <tpie/util.h>
+
+namespace tpie {
+
+namespace radix_heap_bits {
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Default key extractor: the item is its own key.
+///////////////////////////////////////////////////////////////////////////////
+struct identity_key {
+	template <typename T>
+	const T & operator()(const T & t) const noexcept {return t;}
+};
+
+} // namespace radix_heap_bits
+
+///////////////////////////////////////////////////////////////////////////////
+/// \class radix_heap
+/// \brief External memory radix heap, after Ahuja, Mehlhorn, Orlin and
+/// Tarjan, "Faster algorithms for the shortest path problem" (1990).
+///
+/// A monotone priority queue: the key of a pushed item must not be smaller
+/// than the key of the last item returned by top() or pop(). Time stamps in event simulation
+/// and distances in Dijkstra's algorithm with nonnegative integer weights
+/// have this property.
+///
+/// Items are kept in one bucket per bit of the key. An item whose key
+/// differs from the last popped key first in bit i is in bucket i+1, and
+/// items with the last popped key are in bucket 0. When bucket 0 runs
+/// empty, the lowest nonempty bucket is split into the buckets below it,
+/// so an item moves at most once per bit, and without any comparisons.
+///
+/// Every bucket has an in-memory buffer and spills to its own file when
+/// the buffer is full, so an item costs O(w/B) amortized I/Os for w-bit
+/// keys.
+///
+/// \tparam T The item type. Must be trivially copyable.
+/// \tparam key_extract_t Functor returning the unsigned integer key of an
+/// item.
+///////////////////////////////////////////////////////////////////////////////
+template <typename T, typename key_extract_t = radix_heap_bits::identity_key>
+class radix_heap {
+public:
+	typedef T item_type;
+	typedef typename std::decay<decltype(std::declval<key_extract_t>()(std::declval<const T &>()))>::type key_type;
+	static_assert(std::is_unsigned<key_type>::value, "radix_heap requires an unsigned integer key");
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Number of buckets: one for every bit of the key, and one for
+	/// the last popped key.
+	///////////////////////////////////////////////////////////////////////////
+	static const memory_size_type buckets = std::numeric_limits<key_type>::digits + 1;
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Construct an empty heap.
+	///
+	/// \param memory The number of bytes the heap may use.
+	/// \param blockFactor Block factor of the bucket files.
+	/// \param key Key extractor.
+	///////////////////////////////////////////////////////////////////////////
+	radix_heap(memory_size_type memory, double blockFactor = 1.0, key_extract_t key = key_extract_t())
+		: m_blockFactor(blockFactor)
+		, m_key(key)
+		, m_last(0)
+		, m_size(0)
+	{
+		m_bufferItems = buffer_items(memory, blockFactor);
+		if (m_bufferItems < minimum_buffer_items)
+			throw exception("radix_heap: Not enough memory");
+		m_buffers.resize(buckets * m_bufferItems);
+		m_bufferSize.resize(buckets, 0);
+		m_fileSize.resize(buckets, 0);
+		m_min.resize(buckets, std::numeric_limits<key_type>::max());
+		m_files.resize(buckets);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Return the number of bytes used by a heap whose buckets buffer
+	/// the given number of items.
+	///////////////////////////////////////////////////////////////////////////
+	static memory_size_type memory_usage(memory_size_type bufferItems, double blockFactor = 1.0) {
+		return sizeof(radix_heap)
+			+ streams * file_stream<T>::memory_usage(blockFactor)
+			+ array<T>::memory_usage(buckets * bufferItems)
+			+ 2 * array<memory_size_type>::memory_usage(buckets)
+			+ array<key_type>::memory_usage(buckets)
+			+ array<temp_file>::memory_usage(buckets);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Return the number of bytes used by this heap.
+	///////////////////////////////////////////////////////////////////////////
+	memory_size_type memory_usage() const {
+		return memory_usage(m_bufferItems, m_blockFactor);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Is the heap empty?
+	///////////////////////////////////////////////////////////////////////////
+	bool empty() const {return m_size == 0;}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Return the number of items in the heap.
+	///////////////////////////////////////////////////////////////////////////
+	stream_size_type size() const {return m_size;}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Insert an item. Its key must not be smaller than last_key().
+	///////////////////////////////////////////////////////////////////////////
+	void push(const T & x) {
+		key_type k = m_key(x);
+		if (k < m_last)
+			throw exception("radix_heap: Pushed key is smaller than the last key");
+		push_bucket(bucket(k), k, x);
+		++m_size;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Return an item with the smallest key.
+	///////////////////////////////////////////////////////////////////////////
+	const T & top() {
+		assert(!empty());
+		if (m_bufferSize[0] == 0) refill();
+		return m_buffers[m_bufferSize[0] - 1];
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Remove an item with the smallest key.
+	///////////////////////////////////////////////////////////////////////////
+	void pop() {
+		assert(!empty());
+		if (m_bufferSize[0] == 0) refill();
+		--m_bufferSize[0];
+		--m_size;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Return the key of the last item returned by top() or pop(),
+	/// which lower bounds the keys that may be pushed.
+	///////////////////////////////////////////////////////////////////////////
+	key_type last_key() const {return m_last;}
+
+private:
+	static const memory_size_type minimum_buffer_items = 16;
+
+	// At most two bucket files are open at a time, the one being split and
+	// the one being spilled to.
+	static const memory_size_type streams = 2;
+
+	static memory_size_type buffer_items(memory_size_type memory, double blockFactor) {
+		memory_size_type fixed = memory_usage(0, blockFactor);
+		if (memory <= fixed) return 0;
+		return (memory - fixed) / (buckets * sizeof(T));
+	}
+
+	// The number of significant bits of k ^ m_last.
+	memory_size_type bucket(key_type k) const {
+		key_type d = k ^ m_last;
+		if (d == 0) return 0;
+#ifdef __GNUC__
+		return static_cast<memory_size_type>(64 - __builtin_clzll(static_cast<unsigned long long>(d)));
+#else
+		memory_size_type b = 0;
+		while (d != 0) {
+			d >>= 1;
+			++b;
+		}
+		return b;
+#endif
+	}
+
+	T * buffer(memory_size_type b) {return m_buffers.get() + b * m_bufferItems;}
+
+	void push_bucket(memory_size_type b, key_type k, const T & x) {
+		if (m_bufferSize[b] == m_bufferItems) spill(b);
+		buffer(b)[m_bufferSize[b]++] = x;
+		if (k < m_min[b]) m_min[b] = k;
+	}
+
+	void spill(memory_size_type b) {
+		file_stream<T> out(m_blockFactor);
+		if (m_fileSize[b] == 0) {
+			out.open(m_files[b], access_write);
+		} else {
+			out.open(m_files[b], access_read_write);
+			out.seek(0, file_stream<T>::end);
+		}
+		out.write(buffer(b), buffer(b) + m_bufferSize[b]);
+		m_fileSize[b] += m_bufferSize[b];
+		m_bufferSize[b] = 0;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Make the buffer of bucket 0 nonempty.
+	///////////////////////////////////////////////////////////////////////////
+	void refill() {
+		if (m_fileSize[0] != 0) {
+			// All items of bucket 0 have the same key, so take any of them.
+			file_stream<T> in(m_blockFactor);
+			in.open(m_files[0], access_read_write);
+			in.seek(0, file_stream<T>::end);
+			memory_size_type n = static_cast<memory_size_type>(
+				std::min<stream_size_type>(m_fileSize[0], m_bufferItems));
+			T * to = buffer(0);
+			for (memory_size_type i = 0; i < n; ++i) to[i] = in.read_back();
+			in.truncate(in.get_position());
+			m_fileSize[0] -= n;
+			m_bufferSize[0] = n;
+			return;
+		}
+
+		memory_size_type b = 1;
+		while (m_bufferSize[b] == 0 && m_fileSize[b] == 0) ++b;
+		m_last = m_min[b];
+		m_min[b] = std::numeric_limits<key_type>::max();
+
+		// Every item of bucket b has a key that differs from the new last
+		// key below bit b-1, so it goes to a lower bucket.
+		memory_size_type n = m_bufferSize[b];
+		m_bufferSize[b] = 0;
+		const T * from = buffer(b);
+		for (memory_size_type i = 0; i < n; ++i) {
+			key_type k = m_key(from[i]);
+			push_bucket(bucket(k), k, from[i]);
+		}
+		if (m_fileSize[b] != 0) {
+			file_stream<T> in(m_blockFactor);
+			in.open(m_files[b], access_read);
+			while (in.can_read()) {
+				const T & x = in.read();
+				key_type k = m_key(x);
+				push_bucket(bucket(k), k, x);
+			}
+			m_fileSize[b] = 0;
+		}
+		m_min[0] = m_last;
+		assert(m_bufferSize[0] != 0);
+	}
+
+	double m_blockFactor;
+	key_extract_t m_key;
+	key_type m_last;
+	stream_size_type m_size;
+	memory_size_type m_bufferItems;
+
+	/** Bucket b buffers its items at [b*m_bufferItems, (b+1)*m_bufferItems). */
+	array<T> m_buffers;
+	array<memory_size_type> m_bufferSize;
+	array<stream_size_type> m_fileSize;
+	/** Smallest key in each bucket. */
+	array<key_type> m_min;
+	array<temp_file> m_files;
+};
+
+} // namespace tpie
+
+#endif // TPIE_RADIX_HEAP_H
@@ -0,0 +1,666 @@
+// -*- mode: c++; tab-width: 4; indent-tabs-mode: t; eval: (progn (c-set-style "stroustrup") (c-set-offset 'innamespace 0)); -*-
+// vi:set ts=4 sts=4 sw=4 noet :
+// Copyright 2026, The TPIE development team
+//
+// This file is part of TPIE.
+//
+// TPIE is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// TPIE is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with TPIE.  If not, see <http://www.gnu.org/licenses/>
+
+///////////////////////////////////////////////////////////////////////////////
+/// \file serialization_priority_queue.h
+/// \brief External memory priority queue for variable size items.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TPIE_SERIALIZATION_PRIORITY_QUEUE_H
+#define TPIE_SERIALIZATION_PRIORITY_QUEUE_H
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+#include <tpie/array.h>
+#include <tpie/exception.h>
+#include <tpie/file_manager.h>
+#include <tpie/memory.h>
+#include <tpie/serialization2.h>
+#include <tpie/serialization_stream.h>
+#include <tpie/tempname.h>
+#include <tpie/tpie_log.h>
+
+namespace tpie {
+
+///////////////////////////////////////////////////////////////////////////////
+/// \class serialization_priority_queue
+/// \brief External memory priority queue for serializable items of varying
+/// size, such as strings.
+///
+/// This is the structure of tpie::priority_queue, with runs and group
+/// buffers stored in serialization streams instead of file_streams: an
+/// insertion heap is written out as a sorted run to a slot in group 0 when
+/// it is full, and when all slots of a group are in use they are merged
+/// into one slot of the next group. Every group has a group buffer holding
+/// the smallest items of its slots, and a deletion buffer holds the
+/// smallest items of the group buffers.
+///
+/// Serialization streams are read sequentially, so instead of the cyclic
+/// group buffers of tpie::priority_queue a group buffer is written anew
+/// when it runs empty, and partially read slots and group buffers are
+/// resumed at the byte offset where reading stopped.
+///
+/// Memory is accounted as in serialization_sorter: an item is assumed to
+/// use sizeof(T) plus its serialized size in memory. Slots of the in-memory
+/// buffers that hold no item, such as unused vector capacity, count
+/// sizeof(T) bytes each. Every open
+/// serialization stream uses a block of
+/// serialization_reader::block_size() bytes, and at most fanout() + 1
+/// streams are open at a time.
+///
+/// \tparam T The item type. Must be serializable and default constructible.
+/// \tparam pred_t The item comparator; top() returns a least item.
+///////////////////////////////////////////////////////////////////////////////
+template <typename T, typename pred_t = std::less<T> >
+class serialization_priority_queue {
+public:
+	typedef T item_type;
+	typedef memory_size_type slot_type;
+	typedef memory_size_type group_type;
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Construct an empty queue.
+	///
+	/// \param memory The number of bytes the queue may use. Must be at least
+	/// minimum_memory().
+	/// \param pred Item comparator.
+	///////////////////////////////////////////////////////////////////////////
+	serialization_priority_queue(memory_size_type memory, pred_t pred = pred_t())
+		: m_pred(pred)
+		, m_size(0)
+		, m_groups(0)
+		, m_insertBytes(0)
+		, m_bufferStart(0)
+		, m_bufferBytes(0)
+		, m_group0Start(0)
+		, m_group0Bytes(0)
+	{
+		memory_size_type streams = (memory / 2) / stream_memory();
+		if (streams < minimum_streams)
+			throw exception("serialization_priority_queue: Not enough memory");
+		m_fanout = std::min(streams, max_fanout + 1) - 1;
+		// Don't open too many files
+		memory_size_type files = get_file_manager().available();
+		if (files == 0)
+			throw exception("serialization_priority_queue: No files available");
+		if (files <= m_fanout)
+			m_fanout = files - 1;
+		if (m_fanout < minimum_fanout)
+			throw exception("serialization_priority_queue: Not enough files available");
+		// fill_buffer() has a reader open for every group buffer but the
+		// first, so with one more group than streams it uses no more
+		// streams than the merges.
+		m_maxGroups = m_fanout + 2;
+
+		memory_size_type fixed = sizeof(serialization_priority_queue)
+			+ (m_fanout + 1) * stream_memory()
+			+ state_memory(m_fanout, m_maxGroups);
+		if (memory <= fixed)
+			throw exception("serialization_priority_queue: Not enough memory");
+
+		// The insertion heap, group buffer 0 and the deletion buffer are in
+		// memory at the same time. Another group buffer is read into memory
+		// when it is removed, and the rest is left for the merges.
+		memory_size_type unit = (memory - fixed) / 6;
+		m_runCapacity = 2 * unit;
+		m_groupCapacity = unit;
+		m_bufferCapacity = unit;
+
+		m_slotSize.resize(m_maxGroups * m_fanout, 0);
+		m_slotOffset.resize(m_maxGroups * m_fanout, 0);
+		m_slotFiles.resize(m_maxGroups * m_fanout);
+		m_groupSize.resize(m_maxGroups, 0);
+		m_groupOffset.resize(m_maxGroups, 0);
+		m_groupFiles.resize(m_maxGroups);
+
+		TP_LOG_DEBUG("serialization_priority_queue\n"
+					 << "\tfanout: " << m_fanout << "\n"
+					 << "\trun capacity: " << m_runCapacity << "b\n"
+					 << "\tgroup buffer capacity: " << m_groupCapacity << "b\n");
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Return the least amount of memory a queue can be constructed
+	/// with.
+	///////////////////////////////////////////////////////////////////////////
+	static memory_size_type minimum_memory() {
+		return 2 * minimum_streams * stream_memory();
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Insert an item.
+	///////////////////////////////////////////////////////////////////////////
+	void push(const T & x) {
+		memory_size_type bytes = item_bytes(x);
+		if (!m_insert.empty() && !fits(m_insert, m_insertBytes, bytes, m_runCapacity))
+			flush_insert();
+		reserve_push(m_insert, m_insertBytes, bytes, m_runCapacity);
+		m_insert.push_back(x);
+		std::push_heap(m_insert.begin(), m_insert.end(), heap_pred(m_pred));
+		m_insertBytes += bytes;
+		++m_size;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Return a least item. The queue must not be empty.
+	///
+	/// The reference is valid until the queue is modified.
+	///////////////////////////////////////////////////////////////////////////
+	const T & top() {
+		if (empty())
+			throw exception("serialization_priority_queue: top() invoked on empty queue");
+		if (min_in_buffer()) return m_buffer[m_bufferStart];
+		return m_insert.front();
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Remove a least item. The queue must not be empty.
+	///////////////////////////////////////////////////////////////////////////
+	void pop() {
+		if (empty())
+			throw exception("serialization_priority_queue: pop() invoked on empty queue");
+		if (min_in_buffer()) {
+			m_bufferBytes -= item_bytes(m_buffer[m_bufferStart]);
+			// Release the item now rather than when the buffer is refilled
+			m_buffer[m_bufferStart++] = T();
+			if (m_bufferStart == m_buffer.size()) {
+				m_buffer.clear();
+				m_bufferStart = 0;
+			}
+		} else {
+			m_insertBytes -= item_bytes(m_insert.front());
+			std::pop_heap(m_insert.begin(), m_insert.end(), heap_pred(m_pred));
+			m_insert.pop_back();
+		}
+		--m_size;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Return the number of items in the queue.
+	///////////////////////////////////////////////////////////////////////////
+	stream_size_type size() const {return m_size;}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Is the queue empty?
+	///////////////////////////////////////////////////////////////////////////
+	bool empty() const {return m_size == 0;}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Return the number of slots in a group, which is also the
+	/// number of runs merged at a time.
+	///////////////////////////////////////////////////////////////////////////
+	memory_size_type fanout() const {return m_fanout;}
+
+private:
+	typedef std::vector<T, allocator<T> > item_vector;
+
+	static const memory_size_type minimum_streams = 4;
+	static const memory_size_type minimum_fanout = 3;
+	// Performance degrades with more than around 250 open files
+	static const memory_size_type max_fanout = 250;
+
+	// Reverses the comparator so that the standard heap algorithms keep the
+	// least item at the front.
+	struct heap_pred {
+		pred_t pred;
+		heap_pred(const pred_t & pred) : pred(pred) {}
+		bool operator()(const T & a, const T & b) const {return pred(b, a);}
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Merge heap over the heads of a number of sorted streams.
+	///////////////////////////////////////////////////////////////////////////
+	class merge_heap {
+	public:
+		typedef std::pair<T, memory_size_type> entry;
+
+		merge_heap(const pred_t & pred) : m_pred(pred) {}
+
+		void push(T && x, memory_size_type run) {
+			m_entries.push_back(entry(std::move(x), run));
+			std::push_heap(m_entries.begin(), m_entries.end(), m_pred);
+		}
+
+		// Remove the top item, moving it to x.
+		memory_size_type pop(T & x) {
+			std::pop_heap(m_entries.begin(), m_entries.end(), m_pred);
+			x = std::move(m_entries.back().first);
+			memory_size_type run = m_entries.back().second;
+			m_entries.pop_back();
+			return run;
+		}
+
+		const T & top() const {return m_entries.front().first;}
+		bool empty() const {return m_entries.empty();}
+
+	private:
+		struct entry_pred {
+			pred_t pred;
+			entry_pred(const pred_t & pred) : pred(pred) {}
+			bool operator()(const entry & a, const entry & b) const {return pred(b.first, a.first);}
+		};
+
+		entry_pred m_pred;
+		std::vector<entry, allocator<entry> > m_entries;
+	};
+
+	typedef array<unique_ptr<serialization_reader> > reader_array;
+
+	static memory_size_type stream_memory() {
+		return std::max(serialization_reader::memory_usage(), serialization_writer::memory_usage());
+	}
+
+	static memory_size_type state_memory(memory_size_type fanout, memory_size_type groups) {
+		return 2 * array<stream_size_type>::memory_usage(groups * fanout)
+			+ array<temp_file>::memory_usage(groups * fanout)
+			+ 2 * array<stream_size_type>::memory_usage(groups)
+			+ array<temp_file>::memory_usage(groups)
+			+ reader_array::memory_usage(groups)
+			+ fanout * (sizeof(typename merge_heap::entry) + sizeof(serialization_reader));
+	}
+
+	static memory_size_type item_bytes(const T & x) {
+		return sizeof(T) + serialized_size(x);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Does an item of b bytes fit in a buffer holding items of the
+	/// given number of bytes, counting the unused capacity of the vector?
+	///
+	/// A full vector is assumed to grow by one slot; see reserve_push().
+	///////////////////////////////////////////////////////////////////////////
+	static bool fits(const item_vector & v, memory_size_type bytes,
+					 memory_size_type b, memory_size_type capacity) {
+		memory_size_type slots = std::max(v.capacity(), v.size() + 1);
+		return bytes + b + (slots - v.size() - 1) * sizeof(T) <= capacity;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Make room for pushing an item of b bytes to a full buffer.
+	///
+	/// The vector grows geometrically, but never by more unused slots than
+	/// the byte capacity has room for, so fits() stays accurate.
+	///////////////////////////////////////////////////////////////////////////
+	static void reserve_push(item_vector & v, memory_size_type bytes,
+							 memory_size_type b, memory_size_type capacity) {
+		if (v.size() < v.capacity()) return;
+		memory_size_type used = bytes + b;
+		memory_size_type room = used < capacity ? (capacity - used) / sizeof(T) : 0;
+		v.reserve(v.size() + 1 + std::min(v.size(), room));
+	}
+
+	static T read_item(serialization_reader & rd) {
+		T x;
+		rd.unserialize(x);
+		return x;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Refill the deletion buffer if needed, and report whether it
+	/// holds a least item.
+	///////////////////////////////////////////////////////////////////////////
+	bool min_in_buffer() {
+		if (m_buffer.empty() && m_insert.size() != m_size) fill_buffer();
+		if (m_buffer.empty()) return false;
+		if (m_insert.empty()) return true;
+		return !m_pred(m_insert.front(), m_buffer[m_bufferStart]);
+	}
+
+	memory_size_type group_size(group_type group) const {
+		if (group == 0) return m_group0.size() - m_group0Start;
+		return static_cast<memory_size_type>(m_groupSize[group]);
+	}
+
+	bool slots_empty(group_type group) const {
+		for (slot_type i = group * m_fanout; i < (group + 1) * m_fanout; ++i)
+			if (m_slotSize[i] != 0) return false;
+		return true;
+	}
+
+	void open_slot_read(serialization_reader & rd, slot_type slot) {
+		rd.open(m_slotFiles[slot]);
+		rd.seek(m_slotOffset[slot]);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Write the insertion heap as a run to a free slot in group 0.
+	///////////////////////////////////////////////////////////////////////////
+	void flush_insert() {
+		slot_type slot = free_slot(0);
+		item_vector run;
+		run.swap(m_insert);
+		m_insertBytes = 0;
+		std::sort_heap(run.begin(), run.end(), heap_pred(m_pred));
+		std::reverse(run.begin(), run.end());
+		write_run(slot, run);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Write the sorted items of run to the given free group 0 slot.
+	///
+	/// To maintain the heap invariant
+	///     deletion buffer <= group buffer 0 <= group 0 slots
+	/// lesser items of the run are bubbled down into the deletion buffer and
+	/// group buffer 0.
+	///////////////////////////////////////////////////////////////////////////
+	void write_run(slot_type slot, item_vector & run) {
+		bubble(m_buffer, m_bufferStart, m_bufferBytes, m_bufferCapacity, run);
+		bubble(m_group0, m_group0Start, m_group0Bytes, m_groupCapacity, run);
+		write_slot(slot, run);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Exchange items between a sorted buffer and a sorted run so that
+	/// no item in the run is less than an item in the buffer.
+	///
+	/// The buffer keeps at most as many items as before, and no more bytes
+	/// than its capacity; the rest go to the run.
+	///////////////////////////////////////////////////////////////////////////
+	void bubble(item_vector & buffer, memory_size_type & start, memory_size_type & bytes,
+				memory_size_type capacity, item_vector & run) {
+		if (start == buffer.size() || !m_pred(run.front(), buffer.back())) return;
+		memory_size_type n = buffer.size() - start;
+		item_vector merged;
+		merged.reserve(n + run.size());
+		std::merge(std::make_move_iterator(buffer.begin() + start), std::make_move_iterator(buffer.end()),
+				   std::make_move_iterator(run.begin()), std::make_move_iterator(run.end()),
+				   std::back_inserter(merged), m_pred);
+		buffer.clear();
+		run.clear();
+		start = 0;
+		bytes = 0;
+		// The cleared buffer keeps its capacity, and at most n <= capacity
+		// items are put back.
+		memory_size_type i = 0;
+		while (i < n
+			   && bytes + item_bytes(merged[i]) + (buffer.capacity() - i - 1) * sizeof(T) <= capacity)
+			bytes += item_bytes(merged[i++]);
+		buffer.assign(std::make_move_iterator(merged.begin()), std::make_move_iterator(merged.begin() + i));
+		run.assign(std::make_move_iterator(merged.begin() + i), std::make_move_iterator(merged.end()));
+	}
+
+	void write_slot(slot_type slot, item_vector & run) {
+		assert(!run.empty());
+		serialization_writer wr;
+		wr.open(m_slotFiles[slot]);
+		for (memory_size_type i = 0; i < run.size(); ++i) wr.serialize(run[i]);
+		wr.close();
+		m_slotSize[slot] = run.size();
+		m_slotOffset[slot] = 0;
+		item_vector().swap(run);
+		if (m_groups == 0) m_groups = 1;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Return a free slot in the given group. If the group is full,
+	/// it is emptied by merging its slots into a slot of the next group.
+	///////////////////////////////////////////////////////////////////////////
+	slot_type free_slot(group_type group) {
+		if (group >= m_maxGroups)
+			throw exception("serialization_priority_queue: Queue is full. Increase memory.");
+		for (slot_type i = group * m_fanout; i < (group + 1) * m_fanout; ++i)
+			if (m_slotSize[i] == 0) return i;
+
+		empty_group(group);
+
+		if (m_slotSize[group * m_fanout] != 0) {
+			return free_slot(group); // some group buffers might have been moved
+		}
+		return group * m_fanout;
+	}
+
+	void empty_group(group_type group) {
+		slot_type newslot = free_slot(group + 1);
+		assert(m_slotSize[newslot] == 0);
+		if (m_groups < group + 2) m_groups = group + 2;
+
+		// Finding the new slot may have moved a group buffer into group 0
+		// and so freed a slot in this group; then there is nothing to do.
+		bool ret = false;
+		{
+			merge_heap heap(m_pred);
+			reader_array data(m_fanout);
+			for (memory_size_type i = 0; i < m_fanout; ++i) {
+				slot_type slot = group * m_fanout + i;
+				if (m_slotSize[slot] == 0) {
+					ret = true;
+					break;
+				}
+				data[i].reset(tpie_new<serialization_reader>());
+				open_slot_read(*data[i], slot);
+				heap.push(read_item(*data[i]), i);
+			}
+			if (!ret) {
+				serialization_writer wr;
+				wr.open(m_slotFiles[newslot]);
+				stream_size_type written = 0;
+				T x;
+				while (!heap.empty()) {
+					memory_size_type i = heap.pop(x);
+					wr.serialize(x);
+					++written;
+					if (--m_slotSize[group * m_fanout + i] != 0)
+						heap.push(read_item(*data[i]), i);
+				}
+				wr.close();
+				m_slotSize[newslot] = written;
+				m_slotOffset[newslot] = 0;
+			}
+		}
+
+		if (!ret && group_size(group + 1) > 0) {
+			// Maintain heap invariant:
+			//     group buffer i <= group i slots
+			// The new slot may have items that are less than items in group
+			// buffer [group+1], so remove that group buffer.
+			remove_group_buffer(group + 1);
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Move the items of a group buffer into a slot in group 0.
+	///////////////////////////////////////////////////////////////////////////
+	void remove_group_buffer(group_type group) {
+		assert(group != 0);
+		slot_type slot = free_slot(0);
+		if (group_size(group) == 0) return;
+
+		item_vector run;
+		run.reserve(group_size(group));
+		{
+			serialization_reader rd;
+			rd.open(m_groupFiles[group]);
+			rd.seek(m_groupOffset[group]);
+			for (memory_size_type i = group_size(group); i > 0; --i)
+				run.push_back(read_item(rd));
+		}
+		m_groupSize[group] = 0;
+		m_groupOffset[group] = 0;
+		write_run(slot, run);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Refill the empty group buffer of the given group by merging
+	/// its slots.
+	///////////////////////////////////////////////////////////////////////////
+	void fill_group_buffer(group_type group) {
+		assert(group_size(group) == 0);
+		merge_heap heap(m_pred);
+		reader_array data(m_fanout);
+		for (memory_size_type i = 0; i < m_fanout; ++i) {
+			slot_type slot = group * m_fanout + i;
+			if (m_slotSize[slot] == 0) continue;
+			data[i].reset(tpie_new<serialization_reader>());
+			open_slot_read(*data[i], slot);
+			heap.push(read_item(*data[i]), i);
+		}
+
+		// Group buffer 0 is kept in memory
+		serialization_writer wr;
+		if (group == 0) {
+			m_group0.clear();
+			m_group0Start = 0;
+		} else {
+			wr.open(m_groupFiles[group]);
+		}
+
+		memory_size_type count = 0;
+		memory_size_type bytes = 0;
+		T x;
+		while (!heap.empty()) {
+			memory_size_type b = item_bytes(heap.top());
+			if (count > 0) {
+				if (group == 0 ? !fits(m_group0, bytes, b, m_groupCapacity)
+					: bytes + b > m_groupCapacity) break;
+			}
+			if (group == 0) reserve_push(m_group0, bytes, b, m_groupCapacity);
+			memory_size_type i = heap.pop(x);
+			if (group == 0) m_group0.push_back(std::move(x));
+			else wr.serialize(x);
+			++count;
+			bytes += b;
+
+			slot_type slot = group * m_fanout + i;
+			--m_slotSize[slot];
+			// Remember where the slot continues before reading ahead
+			m_slotOffset[slot] = data[i]->offset();
+			if (m_slotSize[slot] != 0) heap.push(read_item(*data[i]), i);
+		}
+
+		if (group == 0) {
+			m_group0Bytes = bytes;
+		} else {
+			wr.close();
+			m_groupSize[group] = count;
+			m_groupOffset[group] = 0;
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Refill the empty deletion buffer by merging the group buffers.
+	///////////////////////////////////////////////////////////////////////////
+	void fill_buffer() {
+		assert(m_buffer.empty());
+		for (group_type i = 0; i < m_groups; ++i)
+			if (group_size(i) == 0 && !slots_empty(i)) fill_group_buffer(i);
+		while (m_groups > 0 && group_size(m_groups - 1) == 0 && slots_empty(m_groups - 1))
+			--m_groups;
+
+		merge_heap heap(m_pred);
+		reader_array data(m_groups);
+		for (group_type i = 0; i < m_groups; ++i) {
+			if (group_size(i) == 0) continue;
+			if (i == 0) {
+				heap.push(std::move(m_group0[m_group0Start]), 0);
+				continue;
+			}
+			data[i].reset(tpie_new<serialization_reader>());
+			data[i]->open(m_groupFiles[i]);
+			data[i]->seek(m_groupOffset[i]);
+			heap.push(read_item(*data[i]), i);
+		}
+
+		T x;
+		while (!heap.empty()) {
+			memory_size_type b = item_bytes(heap.top());
+			if (!m_buffer.empty() && !fits(m_buffer, m_bufferBytes, b, m_bufferCapacity)) {
+				// Put back the head of group buffer 0; the heads of the
+				// others are still in their files.
+				group_type i = heap.pop(x);
+				if (i == 0) m_group0[m_group0Start] = std::move(x);
+				break;
+			}
+			reserve_push(m_buffer, m_bufferBytes, b, m_bufferCapacity);
+			group_type i = heap.pop(x);
+			m_buffer.push_back(std::move(x));
+			m_bufferBytes += b;
+
+			if (i == 0) {
+				m_group0Bytes -= b;
+				++m_group0Start;
+				if (m_group0Start == m_group0.size()) {
+					m_group0.clear();
+					m_group0Start = 0;
+				}
+			} else {
+				--m_groupSize[i];
+				m_groupOffset[i] = data[i]->offset();
+			}
+
+			if (group_size(i) == 0) {
+				// The slots of the group may hold items that are less than
+				// the heads of the other group buffers.
+				if (!slots_empty(i)) break;
+			} else if (i == 0) {
+				heap.push(std::move(m_group0[m_group0Start]), 0);
+			} else {
+				heap.push(read_item(*data[i]), i);
+			}
+		}
+		// Return the heads of group buffer 0 still in the heap
+		while (!heap.empty()) {
+			group_type i = heap.pop(x);
+			if (i == 0) m_group0[m_group0Start] = std::move(x);
+		}
+	}
+
+	pred_t m_pred;
+	stream_size_type m_size;
+	memory_size_type m_fanout;
+	memory_size_type m_maxGroups;
+	/** Number of groups in use. */
+	memory_size_type m_groups;
+
+	/** Capacities in bytes of the insertion heap, group buffers and deletion
+	 * buffer. */
+	memory_size_type m_runCapacity;
+	memory_size_type m_groupCapacity;
+	memory_size_type m_bufferCapacity;
+
+	item_vector m_insert;
+	memory_size_type m_insertBytes;
+
+	/** Deletion buffer: sorted items from index m_bufferStart. */
+	item_vector m_buffer;
+	memory_size_type m_bufferStart;
+	memory_size_type m_bufferBytes;
+
+	/** Group buffer 0: sorted items from index m_group0Start. */
+	item_vector m_group0;
+	memory_size_type m_group0Start;
+	memory_size_type m_group0Bytes;
+
+	/** Number of items left in each slot, and the byte offset of the first
+	 * of them in the slot file. */
+	array<stream_size_type> m_slotSize;
+	array<stream_size_type> m_slotOffset;
+	array<temp_file> m_slotFiles;
+
+	/** The same for the group buffers of groups 1 and up. */
+	array<stream_size_type> m_groupSize;
+	array<stream_size_type> m_groupOffset;
+	array<temp_file> m_groupFiles;
+};
+
+} // namespace tpie
+
+#endif // TPIE_SERIALIZATION_PRIORITY_QUEUE_H
@@ -21,17 +21,21 @@
 #define TPIE_SERIALIZATION_SORTER_H
 
 #include <queue>
+#include <exception>
 #include <boost/filesystem.hpp>
 
 #include <tpie/array.h>
 #include <tpie/array_view.h>
+#include <tpie/job.h>
 #include <tpie/tempname.h>
 #include <tpie/tpie_log.h>
 #include <tpie/stats.h>
 #include <tpie/parallel_sort.h>
+#include <tpie/string_sort.h>
 
 #include <tpie/serialization2.h>
 #include <tpie/serialization_stream.h>
+#include <tpie/compressed/stream.h>
 
 #include <tpie/pipelining/node.h>
 
@@ -44,6 +48,8 @@ struct sort_parameters {
 	memory_size_type filesPhase1;
 	/** memory available while forming sorted runs. */
 	memory_size_type memoryPhase1;
+	/** Memory of each of the two run formation buffers. */
+	memory_size_type memoryRunBuffer;
 	/** files available while merging runs. */
 	memory_size_type filesPhase2;
 	/** Memory available while merging runs. */
@@ -56,17 +62,21 @@ struct sort_parameters {
 	memory_size_type minimumItemSize;
 	/** Directory in which temporary files are stored. */
 	std::string tempDir;
+	/** Compression of the run files. */
+	compression_flags compression;
 
 	void dump(std::ostream & out) const {
 		out << "Serialization merge sort parameters\n"
 			<< "Phase 1 files:               " << filesPhase1 << '\n'
 			<< "Phase 1 memory:              " << memoryPhase1 << '\n'
+			<< "Run buffer memory:           " << memoryRunBuffer << '\n'
 			<< "Phase 2 files:               " << filesPhase2 << '\n'
 			<< "Phase 2 memory:              " << memoryPhase2 << '\n'
 			<< "Phase 3 files:               " << filesPhase3 << '\n'
 			<< "Phase 3 memory:              " << memoryPhase3 << '\n'
 			<< "Minimum item size:           " << minimumItemSize << '\n'
-			<< "Temporary directory:         " << tempDir << '\n';
+			<< "Temporary directory:         " << tempDir << '\n'
+			<< "Run compression:             " << compression << '\n';
 	}
 };
 
@@ -85,41 +95,64 @@ void set_owner(memory_bucket_ref b, T & item) {
 template <typename T>
 void unset_owner(memory_bucket_ref /*b*/, T & /*item*/) {}
 
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Run formation buffer for the serialization sorter, holding the
+/// items as T objects.
+///
+/// If use_string_sort<T, pred_t> holds, runs are sorted with string_sort()
+/// rather than parallel_sort(), and a key reference per buffer slot is
+/// allocated up front along with the item buffer.
+///
+/// Several buffers may share the memory buckets; each buffer keeps track of
+/// its own share of the item bucket.
+///////////////////////////////////////////////////////////////////////////////
 template <typename T, typename pred_t>
 class internal_sort {
+	static const bool stringSort = use_string_sort<T, pred_t>::value;
+	static const memory_size_type keyRefSize = stringSort ? sizeof(string_sort_bits::key_ref) : 0;
+
 	array<T> m_buffer;
+	array<string_sort_bits::key_ref> m_keys;
 	memory_size_type m_items;
 	memory_size_type m_memForItems;
+	memory_size_type m_itemBytes;
 
 	memory_size_type m_largestItem;
 
 	pred_t m_pred;
 
 	bool m_full;
+	bool m_sorted;
 
 	memory_bucket_ref m_buffer_bucket;
 	memory_bucket_ref m_item_bucket;
 
 public:
-	internal_sort(memory_bucket_ref buffer_bucket, 
+	internal_sort(memory_bucket_ref buffer_bucket,
 				  memory_bucket_ref item_bucket,
 				  pred_t pred = pred_t())
 		: m_buffer(buffer_bucket)
+		, m_keys(buffer_bucket)
 		, m_items(0)
+		, m_itemBytes(0)
 		, m_largestItem(sizeof(T))
 		, m_pred(pred)
 		, m_full(false)
+		, m_sorted(true)
 		, m_buffer_bucket(buffer_bucket)
 		, m_item_bucket(item_bucket)
 	{
 	}
 
 	void begin(memory_size_type memAvail) {
-		m_buffer.resize(memAvail / sizeof(T) / 2);
+		m_buffer.resize(memAvail / (sizeof(T) + keyRefSize) / 2);
+		if (stringSort) m_keys.resize(m_buffer.size());
 		m_items = 0;
+		m_itemBytes = 0;
 		m_largestItem = sizeof(T);
 		m_full = false;
-		m_memForItems = memAvail - m_buffer_bucket->count;
+		m_sorted = true;
+		m_memForItems = memAvail - buffer_memory_usage();
 	}
 
 	///////////////////////////////////////////////////////////////////////////
@@ -138,16 +171,20 @@ public:
 
 		size_t oldSize = m_item_bucket->count;
 		set_owner(m_item_bucket, item);
+		memory_size_type itemSize = m_item_bucket->count - oldSize;
 
-		if (m_item_bucket->count > m_memForItems) {
+		if (m_itemBytes + itemSize > m_memForItems) {
 			unset_owner(m_item_bucket, item);
+			m_item_bucket->count = oldSize;
 			m_full = true;
 			return false;
 		}
 
-		m_largestItem = std::max(m_largestItem, m_item_bucket->count - oldSize);
+		m_itemBytes += itemSize;
+		m_largestItem = std::max(m_largestItem, itemSize);
 
 		m_buffer[m_items++] = item;
+		m_sorted = false;
 
 		return true;
 	}
@@ -163,7 +200,7 @@ public:
 	/// disk.
 	///////////////////////////////////////////////////////////////////////////
 	memory_size_type current_serialized_size() {
-		return m_item_bucket->count;
+		return m_itemBytes;
 	}
 
 	///////////////////////////////////////////////////////////////////////////
@@ -177,28 +214,52 @@ public:
 	/// calculations.
 	///////////////////////////////////////////////////////////////////////////
 	memory_size_type memory_usage() {
-		return m_buffer_bucket->count + m_item_bucket->count;
+		return buffer_memory_usage() + m_itemBytes;
 	}
 
 	bool can_shrink_buffer() {
 		return current_serialized_size() <= get_memory_manager().available();
 	}
 
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Shrink the buffer to the items in it. Must be called after
+	/// sort(); the buffer cannot be pushed to afterwards.
+	///////////////////////////////////////////////////////////////////////////
 	void shrink_buffer() {
-		array<T> newBuffer(array_view<const T>(begin(), end()));
+		array<T> newBuffer(array_view<const T>(m_buffer.get(), m_buffer.get() + m_items));
 		m_buffer.swap(newBuffer);
+		m_keys.resize(0);
 	}
 
 	void sort() {
-		parallel_sort(m_buffer.get(), m_buffer.get() + m_items, m_pred);
+		if (m_sorted) return;
+		sort(std::integral_constant<bool, stringSort>());
+		m_sorted = true;
 	}
 
-	const T * begin() const {
-		return m_buffer.get();
+	bool empty() const {
+		return m_items == 0;
 	}
 
-	const T * end() const {
-		return m_buffer.get() + m_items;
+	memory_size_type size() const {
+		return m_items;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief The ith item in sorted order. Must be called after sort().
+	///////////////////////////////////////////////////////////////////////////
+	T item(memory_size_type i) const {
+		return m_buffer[i];
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Write the items in sorted order to the open run writer of
+	/// files. Must be called after sort().
+	///////////////////////////////////////////////////////////////////////////
+	template <typename files_t>
+	void write_run(files_t & files) const {
+		for (memory_size_type i = 0; i < m_items; ++i)
+			files.write(m_buffer[i]);
 	}
 
 	///////////////////////////////////////////////////////////////////////////
@@ -207,6 +268,7 @@ public:
 	void free() {
 		reset();
 		m_buffer.resize(0);
+		m_keys.resize(0);
 	}
 
 	///////////////////////////////////////////////////////////////////////////
@@ -216,12 +278,463 @@ public:
 	void reset() {
 		for (size_t i = 0 ; i < m_items ; ++i)
 			unset_owner(m_item_bucket, m_buffer[i]);
-		m_item_bucket->count = 0;
+		m_item_bucket->count -= m_itemBytes;
+		m_itemBytes = 0;
 		m_items = 0;
 		m_full = false;
+		m_sorted = true;
+	}
+
+private:
+	memory_size_type buffer_memory_usage() const {
+		return m_buffer.size() * sizeof(T) + m_keys.size() * sizeof(string_sort_bits::key_ref);
+	}
+
+	void sort(std::false_type) {
+		parallel_sort(m_buffer.get(), m_buffer.get() + m_items, m_pred);
+	}
+
+	void sort(std::true_type) {
+		string_sort(m_buffer.get(), m_buffer.get() + m_items, m_keys.get());
 	}
 };
 
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Locate the string_key of an item in its serialized form.
+///
+/// Specialize this with enabled set to true for item types whose
+/// serialization contains the key bytes, providing
+///
+///     static void key(const char * item, const char *& data, size_t & size);
+///
+/// which, given the serialized item, returns the key stored within it.
+/// Such items are kept in serialized form during run formation; see
+/// arena_sort.
+///////////////////////////////////////////////////////////////////////////////
+template <typename T>
+struct serialized_string_key {
+	static const bool enabled = false;
+};
+
+template <>
+struct serialized_string_key<std::string> {
+	static const bool enabled = true;
+
+	// std::string serializes as its size followed by its characters.
+	static void key(const char * item, const char *& data, size_t & size) {
+		std::string::size_type n;
+		std::memcpy(&n, item, sizeof(n));
+		data = item + sizeof(n);
+		size = n;
+	}
+};
+
+template <typename T, typename pred_t>
+struct use_arena_sort : public std::integral_constant<bool,
+	use_string_sort<T, pred_t>::value && serialized_string_key<T>::enabled> {
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Run formation buffer for the serialization sorter, holding the
+/// items serialized back to back in one contiguous arena.
+///
+/// Pushing an item serializes it into the arena, so variable-length payloads
+/// need no allocation of their own. The keys are sorted with a multikey
+/// quicksort reading the key bytes directly from the arena, and a run is
+/// written by copying the serialized bytes in sorted order. Items are only
+/// unserialized again if the sorter reports internally.
+///
+/// Half of the memory goes to the arena, and half to the per-item key
+/// references and arena offsets, mirroring the split in internal_sort.
+///////////////////////////////////////////////////////////////////////////////
+template <typename T, typename pred_t>
+class arena_sort {
+	static const memory_size_type perItem =
+		sizeof(string_sort_bits::key_ref) + sizeof(memory_size_type);
+
+	array<char> m_arena;
+	memory_size_type m_arenaUsed;
+	array<string_sort_bits::key_ref> m_keys;
+	// Item i is serialized in [m_offsets[i], m_offsets[i+1]) of the arena.
+	array<memory_size_type> m_offsets;
+	memory_size_type m_items;
+
+	memory_size_type m_largestItem;
+
+	bool m_full;
+	bool m_sorted;
+
+	class arena_writer {
+		char * m_dest;
+	public:
+		arena_writer(char * dest) : m_dest(dest) {}
+
+		void write(const char * const s, const memory_size_type n) {
+			m_dest = std::copy(s, s + n, m_dest);
+		}
+	};
+
+	class arena_reader {
+		const char * m_src;
+	public:
+		arena_reader(const char * src) : m_src(src) {}
+
+		void read(char * const s, const memory_size_type n) {
+			std::copy(m_src, m_src + n, s);
+			m_src += n;
+		}
+	};
+
+public:
+	arena_sort(memory_bucket_ref buffer_bucket,
+			   memory_bucket_ref /*item_bucket*/,
+			   pred_t /*pred*/ = pred_t())
+		: m_arena(buffer_bucket)
+		, m_arenaUsed(0)
+		, m_keys(buffer_bucket)
+		, m_offsets(buffer_bucket)
+		, m_items(0)
+		, m_largestItem(sizeof(T))
+		, m_full(false)
+		, m_sorted(true)
+	{
+	}
+
+	void begin(memory_size_type memAvail) {
+		memory_size_type items = memAvail / perItem / 2;
+		m_keys.resize(items);
+		m_offsets.resize(items + 1);
+		m_arena.resize(memAvail - items * perItem - sizeof(memory_size_type));
+		m_arenaUsed = 0;
+		m_offsets[0] = 0;
+		m_items = 0;
+		m_largestItem = sizeof(T);
+		m_full = false;
+		m_sorted = true;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \copydoc internal_sort::push
+	///////////////////////////////////////////////////////////////////////////
+	bool push(const T & item) {
+		if (m_full) return false;
+
+		memory_size_type serSize = serialized_size(item);
+		if (m_items == m_keys.size() || m_arenaUsed + serSize > m_arena.size()) {
+			m_full = true;
+			return false;
+		}
+
+		arena_writer wr(m_arena.get() + m_arenaUsed);
+		serialize(wr, item);
+		m_arenaUsed += serSize;
+		m_offsets[++m_items] = m_arenaUsed;
+		m_largestItem = std::max(m_largestItem, sizeof(T) + serSize);
+		m_sorted = false;
+		return true;
+	}
+
+	memory_size_type get_largest_item_size() {
+		return m_largestItem;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief  Memory needed to hold the items after shrink_buffer().
+	///////////////////////////////////////////////////////////////////////////
+	memory_size_type current_serialized_size() {
+		return m_arenaUsed + m_items * perItem;
+	}
+
+	memory_size_type memory_usage() {
+		return m_arena.size() + m_keys.size() * sizeof(string_sort_bits::key_ref)
+			+ m_offsets.size() * sizeof(memory_size_type);
+	}
+
+	bool can_shrink_buffer() {
+		return current_serialized_size() <= get_memory_manager().available();
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \copydoc internal_sort::shrink_buffer
+	///////////////////////////////////////////////////////////////////////////
+	void shrink_buffer() {
+		array<char> newArena(array_view<const char>(m_arena.get(), m_arena.get() + m_arenaUsed));
+		for (memory_size_type i = 0; i < m_items; ++i) {
+			m_keys[i].key = reinterpret_cast<const unsigned char *>(newArena.get())
+				+ (m_keys[i].key - reinterpret_cast<const unsigned char *>(m_arena.get()));
+		}
+		m_arena.swap(newArena);
+		array<string_sort_bits::key_ref> newKeys(array_view<const string_sort_bits::key_ref>(m_keys.get(), m_keys.get() + m_items));
+		m_keys.swap(newKeys);
+		array<memory_size_type> newOffsets(array_view<const memory_size_type>(m_offsets.get(), m_offsets.get() + m_items + 1));
+		m_offsets.swap(newOffsets);
+	}
+
+	void sort() {
+		if (m_sorted) return;
+		for (memory_size_type i = 0; i < m_items; ++i) {
+			const char * data;
+			size_t size;
+			serialized_string_key<T>::key(m_arena.get() + m_offsets[i], data, size);
+			m_keys[i].key = reinterpret_cast<const unsigned char *>(data);
+			m_keys[i].length = size;
+			m_keys[i].index = i;
+		}
+		string_sort_bits::multikey_quicksort::sort(m_keys.get(), m_items);
+		m_sorted = true;
+	}
+
+	bool empty() const {
+		return m_items == 0;
+	}
+
+	memory_size_type size() const {
+		return m_items;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \copydoc internal_sort::item
+	///////////////////////////////////////////////////////////////////////////
+	T item(memory_size_type i) const {
+		T res;
+		arena_reader rd(m_arena.get() + m_offsets[m_keys[i].index]);
+		unserialize(rd, res);
+		return res;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \copydoc internal_sort::write_run
+	///////////////////////////////////////////////////////////////////////////
+	template <typename files_t>
+	void write_run(files_t & files) const {
+		for (memory_size_type i = 0; i < m_items; ++i) {
+			memory_size_type idx = m_keys[i].index;
+			files.write_bytes(m_arena.get() + m_offsets[idx], m_offsets[idx+1] - m_offsets[idx]);
+		}
+	}
+
+	void free() {
+		reset();
+		m_arena.resize(0);
+		m_keys.resize(0);
+		m_offsets.resize(0);
+	}
+
+	void reset() {
+		m_arenaUsed = 0;
+		m_items = 0;
+		m_full = false;
+		m_sorted = true;
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief The run formation buffer used for the given item type and
+/// predicate.
+///////////////////////////////////////////////////////////////////////////////
+template <typename T, typename pred_t>
+struct run_buffer {
+	typedef typename std::conditional<use_arena_sort<T, pred_t>::value,
+		arena_sort<T, pred_t>,
+		internal_sort<T, pred_t> >::type type;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief  Unit in which compressed run files store serialized bytes.
+///////////////////////////////////////////////////////////////////////////////
+struct run_chunk {
+	static const memory_size_type size = 512;
+	char data[size];
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief  Writer of a single run file.
+///
+/// With compression_none the run is a plain serialization stream. Otherwise
+/// the serialized bytes are packed into run_chunks and written to a
+/// file_stream, which compresses its blocks on the compressor thread. The
+/// number of serialized bytes is stored in the stream's user data, so the
+/// padding in the last chunk is never read back.
+///////////////////////////////////////////////////////////////////////////////
+class run_writer {
+public:
+	run_writer()
+		: m_compression(compression_none)
+		, m_index(0)
+		, m_bytes(0)
+	{
+	}
+
+	static memory_size_type memory_usage(compression_flags compression) {
+		if (compression == compression_none)
+			return serialization_writer::memory_usage();
+		return file_stream<run_chunk>::memory_usage() + sizeof(run_chunk);
+	}
+
+	void open(const std::string & path, compression_flags compression) {
+		m_compression = compression;
+		m_path = path;
+		if (m_compression == compression_none) {
+			m_writer.open(path);
+			return;
+		}
+		m_stream.open(path, access_read_write, sizeof(stream_size_type),
+					  access_sequential, m_compression);
+		m_index = 0;
+		m_bytes = 0;
+	}
+
+	void write(const char * const s, const memory_size_type n) {
+		if (m_compression == compression_none) {
+			serialization_writer::serializer(m_writer).write(s, n);
+			return;
+		}
+		const char * i = s;
+		memory_size_type written = 0;
+		while (written != n) {
+			if (m_index == run_chunk::size) write_chunk();
+			memory_size_type writeSize = std::min(n - written, run_chunk::size - m_index);
+			std::copy(i, i + writeSize, m_chunk.data + m_index);
+			i += writeSize;
+			written += writeSize;
+			m_index += writeSize;
+		}
+		m_bytes += n;
+	}
+
+	template <typename T>
+	void serialize(const T & v) {
+		using tpie::serialize;
+		serialize(*this, v);
+	}
+
+	void close() {
+		if (m_compression == compression_none) {
+			m_writer.close();
+			return;
+		}
+		if (m_index > 0) write_chunk();
+		m_stream.write_user_data(m_bytes);
+		m_stream.close();
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief  Size of the closed run file on disk.
+	///////////////////////////////////////////////////////////////////////////
+	stream_size_type file_size() {
+		if (m_compression == compression_none)
+			return m_writer.file_size();
+		return boost::filesystem::file_size(m_path);
+	}
+
+private:
+	void write_chunk() {
+		m_stream.write(m_chunk);
+		m_index = 0;
+	}
+
+	compression_flags m_compression;
+	std::string m_path;
+	serialization_writer m_writer;
+	file_stream<run_chunk> m_stream;
+	run_chunk m_chunk;
+	memory_size_type m_index;
+	stream_size_type m_bytes;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief  Reader of a single run file written by run_writer.
+///////////////////////////////////////////////////////////////////////////////
+class run_reader {
+public:
+	run_reader()
+		: m_compression(compression_none)
+		, m_index(0)
+		, m_bytes(0)
+		, m_bytesRead(0)
+	{
+	}
+
+	static memory_size_type memory_usage(compression_flags compression) {
+		if (compression == compression_none)
+			return serialization_reader::memory_usage();
+		return file_stream<run_chunk>::memory_usage() + sizeof(run_chunk);
+	}
+
+	void open(const std::string & path, compression_flags compression) {
+		m_compression = compression;
+		m_path = path;
+		if (m_compression == compression_none) {
+			m_reader.open(path);
+			return;
+		}
+		m_stream.open(path, access_read, sizeof(stream_size_type),
+					  access_sequential, m_compression);
+		m_stream.read_user_data(m_bytes);
+		m_index = run_chunk::size;
+		m_bytesRead = 0;
+	}
+
+	bool can_read() {
+		if (m_compression == compression_none)
+			return m_reader.can_read();
+		return m_bytesRead < m_bytes;
+	}
+
+	void read(char * const s, const memory_size_type n) {
+		if (m_compression == compression_none) {
+			m_reader.read(s, n);
+			return;
+		}
+		if (m_bytesRead + n > m_bytes) throw end_of_stream_exception();
+		char * i = s;
+		memory_size_type written = 0;
+		while (written != n) {
+			if (m_index == run_chunk::size) {
+				m_chunk = m_stream.read();
+				m_index = 0;
+			}
+			memory_size_type readSize = std::min(n - written, run_chunk::size - m_index);
+			i = std::copy(m_chunk.data + m_index, m_chunk.data + m_index + readSize, i);
+			written += readSize;
+			m_index += readSize;
+		}
+		m_bytesRead += n;
+	}
+
+	template <typename T>
+	void unserialize(T & v) {
+		using tpie::unserialize;
+		unserialize(*this, v);
+	}
+
+	void close() {
+		if (m_compression == compression_none)
+			m_reader.close();
+		else
+			m_stream.close();
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief  Size of the run file on disk.
+	///////////////////////////////////////////////////////////////////////////
+	stream_size_type file_size() {
+		if (m_compression == compression_none)
+			return m_reader.file_size();
+		return boost::filesystem::file_size(m_path);
+	}
+
+private:
+	compression_flags m_compression;
+	std::string m_path;
+	serialization_reader m_reader;
+	file_stream<run_chunk> m_stream;
+	run_chunk m_chunk;
+	memory_size_type m_index;
+	stream_size_type m_bytes;
+	stream_size_type m_bytesRead;
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 /// \brief  File handling for merge sort.
 ///
@@ -273,12 +786,12 @@ class file_handler {
 	bool m_writerOpen;
 	size_t m_readersOpen;
 
-	serialization_writer m_writer;
-	stream_size_type m_currentWriterByteSize;
+	run_writer m_writer;
 
-	array<serialization_reader> m_readers;
+	array<run_reader> m_readers;
 
 	std::string m_tempDir;
+	compression_flags m_compression;
 
 	std::string run_file(size_t physicalIndex) {
 		if (m_tempDir.size() == 0) throw exception("run_file: temp dir is the empty string");
@@ -297,7 +810,7 @@ public:
 		, m_readersOpen(0)
 
 		, m_writer()
-		, m_currentWriterByteSize(0)
+		, m_compression(compression_none)
 	{
 	}
 
@@ -311,10 +824,15 @@ public:
 		m_tempDir = tempDir;
 	}
 
+	void set_compression(compression_flags compression) {
+		if (m_nextFileOffset != 0)
+			throw exception("set_compression: trying to change compression after files already open");
+		m_compression = compression;
+	}
+
 	void open_new_writer() {
 		if (m_writerOpen) throw exception("open_new_writer: Writer already open");
-		m_writer.open(run_file(m_nextFileOffset++));
-		m_currentWriterByteSize = m_writer.file_size();
+		m_writer.open(run_file(m_nextFileOffset++), m_compression);
 		m_writerOpen = true;
 	}
 
@@ -323,6 +841,14 @@ public:
 		m_writer.serialize(v);
 	}
 
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Write an item that is already serialized.
+	///////////////////////////////////////////////////////////////////////////
+	void write_bytes(const char * const s, const memory_size_type n) {
+		if (!m_writerOpen) throw exception("write_bytes: No writer open");
+		m_writer.write(s, n);
+	}
+
 	void close_writer() {
 		if (!m_writerOpen) throw exception("close_writer: No writer open");
 		m_writer.close();
@@ -354,7 +880,7 @@ public:
 
 		if (m_readers.size() < fanout) m_readers.resize(fanout);
 		for (size_t i = 0; i < fanout; ++i) {
-			m_readers[i].open(run_file(m_fileOffset + i));
+			m_readers[i].open(run_file(m_fileOffset + i), m_compression);
 		}
 		m_readersOpen = fanout;
 	}
@@ -383,6 +909,7 @@ public:
 		}
 		m_fileOffset += m_readersOpen;
 		m_readersOpen = 0;
+		m_readers.resize(0);
 	}
 
 	void move_last_reader_to_next_level() {
@@ -404,10 +931,7 @@ public:
 		log_debug() << "Remove " << m_fileOffset << " through " << m_nextFileOffset << std::endl;
 		for (size_t i = m_fileOffset; i < m_nextFileOffset; ++i) {
 			std::string runFile = run_file(i);
-			serialization_reader rd;
-			rd.open(runFile);
-			decrease_usage(i, rd.file_size());
-			rd.close();
+			decrease_usage(i, boost::filesystem::file_size(runFile));
 			boost::filesystem::remove(runFile);
 		}
 		m_fileOffset = m_nextLevelFileOffset = m_nextFileOffset = 0;
@@ -445,7 +969,6 @@ class merger {
 
 	file_handler<T> & files;
 	pred_t pred;
-	std::vector<serialization_reader> rd;
 	typedef std::priority_queue<item_type, std::vector<item_type>, mergepred_t> priority_queue_type;
 	priority_queue_type pq;
 
@@ -459,7 +982,6 @@ public:
 
 	// Assume files.open_readers(fanout) has just been called
 	void init(size_t fanout) {
-		rd.resize(fanout);
 		for (size_t i = 0; i < fanout; ++i)
 			push_from(i);
 	}
@@ -484,7 +1006,6 @@ public:
 			priority_queue_type tmp(pred);
 			std::swap(pq, tmp);
 		}
-		rd.resize(0);
 	}
 
 private:
@@ -511,8 +1032,38 @@ private:
 	memory_bucket_ref m_item_bucket;
 	pipelining::node * m_owning_node;
 
+	typedef typename serialization_bits::run_buffer<T, pred_t>::type run_buffer_t;
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Writes the items of a sorted run buffer to the open run file.
+	///////////////////////////////////////////////////////////////////////////
+	class run_writer_job : public job {
+	public:
+		run_writer_job(serialization_bits::file_handler<T> & files)
+			: m_files(files), m_buffer(nullptr) {}
+
+		void operator()() override {
+			try {
+				m_buffer->write_run(m_files);
+			} catch (...) {
+				m_error = std::current_exception();
+			}
+		}
+
+		serialization_bits::file_handler<T> & m_files;
+		run_buffer_t * m_buffer;
+		std::exception_ptr m_error;
+	};
+
 	sorter_state m_state;
-	serialization_bits::internal_sort<T, pred_t> m_sorter;
+	// Runs are formed in two buffers. While one is being filled, the sorted
+	// contents of the other are written to disk by m_runWriter.
+	run_buffer_t m_runBuffer1;
+	run_buffer_t m_runBuffer2;
+	run_buffer_t * m_sorter;
+	run_buffer_t * m_spare;
+	run_writer_job m_runWriter;
+	bool m_writingRun;
 	serialization_bits::sort_parameters m_params;
 	bool m_parametersSet;
 	serialization_bits::file_handler<T> m_files;
@@ -520,7 +1071,7 @@ private:
 
 	stream_size_type m_items;
 	bool m_reportInternal;
-	const T * m_nextInternalItem;
+	memory_size_type m_nextInternalItem;
 
 	static const memory_size_type defaultFiles = 253; // Default number of files available, when not using set_available_files
 	static const memory_size_type minimumFilesPhase1 = 1;
@@ -540,7 +1091,12 @@ public:
 		, m_item_bucket(memory_bucket_ref(m_item_bucket_ptr.get()))
 		, m_owning_node(nullptr)
 		, m_state(state_initial)
-		, m_sorter(m_buffer_bucket, m_item_bucket, pred)
+		, m_runBuffer1(m_buffer_bucket, m_item_bucket, pred)
+		, m_runBuffer2(m_buffer_bucket, m_item_bucket, pred)
+		, m_sorter(&m_runBuffer1)
+		, m_spare(&m_runBuffer2)
+		, m_runWriter(m_files)
+		, m_writingRun(false)
 		, m_parametersSet(false)
 		, m_files()
 		, m_merger(m_files, pred)
@@ -552,9 +1108,15 @@ public:
 		m_params.filesPhase2 = 0;
 		m_params.filesPhase3 = 0;
 		m_params.memoryPhase1 = 0;
+		m_params.memoryRunBuffer = 0;
 		m_params.memoryPhase2 = 0;
 		m_params.memoryPhase3 = 0;
 		m_params.minimumItemSize = minimumItemSize;
+		m_params.compression = compression_none;
+	}
+
+	~serialization_sorter() {
+		if (m_writingRun) m_runWriter.join();
 	}
 
 private:
@@ -630,26 +1192,39 @@ public:
 		set_phase_3_memory(m3);
 	}
 
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Write and read run files with the given compression.
+	///
+	/// With compression_normal or compression_all, runs are stored in
+	/// compressed streams whose blocks are compressed on the compressor
+	/// thread. The default is compression_none.
+	///////////////////////////////////////////////////////////////////////////
+	void set_run_compression(compression_flags compression) {
+		check_not_started();
+		m_params.compression = compression;
+	}
+
+	// The minimum memory bounds hold regardless of run compression.
 	static memory_size_type minimum_memory_phase_1() {
-		return serialization_writer::memory_usage()*2;
+		return max_writer_memory_usage()*2;
 	}
 
 	static memory_size_type minimum_memory_phase_2() {
-		return serialization_writer::memory_usage()
-			+ 2*serialization_reader::memory_usage();
+		return max_writer_memory_usage()
+			+ 2*max_reader_memory_usage();
 	}
 
 	static memory_size_type minimum_memory_phase_3() {
-		return 2*serialization_reader::memory_usage();
+		return 2*max_reader_memory_usage();
 	}
 
 	memory_size_type actual_memory_phase_3() {
 		if (m_state != state_3)
 			throw tpie::exception("Bad state in actualy_memory_phase_3");
 		if (m_reportInternal)
-			return m_sorter.memory_usage();
+			return m_sorter->memory_usage();
 		else
-			return m_files.next_level_runs() * (m_sorter.get_largest_item_size() + serialization_reader::memory_usage());
+			return m_files.next_level_runs() * (m_sorter->get_largest_item_size() + reader_memory_usage());
 	}
 
 	void set_owner(pipelining::node * n) {
@@ -670,6 +1245,24 @@ private:
 		return std::max(lo, std::min(val, hi));
 	}
 
+	static memory_size_type max_writer_memory_usage() {
+		return std::max(serialization_bits::run_writer::memory_usage(compression_none),
+						serialization_bits::run_writer::memory_usage(compression_normal));
+	}
+
+	static memory_size_type max_reader_memory_usage() {
+		return std::max(serialization_bits::run_reader::memory_usage(compression_none),
+						serialization_bits::run_reader::memory_usage(compression_normal));
+	}
+
+	memory_size_type writer_memory_usage() const {
+		return serialization_bits::run_writer::memory_usage(m_params.compression);
+	}
+
+	memory_size_type reader_memory_usage() const {
+		return serialization_bits::run_reader::memory_usage(m_params.compression);
+	}
+
 	void calculate_parameters() {
 		if (m_state != state_initial)
 			throw tpie::exception("Bad state in calculate_parameters");
@@ -689,20 +1282,23 @@ private:
 			throw tpie::exception("file limit for phase 3 too small (" + std::to_string(m_params.filesPhase3) + " < " + std::to_string(minimumFilesPhase3) + ")");
 
 		memory_size_type memAvail1 = m_params.memoryPhase1;
-		if (memAvail1 <= serialization_writer::memory_usage()) {
+		if (memAvail1 <= writer_memory_usage()) {
 			log_error() << "Not enough memory for run formation; have " << memAvail1
-				<< " bytes but " << serialization_writer::memory_usage()
+				<< " bytes but " << writer_memory_usage()
 				<< " is required for writing a run." << std::endl;
 			throw exception("Not enough memory for run formation");
 		}
+		// One writer is open at a time, either for the run being written in
+		// the background or for a run written synchronously.
+		m_params.memoryRunBuffer = (memAvail1 - writer_memory_usage()) / 2;
 
 		memory_size_type memAvail2 = m_params.memoryPhase2;
 
 		// We have to keep a writer open no matter what.
-		if (memAvail2 <= serialization_writer::memory_usage()) {
+		if (memAvail2 <= writer_memory_usage()) {
 			log_error() << "Not enough memory for merging. "
 				<< "mem avail = " << memAvail2
-				<< ", writer usage = " << serialization_writer::memory_usage()
+				<< ", writer usage = " << writer_memory_usage()
 				<< std::endl;
 			throw exception("Not enough memory for merging.");
 		}
@@ -710,10 +1306,10 @@ private:
 		memory_size_type memAvail3 = m_params.memoryPhase3;
 
 		// We have to keep a writer open no matter what.
-		if (memAvail2 <= serialization_writer::memory_usage()) {
+		if (memAvail2 <= writer_memory_usage()) {
 			log_error() << "Not enough memory for outputting. "
 				<< "mem avail = " << memAvail3
-				<< ", writer usage = " << serialization_writer::memory_usage()
+				<< ", writer usage = " << writer_memory_usage()
 				<< std::endl;
 			throw exception("Not enough memory for outputting.");
 		}
@@ -725,10 +1321,10 @@ private:
 		// Instead, we assume that all items have minimum size.
 
 		// We have to keep a writer open no matter what.
-		memory_size_type fanoutMemory = memForMerge - serialization_writer::memory_usage();
+		memory_size_type fanoutMemory = memForMerge - writer_memory_usage();
 
 		// This is a lower bound on the memory used per fanout.
-		memory_size_type perFanout = m_params.minimumItemSize + serialization_reader::memory_usage();
+		memory_size_type perFanout = m_params.minimumItemSize + reader_memory_usage();
 
 		// Floored division to compute the largest possible fanout.
 		memory_size_type fanout = std::min(fanoutMemory / perFanout, m_params.filesPhase2 - 1);
@@ -743,6 +1339,7 @@ private:
 
 		m_params.tempDir = tempname::tpie_dir_name();
 		m_files.set_temp_dir(m_params.tempDir);
+		m_files.set_compression(m_params.compression);
 
 		log_debug() << "Calculated serialization_sorter parameters.\n";
 		m_params.dump(log_debug());
@@ -761,7 +1358,8 @@ public:
 
 		log_debug() << "Before begin; mem usage = "
 			<< get_memory_manager().used() << std::endl;
-		m_sorter.begin(m_params.memoryPhase1 - serialization_writer::memory_usage());
+		m_runBuffer1.begin(m_params.memoryRunBuffer);
+		m_runBuffer2.begin(m_params.memoryRunBuffer);
 		log_debug() << "After internal sorter begin; mem usage = "
 			<< get_memory_manager().used() << std::endl;
 		boost::filesystem::create_directory(m_params.tempDir);
@@ -773,9 +1371,9 @@ public:
 
 		++m_items;
 
-		if (m_sorter.push(item)) return;
-		end_run();
-		if (!m_sorter.push(item)) {
+		if (m_sorter->push(item)) return;
+		start_run();
+		if (!m_sorter->push(item)) {
 			throw exception("Couldn't fit a single item in buffer");
 		}
 	}
@@ -784,35 +1382,38 @@ public:
 		if (m_state != state_1)
 			throw tpie::exception("Bad state in end");
 
+		wait_for_run_writer();
+		m_spare->free();
+
 		memory_size_type internalThreshold =
 			std::min(m_params.memoryPhase2, m_params.memoryPhase3);
 
-		log_debug() << "m_sorter.memory_usage == " << m_sorter.memory_usage() << '\n'
+		log_debug() << "m_sorter->memory_usage == " << m_sorter->memory_usage() << '\n'
 			<< "internalThreshold == " << internalThreshold << std::endl;
 
 		if (m_items == 0) {
 			m_reportInternal = true;
 			m_nextInternalItem = 0;
-			m_sorter.free();
+			m_sorter->free();
 			log_debug() << "Got no items. Internal reporting mode." << std::endl;
 		} else if (m_files.next_level_runs() == 0
-			&& m_sorter.memory_usage()
+			&& m_sorter->memory_usage()
 			   <= internalThreshold) {
 
-			m_sorter.sort();
+			m_sorter->sort();
 			m_reportInternal = true;
-			m_nextInternalItem = m_sorter.begin();
-			log_debug() << "Got " << m_sorter.current_serialized_size()
+			m_nextInternalItem = 0;
+			log_debug() << "Got " << m_sorter->current_serialized_size()
 				<< " bytes of items. Internal reporting mode." << std::endl;
 		} else if (m_files.next_level_runs() == 0
-				   && m_sorter.current_serialized_size() <= internalThreshold
-				   && m_sorter.can_shrink_buffer()) {
+				   && m_sorter->current_serialized_size() <= internalThreshold
+				   && m_sorter->can_shrink_buffer()) {
 
-			m_sorter.sort();
-			m_sorter.shrink_buffer();
+			m_sorter->sort();
+			m_sorter->shrink_buffer();
 			m_reportInternal = true;
-			m_nextInternalItem = m_sorter.begin();
-			log_debug() << "Got " << m_sorter.current_serialized_size()
+			m_nextInternalItem = 0;
+			log_debug() << "Got " << m_sorter->current_serialized_size()
 				<< " bytes of items. Internal reporting mode after shrinking buffer." << std::endl;
 
 		} else {
@@ -820,7 +1421,7 @@ public:
 			end_run();
 			log_debug() << "Got " << m_files.next_level_runs() << " runs. "
 				<< "External reporting mode." << std::endl;
-			m_sorter.free();
+			m_sorter->free();
 			m_reportInternal = false;
 		}
 
@@ -844,7 +1445,7 @@ public:
 			case state_3:
 				if (m_reportInternal) {
 					end_run();
-					m_sorter.free();
+					m_sorter->free();
 					m_reportInternal = false;
 					log_debug() << "Evacuate out of internal reporting mode." << std::endl;
 				} else {
@@ -864,9 +1465,9 @@ public:
 			throw tpie::exception("Bad state in end");
 		if (m_reportInternal) return true;
 
-		memory_size_type largestItem = m_sorter.get_largest_item_size();
-		memory_size_type fanoutMemory = m_params.memoryPhase2 - serialization_writer::memory_usage();
-		memory_size_type perFanout = largestItem + serialization_reader::memory_usage();
+		memory_size_type largestItem = m_sorter->get_largest_item_size();
+		memory_size_type fanoutMemory = m_params.memoryPhase2 - writer_memory_usage();
+		memory_size_type perFanout = largestItem + reader_memory_usage();
 		memory_size_type fanout = std::min(m_params.filesPhase2 - 1, fanoutMemory / perFanout);
 		
 		memory_size_type finalFanoutMemory = m_params.memoryPhase3;
@@ -886,20 +1487,20 @@ public:
 			return;
 		}
 
-		memory_size_type largestItem = m_sorter.get_largest_item_size();
+		memory_size_type largestItem = m_sorter->get_largest_item_size();
 		if (largestItem == 0) {
 			log_warning() << "Largest item is 0 bytes; doing nothing." << std::endl;
 			m_state = state_3;
 			return;
 		}
 
-		if (m_params.memoryPhase2 <= serialization_writer::memory_usage())
+		if (m_params.memoryPhase2 <= writer_memory_usage())
 			throw exception("Not enough memory for merging.");
 
 		// Perform almost the same computation as in calculate_parameters.
 		// Only change the item size to largestItem rather than minimumItemSize.
-		memory_size_type fanoutMemory = m_params.memoryPhase2 - serialization_writer::memory_usage();
-		memory_size_type perFanout = largestItem + serialization_reader::memory_usage();
+		memory_size_type fanoutMemory = m_params.memoryPhase2 - writer_memory_usage();
+		memory_size_type perFanout = largestItem + reader_memory_usage();
 		memory_size_type fanout = std::min(fanoutMemory / perFanout, m_params.filesPhase2 - 1);
 
 		if (fanout < 2) {
@@ -947,14 +1548,56 @@ public:
 
 private:
 	void end_run() {
-		m_sorter.sort();
-		if (m_sorter.begin() == m_sorter.end()) return;
+		m_sorter->sort();
+		if (m_sorter->empty()) return;
+		m_files.open_new_writer();
+		m_sorter->write_run(m_files);
+		m_files.close_writer();
+		m_sorter->reset();
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Sort the full run buffer and write it to disk in the
+	/// background while the other buffer is filled.
+	///
+	/// Only the writing of items happens in a job; sorting, opening and
+	/// closing the run file and logging stay on the calling thread.
+	///////////////////////////////////////////////////////////////////////////
+	void start_run() {
+		wait_for_run_writer();
+		m_sorter->sort();
+		if (m_sorter->empty()) return;
 		m_files.open_new_writer();
-		for (const T * item = m_sorter.begin(); item != m_sorter.end(); ++item) {
-			m_files.write(*item);
+		m_runWriter.m_buffer = m_sorter;
+		m_writingRun = true;
+		m_runWriter.enqueue();
+		std::swap(m_sorter, m_spare);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Wait for the run started by start_run(), if any, to be
+	/// written, and close it.
+	///
+	/// If the background write failed, the run file is closed before the
+	/// error is rethrown so that the file handler is left without an open
+	/// writer; the partial run is removed along with the other run files.
+	///////////////////////////////////////////////////////////////////////////
+	void wait_for_run_writer() {
+		if (!m_writingRun) return;
+		m_runWriter.join();
+		m_writingRun = false;
+		m_spare->reset();
+		if (m_runWriter.m_error) {
+			std::exception_ptr e = m_runWriter.m_error;
+			m_runWriter.m_error = nullptr;
+			try {
+				m_files.close_writer();
+			} catch (...) {
+				// Report the original error rather than the failed close.
+			}
+			std::rethrow_exception(e);
 		}
 		m_files.close_writer();
-		m_sorter.reset();
 	}
 
 	void initialize_merger(size_t fanout) {
@@ -992,9 +1635,9 @@ public:
 			throw exception("pull: !can_pull");
 
 		if (m_reportInternal) {
-			T item = *m_nextInternalItem++;
-			if (m_nextInternalItem == m_sorter.end()) {
-				m_sorter.free();
+			T item = m_sorter->item(m_nextInternalItem++);
+			if (m_nextInternalItem == m_sorter->size()) {
+				m_sorter->free();
 				m_nextInternalItem = 0;
 			}
 			return item;
@@ -1018,7 +1661,7 @@ public:
 	}
 
 	bool can_pull() {
-		if (m_reportInternal) return m_nextInternalItem != 0;
+		if (m_reportInternal) return m_nextInternalItem < m_sorter->size();
 		if (!m_files.readers_open()) return m_files.next_level_runs() > 0;
 		return !m_merger.empty();
 	}
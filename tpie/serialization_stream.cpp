@@ -380,6 +380,22 @@ stream_size_type serialization_reader::offset() {
 	return m_blockNumber * block_size() + m_index;
 }
 
+void serialization_reader::seek(stream_size_type offset) {
+	if (offset > m_size) throw end_of_stream_exception();
+	if (offset == 0) {
+		// As after open(): the first read loads block 0.
+		m_blockNumber = 0;
+		m_index = 0;
+		m_blockSize = 0;
+		return;
+	}
+	// Position at the end of the previous block when the offset is on a
+	// block boundary, so that the next read loads the following block.
+	m_blockNumber = (offset - 1) / block_size();
+	read_block(m_blockNumber);
+	m_index = static_cast<memory_size_type>(offset - m_blockNumber * block_size());
+}
+
 void serialization_reverse_reader::next_block() /*override*/ {
 	if (m_blockNumber == 0)
 		throw end_of_stream_exception();
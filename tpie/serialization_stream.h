@@ -379,6 +379,15 @@ public:
 	/// For progress reporting.
 	///////////////////////////////////////////////////////////////////////////
 	stream_size_type offset();
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Continue reading at the given offset, which must be a value
+	/// previously returned by offset(), or size().
+	///
+	/// The offset of an item is only known after reading the item before it,
+	/// so this is for resuming a partially read stream.
+	///////////////////////////////////////////////////////////////////////////
+	void seek(stream_size_type offset);
 };
 
 class serialization_reverse_reader : public bits::serialization_reader_base {
@@ -0,0 +1,297 @@
+// -*- mode: c++; tab-width: 4; indent-tabs-mode: t; eval: (progn (c-set-style "stroustrup") (c-set-offset 'innamespace 0)); -*-
+// vi:set ts=4 sts=4 sw=4 noet :
+// Copyright 2026, The TPIE development team
+//
+// This file is part of TPIE.
+//
+// TPIE is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// TPIE is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with TPIE.  If not, see <http://www.gnu.org/licenses/>
+
+///////////////////////////////////////////////////////////////////////////////
+/// \file string_sort.h
+/// Multikey quicksort for items ordered by a byte-string key.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TPIE_STRING_SORT_H
+#define TPIE_STRING_SORT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <tpie/array.h>
+
+namespace tpie {
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Byte-string key of an item type.
+///
+/// Specialize this for item types that are ordered by a contiguous byte
+/// string (a URL, a path, ...). A specialization must set enabled to true and
+/// provide
+///
+///     static const char * data(const T &);
+///     static size_t size(const T &);
+///
+/// Keys are compared as sequences of unsigned bytes, and a key that is a
+/// proper prefix of another key is smaller.
+///////////////////////////////////////////////////////////////////////////////
+template <typename T>
+struct string_key {
+	static const bool enabled = false;
+};
+
+template <>
+struct string_key<std::string> {
+	static const bool enabled = true;
+	static const char * data(const std::string & s) { return s.data(); }
+	static size_t size(const std::string & s) { return s.size(); }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Less-than predicate ordering items by their string_key.
+///
+/// Using this predicate with serialization_sorter selects the multikey
+/// quicksort for run formation.
+///////////////////////////////////////////////////////////////////////////////
+template <typename T>
+struct string_key_less {
+	bool operator()(const T & a, const T & b) const {
+		size_t la = string_key<T>::size(a);
+		size_t lb = string_key<T>::size(b);
+		int c = std::memcmp(string_key<T>::data(a), string_key<T>::data(b), std::min(la, lb));
+		return c < 0 || (c == 0 && la < lb);
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief True if items of type T sorted by pred_t may be sorted with
+/// string_sort().
+///
+/// This is the case for string_key_less<T>, and for std::less<std::string>
+/// since std::string compares its characters as unsigned bytes.
+///////////////////////////////////////////////////////////////////////////////
+template <typename T, typename pred_t>
+struct use_string_sort : public std::integral_constant<bool,
+	string_key<T>::enabled
+	&& (std::is_same<pred_t, string_key_less<T> >::value
+		|| (std::is_same<T, std::string>::value
+			&& std::is_same<pred_t, std::less<T> >::value))> {
+};
+
+namespace string_sort_bits {
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Reference to the key of an item being sorted.
+///
+/// The eight key bytes starting at the current depth are cached big-endian
+/// in prefix, so most comparisons are a single integer comparison and do not
+/// touch the key itself.
+///////////////////////////////////////////////////////////////////////////////
+struct key_ref {
+	std::uint64_t prefix;
+	const unsigned char * key;
+	size_t length;
+	size_t index;
+};
+
+class multikey_quicksort {
+public:
+	/** Bytes of key cached in key_ref::prefix. */
+	static const size_t chunk = sizeof(std::uint64_t);
+
+	/** Segments smaller than this are insertion sorted. */
+	static const size_t insertionThreshold = 16;
+
+	static void sort(key_ref * a, size_t n) {
+		for (size_t i = 0; i < n; ++i) load_prefix(a[i], 0);
+		sort(a, n, 0);
+	}
+
+private:
+	static void load_prefix(key_ref & r, size_t depth) {
+		std::uint64_t p = 0;
+		size_t end = std::min(r.length, depth + chunk);
+		size_t i = depth;
+		for (; i < end; ++i) p = (p << 8) | r.key[i];
+		for (; i < depth + chunk; ++i) p <<= 8;
+		r.prefix = p;
+	}
+
+	// Number of key bytes covered by the prefix at the given depth.
+	static size_t chunk_length(const key_ref & r, size_t depth) {
+		return std::min(r.length - depth, chunk);
+	}
+
+	// Three-way comparison of the cached prefixes. If the prefixes are
+	// equal but one key ends inside the chunk, the shorter key is a prefix of
+	// the longer (the remainder is zero padding on one side) and is smaller.
+	static int compare_chunk(const key_ref & a, const key_ref & b, size_t depth) {
+		if (a.prefix != b.prefix) return a.prefix < b.prefix ? -1 : 1;
+		size_t la = chunk_length(a, depth);
+		size_t lb = chunk_length(b, depth);
+		if (la != lb) return la < lb ? -1 : 1;
+		return 0;
+	}
+
+	// Full comparison of two keys known to be equal before depth.
+	static bool less(const key_ref & a, const key_ref & b, size_t depth) {
+		int c = compare_chunk(a, b, depth);
+		if (c != 0) return c < 0;
+		size_t la = a.length > depth + chunk ? a.length - depth - chunk : 0;
+		size_t lb = b.length > depth + chunk ? b.length - depth - chunk : 0;
+		c = std::memcmp(a.key + depth + chunk, b.key + depth + chunk, std::min(la, lb));
+		return c < 0 || (c == 0 && la < lb);
+	}
+
+	static void insertion_sort(key_ref * a, size_t n, size_t depth) {
+		for (size_t i = 1; i < n; ++i) {
+			key_ref x = a[i];
+			size_t j = i;
+			while (j > 0 && less(x, a[j-1], depth)) {
+				a[j] = a[j-1];
+				--j;
+			}
+			a[j] = x;
+		}
+	}
+
+	static size_t median(key_ref * a, size_t i, size_t j, size_t k, size_t depth) {
+		if (compare_chunk(a[i], a[j], depth) < 0) {
+			if (compare_chunk(a[j], a[k], depth) < 0) return j;
+			return compare_chunk(a[i], a[k], depth) < 0 ? k : i;
+		} else {
+			if (compare_chunk(a[i], a[k], depth) < 0) return i;
+			return compare_chunk(a[j], a[k], depth) < 0 ? k : j;
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	/// \brief Sort n keys that are known to be equal in the first depth bytes
+	/// and whose prefixes are loaded for the given depth.
+	///
+	/// Partitions three ways on the cached chunk. The equal part continues at
+	/// the next depth. The largest of the three parts is handled by the loop
+	/// so the recursion depth stays logarithmic.
+	///////////////////////////////////////////////////////////////////////////
+	static void sort(key_ref * a, size_t n, size_t depth) {
+		while (n >= insertionThreshold) {
+			size_t step = n / 8;
+			size_t m = median(a, median(a, 0, step, 2*step, depth),
+							  median(a, 3*step, 4*step, 5*step, depth),
+							  median(a, 6*step, 7*step, n-1, depth), depth);
+			key_ref pivot = a[m];
+
+			// Dutch national flag partition: [0, lt) less, [lt, i) equal,
+			// [gt, n) greater.
+			size_t lt = 0, i = 0, gt = n;
+			while (i < gt) {
+				int c = compare_chunk(a[i], pivot, depth);
+				if (c < 0) std::swap(a[lt++], a[i++]);
+				else if (c > 0) std::swap(a[i], a[--gt]);
+				else ++i;
+			}
+
+			size_t nLess = lt;
+			size_t nEqual = gt - lt;
+			size_t nGreater = n - gt;
+
+			// All keys in the equal part end in this chunk: they are equal.
+			bool equalDone = chunk_length(pivot, depth) < chunk;
+			if (!equalDone)
+				for (size_t j = lt; j < gt; ++j) load_prefix(a[j], depth + chunk);
+
+			if (nEqual >= nLess && nEqual >= nGreater && !equalDone) {
+				sort(a, nLess, depth);
+				sort(a + gt, nGreater, depth);
+				a += lt;
+				n = nEqual;
+				depth += chunk;
+			} else if (nLess >= nGreater) {
+				if (!equalDone) sort(a + lt, nEqual, depth + chunk);
+				sort(a + gt, nGreater, depth);
+				n = nLess;
+			} else {
+				sort(a, nLess, depth);
+				if (!equalDone) sort(a + lt, nEqual, depth + chunk);
+				a += gt;
+				n = nGreater;
+			}
+		}
+		insertion_sort(a, n, depth);
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Rearrange items so that item i is the one at keys[i].index.
+///
+/// Runs in place by following the cycles of the permutation. The indices in
+/// keys are overwritten.
+///////////////////////////////////////////////////////////////////////////////
+template <typename T>
+void apply_permutation(T * items, key_ref * keys, size_t n) {
+	for (size_t i = 0; i < n; ++i) {
+		if (keys[i].index == i) continue;
+		T tmp(std::move(items[i]));
+		size_t j = i;
+		while (keys[j].index != i) {
+			size_t next = keys[j].index;
+			items[j] = std::move(items[next]);
+			keys[j].index = j;
+			j = next;
+		}
+		items[j] = std::move(tmp);
+		keys[j].index = j;
+	}
+}
+
+} // namespace string_sort_bits
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Sort the items in [first, last) by their string_key using multikey
+/// quicksort.
+///
+/// Rather than comparing whole keys, the sort inspects eight key bytes at a
+/// time and only looks further into the keys of items that share all bytes
+/// seen so far, so long common prefixes are scanned once per item instead of
+/// once per comparison.
+///
+/// \param keys  Scratch space for at least (last - first) key references.
+///////////////////////////////////////////////////////////////////////////////
+template <typename T>
+void string_sort(T * first, T * last, string_sort_bits::key_ref * keys) {
+	size_t n = static_cast<size_t>(last - first);
+	for (size_t i = 0; i < n; ++i) {
+		keys[i].key = reinterpret_cast<const unsigned char *>(string_key<T>::data(first[i]));
+		keys[i].length = string_key<T>::size(first[i]);
+		keys[i].index = i;
+	}
+	string_sort_bits::multikey_quicksort::sort(keys, n);
+	string_sort_bits::apply_permutation(first, keys, n);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Sort the items in [first, last) by their string_key using multikey
+/// quicksort, allocating the scratch space.
+///////////////////////////////////////////////////////////////////////////////
+template <typename T>
+void string_sort(T * first, T * last) {
+	array<string_sort_bits::key_ref> keys(static_cast<size_t>(last - first));
+	string_sort(first, last, keys.get());
+}
+
+} // namespace tpie
+
+#endif // TPIE_STRING_SORT_H